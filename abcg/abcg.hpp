@@ -16,8 +16,11 @@
 #include "abcgApplication.hpp"
 #include "abcgException.hpp"
 #include "abcgExternal.hpp"
+#include "abcgMeshCache.hpp"
+#include "abcgThreadPool.hpp"
 #include "abcgTrackball.hpp"
 #include "abcgUtil.hpp"
+#include "abcgVertexWelder.hpp"
 #include "abcgWindow.hpp"
 
 #endif
\ No newline at end of file
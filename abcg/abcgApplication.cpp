@@ -12,7 +12,10 @@
 
 #include <SDL_image.h>
 
+#include <charconv>
+#include <cstdlib>
 #include <span>
+#include <string_view>
 
 #include "abcgException.hpp"
 #include "abcgWindow.hpp"
@@ -27,6 +30,30 @@
 
 #include "tiny_obj_loader.h"
 
+#if !defined(__EMSCRIPTEN__)
+namespace {
+// Overrides the headless settings of the window with the environment
+// variables ABCG_HEADLESS and ABCG_FRAME_COUNT
+void applyEnvironmentSettings(abcg::Window &window) {
+  auto settings{window.getWindowSettings()};
+
+  // NOLINTNEXTLINE(concurrency-mt-unsafe)
+  if (auto const *headless{std::getenv("ABCG_HEADLESS")}) {
+    settings.headless = std::string_view{headless} != "0";
+  }
+
+  // NOLINTNEXTLINE(concurrency-mt-unsafe)
+  if (auto const *frameCount{std::getenv("ABCG_FRAME_COUNT")}) {
+    std::string_view const value{frameCount};
+    std::from_chars(value.data(), value.data() + value.size(),
+                    settings.frameCount);
+  }
+
+  window.setWindowSettings(settings);
+}
+} // namespace
+#endif
+
 #if defined(__EMSCRIPTEN__)
 void abcg::mainLoopCallback(void *userData) {
   abcg::Application &app{*(static_cast<abcg::Application *>(userData))};
@@ -69,15 +96,33 @@ abcg::Application::Application([[maybe_unused]] int argc, char **argv) {
  * Initializes the SDL library and its subsystems, initializes the window and
  * runs the event loop.
  *
+ * If abcg::WindowSettings::headless is set, only the video subsystem is
+ * initialized, with the SDL offscreen video driver. If
+ * abcg::WindowSettings::frameCount is set, the loop ends after that number of
+ * frames.
+ *
  * @param window L-value reference to the window object.
  *
  * @throw abcg::SDLError if `SDL_Init` failed.
  * @throw abcg::SDLImageError if `IMG_Init` failed.
  */
 void abcg::Application::run(Window &window) {
-  if (Uint32 const subsystemMask{SDL_INIT_VIDEO | SDL_INIT_AUDIO |
-                                 SDL_INIT_GAMECONTROLLER};
-      SDL_Init(subsystemMask) != 0) {
+#if !defined(__EMSCRIPTEN__)
+  applyEnvironmentSettings(window);
+#endif
+  [[maybe_unused]] auto const &windowSettings{window.getWindowSettings()};
+
+  Uint32 subsystemMask{SDL_INIT_VIDEO | SDL_INIT_AUDIO |
+                       SDL_INIT_GAMECONTROLLER};
+#if !defined(__EMSCRIPTEN__)
+  if (windowSettings.headless) {
+    // The offscreen driver does not need a display. Its OpenGL contexts are
+    // created through EGL with pbuffer surfaces
+    SDL_SetHint(SDL_HINT_VIDEODRIVER, "offscreen");
+    subsystemMask = SDL_INIT_VIDEO;
+  }
+#endif
+  if (SDL_Init(subsystemMask) != 0) {
     throw abcg::SDLError("SDL_Init failed");
   }
 
@@ -97,8 +142,12 @@ void abcg::Application::run(Window &window) {
   emscripten_set_main_loop_arg(mainLoopCallback, this, 0, true);
 #else
   auto done{false};
+  auto frameCount{0};
   while (!done) {
     mainLoopIterator(done);
+    if (++frameCount == windowSettings.frameCount) {
+      done = true;
+    }
   }
 #endif
 
@@ -0,0 +1,83 @@
+/**
+ * @file abcgCPUFeatures.cpp
+ * @brief Definition of functions for detecting instruction set extensions.
+ *
+ * This file is part of ABCg (https://github.com/hbatagelo/abcg).
+ *
+ * @copyright (c) 2021--2023 Harlen Batagelo. All rights reserved.
+ * This project is released under the MIT License.
+ */
+
+#include "abcgCPUFeatures.hpp"
+
+#include <array>
+
+#if defined(ABCG_CPU_X86_64) && defined(_MSC_VER) && !defined(__clang__)
+#include <immintrin.h>
+#include <intrin.h>
+#endif
+
+namespace {
+#if defined(ABCG_CPU_X86_64)
+bool detectSSSE3() {
+#if defined(_MSC_VER) && !defined(__clang__)
+  std::array<int, 4> info{};
+  __cpuid(info.data(), 1);
+  return (info[2] & (1 << 9)) != 0;
+#else
+  __builtin_cpu_init();
+  return __builtin_cpu_supports("ssse3") != 0;
+#endif
+}
+
+bool detectAVX2() {
+#if defined(_MSC_VER) && !defined(__clang__)
+  std::array<int, 4> info{};
+  __cpuid(info.data(), 0);
+  if (info[0] < 7) {
+    return false;
+  }
+  __cpuid(info.data(), 1);
+  // OSXSAVE and AVX, and the OS saves the YMM registers
+  auto const osSupportsAVX{(info[2] & (1 << 27)) != 0 &&
+                           (info[2] & (1 << 28)) != 0 &&
+                           (_xgetbv(0) & 0x6) == 0x6};
+  __cpuidex(info.data(), 7, 0);
+  return osSupportsAVX && (info[1] & (1 << 5)) != 0;
+#else
+  __builtin_cpu_init();
+  return __builtin_cpu_supports("avx2") != 0;
+#endif
+}
+#else
+bool detectSSSE3() { return false; }
+bool detectAVX2() { return false; }
+#endif
+} // namespace
+
+/**
+ * @brief Returns whether the CPU supports SSSE3.
+ *
+ * The result is detected on the first call.
+ *
+ * @return `true` if SSSE3 instructions can be executed; `false` otherwise or
+ * if the target is not x86-64.
+ */
+bool abcg::cpuSupportsSSSE3() noexcept {
+  static bool const supported{detectSSSE3()};
+  return supported;
+}
+
+/**
+ * @brief Returns whether the CPU supports AVX2 and the operating system saves
+ * the AVX registers.
+ *
+ * The result is detected on the first call.
+ *
+ * @return `true` if AVX2 instructions can be executed; `false` otherwise or if
+ * the target is not x86-64.
+ */
+bool abcg::cpuSupportsAVX2() noexcept {
+  static bool const supported{detectAVX2()};
+  return supported;
+}
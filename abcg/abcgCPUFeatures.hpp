@@ -0,0 +1,40 @@
+/**
+ * @file abcgCPUFeatures.hpp
+ * @brief Declaration of functions for detecting instruction set extensions.
+ *
+ * SSE2 is part of the x86-64 baseline and can be used unconditionally. Code
+ * that uses newer extensions must be compiled for them only, by marking the
+ * functions with @ref ABCG_TARGET_SSSE3 or @ref ABCG_TARGET_AVX2, and must be
+ * called only if abcg::cpuSupportsSSSE3 or abcg::cpuSupportsAVX2 returns
+ * `true`. This keeps the executables runnable on any x86-64 CPU.
+ *
+ * This file is part of ABCg (https://github.com/hbatagelo/abcg).
+ *
+ * @copyright (c) 2021--2023 Harlen Batagelo. All rights reserved.
+ * This project is released under the MIT License.
+ */
+
+#ifndef ABCG_CPU_FEATURES_HPP_
+#define ABCG_CPU_FEATURES_HPP_
+
+#if defined(__x86_64__) || defined(_M_X64)
+/** @brief Defined when compiling for x86-64. */
+#define ABCG_CPU_X86_64
+#if defined(_MSC_VER) && !defined(__clang__)
+// MSVC compiles any intrinsic regardless of the target architecture
+#define ABCG_TARGET_SSSE3
+#define ABCG_TARGET_AVX2
+#else
+/** @brief Compiles a function for the SSSE3 target. */
+#define ABCG_TARGET_SSSE3 __attribute__((target("ssse3")))
+/** @brief Compiles a function for the AVX2 target. */
+#define ABCG_TARGET_AVX2 __attribute__((target("avx2")))
+#endif
+#endif
+
+namespace abcg {
+[[nodiscard]] bool cpuSupportsSSSE3() noexcept;
+[[nodiscard]] bool cpuSupportsAVX2() noexcept;
+} // namespace abcg
+
+#endif
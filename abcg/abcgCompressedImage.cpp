@@ -0,0 +1,526 @@
+/**
+ * @file abcgCompressedImage.cpp
+ * @brief Definition of abcg::CompressedImage members.
+ *
+ * This file is part of ABCg (https://github.com/hbatagelo/abcg).
+ *
+ * @copyright (c) 2021--2023 Harlen Batagelo. All rights reserved.
+ * This project is released under the MIT License.
+ */
+
+#include "abcgCompressedImage.hpp"
+
+#include <cppitertools/itertools.hpp>
+#include <fmt/core.h>
+
+#include <algorithm>
+#include <array>
+#include <cctype>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <optional>
+
+#include "abcgException.hpp"
+
+namespace {
+
+// Both containers store multi-byte values in little-endian order, which is
+// also the byte order of all supported platforms
+
+constexpr std::array<unsigned char, 12> ktx2Identifier{
+    0xAB, 'K', 'T', 'X', ' ', '2', '0', 0xBB, '\r', '\n', 0x1A, '\n'};
+constexpr std::size_t ktx2HeaderSize{80};
+constexpr std::size_t ktx2LevelIndexEntrySize{24};
+
+// VkFormat values used in KTX2 files
+enum KTX2Format : std::uint32_t {
+  BC1RGBUnorm = 131,
+  BC1RGBSRGB = 132,
+  BC1RGBAUnorm = 133,
+  BC1RGBASRGB = 134,
+  BC3Unorm = 137,
+  BC3SRGB = 138,
+  BC5Unorm = 141,
+  BC7Unorm = 145,
+  BC7SRGB = 146
+};
+
+constexpr std::uint32_t ddsMagic{0x20534444}; // "DDS "
+constexpr std::size_t ddsHeaderSize{128};     // Includes the magic number
+constexpr std::size_t ddsDX10HeaderSize{20};
+constexpr std::uint32_t ddsMipMapCountFlag{0x20000};
+constexpr std::uint32_t ddsFourCCFlag{0x4};
+constexpr std::uint32_t ddsCubemapFlag{0x200};
+constexpr std::uint32_t ddsVolumeFlag{0x200000};
+
+// DXGI_FORMAT values used in the DX10 header of DDS files
+enum DXGIFormat : std::uint32_t {
+  BC1Unorm = 71,
+  BC1UnormSRGB = 72,
+  BC3UnormDXGI = 77,
+  BC3UnormSRGB = 78,
+  BC5UnormDXGI = 83,
+  BC7UnormDXGI = 98,
+  BC7UnormSRGB = 99
+};
+
+constexpr std::uint32_t makeFourCC(char a, char b, char c, char d) {
+  return static_cast<std::uint32_t>(a) | static_cast<std::uint32_t>(b) << 8 |
+         static_cast<std::uint32_t>(c) << 16 |
+         static_cast<std::uint32_t>(d) << 24;
+}
+
+// Reads a value from an offset that is known to be in bounds
+template <typename T>
+T readValue(std::span<std::byte const> data, std::size_t offset) {
+  T value{};
+  std::memcpy(&value, data.subspan(offset, sizeof(T)).data(), sizeof(T));
+  return value;
+}
+
+struct FormatInfo {
+  abcg::CompressedFormat format{};
+  bool sRGB{};
+};
+
+std::optional<FormatInfo> getKTX2FormatInfo(std::uint32_t vkFormat) {
+  using abcg::CompressedFormat;
+  switch (vkFormat) {
+  case BC1RGBUnorm:
+  case BC1RGBAUnorm:
+    return FormatInfo{CompressedFormat::BC1, false};
+  case BC1RGBSRGB:
+  case BC1RGBASRGB:
+    return FormatInfo{CompressedFormat::BC1, true};
+  case BC3Unorm:
+    return FormatInfo{CompressedFormat::BC3, false};
+  case BC3SRGB:
+    return FormatInfo{CompressedFormat::BC3, true};
+  case BC5Unorm:
+    return FormatInfo{CompressedFormat::BC5, false};
+  case BC7Unorm:
+    return FormatInfo{CompressedFormat::BC7, false};
+  case BC7SRGB:
+    return FormatInfo{CompressedFormat::BC7, true};
+  default:
+    return std::nullopt;
+  }
+}
+
+std::optional<FormatInfo> getDXGIFormatInfo(std::uint32_t dxgiFormat) {
+  using abcg::CompressedFormat;
+  switch (dxgiFormat) {
+  case BC1Unorm:
+    return FormatInfo{CompressedFormat::BC1, false};
+  case BC1UnormSRGB:
+    return FormatInfo{CompressedFormat::BC1, true};
+  case BC3UnormDXGI:
+    return FormatInfo{CompressedFormat::BC3, false};
+  case BC3UnormSRGB:
+    return FormatInfo{CompressedFormat::BC3, true};
+  case BC5UnormDXGI:
+    return FormatInfo{CompressedFormat::BC5, false};
+  case BC7UnormDXGI:
+    return FormatInfo{CompressedFormat::BC7, false};
+  case BC7UnormSRGB:
+    return FormatInfo{CompressedFormat::BC7, true};
+  default:
+    return std::nullopt;
+  }
+}
+
+std::optional<FormatInfo> getFourCCFormatInfo(std::uint32_t fourCC) {
+  using abcg::CompressedFormat;
+  if (fourCC == makeFourCC('D', 'X', 'T', '1')) {
+    return FormatInfo{CompressedFormat::BC1, false};
+  }
+  if (fourCC == makeFourCC('D', 'X', 'T', '5')) {
+    return FormatInfo{CompressedFormat::BC3, false};
+  }
+  if (fourCC == makeFourCC('A', 'T', 'I', '2') ||
+      fourCC == makeFourCC('B', 'C', '5', 'U')) {
+    return FormatInfo{CompressedFormat::BC5, false};
+  }
+  return std::nullopt;
+}
+
+std::uint32_t getKTX2Format(abcg::CompressedFormat format, bool sRGB) {
+  switch (format) {
+  case abcg::CompressedFormat::BC1:
+    return sRGB ? BC1RGBASRGB : BC1RGBAUnorm;
+  case abcg::CompressedFormat::BC3:
+    return sRGB ? BC3SRGB : BC3Unorm;
+  case abcg::CompressedFormat::BC5:
+    return BC5Unorm;
+  case abcg::CompressedFormat::BC7:
+    return sRGB ? BC7SRGB : BC7Unorm;
+  }
+  return 0;
+}
+
+// Builds the Khronos Data Format Descriptor of a BCn format, as required by
+// the KTX2 specification
+std::vector<std::uint32_t>
+makeDataFormatDescriptor(abcg::CompressedFormat format, bool sRGB) {
+  // Color models and channel IDs of the Khronos Data Format Specification
+  constexpr std::uint32_t modelBC1A{128};
+  constexpr std::uint32_t modelBC3{130};
+  constexpr std::uint32_t modelBC5{132};
+  constexpr std::uint32_t modelBC7{134};
+  constexpr std::uint32_t channelColor{0};
+  constexpr std::uint32_t channelAlphaPresent{1};
+  constexpr std::uint32_t channelRed{0};
+  constexpr std::uint32_t channelGreen{1};
+  constexpr std::uint32_t channelAlpha{15};
+  constexpr std::uint32_t qualifierLinear{0x10};
+  constexpr std::uint32_t primariesBT709{1};
+  constexpr std::uint32_t transferLinear{1};
+  constexpr std::uint32_t transferSRGB{2};
+
+  struct Sample {
+    std::uint32_t bitOffset{};
+    std::uint32_t bitLength{};
+    std::uint32_t channelType{};
+  };
+
+  std::uint32_t model{};
+  std::vector<Sample> samples;
+  switch (format) {
+  case abcg::CompressedFormat::BC1:
+    model = modelBC1A;
+    samples = {{0, 64, channelAlphaPresent}};
+    break;
+  case abcg::CompressedFormat::BC3:
+    model = modelBC3;
+    // Alpha is never sRGB-encoded
+    samples = {{0, 64, channelAlpha | (sRGB ? qualifierLinear : 0)},
+               {64, 64, channelColor}};
+    break;
+  case abcg::CompressedFormat::BC5:
+    model = modelBC5;
+    samples = {{0, 64, channelRed}, {64, 64, channelGreen}};
+    break;
+  case abcg::CompressedFormat::BC7:
+    model = modelBC7;
+    samples = {{0, 128, channelColor}};
+    break;
+  }
+
+  auto const blockSize{abcg::CompressedImage::getBlockSize(format)};
+  auto const descriptorBlockSize{
+      static_cast<std::uint32_t>(24 + 16 * samples.size())};
+
+  std::vector<std::uint32_t> dfd;
+  dfd.push_back(4 + descriptorBlockSize); // dfdTotalSize
+  dfd.push_back(0);                       // vendorId, descriptorType
+  dfd.push_back(2 | descriptorBlockSize << 16); // versionNumber
+  dfd.push_back(model | primariesBT709 << 8 |
+                (sRGB ? transferSRGB : transferLinear) << 16);
+  dfd.push_back(3 | 3 << 8); // 4x4 texel blocks
+  dfd.push_back(static_cast<std::uint32_t>(blockSize)); // bytesPlane0
+  dfd.push_back(0);                                     // bytesPlane4..7
+  for (auto const &sample : samples) {
+    dfd.push_back(sample.bitOffset | (sample.bitLength - 1) << 16 |
+                  sample.channelType << 24);
+    dfd.push_back(0);          // samplePosition
+    dfd.push_back(0);          // sampleLower
+    dfd.push_back(0xFFFFFFFF); // sampleUpper
+  }
+  return dfd;
+}
+
+} // namespace
+
+/**
+ * @brief Constructs a compressed image and calls abcg::CompressedImage::load.
+ *
+ * @param path Path to the KTX2 or DDS file.
+ */
+abcg::CompressedImage::CompressedImage(std::string_view path) { load(path); }
+
+/**
+ * @brief Maps a KTX2 or DDS file and parses its mipmap levels.
+ *
+ * The container is detected from the contents of the file, not from its
+ * extension.
+ *
+ * @param path Path to the KTX2 or DDS file.
+ *
+ * @throw abcg::RuntimeError if the file cannot be opened, is not a valid
+ * KTX2/DDS file, or uses a format or layout that is not supported.
+ */
+void abcg::CompressedImage::load(std::string_view path) {
+  m_levels.clear();
+  if (!m_file.open(path)) {
+    throw abcg::RuntimeError(
+        fmt::format("Failed to open compressed image file {}", path));
+  }
+
+  auto const data{m_file.getData()};
+  if (data.size() >= ktx2Identifier.size() &&
+      std::memcmp(data.data(), ktx2Identifier.data(),
+                  ktx2Identifier.size()) == 0) {
+    parseKTX2(path);
+  } else if (data.size() >= sizeof(ddsMagic) &&
+             readValue<std::uint32_t>(data, 0) == ddsMagic) {
+    parseDDS(path);
+  } else {
+    throw abcg::RuntimeError(
+        fmt::format("{} is not a KTX2 or DDS file", path));
+  }
+}
+
+void abcg::CompressedImage::parseKTX2(std::string_view path) {
+  auto const data{m_file.getData()};
+  if (data.size() < ktx2HeaderSize) {
+    throw abcg::RuntimeError(fmt::format("Truncated KTX2 file {}", path));
+  }
+
+  auto const vkFormat{readValue<std::uint32_t>(data, 12)};
+  auto const width{readValue<std::uint32_t>(data, 20)};
+  auto const height{readValue<std::uint32_t>(data, 24)};
+  auto const depth{readValue<std::uint32_t>(data, 28)};
+  auto const layerCount{readValue<std::uint32_t>(data, 32)};
+  auto const faceCount{readValue<std::uint32_t>(data, 36)};
+  // Zero means that the mipmap levels should be generated by the loader
+  auto const levelCount{std::max(readValue<std::uint32_t>(data, 40), 1U)};
+  auto const supercompressionScheme{readValue<std::uint32_t>(data, 44)};
+
+  auto const formatInfo{getKTX2FormatInfo(vkFormat)};
+  if (!formatInfo) {
+    throw abcg::RuntimeError(fmt::format(
+        "Unsupported format (VkFormat {}) in KTX2 file {}", vkFormat, path));
+  }
+  if (supercompressionScheme != 0) {
+    throw abcg::RuntimeError(
+        fmt::format("Supercompressed KTX2 file {} is not supported", path));
+  }
+  if (width == 0 || height == 0 || depth > 1 || layerCount > 1 ||
+      faceCount != 1) {
+    throw abcg::RuntimeError(
+        fmt::format("KTX2 file {} is not a single 2D image", path));
+  }
+  if (levelCount > 32 ||
+      data.size() < ktx2HeaderSize + levelCount * ktx2LevelIndexEntrySize) {
+    throw abcg::RuntimeError(fmt::format("Truncated KTX2 file {}", path));
+  }
+
+  m_format = formatInfo->format;
+  m_sRGB = formatInfo->sRGB;
+
+  for (auto const level : iter::range(levelCount)) {
+    auto const entry{ktx2HeaderSize + level * ktx2LevelIndexEntrySize};
+    auto const byteOffset{readValue<std::uint64_t>(data, entry)};
+    auto const byteLength{readValue<std::uint64_t>(data, entry + 8)};
+    addLevel(path, std::max(width >> level, 1U), std::max(height >> level, 1U),
+             byteOffset, byteLength);
+  }
+}
+
+void abcg::CompressedImage::parseDDS(std::string_view path) {
+  auto const data{m_file.getData()};
+  if (data.size() < ddsHeaderSize) {
+    throw abcg::RuntimeError(fmt::format("Truncated DDS file {}", path));
+  }
+
+  auto const flags{readValue<std::uint32_t>(data, 8)};
+  auto const height{readValue<std::uint32_t>(data, 12)};
+  auto const width{readValue<std::uint32_t>(data, 16)};
+  auto const mipMapCount{readValue<std::uint32_t>(data, 28)};
+  auto const pixelFormatFlags{readValue<std::uint32_t>(data, 80)};
+  auto const fourCC{readValue<std::uint32_t>(data, 84)};
+  auto const caps2{readValue<std::uint32_t>(data, 112)};
+
+  if ((pixelFormatFlags & ddsFourCCFlag) == 0) {
+    throw abcg::RuntimeError(
+        fmt::format("Uncompressed DDS file {} is not supported", path));
+  }
+
+  auto offset{ddsHeaderSize};
+  std::optional<FormatInfo> formatInfo;
+  if (fourCC == makeFourCC('D', 'X', '1', '0')) {
+    if (data.size() < ddsHeaderSize + ddsDX10HeaderSize) {
+      throw abcg::RuntimeError(fmt::format("Truncated DDS file {}", path));
+    }
+    auto const dxgiFormat{readValue<std::uint32_t>(data, offset)};
+    auto const resourceDimension{readValue<std::uint32_t>(data, offset + 4)};
+    auto const miscFlag{readValue<std::uint32_t>(data, offset + 8)};
+    auto const arraySize{readValue<std::uint32_t>(data, offset + 12)};
+
+    constexpr std::uint32_t texture2D{3};
+    constexpr std::uint32_t textureCube{0x4};
+    if (resourceDimension != texture2D || (miscFlag & textureCube) != 0 ||
+        arraySize > 1) {
+      throw abcg::RuntimeError(
+          fmt::format("DDS file {} is not a single 2D image", path));
+    }
+
+    formatInfo = getDXGIFormatInfo(dxgiFormat);
+    offset += ddsDX10HeaderSize;
+  } else {
+    formatInfo = getFourCCFormatInfo(fourCC);
+  }
+
+  if (!formatInfo) {
+    throw abcg::RuntimeError(
+        fmt::format("Unsupported format in DDS file {}", path));
+  }
+  if (width == 0 || height == 0 ||
+      (caps2 & (ddsCubemapFlag | ddsVolumeFlag)) != 0) {
+    throw abcg::RuntimeError(
+        fmt::format("DDS file {} is not a single 2D image", path));
+  }
+
+  m_format = formatInfo->format;
+  m_sRGB = formatInfo->sRGB;
+
+  // Levels are stored contiguously, from the base level to the smallest one
+  auto const levelCount{(flags & ddsMipMapCountFlag) != 0
+                            ? std::clamp(mipMapCount, 1U, 32U)
+                            : 1U};
+  for (auto const level : iter::range(levelCount)) {
+    auto const levelWidth{std::max(width >> level, 1U)};
+    auto const levelHeight{std::max(height >> level, 1U)};
+    auto const size{getLevelSize(m_format, levelWidth, levelHeight)};
+    addLevel(path, levelWidth, levelHeight, offset, size);
+    offset += size;
+  }
+}
+
+// Appends a level after checking that its data fits in the file
+void abcg::CompressedImage::addLevel(std::string_view path,
+                                     std::uint32_t width, std::uint32_t height,
+                                     std::size_t offset, std::size_t size) {
+  auto const data{m_file.getData()};
+  if (size != getLevelSize(m_format, width, height) || offset > data.size() ||
+      size > data.size() - offset) {
+    throw abcg::RuntimeError(fmt::format(
+        "Invalid mipmap level {} in file {}", m_levels.size(), path));
+  }
+  m_levels.push_back(
+      {.width = width, .height = height, .data = data.subspan(offset, size)});
+}
+
+/**
+ * @brief Writes block-compressed mipmap levels to a KTX2 file.
+ *
+ * The levels are stored without supercompression, in the layout read by
+ * abcg::CompressedImage::load.
+ *
+ * @param path Path to the KTX2 file to be written.
+ * @param format Format of the compressed blocks.
+ * @param sRGB Whether the color channels are encoded in sRGB space.
+ * @param levels Mipmap levels, starting from the base level. The size of
+ * each level must be half the size of the previous one, rounded down.
+ *
+ * @throw abcg::RuntimeError if the levels are inconsistent or the file cannot
+ * be written.
+ */
+void abcg::CompressedImage::saveKTX2(
+    std::string_view path, CompressedFormat format, bool sRGB,
+    std::span<CompressedImageLevel const> levels) {
+  if (levels.empty()) {
+    throw abcg::RuntimeError("No mipmap levels to write");
+  }
+  for (auto &&[index, level] : iter::enumerate(levels)) {
+    auto const expectedWidth{std::max(levels.front().width >> index, 1U)};
+    auto const expectedHeight{std::max(levels.front().height >> index, 1U)};
+    if (level.width != expectedWidth || level.height != expectedHeight ||
+        level.data.size() != getLevelSize(format, level.width, level.height)) {
+      throw abcg::RuntimeError(fmt::format("Invalid mipmap level {}", index));
+    }
+  }
+
+  auto const dfd{makeDataFormatDescriptor(format, sRGB)};
+  auto const levelCount{static_cast<std::uint32_t>(levels.size())};
+  auto const dfdOffset{static_cast<std::uint32_t>(
+      ktx2HeaderSize + levels.size() * ktx2LevelIndexEntrySize)};
+  auto const dfdSize{static_cast<std::uint32_t>(dfd.size() * sizeof(dfd[0]))};
+
+  // Levels are stored from the smallest to the base level, each one aligned
+  // to the size of a block
+  auto const alignment{getBlockSize(format)};
+  std::vector<std::uint64_t> levelOffsets(levels.size());
+  std::uint64_t offset{dfdOffset + dfdSize};
+  for (auto index{levels.size()}; index-- > 0;) {
+    offset = (offset + alignment - 1) / alignment * alignment;
+    levelOffsets[index] = offset;
+    offset += levels[index].data.size();
+  }
+
+  std::vector<std::byte> file(offset);
+  auto const writeValue{[&file](std::size_t at, auto value) {
+    std::memcpy(file.data() + at, &value, sizeof(value));
+  }};
+
+  std::memcpy(file.data(), ktx2Identifier.data(), ktx2Identifier.size());
+  writeValue(12, getKTX2Format(format, sRGB));
+  writeValue(16, std::uint32_t{1}); // typeSize
+  writeValue(20, levels.front().width);
+  writeValue(24, levels.front().height);
+  writeValue(36, std::uint32_t{1}); // faceCount
+  writeValue(40, levelCount);
+  writeValue(48, dfdOffset);
+  writeValue(52, dfdSize);
+  for (auto &&[index, level] : iter::enumerate(levels)) {
+    auto const entry{ktx2HeaderSize + index * ktx2LevelIndexEntrySize};
+    std::uint64_t const size{level.data.size()};
+    writeValue(entry, levelOffsets[index]);
+    writeValue(entry + 8, size);
+    writeValue(entry + 16, size); // uncompressedByteLength
+    std::memcpy(file.data() + levelOffsets[index], level.data.data(),
+                level.data.size());
+  }
+  std::memcpy(file.data() + dfdOffset, dfd.data(), dfdSize);
+
+  std::ofstream stream{std::string{path}, std::ios::binary | std::ios::trunc};
+  stream.write(reinterpret_cast<char const *>(file.data()),
+               static_cast<std::streamsize>(file.size()));
+  if (!stream) {
+    throw abcg::RuntimeError(fmt::format("Failed to write file {}", path));
+  }
+}
+
+/**
+ * @brief Returns whether a path has the extension of a container supported by
+ * abcg::CompressedImage.
+ *
+ * @param path Path to an image file.
+ *
+ * @return True if the extension is `.ktx2` or `.dds` (case-insensitive).
+ */
+bool abcg::CompressedImage::isCompressedImagePath(std::string_view path) {
+  auto extension{std::filesystem::path{path}.extension().string()};
+  std::ranges::transform(extension, extension.begin(), [](unsigned char c) {
+    return static_cast<char>(std::tolower(c));
+  });
+  return extension == ".ktx2" || extension == ".dds";
+}
+
+/**
+ * @brief Returns the size of a 4x4 block of a compressed format.
+ *
+ * @param format Block-compressed format.
+ *
+ * @return Size in bytes (8 for BC1; 16 for the other formats).
+ */
+std::size_t abcg::CompressedImage::getBlockSize(CompressedFormat format) {
+  return format == CompressedFormat::BC1 ? 8 : 16;
+}
+
+/**
+ * @brief Returns the size of a compressed image.
+ *
+ * @param format Block-compressed format.
+ * @param width Width of the image, in texels.
+ * @param height Height of the image, in texels.
+ *
+ * @return Size in bytes of the blocks that cover the image.
+ */
+std::size_t abcg::CompressedImage::getLevelSize(CompressedFormat format,
+                                                std::uint32_t width,
+                                                std::uint32_t height) {
+  return std::size_t{(width + 3) / 4} * std::size_t{(height + 3) / 4} *
+         getBlockSize(format);
+}
@@ -0,0 +1,151 @@
+/**
+ * @file abcgCompressedImage.hpp
+ * @brief Header file of abcg::CompressedImage.
+ *
+ * Declaration of abcg::CompressedImage class and related structures.
+ *
+ * This file is part of ABCg (https://github.com/hbatagelo/abcg).
+ *
+ * @copyright (c) 2021--2023 Harlen Batagelo. All rights reserved.
+ * This project is released under the MIT License.
+ */
+
+#ifndef ABCG_COMPRESSED_IMAGE_HPP_
+#define ABCG_COMPRESSED_IMAGE_HPP_
+
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <string_view>
+#include <vector>
+
+#include "abcgMappedFile.hpp"
+
+namespace abcg {
+enum class CompressedFormat;
+struct CompressedImageLevel;
+class CompressedImage;
+} // namespace abcg
+
+/**
+ * @brief Block-compressed (BCn) pixel formats supported by
+ * abcg::CompressedImage.
+ *
+ * All formats encode blocks of 4x4 texels.
+ */
+enum class abcg::CompressedFormat {
+  /** @brief BC1 (DXT1): RGB with 1-bit alpha, 8 bytes per block. */
+  BC1,
+  /** @brief BC3 (DXT5): RGBA, 16 bytes per block. */
+  BC3,
+  /** @brief BC5 (RGTC2): two unsigned channels (RG), 16 bytes per block. */
+  BC5,
+  /** @brief BC7 (BPTC): RGBA, 16 bytes per block. */
+  BC7
+};
+
+/**
+ * @brief Mipmap level of an abcg::CompressedImage.
+ */
+struct abcg::CompressedImageLevel {
+  /** @brief Width of the level, in texels. */
+  std::uint32_t width{};
+  /** @brief Height of the level, in texels. */
+  std::uint32_t height{};
+  /** @brief Compressed blocks of the level, in row-major order. */
+  std::span<std::byte const> data{};
+};
+
+/**
+ * @brief Read-only view of a 2D block-compressed image stored in a KTX2 or DDS
+ * container.
+ *
+ * The file is memory-mapped, so that the compressed mipmap levels can be
+ * uploaded to the GPU without being decoded or copied, e.g., with
+ * glCompressedTexImage2D or vk::CommandBuffer::copyBufferToImage.
+ *
+ * Only uncompressed containers (i.e., without supercompression) of a single
+ * 2D image (no arrays, cube maps or 3D images) in one of the formats of
+ * abcg::CompressedFormat are supported. Such files can be created from PNG or
+ * JPEG images with the `texconv` tool (see `tools/texconv`).
+ *
+ * @remark Levels are stored top row first, as in the source image. Because
+ * compressed blocks cannot be flipped on upload, images meant to be loaded
+ * upside down (e.g., with abcg::OpenGLTextureCreateInfo::flipUpsideDown)
+ * should be flipped when converted.
+ */
+class abcg::CompressedImage {
+public:
+  CompressedImage() = default;
+  explicit CompressedImage(std::string_view path);
+
+  void load(std::string_view path);
+
+  static void saveKTX2(std::string_view path, CompressedFormat format,
+                       bool sRGB, std::span<CompressedImageLevel const> levels);
+
+  [[nodiscard]] static bool isCompressedImagePath(std::string_view path);
+  [[nodiscard]] static std::size_t getBlockSize(CompressedFormat format);
+  [[nodiscard]] static std::size_t
+  getLevelSize(CompressedFormat format, std::uint32_t width,
+               std::uint32_t height);
+
+  /**
+   * @brief Returns the pixel format of the image.
+   *
+   * @return Block-compressed format.
+   */
+  [[nodiscard]] CompressedFormat getFormat() const noexcept { return m_format; }
+
+  /**
+   * @brief Returns whether the color channels are encoded in sRGB space.
+   *
+   * abcg::loadOpenGLTexture and abcg::VulkanImage::create ignore this tag and
+   * sample the image in the same color space as an uncompressed image.
+   *
+   * @return True if the image is tagged as sRGB; false if it is linear.
+   */
+  [[nodiscard]] bool isSRGB() const noexcept { return m_sRGB; }
+
+  /**
+   * @brief Returns the width of the base level.
+   *
+   * @return Width in texels.
+   */
+  [[nodiscard]] std::uint32_t getWidth() const noexcept {
+    return m_levels.empty() ? 0 : m_levels.front().width;
+  }
+
+  /**
+   * @brief Returns the height of the base level.
+   *
+   * @return Height in texels.
+   */
+  [[nodiscard]] std::uint32_t getHeight() const noexcept {
+    return m_levels.empty() ? 0 : m_levels.front().height;
+  }
+
+  /**
+   * @brief Returns the mipmap levels, starting from the base level.
+   *
+   * @return Span of levels. The data of each level points into the mapped
+   * file and is valid while the image is alive.
+   */
+  [[nodiscard]] std::span<CompressedImageLevel const>
+  getLevels() const noexcept {
+    return m_levels;
+  }
+
+private:
+  MappedFile m_file;
+  CompressedFormat m_format{};
+  bool m_sRGB{};
+  std::vector<CompressedImageLevel> m_levels;
+
+  void parseKTX2(std::string_view path);
+  void parseDDS(std::string_view path);
+  void addLevel(std::string_view path, std::uint32_t width,
+                std::uint32_t height, std::size_t offset, std::size_t size);
+};
+
+#endif
@@ -13,8 +13,286 @@
 #include <cppitertools/itertools.hpp>
 #include <gsl/gsl>
 
-#include <span>
-#include <vector>
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <cstring>
+
+#include "abcgCPUFeatures.hpp"
+
+#if defined(ABCG_CPU_X86_64)
+#define ABCG_IMAGE_X86
+#include <immintrin.h>
+#elif defined(__ARM_NEON)
+#define ABCG_IMAGE_NEON
+#include <arm_neon.h>
+#endif
+
+namespace {
+
+// Reverses the order of the pixels in [left, right) by swapping them from
+// both ends
+void reversePixelsScalar(std::byte *left, std::byte *right,
+                         std::size_t bytesPerPixel) {
+  auto const pixelSize{static_cast<std::ptrdiff_t>(bytesPerPixel)};
+  while (right - left >= 2 * pixelSize) {
+    right -= pixelSize;
+    std::swap_ranges(left, left + pixelSize, right);
+    left += pixelSize;
+  }
+}
+
+void expandRGBToRGBAScalar(std::byte const *source, std::byte *destination,
+                           std::size_t numPixels) {
+  for ([[maybe_unused]] auto const pixel : iter::range(numPixels)) {
+    std::memcpy(destination, source, 3);
+    destination[3] = std::byte{0xFF};
+    source += 3;
+    destination += 4;
+  }
+}
+
+#if defined(ABCG_IMAGE_X86)
+
+// Reverses 4 pixels per 16-byte register at each end of the row
+void reverseRGBA(std::byte *left, std::byte *right) {
+  while (right - left >= 32) {
+    right -= 16;
+    auto *const leftBlock{reinterpret_cast<__m128i *>(left)};
+    auto *const rightBlock{reinterpret_cast<__m128i *>(right)};
+    auto const leftPixels{_mm_loadu_si128(leftBlock)};
+    auto const rightPixels{_mm_loadu_si128(rightBlock)};
+    _mm_storeu_si128(leftBlock,
+                     _mm_shuffle_epi32(rightPixels, _MM_SHUFFLE(0, 1, 2, 3)));
+    _mm_storeu_si128(rightBlock,
+                     _mm_shuffle_epi32(leftPixels, _MM_SHUFFLE(0, 1, 2, 3)));
+    left += 16;
+  }
+  reversePixelsScalar(left, right, 4);
+}
+
+ABCG_TARGET_SSSE3 void store12(std::byte *destination, __m128i value) {
+  _mm_storel_epi64(reinterpret_cast<__m128i *>(destination), value);
+  auto const high{_mm_cvtsi128_si32(_mm_srli_si128(value, 8))};
+  std::memcpy(destination + 8, &high, 4);
+}
+
+// Reverses 4 pixels (12 bytes) at each end of the row per iteration. The
+// 16-byte loads also read 4 bytes of inner pixels, which are processed later.
+ABCG_TARGET_SSSE3 void reverseRGBSSSE3(std::byte *left, std::byte *right) {
+  auto const leftMask{
+      _mm_setr_epi8(9, 10, 11, 6, 7, 8, 3, 4, 5, 0, 1, 2, -1, -1, -1, -1)};
+  auto const rightMask{
+      _mm_setr_epi8(13, 14, 15, 10, 11, 12, 7, 8, 9, 4, 5, 6, -1, -1, -1, -1)};
+  while (right - left >= 24) {
+    auto const leftPixels{
+        _mm_loadu_si128(reinterpret_cast<__m128i const *>(left))};
+    auto const rightPixels{
+        _mm_loadu_si128(reinterpret_cast<__m128i const *>(right - 16))};
+    store12(left, _mm_shuffle_epi8(rightPixels, rightMask));
+    store12(right - 12, _mm_shuffle_epi8(leftPixels, leftMask));
+    left += 12;
+    right -= 12;
+  }
+  reversePixelsScalar(left, right, 3);
+}
+
+// Expands 4 pixels per iteration. Each load reads 16 bytes, so the loop stops
+// while at least 6 pixels remain.
+ABCG_TARGET_SSSE3 void expandRGBToRGBASSSE3(std::byte const *source,
+                                            std::byte *destination,
+                                            std::size_t numPixels) {
+  auto const mask{
+      _mm_setr_epi8(0, 1, 2, -1, 3, 4, 5, -1, 6, 7, 8, -1, 9, 10, 11, -1)};
+  auto const alpha{_mm_set1_epi32(static_cast<int>(0xFF000000U))};
+  std::size_t pixel{};
+  for (; pixel + 6 <= numPixels; pixel += 4) {
+    auto const pixels{_mm_loadu_si128(
+        reinterpret_cast<__m128i const *>(source + pixel * 3))};
+    _mm_storeu_si128(reinterpret_cast<__m128i *>(destination + pixel * 4),
+                     _mm_or_si128(_mm_shuffle_epi8(pixels, mask), alpha));
+  }
+  expandRGBToRGBAScalar(source + pixel * 3, destination + pixel * 4,
+                        numPixels - pixel);
+}
+
+void reverseRGB(std::byte *left, std::byte *right) {
+  if (abcg::cpuSupportsSSSE3()) {
+    reverseRGBSSSE3(left, right);
+  } else {
+    reversePixelsScalar(left, right, 3);
+  }
+}
+
+void expandRGBToRGBA(std::byte const *source, std::byte *destination,
+                     std::size_t numPixels) {
+  if (abcg::cpuSupportsSSSE3()) {
+    expandRGBToRGBASSSE3(source, destination, numPixels);
+  } else {
+    expandRGBToRGBAScalar(source, destination, numPixels);
+  }
+}
+
+#elif defined(ABCG_IMAGE_NEON)
+
+// Reverses 4 pixels per 16-byte register at each end of the row
+void reverseRGBA(std::byte *left, std::byte *right) {
+  auto const reverse{[](uint8x16_t pixels) {
+    auto const swapped{vrev64q_u32(vreinterpretq_u32_u8(pixels))};
+    return vreinterpretq_u8_u32(
+        vcombine_u32(vget_high_u32(swapped), vget_low_u32(swapped)));
+  }};
+  while (right - left >= 32) {
+    right -= 16;
+    auto *const leftBlock{reinterpret_cast<std::uint8_t *>(left)};
+    auto *const rightBlock{reinterpret_cast<std::uint8_t *>(right)};
+    auto const leftPixels{vld1q_u8(leftBlock)};
+    auto const rightPixels{vld1q_u8(rightBlock)};
+    vst1q_u8(leftBlock, reverse(rightPixels));
+    vst1q_u8(rightBlock, reverse(leftPixels));
+    left += 16;
+  }
+  reversePixelsScalar(left, right, 4);
+}
+
+// Reverses 8 pixels at each end of the row, deinterleaved into channels
+void reverseRGB(std::byte *left, std::byte *right) {
+  while (right - left >= 48) {
+    right -= 24;
+    auto *const leftBlock{reinterpret_cast<std::uint8_t *>(left)};
+    auto *const rightBlock{reinterpret_cast<std::uint8_t *>(right)};
+    auto leftPixels{vld3_u8(leftBlock)};
+    auto rightPixels{vld3_u8(rightBlock)};
+    for (auto const channel : iter::range(3)) {
+      leftPixels.val[channel] = vrev64_u8(leftPixels.val[channel]);
+      rightPixels.val[channel] = vrev64_u8(rightPixels.val[channel]);
+    }
+    vst3_u8(leftBlock, rightPixels);
+    vst3_u8(rightBlock, leftPixels);
+    left += 24;
+  }
+  reversePixelsScalar(left, right, 3);
+}
+
+void expandRGBToRGBA(std::byte const *source, std::byte *destination,
+                     std::size_t numPixels) {
+  std::size_t pixel{};
+  for (; pixel + 8 <= numPixels; pixel += 8) {
+    auto const pixels{
+        vld3_u8(reinterpret_cast<std::uint8_t const *>(source + pixel * 3))};
+    uint8x8x4_t const expanded{
+        {pixels.val[0], pixels.val[1], pixels.val[2], vdup_n_u8(0xFF)}};
+    vst4_u8(reinterpret_cast<std::uint8_t *>(destination + pixel * 4),
+            expanded);
+  }
+  expandRGBToRGBAScalar(source + pixel * 3, destination + pixel * 4,
+                        numPixels - pixel);
+}
+
+#else
+
+void reverseRGBA(std::byte *left, std::byte *right) {
+  reversePixelsScalar(left, right, 4);
+}
+
+void reverseRGB(std::byte *left, std::byte *right) {
+  reversePixelsScalar(left, right, 3);
+}
+
+void expandRGBToRGBA(std::byte const *source, std::byte *destination,
+                     std::size_t numPixels) {
+  expandRGBToRGBAScalar(source, destination, numPixels);
+}
+
+#endif
+
+void reverseRow(std::byte *row, std::size_t width, std::size_t bytesPerPixel) {
+  auto *const end{row + width * bytesPerPixel};
+  switch (bytesPerPixel) {
+  case 3:
+    reverseRGB(row, end);
+    break;
+  case 4:
+    reverseRGBA(row, end);
+    break;
+  default:
+    reversePixelsScalar(row, end, bytesPerPixel);
+    break;
+  }
+}
+
+// Swaps two rows through a small buffer on the stack
+void swapRows(std::byte *first, std::byte *second, std::size_t size) {
+  std::array<std::byte, 4096> buffer;
+  while (size > 0) {
+    auto const chunkSize{std::min(size, buffer.size())};
+    std::memcpy(buffer.data(), first, chunkSize);
+    std::memcpy(first, second, chunkSize);
+    std::memcpy(second, buffer.data(), chunkSize);
+    first += chunkSize;
+    second += chunkSize;
+    size -= chunkSize;
+  }
+}
+
+std::span<std::byte> getPixels(SDL_Surface const &surface) {
+  return {static_cast<std::byte *>(surface.pixels),
+          gsl::narrow<std::size_t>(surface.pitch) *
+              gsl::narrow<std::size_t>(surface.h)};
+}
+
+} // namespace
+
+/**
+ * @brief Flips an image horizontally.
+ *
+ * Reverses each row of the image, in place and without allocating memory. 3-
+ * and 4-byte pixels (e.g., RGB and RGBA) are reversed with SIMD byte shuffles
+ * when available.
+ *
+ * @param pixels Pixel data of the image.
+ * @param width Width of the image, in pixels.
+ * @param height Height of the image, in pixels.
+ * @param bytesPerPixel Size of each pixel, in bytes.
+ * @param pitch Distance between the start of consecutive rows, in bytes. If
+ * zero, rows are assumed to be tightly packed.
+ */
+void abcg::flipHorizontally(std::span<std::byte> pixels, std::size_t width,
+                            std::size_t height, std::size_t bytesPerPixel,
+                            std::size_t pitch) {
+  if (pitch == 0) {
+    pitch = width * bytesPerPixel;
+  }
+  for (auto const rowIndex : iter::range(height)) {
+    reverseRow(pixels.data() + rowIndex * pitch, width, bytesPerPixel);
+  }
+}
+
+/**
+ * @brief Flips an image vertically.
+ *
+ * Reverses each column of the image, in place and without allocating memory.
+ *
+ * @param pixels Pixel data of the image.
+ * @param width Width of the image, in pixels.
+ * @param height Height of the image, in pixels.
+ * @param bytesPerPixel Size of each pixel, in bytes.
+ * @param pitch Distance between the start of consecutive rows, in bytes. If
+ * zero, rows are assumed to be tightly packed.
+ */
+void abcg::flipVertically(std::span<std::byte> pixels, std::size_t width,
+                          std::size_t height, std::size_t bytesPerPixel,
+                          std::size_t pitch) {
+  auto const rowSize{width * bytesPerPixel};
+  if (pitch == 0) {
+    pitch = rowSize;
+  }
+  // If height is odd, won't swap the middle row
+  for (auto const rowIndex : iter::range(height / 2)) {
+    swapRows(pixels.data() + rowIndex * pitch,
+             pixels.data() + (height - rowIndex - 1) * pitch, rowSize);
+  }
+}
 
 /**
  * @brief Flips an image horizontally.
@@ -24,35 +302,11 @@
  * @param surface SDL surface of a RGB or RGBA image.
  */
 void abcg::flipHorizontally(SDL_Surface &surface) {
-  auto const bytesPerPixel{gsl::narrow<int>(surface.format->BytesPerPixel)};
-  auto const widthInBytes{gsl::narrow<std::size_t>(surface.w * bytesPerPixel)};
-  auto const height{gsl::narrow<std::size_t>(surface.h)};
-  std::span const pixels{static_cast<std::byte *>(surface.pixels),
-                         widthInBytes * height};
-
-  // Temporary row of pixels for the swap
-  std::vector<std::byte> pixelRow(gsl::narrow<std::size_t>(widthInBytes), {});
-
   SDL_LockSurface(&surface);
-
-  // For each row
-  for (auto const rowIndex : iter::range(height)) {
-    auto const rowStart{widthInBytes * rowIndex};
-    auto const rowEnd{rowStart + widthInBytes};
-    // For each pixel (RGB/RGA) of current row
-    auto srcBegin{pixels.begin() + gsl::narrow<long>(rowEnd)};
-    auto dstBegin{pixelRow.begin()};
-    for ([[maybe_unused]] auto const pixelIndex : iter::range(surface.w)) {
-      srcBegin -= bytesPerPixel;
-      std::copy(srcBegin, srcBegin + bytesPerPixel, dstBegin);
-      dstBegin += bytesPerPixel;
-    }
-    // std::ranges::copy(pixelRow, pixels.subspan(rowStart).begin());
-    std::copy(pixelRow.begin(),
-              pixelRow.begin() + gsl::narrow<long>(widthInBytes),
-              pixels.subspan(rowStart).begin());
-  }
-
+  flipHorizontally(getPixels(surface), gsl::narrow<std::size_t>(surface.w),
+                   gsl::narrow<std::size_t>(surface.h),
+                   surface.format->BytesPerPixel,
+                   gsl::narrow<std::size_t>(surface.pitch));
   SDL_UnlockSurface(&surface);
 }
 
@@ -64,39 +318,113 @@ void abcg::flipHorizontally(SDL_Surface &surface) {
  * @param surface SDL surface of a RGB or RGBA image.
  */
 void abcg::flipVertically(SDL_Surface &surface) {
-  auto const bytesPerPixel{gsl::narrow<int>(surface.format->BytesPerPixel)};
-  auto const widthInBytes{gsl::narrow<std::size_t>(surface.w * bytesPerPixel)};
+  SDL_LockSurface(&surface);
+  flipVertically(getPixels(surface), gsl::narrow<std::size_t>(surface.w),
+                 gsl::narrow<std::size_t>(surface.h),
+                 surface.format->BytesPerPixel,
+                 gsl::narrow<std::size_t>(surface.pitch));
+  SDL_UnlockSurface(&surface);
+}
+
+/**
+ * @brief Converts the pixels of a surface to another format, optionally
+ * flipping the image upside down in the same pass.
+ *
+ * Copies between surfaces of the same format, and conversions from
+ * `SDL_PIXELFORMAT_RGB24` to `SDL_PIXELFORMAT_RGBA32`, are done directly
+ * from the source rows to the destination rows. Other conversions (e.g., from
+ * indexed images, or from images with a color key) are done by SDL through a
+ * temporary surface.
+ *
+ * @param surface Source SDL surface.
+ * @param pixelFormat Destination pixel format (e.g., `SDL_PIXELFORMAT_RGB24`
+ * or `SDL_PIXELFORMAT_RGBA32`).
+ * @param pixels Destination buffer.
+ * @param pitch Distance between the start of consecutive rows of the
+ * destination, in bytes. If zero, rows are tightly packed.
+ * @param flipUpsideDown Whether to flip the image upside down.
+ *
+ * @return True if the pixels were converted; false if the conversion is not
+ * supported or the destination buffer is too small.
+ */
+bool abcg::convertPixels(SDL_Surface &surface, Uint32 pixelFormat,
+                         std::span<std::byte> pixels, std::size_t pitch,
+                         bool flipUpsideDown) {
+  auto const width{gsl::narrow<std::size_t>(surface.w)};
   auto const height{gsl::narrow<std::size_t>(surface.h)};
-  std::span const pixels{static_cast<std::byte *>(surface.pixels),
-                         gsl::narrow<std::size_t>(widthInBytes * height)};
+  auto const rowSize{width * SDL_BYTESPERPIXEL(pixelFormat)};
+  if (pitch == 0) {
+    pitch = rowSize;
+  }
+  if (height > 0 && pixels.size() < (height - 1) * pitch + rowSize) {
+    return false;
+  }
 
-  // Temporary row of pixels for the swap
-  std::vector<std::byte> pixelRow(widthInBytes, std::byte{});
+  auto const copyRows{[&](SDL_Surface &source, bool expandRGB) {
+    SDL_LockSurface(&source);
+    auto const *const sourcePixels{
+        static_cast<std::byte const *>(source.pixels)};
+    auto const sourcePitch{gsl::narrow<std::size_t>(source.pitch)};
+    for (auto const rowIndex : iter::range(height)) {
+      auto const *const sourceRow{sourcePixels + rowIndex * sourcePitch};
+      auto *const destinationRow{
+          pixels.data() +
+          (flipUpsideDown ? height - rowIndex - 1 : rowIndex) * pitch};
+      if (expandRGB) {
+        expandRGBToRGBA(sourceRow, destinationRow, width);
+      } else {
+        std::memcpy(destinationRow, sourceRow, rowSize);
+      }
+    }
+    SDL_UnlockSurface(&source);
+  }};
 
-  SDL_LockSurface(&surface);
+  auto const sourceFormat{surface.format->format};
+  auto const expandRGB{sourceFormat == SDL_PIXELFORMAT_RGB24 &&
+                       pixelFormat == SDL_PIXELFORMAT_RGBA32};
+  if ((sourceFormat == pixelFormat || expandRGB) &&
+      SDL_HasColorKey(&surface) == SDL_FALSE) {
+    copyRows(surface, expandRGB);
+    return true;
+  }
 
-  // If height is odd, won't swap the middle row
-  for (auto const halfHeight{height / 2};
-       auto const rowIndex : iter::range(halfHeight)) {
-    auto const rowStartFromTop{widthInBytes * rowIndex};
-    auto const rowStartFromBottom{widthInBytes * (height - rowIndex - 1)};
-
-    auto const &topSpan{pixels.subspan(rowStartFromTop)};
-    auto const &bottomSpan{pixels.subspan(rowStartFromBottom)};
-
-    // std::ranges::copy(topSpan.subspan(0, widthInBytes), pixelRow.begin());
-    // std::ranges::copy(bottomSpan.subspan(0, widthInBytes), topSpan.begin());
-    // std::ranges::copy(pixelRow, bottomSpan.begin());
-    std::copy(topSpan.begin(),
-              topSpan.begin() + gsl::narrow<long>(widthInBytes),
-              pixelRow.begin());
-    std::copy(bottomSpan.begin(),
-              bottomSpan.begin() + gsl::narrow<long>(widthInBytes),
-              topSpan.begin());
-    std::copy(pixelRow.begin(),
-              pixelRow.begin() + gsl::narrow<long>(widthInBytes),
-              bottomSpan.begin());
+  SDL_Surface *const convertedSurface{
+      SDL_ConvertSurfaceFormat(&surface, pixelFormat, 0)};
+  if (convertedSurface == nullptr) {
+    return false;
   }
+  copyRows(*convertedSurface, false);
+  SDL_FreeSurface(convertedSurface);
+  return true;
+}
 
-  SDL_UnlockSurface(&surface);
-}
\ No newline at end of file
+/**
+ * @brief Creates a copy of a surface converted to another format, optionally
+ * flipping the image upside down in the same pass.
+ *
+ * This is the fused counterpart of `SDL_ConvertSurfaceFormat` followed by
+ * abcg::flipVertically. See abcg::convertPixels.
+ *
+ * @param surface Source SDL surface.
+ * @param pixelFormat Pixel format of the new surface.
+ * @param flipUpsideDown Whether to flip the image upside down.
+ *
+ * @return New surface, to be released with `SDL_FreeSurface`, or `nullptr` if
+ * the conversion failed.
+ */
+SDL_Surface *abcg::convertSurface(SDL_Surface &surface, Uint32 pixelFormat,
+                                  bool flipUpsideDown) {
+  SDL_Surface *const convertedSurface{SDL_CreateRGBSurfaceWithFormat(
+      0, surface.w, surface.h, SDL_BITSPERPIXEL(pixelFormat), pixelFormat)};
+  if (convertedSurface == nullptr) {
+    return nullptr;
+  }
+
+  if (!convertPixels(surface, pixelFormat, getPixels(*convertedSurface),
+                     gsl::narrow<std::size_t>(convertedSurface->pitch),
+                     flipUpsideDown)) {
+    SDL_FreeSurface(convertedSurface);
+    return nullptr;
+  }
+  return convertedSurface;
+}
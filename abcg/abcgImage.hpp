@@ -13,9 +13,26 @@
 
 #include <SDL_image.h>
 
+#include <cstddef>
+#include <span>
+
 namespace abcg {
+void flipHorizontally(std::span<std::byte> pixels, std::size_t width,
+                      std::size_t height, std::size_t bytesPerPixel,
+                      std::size_t pitch = 0);
+void flipVertically(std::span<std::byte> pixels, std::size_t width,
+                    std::size_t height, std::size_t bytesPerPixel,
+                    std::size_t pitch = 0);
 void flipHorizontally(SDL_Surface &surface);
 void flipVertically(SDL_Surface &surface);
+
+[[nodiscard]] bool convertPixels(SDL_Surface &surface, Uint32 pixelFormat,
+                                 std::span<std::byte> pixels,
+                                 std::size_t pitch = 0,
+                                 bool flipUpsideDown = false);
+[[nodiscard]] SDL_Surface *convertSurface(SDL_Surface &surface,
+                                          Uint32 pixelFormat,
+                                          bool flipUpsideDown = false);
 } // namespace abcg
 
 #endif
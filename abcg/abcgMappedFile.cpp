@@ -0,0 +1,170 @@
+/**
+ * @file abcgMappedFile.cpp
+ * @brief Definition of abcg::MappedFile members.
+ *
+ * This file is part of ABCg (https://github.com/hbatagelo/abcg).
+ *
+ * @copyright (c) 2021--2023 Harlen Batagelo. All rights reserved.
+ * This project is released under the MIT License.
+ */
+
+#include "abcgMappedFile.hpp"
+
+#include <fstream>
+#include <string>
+#include <utility>
+
+#if defined(WIN32)
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#include <windows.h>
+#elif !defined(__EMSCRIPTEN__)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+/**
+ * @brief Constructs a mapped file and calls abcg::MappedFile::open.
+ *
+ * @param path Path to the file.
+ */
+abcg::MappedFile::MappedFile(std::string_view path) { open(path); }
+
+abcg::MappedFile::MappedFile(MappedFile &&other) noexcept { swap(other); }
+
+abcg::MappedFile::~MappedFile() { close(); }
+
+abcg::MappedFile &abcg::MappedFile::operator=(MappedFile &&other) noexcept {
+  if (this != &other) {
+    close();
+    swap(other);
+  }
+  return *this;
+}
+
+/**
+ * @brief Maps a file into memory for reading.
+ *
+ * Any file previously opened by this object is closed first.
+ *
+ * @param path Path to the file.
+ *
+ * @return True if the file could be opened; false otherwise.
+ */
+bool abcg::MappedFile::open(std::string_view path) {
+  close();
+
+  std::string const pathStr{path};
+
+#if defined(WIN32)
+  auto *const file{CreateFileA(
+      pathStr.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+      FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, nullptr)};
+  if (file != INVALID_HANDLE_VALUE) {
+    LARGE_INTEGER size{};
+    if (GetFileSizeEx(file, &size) == 0) {
+      CloseHandle(file);
+      return false;
+    }
+    if (size.QuadPart == 0) {
+      CloseHandle(file);
+      m_isOpen = true;
+      return true;
+    }
+    if (auto *const mapping{
+            CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr)}) {
+      if (auto *const view{MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0)}) {
+        m_fileHandle = file;
+        m_mappingHandle = mapping;
+        m_data = static_cast<std::byte const *>(view);
+        m_size = static_cast<std::size_t>(size.QuadPart);
+        m_isOpen = true;
+        return true;
+      }
+      CloseHandle(mapping);
+    }
+    CloseHandle(file);
+  }
+#elif !defined(__EMSCRIPTEN__)
+  if (auto const fd{::open(pathStr.c_str(), O_RDONLY)}; fd >= 0) {
+    struct stat status {};
+    if (fstat(fd, &status) != 0) {
+      ::close(fd);
+      return false;
+    }
+    if (status.st_size == 0) {
+      ::close(fd);
+      m_isOpen = true;
+      return true;
+    }
+    auto const size{static_cast<std::size_t>(status.st_size)};
+    auto *const view{mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0)};
+    // The mapping keeps a reference to the file
+    ::close(fd);
+    if (view != MAP_FAILED) {
+      m_data = static_cast<std::byte const *>(view);
+      m_size = size;
+      m_isOpen = true;
+      return true;
+    }
+  }
+#endif
+
+  // Fall back to reading the whole file into memory
+  std::ifstream stream{pathStr, std::ios::binary | std::ios::ate};
+  if (!stream) {
+    return false;
+  }
+  m_buffer.resize(static_cast<std::size_t>(stream.tellg()));
+  stream.seekg(0);
+  if (!stream.read(reinterpret_cast<char *>(m_buffer.data()),
+                   static_cast<std::streamsize>(m_buffer.size()))) {
+    m_buffer.clear();
+    return false;
+  }
+  m_data = m_buffer.data();
+  m_size = m_buffer.size();
+  m_isOpen = true;
+  return true;
+}
+
+/**
+ * @brief Unmaps the file, if any.
+ *
+ * Views previously returned by abcg::MappedFile::getData become invalid.
+ */
+void abcg::MappedFile::close() noexcept {
+  if (m_data != nullptr && m_buffer.empty()) {
+#if defined(WIN32)
+    UnmapViewOfFile(m_data);
+    CloseHandle(m_mappingHandle);
+    CloseHandle(m_fileHandle);
+    m_mappingHandle = nullptr;
+    m_fileHandle = nullptr;
+#elif !defined(__EMSCRIPTEN__)
+    munmap(const_cast<std::byte *>(m_data), m_size);
+#endif
+  }
+  m_buffer.clear();
+  m_buffer.shrink_to_fit();
+  m_data = nullptr;
+  m_size = 0;
+  m_isOpen = false;
+}
+
+void abcg::MappedFile::swap(MappedFile &other) noexcept {
+  std::swap(m_data, other.m_data);
+  std::swap(m_size, other.m_size);
+  std::swap(m_isOpen, other.m_isOpen);
+#if defined(WIN32)
+  std::swap(m_fileHandle, other.m_fileHandle);
+  std::swap(m_mappingHandle, other.m_mappingHandle);
+#endif
+  m_buffer.swap(other.m_buffer);
+}
@@ -0,0 +1,81 @@
+/**
+ * @file abcgMappedFile.hpp
+ * @brief Header file of abcg::MappedFile.
+ *
+ * Declaration of abcg::MappedFile class.
+ *
+ * This file is part of ABCg (https://github.com/hbatagelo/abcg).
+ *
+ * @copyright (c) 2021--2023 Harlen Batagelo. All rights reserved.
+ * This project is released under the MIT License.
+ */
+
+#ifndef ABCG_MAPPED_FILE_HPP_
+#define ABCG_MAPPED_FILE_HPP_
+
+#include <cstddef>
+#include <span>
+#include <string_view>
+#include <vector>
+
+namespace abcg {
+class MappedFile;
+} // namespace abcg
+
+/**
+ * @brief Read-only view of the contents of a file mapped into memory.
+ *
+ * On desktop platforms, the file is mapped with `mmap` (POSIX) or
+ * `MapViewOfFile` (Windows), so that pages are loaded on demand by the OS. On
+ * platforms without memory mapping (e.g. Emscripten), the contents are read
+ * into an internal buffer instead.
+ *
+ * The view remains valid until the object is closed or destroyed.
+ */
+class abcg::MappedFile {
+public:
+  MappedFile() = default;
+  explicit MappedFile(std::string_view path);
+  MappedFile(MappedFile const &) = delete;
+  MappedFile(MappedFile &&other) noexcept;
+  ~MappedFile();
+
+  MappedFile &operator=(MappedFile const &) = delete;
+  MappedFile &operator=(MappedFile &&other) noexcept;
+
+  bool open(std::string_view path);
+  void close() noexcept;
+
+  /**
+   * @brief Returns whether a file is currently mapped.
+   *
+   * @return True if the file was opened successfully; false otherwise.
+   */
+  [[nodiscard]] bool isOpen() const noexcept { return m_isOpen; }
+
+  /**
+   * @brief Returns a view of the file contents.
+   *
+   * @return Read-only span of the mapped bytes, or an empty span if no file
+   * is open.
+   */
+  [[nodiscard]] std::span<std::byte const> getData() const noexcept {
+    return {m_data, m_size};
+  }
+
+private:
+  std::byte const *m_data{};
+  std::size_t m_size{};
+  bool m_isOpen{};
+
+#if defined(WIN32)
+  void *m_fileHandle{};
+  void *m_mappingHandle{};
+#endif
+  // Fallback storage when the file cannot be memory-mapped
+  std::vector<std::byte> m_buffer;
+
+  void swap(MappedFile &other) noexcept;
+};
+
+#endif
@@ -0,0 +1,418 @@
+/**
+ * @file abcgMeshCache.cpp
+ * @brief Definition of abcg::MeshCache members.
+ *
+ * This file is part of ABCg (https://github.com/hbatagelo/abcg).
+ *
+ * @copyright (c) 2021--2023 Harlen Batagelo. All rights reserved.
+ * This project is released under the MIT License.
+ */
+
+#include "abcgMeshCache.hpp"
+
+#include <gsl/gsl>
+
+#include <array>
+#include <cstddef>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <system_error>
+#include <vector>
+
+namespace {
+
+// Increment whenever the layout of the cache file changes
+constexpr std::uint32_t cacheVersion{2};
+constexpr std::array<char, 8> cacheMagic{'A', 'B', 'C', 'G', 'M', 'S', 'H',
+                                         '\0'};
+// Used for detecting files written on a machine with different endianness
+constexpr std::uint32_t byteOrderMark{0x01020304};
+// Alignment of each array in the file
+constexpr std::uint64_t arrayAlignment{16};
+
+struct CacheHeader {
+  std::array<char, 8> magic{};
+  std::uint32_t version{};
+  std::uint32_t byteOrder{};
+  std::uint64_t vertexSize{};
+  std::uint64_t options{};
+  std::uint64_t sourceSize{};
+  std::int64_t sourceTime{};
+  std::uint64_t sourceHash{};
+  std::uint64_t vertexOffset{};
+  std::uint64_t vertexDataSize{};
+  std::uint64_t indexOffset{};
+  std::uint64_t indexCount{};
+  std::uint64_t userDataOffset{};
+  std::uint64_t userDataSize{};
+  std::uint64_t dependencyOffset{};
+  std::uint64_t dependencyCount{};
+};
+
+// Followed by the path of the dependency, relative to the directory of the
+// source file. Records are packed one after the other
+struct DependencyRecord {
+  std::uint64_t size{};
+  std::uint64_t hash{};
+  std::uint64_t pathLength{};
+};
+
+struct SourceStatus {
+  std::uint64_t size{};
+  std::int64_t time{};
+};
+
+std::uint64_t alignOffset(std::uint64_t offset) {
+  return (offset + arrayAlignment - 1) & ~(arrayAlignment - 1);
+}
+
+bool getSourceStatus(std::string_view path, SourceStatus &status) {
+  std::error_code error;
+  std::filesystem::path const sourcePath{path};
+  auto const size{std::filesystem::file_size(sourcePath, error)};
+  if (error) {
+    return false;
+  }
+  auto const time{std::filesystem::last_write_time(sourcePath, error)};
+  if (error) {
+    return false;
+  }
+  status.size = size;
+  status.time = gsl::narrow_cast<std::int64_t>(time.time_since_epoch().count());
+  return true;
+}
+
+// 64-bit FNV-1a over 8-byte words
+std::uint64_t hashContents(std::span<std::byte const> data) {
+  constexpr std::uint64_t prime{0x100000001b3};
+  std::uint64_t hash{0xcbf29ce484222325};
+
+  auto const numWords{data.size() / sizeof(std::uint64_t)};
+  for (std::size_t i{}; i < numWords; ++i) {
+    std::uint64_t word{};
+    std::memcpy(&word, data.data() + i * sizeof(word), sizeof(word));
+    hash = (hash ^ word) * prime;
+  }
+  for (auto const byte : data.subspan(numWords * sizeof(std::uint64_t))) {
+    hash = (hash ^ static_cast<std::uint64_t>(byte)) * prime;
+  }
+  return hash;
+}
+
+bool hashSource(std::string_view path, std::uint64_t &hash) {
+  abcg::MappedFile const source{path};
+  if (!source.isOpen()) {
+    return false;
+  }
+  hash = hashContents(source.getData());
+  return true;
+}
+
+// Checks that the dependencies listed in the cache have not changed
+bool checkDependencies(std::span<std::byte const> table, std::uint64_t count,
+                       std::filesystem::path const &sourceDirectory) {
+  for (std::uint64_t i{}; i < count; ++i) {
+    DependencyRecord record{};
+    if (table.size() < sizeof(record)) {
+      return false;
+    }
+    std::memcpy(&record, table.data(), sizeof(record));
+    table = table.subspan(sizeof(record));
+    if (record.pathLength > table.size()) {
+      return false;
+    }
+    std::string const relativePath{
+        reinterpret_cast<char const *>(table.data()), record.pathLength};
+    table = table.subspan(record.pathLength);
+
+    auto const path{(sourceDirectory / relativePath).string()};
+    SourceStatus status{};
+    std::uint64_t hash{};
+    if (!getSourceStatus(path, status) || status.size != record.size ||
+        !hashSource(path, hash) || hash != record.hash) {
+      return false;
+    }
+  }
+  return true;
+}
+
+// Builds the dependency table written by abcg::MeshCache::save
+bool makeDependencyTable(std::span<std::string const> paths,
+                         std::filesystem::path const &sourceDirectory,
+                         std::vector<std::byte> &table) {
+  for (auto const &path : paths) {
+    SourceStatus status{};
+    DependencyRecord record{};
+    if (!getSourceStatus(path, status) || !hashSource(path, record.hash)) {
+      return false;
+    }
+    record.size = status.size;
+
+    // Keep the path absolute if it is not under a common root
+    auto relativePath{
+        std::filesystem::path{path}.lexically_relative(sourceDirectory)};
+    if (relativePath.empty()) {
+      relativePath = path;
+    }
+    auto const pathString{relativePath.generic_string()};
+    record.pathLength = pathString.size();
+
+    auto const recordBytes{std::as_bytes(std::span{&record, 1})};
+    auto const pathBytes{std::as_bytes(std::span{pathString})};
+    table.insert(table.end(), recordBytes.begin(), recordBytes.end());
+    table.insert(table.end(), pathBytes.begin(), pathBytes.end());
+  }
+  return true;
+}
+
+} // namespace
+
+/**
+ * @brief Returns the path of the cache file of a source file.
+ *
+ * @param sourcePath Path of the source file.
+ *
+ * @return Path of the cache file.
+ */
+std::string abcg::MeshCache::getPath(std::string_view sourcePath) {
+  return std::string{sourcePath} + ".abcgmesh";
+}
+
+/**
+ * @brief Loads the cache file of a source file.
+ *
+ * The cache file is memory-mapped and validated against the given key and
+ * the dependencies stored in it. If the modification time of the source file
+ * does not match the one stored in the cache, but its contents do, the file is
+ * unmapped, the stored time is refreshed so that subsequent loads can skip
+ * hashing the source file, and the file is mapped again.
+ *
+ * @param key Key of the source file and vertex layout.
+ *
+ * @return True if a valid cache was found; false otherwise. In the latter
+ * case, the mesh must be rebuilt from the source file.
+ */
+bool abcg::MeshCache::load(MeshCacheKey const &key) {
+  close();
+
+  SourceStatus source{};
+  if (!getSourceStatus(key.sourcePath, source)) {
+    return false;
+  }
+
+  auto const cachePath{getPath(key.sourcePath)};
+  if (!m_file.open(cachePath)) {
+    return false;
+  }
+
+  auto data{m_file.getData()};
+  CacheHeader header{};
+  if (data.size() < sizeof(header)) {
+    close();
+    return false;
+  }
+  std::memcpy(&header, data.data(), sizeof(header));
+
+  auto const inBounds{[size = data.size()](std::uint64_t offset,
+                                           std::uint64_t length) {
+    return offset <= size && length <= size - offset &&
+           offset % arrayAlignment == 0;
+  }};
+
+  if (header.magic != cacheMagic || header.version != cacheVersion ||
+      header.byteOrder != byteOrderMark ||
+      header.vertexSize != key.vertexSize || header.vertexSize == 0 ||
+      header.options != key.options || header.sourceSize != source.size ||
+      header.vertexDataSize % header.vertexSize != 0 ||
+      header.indexCount > data.size() / sizeof(std::uint32_t) ||
+      !inBounds(header.vertexOffset, header.vertexDataSize) ||
+      !inBounds(header.indexOffset,
+                header.indexCount * sizeof(std::uint32_t)) ||
+      !inBounds(header.userDataOffset, header.userDataSize) ||
+      !inBounds(header.dependencyOffset, 0) ||
+      !checkDependencies(data.subspan(header.dependencyOffset),
+                         header.dependencyCount,
+                         std::filesystem::path{key.sourcePath}.parent_path())) {
+    close();
+    return false;
+  }
+
+  if (header.sourceTime != source.time) {
+    // The source may have been copied or touched: compare the contents
+    std::uint64_t sourceHash{};
+    if (!hashSource(key.sourcePath, sourceHash) ||
+        sourceHash != header.sourceHash) {
+      close();
+      return false;
+    }
+
+    // Refresh the modification time stored in the cache. The file is unmapped
+    // first, as a mapped file cannot be written on Windows
+    auto const size{data.size()};
+    close();
+    {
+      std::fstream stream{cachePath,
+                          std::ios::binary | std::ios::in | std::ios::out};
+      if (stream) {
+        stream.seekp(offsetof(CacheHeader, sourceTime));
+        stream.write(reinterpret_cast<char const *>(&source.time),
+                     sizeof(source.time));
+      }
+    }
+    if (!m_file.open(cachePath) || m_file.getData().size() != size) {
+      close();
+      return false;
+    }
+    data = m_file.getData();
+  }
+
+  m_vertexData = data.subspan(header.vertexOffset, header.vertexDataSize);
+  m_indices = {reinterpret_cast<std::uint32_t const *>(data.data() +
+                                                       header.indexOffset),
+               header.indexCount};
+  m_userData = data.subspan(header.userDataOffset, header.userDataSize);
+
+  return true;
+}
+
+/**
+ * @brief Unmaps the cache file, if any.
+ */
+void abcg::MeshCache::close() noexcept {
+  m_vertexData = {};
+  m_indices = {};
+  m_userData = {};
+  m_file.close();
+}
+
+/**
+ * @brief Stores a mesh in the cache file of a source file.
+ *
+ * The file is written to a temporary file first and then renamed, so that a
+ * partially written cache is never picked up by abcg::MeshCache::load.
+ *
+ * @param key Key of the source file and vertex layout.
+ * @param vertexData Raw bytes of the vertex array.
+ * @param indices Array of indices.
+ * @param userData Optional data to be stored along with the mesh.
+ * @param dependencyPaths Paths of other files the mesh or the user data were
+ * built from (e.g. the MTL files of an OBJ file).
+ *
+ * @return True if the cache file was written; false otherwise (e.g. if the
+ * directory is read-only or a dependency cannot be read).
+ */
+bool abcg::MeshCache::save(MeshCacheKey const &key,
+                           std::span<std::byte const> vertexData,
+                           std::span<std::uint32_t const> indices,
+                           std::span<std::byte const> userData,
+                           std::span<std::string const> dependencyPaths) {
+  if (key.vertexSize == 0 || vertexData.size() % key.vertexSize != 0) {
+    return false;
+  }
+
+  SourceStatus source{};
+  CacheHeader header{.magic = cacheMagic,
+                     .version = cacheVersion,
+                     .byteOrder = byteOrderMark,
+                     .vertexSize = key.vertexSize,
+                     .options = key.options};
+  if (!getSourceStatus(key.sourcePath, source) ||
+      !hashSource(key.sourcePath, header.sourceHash)) {
+    return false;
+  }
+  header.sourceSize = source.size;
+  header.sourceTime = source.time;
+
+  std::vector<std::byte> dependencyTable;
+  if (!makeDependencyTable(
+          dependencyPaths,
+          std::filesystem::path{key.sourcePath}.parent_path(),
+          dependencyTable)) {
+    return false;
+  }
+
+  header.vertexOffset = alignOffset(sizeof(header));
+  header.vertexDataSize = vertexData.size();
+  header.indexOffset = alignOffset(header.vertexOffset + vertexData.size());
+  header.indexCount = indices.size();
+  header.userDataOffset =
+      alignOffset(header.indexOffset + indices.size_bytes());
+  header.userDataSize = userData.size();
+  header.dependencyOffset =
+      alignOffset(header.userDataOffset + userData.size());
+  header.dependencyCount = dependencyPaths.size();
+
+  auto const cachePath{getPath(key.sourcePath)};
+  auto const tempPath{cachePath + ".tmp"};
+
+  {
+    std::ofstream stream{tempPath, std::ios::binary | std::ios::trunc};
+    if (!stream) {
+      return false;
+    }
+
+    auto const writeAt{[&stream](std::uint64_t offset,
+                                 std::span<std::byte const> bytes) {
+      // Pad up to the requested offset
+      static constexpr std::array<char, arrayAlignment> padding{};
+      auto const position{static_cast<std::uint64_t>(stream.tellp())};
+      stream.write(padding.data(),
+                   static_cast<std::streamsize>(offset - position));
+      stream.write(reinterpret_cast<char const *>(bytes.data()),
+                   static_cast<std::streamsize>(bytes.size()));
+    }};
+
+    writeAt(0, std::as_bytes(std::span{&header, 1}));
+    writeAt(header.vertexOffset, vertexData);
+    writeAt(header.indexOffset, std::as_bytes(indices));
+    writeAt(header.userDataOffset, userData);
+    writeAt(header.dependencyOffset, dependencyTable);
+
+    if (!stream) {
+      stream.close();
+      std::error_code error;
+      std::filesystem::remove(tempPath, error);
+      return false;
+    }
+  }
+
+  std::error_code error;
+  std::filesystem::rename(tempPath, cachePath, error);
+  if (error) {
+    std::filesystem::remove(tempPath, error);
+    return false;
+  }
+
+  return true;
+}
+
+/**
+ * @brief Returns the raw bytes of the cached vertex array.
+ *
+ * @return Read-only span pointing to the mapped file, or an empty span if no
+ * cache is loaded.
+ */
+std::span<std::byte const> abcg::MeshCache::getVertexData() const noexcept {
+  return m_vertexData;
+}
+
+/**
+ * @brief Returns the cached index array.
+ *
+ * @return Read-only span pointing to the mapped file, or an empty span if no
+ * cache is loaded.
+ */
+std::span<std::uint32_t const> abcg::MeshCache::getIndices() const noexcept {
+  return m_indices;
+}
+
+/**
+ * @brief Returns the user data stored along with the mesh.
+ *
+ * @return Read-only span pointing to the mapped file, or an empty span if no
+ * cache is loaded or no user data was stored.
+ */
+std::span<std::byte const> abcg::MeshCache::getUserData() const noexcept {
+  return m_userData;
+}
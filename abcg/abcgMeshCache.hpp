@@ -0,0 +1,148 @@
+/**
+ * @file abcgMeshCache.hpp
+ * @brief Header file of abcg::MeshCache.
+ *
+ * Declaration of abcg::MeshCache class and related structures.
+ *
+ * This file is part of ABCg (https://github.com/hbatagelo/abcg).
+ *
+ * @copyright (c) 2021--2023 Harlen Batagelo. All rights reserved.
+ * This project is released under the MIT License.
+ */
+
+#ifndef ABCG_MESH_CACHE_HPP_
+#define ABCG_MESH_CACHE_HPP_
+
+#include <cstdint>
+#include <span>
+#include <string>
+#include <type_traits>
+
+#include "abcgMappedFile.hpp"
+
+namespace abcg {
+class MeshCache;
+struct MeshCacheKey;
+} // namespace abcg
+
+/**
+ * @brief Identifies the source and layout of a cached mesh.
+ *
+ * A cache file is only accepted if it was created with the same vertex size
+ * and options, and if the source file and its dependencies have not changed
+ * since then.
+ */
+struct abcg::MeshCacheKey {
+  /** @brief Path of the source model file (e.g. a Wavefront OBJ file). */
+  std::string_view sourcePath;
+  /** @brief Size, in bytes, of each vertex. */
+  std::size_t vertexSize{};
+  /**
+   * @brief Hash of any option that changes the processed mesh (e.g. whether
+   * the mesh is standardized), or of the vertex layout itself.
+   */
+  std::size_t options{};
+};
+
+/**
+ * @brief Versioned binary cache of a processed indexed mesh.
+ *
+ * The cache stores the deduplicated vertex array and the 32-bit index array of
+ * a mesh, together with an optional blob of user data (e.g. material
+ * properties). Cache files are written next to the source file with the
+ * extension `.abcgmesh` appended to the source filename.
+ *
+ * A cache file is validated against the modification time and size of the
+ * source file. If the modification time differs, the contents of the source
+ * file are hashed and compared with the hash stored in the cache, so that
+ * copying the source file around does not invalidate the cache.
+ *
+ * Other files the mesh or the user data were built from (e.g. the MTL files
+ * of an OBJ file) can be given to abcg::MeshCache::save as dependencies. Their
+ * paths, relative to the directory of the source file, are stored in the
+ * cache, and their sizes and contents are validated on load.
+ *
+ * Cache files are memory-mapped on load, so that the vertex and index arrays
+ * can be uploaded to the GPU directly from the mapped pages:
+ * @code
+ * abcg::MeshCache cache;
+ * if (cache.load({.sourcePath = path, .vertexSize = sizeof(Vertex)})) {
+ *   auto const vertices{cache.getVertices<Vertex>()};
+ *   auto const indices{cache.getIndices()};
+ *   // Upload vertices and indices...
+ * }
+ * @endcode
+ */
+class abcg::MeshCache {
+public:
+  bool load(MeshCacheKey const &key);
+  void close() noexcept;
+
+  static bool save(MeshCacheKey const &key,
+                   std::span<std::byte const> vertexData,
+                   std::span<std::uint32_t const> indices,
+                   std::span<std::byte const> userData = {},
+                   std::span<std::string const> dependencyPaths = {});
+
+  /**
+   * @brief Stores a mesh in the cache file of a source file.
+   *
+   * @tparam TVertex Vertex type. Must be trivially copyable.
+   *
+   * @param key Key of the source file and vertex layout.
+   * @param vertices Array of vertices.
+   * @param indices Array of indices.
+   * @param userData Optional data to be stored along with the mesh.
+   * @param dependencyPaths Paths of other files the mesh or the user data
+   * were built from.
+   *
+   * @return True if the cache file was written; false otherwise.
+   */
+  template <typename TVertex>
+  static bool save(MeshCacheKey const &key, std::span<TVertex const> vertices,
+                   std::span<std::uint32_t const> indices,
+                   std::span<std::byte const> userData = {},
+                   std::span<std::string const> dependencyPaths = {}) {
+    static_assert(std::is_trivially_copyable_v<TVertex>);
+    return save(key, std::as_bytes(vertices), indices, userData,
+                dependencyPaths);
+  }
+
+  [[nodiscard]] static std::string getPath(std::string_view sourcePath);
+
+  /**
+   * @brief Returns whether a cache file is currently loaded.
+   *
+   * @return True if abcg::MeshCache::load succeeded; false otherwise.
+   */
+  [[nodiscard]] bool isLoaded() const noexcept { return m_file.isOpen(); }
+
+  [[nodiscard]] std::span<std::byte const> getVertexData() const noexcept;
+  [[nodiscard]] std::span<std::uint32_t const> getIndices() const noexcept;
+  [[nodiscard]] std::span<std::byte const> getUserData() const noexcept;
+
+  /**
+   * @brief Returns a typed view of the cached vertices.
+   *
+   * @tparam TVertex Vertex type. Its size must match the vertex size given
+   * in the key used to load the cache.
+   *
+   * @return Read-only span of vertices pointing to the mapped file.
+   */
+  template <typename TVertex>
+  [[nodiscard]] std::span<TVertex const> getVertices() const noexcept {
+    static_assert(std::is_trivially_copyable_v<TVertex>);
+    auto const data{getVertexData()};
+    return {reinterpret_cast<TVertex const *>(data.data()),
+            data.size() / sizeof(TVertex)};
+  }
+
+private:
+  MappedFile m_file;
+
+  std::span<std::byte const> m_vertexData;
+  std::span<std::uint32_t const> m_indices;
+  std::span<std::byte const> m_userData;
+};
+
+#endif
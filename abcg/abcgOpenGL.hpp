@@ -14,7 +14,11 @@
 #define ABCG_OPENGL_HPP_
 
 #include "abcg.hpp"
+#include "abcgOpenGLFrameCapture.hpp"
 #include "abcgOpenGLImage.hpp"
+#include "abcgOpenGLProfiler.hpp"
+#include "abcgOpenGLProgram.hpp"
+#include "abcgOpenGLProgramBuilder.hpp"
 #include "abcgOpenGLShader.hpp"
 #include "abcgOpenGLWindow.hpp"
 
@@ -0,0 +1,365 @@
+/**
+ * @file abcgOpenGLFrameCapture.cpp
+ * @brief Definition of abcg::OpenGLFrameCapture
+ *
+ * This file is part of ABCg (https://github.com/hbatagelo/abcg).
+ *
+ * @copyright (c) 2021--2023 Harlen Batagelo. All rights reserved.
+ * This project is released under the MIT License.
+ */
+
+#include "abcgOpenGLFrameCapture.hpp"
+
+#include <SDL_image.h>
+#include <fmt/core.h>
+#include <fmt/format.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <exception>
+#include <fstream>
+#include <utility>
+
+#include "abcgException.hpp"
+
+namespace {
+constexpr auto channels{4};
+} // namespace
+
+/**
+ * @brief Flips an image read with `glReadPixels` upside down and writes it to
+ * a file.
+ *
+ * This is used by the worker threads of the capture and by
+ * abcg::OpenGLWindow::saveScreenshotPNG.
+ *
+ * @param pixels 8-bit RGBA pixels, bottom row first. They are flipped in
+ * place.
+ * @param size Size of the image, in pixels.
+ * @param path Path of the file.
+ * @param format File format.
+ *
+ * @throw abcg::RuntimeError if the file cannot be written.
+ */
+void abcg::OpenGLFrameCapture::writeImage(std::vector<unsigned char> &pixels,
+                                          glm::ivec2 const &size,
+                                          std::string const &path,
+                                          CaptureFormat format) {
+  auto const pitch{gsl::narrow<long>(size.x * channels)};
+  for (auto const line : iter::range(size.y / 2)) {
+    std::swap_ranges(pixels.begin() + pitch * line,
+                     pixels.begin() + pitch * (line + 1),
+                     pixels.begin() + pitch * (size.y - line - 1));
+  }
+
+  if (format == CaptureFormat::Raw) {
+    std::ofstream stream{path, std::ios::binary | std::ios::trunc};
+    stream.write(reinterpret_cast<char const *>(pixels.data()),
+                 gsl::narrow<std::streamsize>(pixels.size()));
+    if (!stream) {
+      throw abcg::RuntimeError(fmt::format("Failed to write {}", path));
+    }
+    return;
+  }
+
+  auto const bitsPerPixel{8};
+  auto *const surface{SDL_CreateRGBSurfaceFrom(
+      pixels.data(), size.x, size.y, channels * bitsPerPixel,
+      gsl::narrow<int>(pitch), 0x000000FF, 0x0000FF00, 0x00FF0000,
+      0xFF000000)};
+  if (surface == nullptr) {
+    throw abcg::SDLError("SDL_CreateRGBSurfaceFrom failed");
+  }
+  auto const result{IMG_SavePNG(surface, path.c_str())};
+  SDL_FreeSurface(surface);
+  if (result != 0) {
+    throw abcg::RuntimeError(fmt::format("Failed to write {}", path));
+  }
+}
+
+/**
+ * @brief Sets the number of buffers and encoder threads.
+ *
+ * Calling this is optional. The buffers and the threads are created when the
+ * first capture is requested, so a capture that is never used costs nothing.
+ *
+ * @param ringSize Number of pixel pack buffers. Larger rings let more frames
+ * be read before the oldest one must be ready.
+ * @param encoderThreads Maximum number of threads that flip and encode the
+ * images. This is limited to abcg::ThreadPool::getDefaultThreadCount, and
+ * images are encoded in the render thread if it is zero.
+ */
+void abcg::OpenGLFrameCapture::create(std::size_t ringSize,
+                                      std::size_t encoderThreads) {
+  destroy();
+
+  m_ringSize = std::max(ringSize, std::size_t{1});
+  m_encoderThreads = encoderThreads;
+}
+
+/**
+ * @brief Writes the pending captures and releases the buffers.
+ */
+void abcg::OpenGLFrameCapture::destroy() {
+  flush();
+  for (auto &readback : m_readbacks) {
+    glDeleteBuffers(1, &readback.buffer);
+  }
+  m_readbacks.clear();
+  m_nextReadback = 0;
+  m_screenshots.clear();
+  m_recording = false;
+  m_pool.reset();
+}
+
+/**
+ * @brief Requests a screenshot of the next frame.
+ *
+ * The file is written asynchronously, a few frames later.
+ *
+ * @param path Path of the file.
+ * @param format File format.
+ */
+void abcg::OpenGLFrameCapture::requestScreenshot(std::string_view path,
+                                                 CaptureFormat format) {
+  createEncoder();
+  m_screenshots.push_back({.path = std::string{path}, .format = format});
+}
+
+/**
+ * @brief Starts recording every frame to a sequence of numbered files.
+ *
+ * @param pathPattern Format string of the file paths. It is formatted with
+ * the frame number, starting at 0 (e.g., `"frame_{:05d}.png"`).
+ * @param format File format.
+ *
+ * @throw abcg::RuntimeError if @a pathPattern is not a valid format string.
+ */
+void abcg::OpenGLFrameCapture::startRecording(std::string_view pathPattern,
+                                              CaptureFormat format) {
+  try {
+    [[maybe_unused]] auto const path{
+        fmt::format(fmt::runtime(pathPattern), 0)};
+  } catch (fmt::format_error const &exception) {
+    throw abcg::RuntimeError(fmt::format("Invalid recording path {}: {}",
+                                         pathPattern, exception.what()));
+  }
+
+  createEncoder();
+  m_recording = true;
+  m_recordingPattern = pathPattern;
+  m_recordingFormat = format;
+  m_recordedFrames = 0;
+}
+
+/**
+ * @brief Stops recording frames.
+ *
+ * The frames already captured are still written.
+ */
+void abcg::OpenGLFrameCapture::stopRecording() noexcept {
+  m_recording = false;
+}
+
+/**
+ * @brief Returns whether frames are being recorded.
+ *
+ * @return `true` between abcg::OpenGLFrameCapture::startRecording and
+ * abcg::OpenGLFrameCapture::stopRecording.
+ */
+bool abcg::OpenGLFrameCapture::isRecording() const noexcept {
+  return m_recording;
+}
+
+/**
+ * @brief Returns the number of frames captured by the current or last
+ * recording.
+ *
+ * @return Number of frames.
+ */
+std::size_t abcg::OpenGLFrameCapture::getRecordedFrameCount() const noexcept {
+  return m_recordedFrames;
+}
+
+/**
+ * @brief Captures the current frame if a screenshot was requested or frames
+ * are being recorded, and writes the captures whose pixels are ready.
+ *
+ * abcg::OpenGLWindow calls it once per frame.
+ *
+ * @param size Size of the framebuffer, in pixels.
+ * @param readBuffer Color buffer to read from (e.g., `GL_BACK`).
+ */
+void abcg::OpenGLFrameCapture::capture(glm::ivec2 const &size,
+                                       GLenum readBuffer) {
+  collect(false);
+  collectEncodes(false);
+
+  if (size.x <= 0 || size.y <= 0) {
+    return;
+  }
+
+  while (!m_screenshots.empty()) {
+    readPixels(size, readBuffer, std::move(m_screenshots.front()));
+    m_screenshots.pop_front();
+  }
+
+  if (m_recording) {
+    readPixels(size, readBuffer,
+               {.path = fmt::format(fmt::runtime(m_recordingPattern),
+                                    m_recordedFrames++),
+                .format = m_recordingFormat});
+  }
+}
+
+/**
+ * @brief Waits for all captures to be written.
+ */
+void abcg::OpenGLFrameCapture::flush() {
+  collect(true);
+  collectEncodes(true);
+}
+
+void abcg::OpenGLFrameCapture::readPixels(glm::ivec2 const &size,
+                                          GLenum readBuffer, Target target) {
+  auto const numBytes{gsl::narrow<std::size_t>(size.x * size.y * channels)};
+
+#if defined(__EMSCRIPTEN__)
+  std::vector<unsigned char> pixels(numBytes);
+  glReadBuffer(readBuffer);
+  glReadPixels(0, 0, size.x, size.y, GL_RGBA, GL_UNSIGNED_BYTE, pixels.data());
+  encode(std::move(pixels), size, std::move(target));
+#else
+  if (m_readbacks.empty()) {
+    m_readbacks.resize(m_ringSize);
+    for (auto &readback : m_readbacks) {
+      glGenBuffers(1, &readback.buffer);
+    }
+  }
+
+  auto &readback{m_readbacks.at(m_nextReadback)};
+  m_nextReadback = (m_nextReadback + 1) % m_readbacks.size();
+
+  // The ring is full. Wait for the oldest capture rather than dropping this
+  // one
+  if (readback.fence != nullptr) {
+    while (glClientWaitSync(readback.fence, GL_SYNC_FLUSH_COMMANDS_BIT,
+                            GL_TIMEOUT_IGNORED) == GL_TIMEOUT_EXPIRED)
+      ;
+    finishReadback(readback);
+  }
+
+  glBindBuffer(GL_PIXEL_PACK_BUFFER, readback.buffer);
+  if (readback.capacity < numBytes) {
+    glBufferData(GL_PIXEL_PACK_BUFFER, gsl::narrow<GLsizeiptr>(numBytes),
+                 nullptr, GL_STREAM_READ);
+    readback.capacity = numBytes;
+  }
+  glReadBuffer(readBuffer);
+  glReadPixels(0, 0, size.x, size.y, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+  glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+  readback.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+  readback.size = size;
+  readback.target = std::move(target);
+#endif
+}
+
+// Finishes the readbacks whose fences are signaled, from the oldest to the
+// newest. If wait is true, waits for all of them
+void abcg::OpenGLFrameCapture::collect(bool wait) {
+  for (auto const offset : iter::range(m_readbacks.size())) {
+    auto &readback{
+        m_readbacks.at((m_nextReadback + offset) % m_readbacks.size())};
+    if (readback.fence == nullptr) {
+      continue;
+    }
+
+    auto status{glClientWaitSync(readback.fence, 0, 0)};
+    while (wait && status == GL_TIMEOUT_EXPIRED) {
+      status = glClientWaitSync(readback.fence, GL_SYNC_FLUSH_COMMANDS_BIT,
+                                GL_TIMEOUT_IGNORED);
+    }
+    if (status == GL_TIMEOUT_EXPIRED) {
+      // Newer readbacks are not ready either
+      return;
+    }
+    finishReadback(readback);
+  }
+}
+
+// Copies the pixels of a readback whose fence is signaled and hands them to
+// the encoder
+void abcg::OpenGLFrameCapture::finishReadback(Readback &readback) {
+  glDeleteSync(readback.fence);
+  readback.fence = nullptr;
+
+  auto const numBytes{
+      gsl::narrow<std::size_t>(readback.size.x * readback.size.y * channels)};
+  std::vector<unsigned char> pixels(numBytes);
+
+  glBindBuffer(GL_PIXEL_PACK_BUFFER, readback.buffer);
+  auto const *data{glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0,
+                                    gsl::narrow<GLsizeiptr>(numBytes),
+                                    GL_MAP_READ_BIT)};
+  if (data != nullptr) {
+    std::memcpy(pixels.data(), data, numBytes);
+    glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+  }
+  glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+  if (data == nullptr) {
+    fmt::print(stderr, "Failed to map the pixels of {}\n",
+               readback.target.path);
+    return;
+  }
+  encode(std::move(pixels), readback.size, std::move(readback.target));
+}
+
+// Creates the encoder threads, if they were not created yet
+void abcg::OpenGLFrameCapture::createEncoder() {
+  if (m_pool) {
+    return;
+  }
+  auto const threads{
+      std::min(m_encoderThreads, ThreadPool::getDefaultThreadCount())};
+  m_pool = std::make_unique<ThreadPool>(threads);
+  // Bounds the memory held by images waiting to be encoded
+  m_maxPendingEncodes = 2 * std::max(threads, std::size_t{1});
+}
+
+void abcg::OpenGLFrameCapture::encode(std::vector<unsigned char> pixels,
+                                      glm::ivec2 const &size, Target target) {
+  // Wait for the oldest images if the encoder is behind
+  while (m_encodes.size() >= m_maxPendingEncodes) {
+    finishEncode();
+  }
+
+  m_encodes.push_back(m_pool->submit(
+      [pixels = std::move(pixels), size, target = std::move(target)]() mutable {
+        writeImage(pixels, size, target.path, target.format);
+      }));
+}
+
+// Removes the finished encodes from the front of the queue. If wait is true,
+// waits for all of them
+void abcg::OpenGLFrameCapture::collectEncodes(bool wait) {
+  while (!m_encodes.empty()) {
+    if (!wait && m_encodes.front().wait_for(std::chrono::seconds{0}) !=
+                     std::future_status::ready) {
+      return;
+    }
+    finishEncode();
+  }
+}
+
+// Waits for the oldest encode and prints its error, if any
+void abcg::OpenGLFrameCapture::finishEncode() {
+  try {
+    m_encodes.front().get();
+  } catch (std::exception const &exception) {
+    fmt::print(stderr, "{}\n", exception.what());
+  }
+  m_encodes.pop_front();
+}
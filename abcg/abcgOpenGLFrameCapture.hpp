@@ -0,0 +1,142 @@
+/**
+ * @file abcgOpenGLFrameCapture.hpp
+ * @brief Header file of abcg::OpenGLFrameCapture
+ *
+ * Declaration of abcg::OpenGLFrameCapture
+ *
+ * This file is part of ABCg (https://github.com/hbatagelo/abcg).
+ *
+ * @copyright (c) 2021--2023 Harlen Batagelo. All rights reserved.
+ * This project is released under the MIT License.
+ */
+
+#ifndef ABCG_OPENGL_FRAME_CAPTURE_HPP_
+#define ABCG_OPENGL_FRAME_CAPTURE_HPP_
+
+#include "abcgExternal.hpp"
+#include "abcgOpenGLExternal.hpp"
+#include "abcgThreadPool.hpp"
+
+#include <deque>
+#include <future>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace abcg {
+enum class CaptureFormat;
+class OpenGLFrameCapture;
+} // namespace abcg
+
+/**
+ * @brief Enumeration of the file formats written by
+ * abcg::OpenGLFrameCapture.
+ */
+enum class abcg::CaptureFormat {
+  /** @brief PNG image. */
+  PNG,
+  /** @brief Raw 8-bit RGBA pixels, top row first, without a header.
+   *
+   * This is much faster to write than PNG. A sequence of raw frames can be
+   * concatenated and piped to, e.g., `ffmpeg -f rawvideo -pixel_format rgba
+   * -video_size WIDTHxHEIGHT -i - out.mp4`.
+   */
+  Raw
+};
+
+/**
+ * @brief Captures the framebuffer to files without stalling the pipeline.
+ *
+ * Each capture is read with `glReadPixels` into one of a ring of
+ * `GL_PIXEL_PACK_BUFFER` objects, and a fence is inserted after it. The pixels
+ * are mapped a few frames later, once the fence is signaled, and are flipped
+ * and encoded by a worker thread. If all buffers of the ring are in use, the
+ * capture waits for the oldest one instead of dropping the frame.
+ *
+ * Besides single screenshots, the capture can record a sequence of numbered
+ * frames:
+ *
+ * @code
+ * // Writes frames/frame_00000.png, frames/frame_00001.png, ...
+ * getFrameCapture().startRecording("frames/frame_{:05d}.png");
+ * // ...
+ * getFrameCapture().stopRecording();
+ * @endcode
+ *
+ * abcg::OpenGLWindow owns a capture object (see
+ * abcg::OpenGLWindow::getFrameCapture) and calls
+ * abcg::OpenGLFrameCapture::capture after abcg::OpenGLWindow::onPaint, so the
+ * captured images do not include the UI. The buffers and the encoder threads
+ * are created on the first request, so a window that never captures does not
+ * pay for them.
+ *
+ * @remark In WebGL, buffers cannot be mapped and the pixels are read
+ * synchronously.
+ */
+class abcg::OpenGLFrameCapture {
+public:
+  void create(std::size_t ringSize = 3, std::size_t encoderThreads = 2);
+  void destroy();
+
+  void requestScreenshot(std::string_view path,
+                         CaptureFormat format = CaptureFormat::PNG);
+  void startRecording(std::string_view pathPattern,
+                      CaptureFormat format = CaptureFormat::PNG);
+  void stopRecording() noexcept;
+  [[nodiscard]] bool isRecording() const noexcept;
+  [[nodiscard]] std::size_t getRecordedFrameCount() const noexcept;
+
+  void capture(glm::ivec2 const &size, GLenum readBuffer);
+  void flush();
+
+  static void writeImage(std::vector<unsigned char> &pixels,
+                         glm::ivec2 const &size, std::string const &path,
+                         CaptureFormat format);
+
+private:
+  // Destination of a capture
+  struct Target {
+    std::string path;
+    CaptureFormat format{};
+  };
+
+  // Pixel pack buffer of the ring
+  struct Readback {
+    GLuint buffer{};
+    GLsync fence{};
+    std::size_t capacity{};
+    glm::ivec2 size{};
+    Target target;
+  };
+
+  void readPixels(glm::ivec2 const &size, GLenum readBuffer, Target target);
+  void collect(bool wait);
+  void finishReadback(Readback &readback);
+  void createEncoder();
+  void encode(std::vector<unsigned char> pixels, glm::ivec2 const &size,
+              Target target);
+  void collectEncodes(bool wait);
+  void finishEncode();
+
+  std::size_t m_ringSize{3};
+  std::size_t m_encoderThreads{2};
+
+  // Created on the first capture
+  std::vector<Readback> m_readbacks;
+  // Next buffer of the ring. Once the ring is full, this is also the oldest
+  std::size_t m_nextReadback{};
+
+  std::deque<Target> m_screenshots;
+  bool m_recording{};
+  std::string m_recordingPattern;
+  CaptureFormat m_recordingFormat{};
+  std::size_t m_recordedFrames{};
+
+  // Created on the first request
+  std::unique_ptr<ThreadPool> m_pool;
+  std::deque<std::future<void>> m_encodes;
+  std::size_t m_maxPendingEncodes{};
+};
+
+#endif
@@ -12,6 +12,73 @@
 #include "abcgOpenGLError.hpp"
 
 #if !defined(NDEBUG) && !defined(__EMSCRIPTEN__) && !defined(__APPLE__)
+#include <fmt/core.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <gsl/gsl>
+#include <string>
+#include <utility>
+
+namespace {
+abcg::OpenGLErrorCheck errorCheckMode{abcg::OpenGLErrorCheck::EachCall};
+uint64_t sampleInterval{1};
+uint64_t frameNumber{};
+// Error reported by the debug callback that was not thrown yet
+std::string pendingErrorMessage;
+GLenum pendingErrorCode{GL_NO_ERROR};
+// First error raised by a function that was not called through the abcg
+// namespace. It is thrown by abcg::endGLErrorCheckFrame
+bool deferredError{};
+std::string deferredErrorMessage;
+GLenum deferredErrorCode{GL_NO_ERROR};
+
+// Some drivers use the error code as the message ID. Others use their own IDs,
+// for which this returns GL_NO_ERROR
+GLenum getErrorCodeFromID(GLuint id) {
+  switch (id) {
+  case GL_INVALID_ENUM:
+  case GL_INVALID_VALUE:
+  case GL_INVALID_OPERATION:
+  case GL_STACK_OVERFLOW:
+  case GL_STACK_UNDERFLOW:
+  case GL_OUT_OF_MEMORY:
+  case GL_INVALID_FRAMEBUFFER_OPERATION:
+    return id;
+  default:
+    return GL_NO_ERROR;
+  }
+}
+
+// Returns the code of the pending error and clears the error flag, which
+// holds the code if the debug callback could not tell it, as no glGetError was
+// called since the error was raised
+GLenum takePendingErrorCode() {
+  auto const flag{glGetError()};
+  auto const code{std::exchange(pendingErrorCode, GLenum{GL_NO_ERROR})};
+  return code == GL_NO_ERROR ? flag : code;
+}
+
+void GLAPIENTRY debugMessageCallback([[maybe_unused]] GLenum source,
+                                     GLenum type, GLuint id,
+                                     [[maybe_unused]] GLenum severity,
+                                     GLsizei length, GLchar const *message,
+                                     [[maybe_unused]] void const *userParam) {
+  auto &state{abcg::detail::glErrorCheckState};
+  if (type != GL_DEBUG_TYPE_ERROR || state.pendingError) {
+    return;
+  }
+  // Exceptions must not propagate through the driver, and OpenGL functions
+  // must not be called from here, so the error is thrown by callGL after the
+  // function returns
+  pendingErrorMessage =
+      length < 0 ? std::string{message}
+                 : std::string{message, gsl::narrow<std::size_t>(length)};
+  pendingErrorCode = getErrorCodeFromID(id);
+  state.pendingError = true;
+}
+} // namespace
+
 /**
  * @brief Checks OpenGL error status and throws on error with a log message.
  *
@@ -29,4 +96,135 @@ void abcg::checkGLError(source_location const &sourceLocation,
     throw abcg::OpenGLError(appendString, status, sourceLocation);
   }
 }
+
+/**
+ * @brief Sets how the OpenGL functions of the abcg namespace check for
+ * errors.
+ *
+ * This must be called after the OpenGL context is created and made current.
+ * abcg::OpenGLWindow calls it with abcg::OpenGLSettings::errorCheck and
+ * abcg::OpenGLSettings::errorCheckInterval.
+ *
+ * @param mode Error checking mode.
+ * @param interval Number of frames between checked frames in
+ * abcg::OpenGLErrorCheck::Sampled mode.
+ *
+ * @remark In abcg::OpenGLErrorCheck::DebugCallback mode, debug messages are
+ * guaranteed to be generated only by contexts created with the debug flag.
+ */
+void abcg::setupGLErrorCheck(OpenGLErrorCheck mode, int interval) {
+  errorCheckMode = mode;
+  sampleInterval = gsl::narrow<uint64_t>(std::max(interval, 1));
+  frameNumber = 0;
+  pendingErrorMessage.clear();
+  pendingErrorCode = GL_NO_ERROR;
+  deferredError = false;
+  deferredErrorMessage.clear();
+  deferredErrorCode = GL_NO_ERROR;
+  detail::glErrorCheckState = {};
+
+  if (mode == OpenGLErrorCheck::DebugCallback) {
+    if (GLEW_KHR_debug == GL_TRUE) {
+      // Synchronous output calls the callback before the function that raised
+      // the error returns
+      glEnable(GL_DEBUG_OUTPUT);
+      glEnable(GL_DEBUG_OUTPUT_SYNCHRONOUS);
+      glDebugMessageControl(GL_DONT_CARE, GL_DONT_CARE, GL_DONT_CARE, 0,
+                            nullptr, GL_FALSE);
+      glDebugMessageControl(GL_DONT_CARE, GL_DEBUG_TYPE_ERROR, GL_DONT_CARE, 0,
+                            nullptr, GL_TRUE);
+      glDebugMessageCallback(debugMessageCallback, nullptr);
+    } else {
+      fmt::print(stderr, "GL_KHR_debug is not supported. OpenGL errors will "
+                         "be checked after each function call\n");
+      errorCheckMode = OpenGLErrorCheck::EachCall;
+    }
+  }
+
+  // Calls made before the first frame (e.g., in onCreate) are checked in
+  // sampled mode
+  detail::glErrorCheckState.checkEachCall =
+      errorCheckMode == OpenGLErrorCheck::EachCall ||
+      errorCheckMode == OpenGLErrorCheck::Sampled;
+}
+
+/**
+ * @brief Begins a frame for error checking.
+ *
+ * In abcg::OpenGLErrorCheck::Sampled mode, this enables the checks of the
+ * function calls if the frame is sampled, and disables them otherwise.
+ * abcg::OpenGLWindow calls it at the beginning of each frame.
+ *
+ * @param sourceLocation Information about the source code, used for logging
+ * errors raised by frames that were not checked.
+ *
+ * @throw abcg::OpenGLError if a frame that was not checked raised an error.
+ */
+void abcg::beginGLErrorCheckFrame(source_location const &sourceLocation) {
+  if (errorCheckMode != OpenGLErrorCheck::Sampled) {
+    return;
+  }
+
+  auto const sampled{frameNumber++ % sampleInterval == 0};
+  if (sampled) {
+    checkGLError(sourceLocation, "raised by a frame that was not checked");
+  }
+  detail::glErrorCheckState.checkEachCall = sampled;
+}
+
+/**
+ * @brief Ends a frame for error checking.
+ *
+ * In abcg::OpenGLErrorCheck::FrameBoundary mode, this calls `glGetError`.
+ * In abcg::OpenGLErrorCheck::DebugCallback mode, this reports errors raised
+ * by OpenGL functions that were not called through the abcg namespace. Only
+ * the first of these errors is reported, with the source location of the
+ * frame boundary. abcg::OpenGLWindow calls it at the end of each frame,
+ * before swapping the buffers.
+ *
+ * @param sourceLocation Information about the source code, used for logging.
+ *
+ * @throw abcg::OpenGLError if an error was raised during the frame.
+ */
+void abcg::endGLErrorCheckFrame(source_location const &sourceLocation) {
+  if (errorCheckMode == OpenGLErrorCheck::FrameBoundary) {
+    checkGLError(sourceLocation, "at frame boundary");
+    return;
+  }
+
+  // Raised after the last function called through the abcg namespace
+  if (detail::glErrorCheckState.pendingError) {
+    detail::deferPendingGLError();
+  }
+  if (deferredError) {
+    deferredError = false;
+    auto const message{std::exchange(deferredErrorMessage, {})};
+    throw abcg::OpenGLError(
+        fmt::format("raised by a function not called through the abcg "
+                    "namespace: {}",
+                    message),
+        std::exchange(deferredErrorCode, GLenum{GL_NO_ERROR}), sourceLocation);
+  }
+}
+
+// Throws the error reported by the debug callback during the function call
+void abcg::detail::throwPendingGLError(source_location const &sourceLocation) {
+  glErrorCheckState.pendingError = false;
+  auto const message{std::exchange(pendingErrorMessage, {})};
+  throw abcg::OpenGLError(fmt::format("AFTER function call: {}", message),
+                          takePendingErrorCode(), sourceLocation);
+}
+
+// Keeps the error reported by the debug callback for
+// abcg::endGLErrorCheckFrame, as it was raised by a function that was not
+// called through the abcg namespace
+void abcg::detail::deferPendingGLError() {
+  glErrorCheckState.pendingError = false;
+  auto const code{takePendingErrorCode()};
+  if (!deferredError) {
+    deferredError = true;
+    deferredErrorMessage = std::exchange(pendingErrorMessage, {});
+    deferredErrorCode = code;
+  }
+}
 #endif
@@ -40,14 +40,106 @@ using source_location = std::source_location;
 #pragma warning(disable : 4702)
 #endif
 
+namespace abcg {
+enum class OpenGLErrorCheck;
+} // namespace abcg
+
+/**
+ * @brief Enumeration of the ways the OpenGL functions of the abcg namespace
+ * check for errors.
+ *
+ * Errors are checked only in debug builds. In release builds (`NDEBUG`), and
+ * when building for WebAssembly or macOS, the functions call OpenGL directly
+ * whatever the mode.
+ *
+ * @sa abcg::OpenGLSettings::errorCheck.
+ */
+enum class abcg::OpenGLErrorCheck {
+  /** @brief Calls `glGetError` before and after each function call.
+   *
+   * This is the most precise mode, but each `glGetError` may serialize the
+   * driver.
+   */
+  EachCall,
+  /** @brief Receives errors from a `GL_KHR_debug` callback with synchronous
+   * output instead of polling `glGetError`.
+   *
+   * Errors are still reported with the source location of the function call
+   * that raised them. Errors raised by OpenGL functions that are not called
+   * through the abcg namespace (e.g., by ImGui) have no such location and are
+   * reported by abcg::endGLErrorCheckFrame. If `GL_KHR_debug` is not
+   * supported, this falls back to abcg::OpenGLErrorCheck::EachCall.
+   */
+  DebugCallback,
+  /** @brief Checks each function call only during one of every
+   * abcg::OpenGLSettings::errorCheckInterval frames.
+   *
+   * Errors raised by the frames that are not checked are reported at the
+   * beginning of the next checked frame.
+   */
+  Sampled,
+  /** @brief Calls `glGetError` only once at the end of each frame.
+   *
+   * Errors are reported with the source location of the frame boundary.
+   */
+  FrameBoundary
+};
+
 namespace abcg {
 #if !defined(NDEBUG) && !defined(__EMSCRIPTEN__) && !defined(__APPLE__)
 
 void checkGLError(source_location const &sourceLocation,
                   std::string_view appendString);
+void setupGLErrorCheck(OpenGLErrorCheck mode, int interval);
+void beginGLErrorCheckFrame(
+    source_location const &sourceLocation = source_location::current());
+void endGLErrorCheckFrame(
+    source_location const &sourceLocation = source_location::current());
+
+namespace detail {
+// Read by callGL on every call, so it is kept inline instead of behind a
+// function call
+struct GLErrorCheckState {
+  // Whether glGetError is called around each function call
+  bool checkEachCall{true};
+  // Whether the debug callback reported an error that was not thrown yet
+  bool pendingError{};
+};
+inline GLErrorCheckState glErrorCheckState;
+
+[[noreturn]] void throwPendingGLError(source_location const &sourceLocation);
+void deferPendingGLError();
+
+// Checks for errors raised before a function call
+inline void checkGLCallBefore(source_location const &sourceLocation,
+                              bool checkEachCall) {
+  if (checkEachCall) {
+    checkGLError(sourceLocation, "BEFORE function call");
+  } else if (glErrorCheckState.pendingError) {
+    // Raised by a function that was not called through the abcg namespace, so
+    // it is not attributed to this call
+    deferPendingGLError();
+  }
+}
+
+// Checks for errors raised by a function call
+inline void checkGLCall(source_location const &sourceLocation,
+                        bool checkEachCall) {
+  if (checkEachCall) {
+    checkGLError(sourceLocation, "AFTER function call");
+  } else if (glErrorCheckState.pendingError) {
+    throwPendingGLError(sourceLocation);
+  }
+}
+} // namespace detail
 
 /**
- * @brief Checks for OpenGL errors before and after a function call.
+ * @brief Checks for OpenGL errors raised by a function call.
+ *
+ * Depending on the abcg::OpenGLErrorCheck mode set by
+ * abcg::setupGLErrorCheck, this calls `glGetError` before and after the
+ * function call, or only checks whether the debug callback reported an error
+ * during the call.
  *
  * @tparam TFun Function typename.
  * @tparam TArgs Variadic arguments typename.
@@ -61,16 +153,17 @@ void checkGLError(source_location const &sourceLocation,
 template <typename TFun, typename... TArgs>
 auto callGL(source_location const &sourceLocation, TFun &&function,
             TArgs &&...args) {
-  checkGLError(sourceLocation, "BEFORE function call");
+  auto const checkEachCall{detail::glErrorCheckState.checkEachCall};
+  detail::checkGLCallBefore(sourceLocation, checkEachCall);
   if constexpr (!std::is_void_v<std::invoke_result_t<TFun, TArgs...>>) {
     // Specialization for functions that do not return void
     auto &&res{std::forward<TFun>(function)(std::forward<TArgs>(args)...)};
-    checkGLError(sourceLocation, "AFTER function call");
+    detail::checkGLCall(sourceLocation, checkEachCall);
     return res;
   }
   // Specialization for functions that return void
   std::forward<TFun>(function)(std::forward<TArgs>(args)...);
-  checkGLError(sourceLocation, "AFTER function call");
+  detail::checkGLCall(sourceLocation, checkEachCall);
 }
 
 #else
@@ -81,6 +174,14 @@ struct source_location {
   }
 };
 
+// Errors are not checked, so there is nothing to set up
+inline void setupGLErrorCheck([[maybe_unused]] OpenGLErrorCheck mode,
+                              [[maybe_unused]] int interval) {}
+inline void beginGLErrorCheckFrame(
+    [[maybe_unused]] source_location sourceLocation = {}) {}
+inline void
+endGLErrorCheckFrame([[maybe_unused]] source_location sourceLocation = {}) {}
+
 /**
  * @brief Calls a function with given arguments.
  *
@@ -9,48 +9,178 @@
  */
 
 #include "abcgOpenGLImage.hpp"
+#include "abcgCompressedImage.hpp"
 #include "abcgImage.hpp"
 
 #include <cppitertools/itertools.hpp>
 #include <fmt/core.h>
 #include <gsl/gsl>
 
+#include <algorithm>
+#include <bit>
+#include <chrono>
+#include <cstring>
+
 #include "abcgException.hpp"
+#include "abcgOpenGLFunction.hpp"
+
+// Block-compressed formats are not declared by all OpenGL headers
+#if !defined(GL_COMPRESSED_RGBA_S3TC_DXT1_EXT)
+#define GL_COMPRESSED_RGBA_S3TC_DXT1_EXT 0x83F1
+#define GL_COMPRESSED_RGBA_S3TC_DXT5_EXT 0x83F3
+#endif
+#if !defined(GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT1_EXT)
+#define GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT1_EXT 0x8C4D
+#define GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT5_EXT 0x8C4F
+#endif
+#if !defined(GL_COMPRESSED_RG_RGTC2)
+#define GL_COMPRESSED_RG_RGTC2 0x8DBD
+#endif
+#if !defined(GL_COMPRESSED_RGBA_BPTC_UNORM)
+#define GL_COMPRESSED_RGBA_BPTC_UNORM 0x8E8C
+#define GL_COMPRESSED_SRGB_ALPHA_BPTC_UNORM 0x8E8D
+#endif
+
+namespace {
+
+GLenum getOpenGLFormat(abcg::CompressedFormat format, bool sRGB) {
+  switch (format) {
+  case abcg::CompressedFormat::BC1:
+    return sRGB ? GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT1_EXT
+                : GL_COMPRESSED_RGBA_S3TC_DXT1_EXT;
+  case abcg::CompressedFormat::BC3:
+    return sRGB ? GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT5_EXT
+                : GL_COMPRESSED_RGBA_S3TC_DXT5_EXT;
+  case abcg::CompressedFormat::BC5:
+    return GL_COMPRESSED_RG_RGTC2;
+  case abcg::CompressedFormat::BC7:
+    return sRGB ? GL_COMPRESSED_SRGB_ALPHA_BPTC_UNORM
+                : GL_COMPRESSED_RGBA_BPTC_UNORM;
+  }
+  return GL_NONE;
+}
+
+// Returns whether textures of a block-compressed format can be created
+bool isCompressedFormatSupported(abcg::CompressedFormat format, bool sRGB) {
+#if defined(__EMSCRIPTEN__)
+  // WebGL requires extensions to be enabled before use
+  auto const enable{[](char const *extension) {
+    return emscripten_webgl_enable_extension(
+               emscripten_webgl_get_current_context(), extension) == EM_TRUE;
+  }};
+  switch (format) {
+  case abcg::CompressedFormat::BC1:
+  case abcg::CompressedFormat::BC3:
+    return enable("WEBGL_compressed_texture_s3tc") &&
+           (!sRGB || enable("WEBGL_compressed_texture_s3tc_srgb"));
+  case abcg::CompressedFormat::BC5:
+    return enable("EXT_texture_compression_rgtc");
+  case abcg::CompressedFormat::BC7:
+    return enable("EXT_texture_compression_bptc");
+  }
+#else
+  switch (format) {
+  case abcg::CompressedFormat::BC1:
+  case abcg::CompressedFormat::BC3:
+    return GLEW_EXT_texture_compression_s3tc == GL_TRUE &&
+           (!sRGB || GLEW_EXT_texture_sRGB == GL_TRUE);
+  case abcg::CompressedFormat::BC5:
+    return GLEW_VERSION_3_0 == GL_TRUE ||
+           GLEW_ARB_texture_compression_rgtc == GL_TRUE;
+  case abcg::CompressedFormat::BC7:
+    return GLEW_VERSION_4_2 == GL_TRUE ||
+           GLEW_ARB_texture_compression_bptc == GL_TRUE;
+  }
+#endif
+  return false;
+}
+
+// Uploads the mipmap levels of a KTX2/DDS file without decoding them
+GLuint loadCompressedTexture(abcg::OpenGLTextureCreateInfo const &createInfo) {
+  abcg::CompressedImage const image{createInfo.path};
+  auto const levels{image.getLevels()};
+
+  // As with uncompressed images, the color space is chosen by the create
+  // info, not by the file
+  if (!isCompressedFormatSupported(image.getFormat(),
+                                   createInfo.sRGBToLinear)) {
+    throw abcg::RuntimeError(
+        fmt::format("The compressed format of texture file {} is not supported",
+                    createInfo.path));
+  }
+  auto const internalFormat{
+      getOpenGLFormat(image.getFormat(), createInfo.sRGBToLinear)};
+
+  GLuint textureID{};
+  abcg::glGenTextures(1, &textureID);
+  abcg::glBindTexture(GL_TEXTURE_2D, textureID);
+
+  auto const numLevels{createInfo.generateMipmaps ? levels.size() : 1};
+  for (auto &&[index, level] : iter::enumerate(levels.first(numLevels))) {
+    abcg::glCompressedTexImage2D(
+        GL_TEXTURE_2D, gsl::narrow<GLint>(index), internalFormat,
+        gsl::narrow<GLsizei>(level.width), gsl::narrow<GLsizei>(level.height),
+        0, gsl::narrow<GLsizei>(level.data.size()), level.data.data());
+  }
+
+  // Mipmap levels cannot be generated from compressed data. Only the levels
+  // stored in the file are used.
+  abcg::glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL,
+                        gsl::narrow<GLint>(numLevels - 1));
+  abcg::glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER,
+                        numLevels > 1 ? GL_LINEAR_MIPMAP_LINEAR : GL_LINEAR);
+  abcg::glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+  abcg::glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+  abcg::glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+
+  abcg::glBindTexture(GL_TEXTURE_2D, 0);
+
+  return textureID;
+}
+
+} // namespace
 
 /**
  * @brief Creates an OpenGL 2D texture from an image loaded from a filesystem
  * path.
  *
+ * Block-compressed KTX2 and DDS files are uploaded with
+ * glCompressedTexImage2D, without being decoded.
+ *
  * @param createInfo Texture creation settings.
  *
- * @throw abcg::RuntimeError if the image could not be loaded.
+ * @throw abcg::RuntimeError if the image could not be loaded, or if its
+ * compressed format is not supported by the OpenGL implementation.
  *
  * @return ID of the texture, as generated by glGenTextures.
  */
 GLuint abcg::loadOpenGLTexture(OpenGLTextureCreateInfo const &createInfo) {
+  if (CompressedImage::isCompressedImagePath(createInfo.path)) {
+    return loadCompressedTexture(createInfo);
+  }
+
   GLuint textureID{};
 
   if (SDL_Surface *const surface{IMG_Load(createInfo.path.data())}) {
-    // Enforce RGB/RGBA
+    // Enforce RGB/RGBA, flipping upside down in the same pass
     GLenum internalFormat{};
     GLenum format{};
     SDL_Surface *formattedSurface{};
     if (surface->format->BytesPerPixel == 3) {
-      formattedSurface =
-          SDL_ConvertSurfaceFormat(surface, SDL_PIXELFORMAT_RGB24, 0);
+      formattedSurface = convertSurface(*surface, SDL_PIXELFORMAT_RGB24,
+                                        createInfo.flipUpsideDown);
       internalFormat = createInfo.sRGBToLinear ? GL_SRGB8 : GL_RGB;
       format = GL_RGB;
     } else {
-      formattedSurface =
-          SDL_ConvertSurfaceFormat(surface, SDL_PIXELFORMAT_RGBA32, 0);
+      formattedSurface = convertSurface(*surface, SDL_PIXELFORMAT_RGBA32,
+                                        createInfo.flipUpsideDown);
       internalFormat = createInfo.sRGBToLinear ? GL_SRGB8_ALPHA8 : GL_RGBA;
       format = GL_RGBA;
     }
     SDL_FreeSurface(surface);
-
-    // Flip upside down
-    if (createInfo.flipUpsideDown) {
-      flipVertically(*formattedSurface);
+    if (formattedSurface == nullptr) {
+      throw abcg::RuntimeError(
+          fmt::format("Failed to convert texture file {}", createInfo.path));
     }
 
     // Generate the texture
@@ -106,20 +236,24 @@ GLuint abcg::loadOpenGLCubemap(OpenGLCubemapCreateInfo const &createInfo) {
   for (auto &&[index, path] : iter::enumerate(createInfo.paths)) {
     // Load the bitmap
     if (SDL_Surface *const surface{IMG_Load(path.data())}) {
-      // Enforce RGB
+      auto target{GL_TEXTURE_CUBE_MAP_POSITIVE_X + gsl::narrow<GLenum>(index)};
+      auto const isYFace{target == GL_TEXTURE_CUBE_MAP_POSITIVE_Y ||
+                         target == GL_TEXTURE_CUBE_MAP_NEGATIVE_Y};
+
+      // Enforce RGB. In a right-handed system, the Y faces are flipped upside
+      // down in the same pass.
       SDL_Surface *const formattedSurface{
-          SDL_ConvertSurfaceFormat(surface, SDL_PIXELFORMAT_RGB24, 0)};
+          convertSurface(*surface, SDL_PIXELFORMAT_RGB24,
+                         createInfo.rightHandedSystem && isYFace)};
       SDL_FreeSurface(surface);
-
-      auto target{GL_TEXTURE_CUBE_MAP_POSITIVE_X + gsl::narrow<GLenum>(index)};
+      if (formattedSurface == nullptr) {
+        throw abcg::RuntimeError(
+            fmt::format("Failed to convert texture file {}", path));
+      }
 
       // LHS to RHS
       if (createInfo.rightHandedSystem) {
-        if (target == GL_TEXTURE_CUBE_MAP_POSITIVE_Y ||
-            target == GL_TEXTURE_CUBE_MAP_NEGATIVE_Y) {
-          // Flip upside down
-          flipVertically(*formattedSurface);
-        } else {
+        if (!isYFace) {
           flipHorizontally(*formattedSurface);
         }
 
@@ -160,4 +294,364 @@ GLuint abcg::loadOpenGLCubemap(OpenGLCubemapCreateInfo const &createInfo) {
   }
 
   return textureID;
-}
\ No newline at end of file
+}
+
+/**
+ * @brief Constructs a texture loader.
+ *
+ * @param numThreads Number of worker threads used for decoding images. If
+ * zero, images are decoded synchronously by the functions that start the
+ * loading, and only the upload is deferred.
+ */
+abcg::OpenGLTextureLoader::OpenGLTextureLoader(std::size_t numThreads)
+    : m_pool(numThreads) {}
+
+/**
+ * @brief Starts loading a 2D texture from an image file.
+ *
+ * @param createInfo Texture creation settings.
+ * @param placeholderColor RGBA color of the 1x1 image used until the texture
+ * is loaded. For normal maps, use e.g. {128, 128, 255, 255}.
+ *
+ * @return ID of the texture, as generated by glGenTextures.
+ *
+ * @remark If the image cannot be loaded, abcg::OpenGLTextureLoader::update
+ * throws abcg::RuntimeError and the texture keeps the placeholder image.
+ *
+ * @remark Block-compressed KTX2/DDS files need no decoding and are loaded
+ * synchronously with abcg::loadOpenGLTexture.
+ */
+GLuint abcg::OpenGLTextureLoader::loadTexture(
+    OpenGLTextureCreateInfo const &createInfo,
+    std::array<GLubyte, 4> const &placeholderColor) {
+  if (CompressedImage::isCompressedImagePath(createInfo.path)) {
+    return loadOpenGLTexture(createInfo);
+  }
+
+  GLuint textureID{};
+  glGenTextures(1, &textureID);
+  glBindTexture(GL_TEXTURE_2D, textureID);
+  glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, 1, 1, 0, GL_RGBA, GL_UNSIGNED_BYTE,
+               placeholderColor.data());
+
+  // Set texture filtering
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+
+  // Set texture wrapping
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+
+  glBindTexture(GL_TEXTURE_2D, 0);
+
+  PendingTexture texture{.textureID = textureID,
+                         .target = GL_TEXTURE_2D,
+                         .sRGBToLinear = createInfo.sRGBToLinear,
+                         .generateMipmaps = createInfo.generateMipmaps,
+                         .faceTargets = {GL_TEXTURE_2D},
+                         .faces = {}};
+  texture.faces.push_back(
+      m_pool.submit([path = std::string{createInfo.path},
+                     flipUpsideDown = createInfo.flipUpsideDown] {
+        return decode(path, false, flipUpsideDown, false);
+      }));
+  m_pending.push_back(std::move(texture));
+
+  return textureID;
+}
+
+/**
+ * @brief Starts loading a cubemap texture from a set of image files.
+ *
+ * The six images are decoded in parallel and uploaded in the same call to
+ * abcg::OpenGLTextureLoader::update.
+ *
+ * @param createInfo Texture creation settings.
+ * @param placeholderColor RGBA color of the 1x1 images used until the texture
+ * is loaded.
+ *
+ * @return ID of the texture, as generated by glGenTextures.
+ *
+ * @remark If any image cannot be loaded, abcg::OpenGLTextureLoader::update
+ * throws abcg::RuntimeError and the texture keeps the placeholder images.
+ */
+GLuint abcg::OpenGLTextureLoader::loadCubemap(
+    OpenGLCubemapCreateInfo const &createInfo,
+    std::array<GLubyte, 4> const &placeholderColor) {
+  GLuint textureID{};
+  glGenTextures(1, &textureID);
+  glBindTexture(GL_TEXTURE_CUBE_MAP, textureID);
+
+  PendingTexture texture{.textureID = textureID,
+                         .target = GL_TEXTURE_CUBE_MAP,
+                         .sRGBToLinear = false,
+                         .generateMipmaps = createInfo.generateMipmaps,
+                         .faceTargets = {},
+                         .faces = {}};
+
+  for (auto &&[index, path] : iter::enumerate(createInfo.paths)) {
+    auto target{GL_TEXTURE_CUBE_MAP_POSITIVE_X + gsl::narrow<GLenum>(index)};
+    glTexImage2D(target, 0, GL_RGBA, 1, 1, 0, GL_RGBA, GL_UNSIGNED_BYTE,
+                 placeholderColor.data());
+
+    auto flipUpsideDown{false};
+    auto flipLeftRight{false};
+
+    // LHS to RHS
+    if (createInfo.rightHandedSystem) {
+      if (target == GL_TEXTURE_CUBE_MAP_POSITIVE_Y ||
+          target == GL_TEXTURE_CUBE_MAP_NEGATIVE_Y) {
+        flipUpsideDown = true;
+      } else {
+        flipLeftRight = true;
+      }
+
+      // Swap -z and +z
+      if (target == GL_TEXTURE_CUBE_MAP_POSITIVE_Z)
+        target = GL_TEXTURE_CUBE_MAP_NEGATIVE_Z;
+      else if (target == GL_TEXTURE_CUBE_MAP_NEGATIVE_Z)
+        target = GL_TEXTURE_CUBE_MAP_POSITIVE_Z;
+    }
+
+    texture.faceTargets.push_back(target);
+    texture.faces.push_back(m_pool.submit(
+        [path = std::string{path}, flipUpsideDown, flipLeftRight] {
+          return decode(path, true, flipUpsideDown, flipLeftRight);
+        }));
+  }
+
+  // Set texture wrapping
+  glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+  glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+  glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
+
+  // Set texture filtering
+  glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+  glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+
+  glBindTexture(GL_TEXTURE_CUBE_MAP, 0);
+
+  m_pending.push_back(std::move(texture));
+
+  return textureID;
+}
+
+/**
+ * @brief Uploads decoded images and generates mipmap levels.
+ *
+ * Must be called once per frame from the thread that owns the OpenGL context.
+ * Textures whose images are decoded are uploaded until the upload budget is
+ * reached. For each texture already uploaded, the next mipmap level is
+ * generated from the previous one. Until all levels are generated, the
+ * texture is sampled only from the levels generated so far.
+ *
+ * @throw abcg::RuntimeError if an image could not be loaded. The remaining
+ * textures are processed in subsequent calls.
+ */
+void abcg::OpenGLTextureLoader::update() {
+  std::size_t uploadedBytes{};
+
+  for (std::size_t index{}; index < m_pending.size();) {
+    auto &texture{m_pending[index]};
+    auto done{false};
+
+    if (glIsTexture(texture.textureID) == GL_FALSE) {
+      // Deleted by the user
+      done = true;
+    } else if (!texture.uploaded) {
+      auto const isDecoded{
+          std::ranges::all_of(texture.faces, [](auto const &face) {
+            return face.wait_for(std::chrono::seconds{0}) ==
+                   std::future_status::ready;
+          })};
+      if (isDecoded &&
+          (uploadedBytes == 0 || uploadedBytes < m_uploadBudget)) {
+        try {
+          uploadedBytes += upload(texture);
+        } catch (...) {
+          m_pending.erase(m_pending.begin() + gsl::narrow<long>(index));
+          throw;
+        }
+        done = texture.numReadyLevels == texture.numLevels;
+      }
+    } else {
+      done = generateNextLevel(texture);
+    }
+
+    if (done) {
+      m_pending.erase(m_pending.begin() + gsl::narrow<long>(index));
+    } else {
+      ++index;
+    }
+  }
+}
+
+/**
+ * @brief Stops loading a texture.
+ *
+ * The texture keeps the images uploaded so far. Images being decoded are
+ * discarded.
+ *
+ * @param textureID ID of a texture returned by
+ * abcg::OpenGLTextureLoader::loadTexture or
+ * abcg::OpenGLTextureLoader::loadCubemap.
+ */
+void abcg::OpenGLTextureLoader::cancel(GLuint textureID) {
+  std::erase_if(m_pending, [textureID](auto const &texture) {
+    return texture.textureID == textureID;
+  });
+}
+
+/**
+ * @brief Releases the OpenGL resources of the loader.
+ *
+ * Textures not completely loaded are left as they are. Their IDs remain
+ * valid and must be deleted by the user.
+ */
+void abcg::OpenGLTextureLoader::destroy() {
+  glDeleteBuffers(1, &m_unpackBuffer);
+  m_unpackBuffer = 0;
+  m_pending.clear();
+}
+
+/**
+ * @brief Returns whether a texture is still being loaded.
+ *
+ * @param textureID ID of a texture returned by
+ * abcg::OpenGLTextureLoader::loadTexture or
+ * abcg::OpenGLTextureLoader::loadCubemap.
+ *
+ * @return True if the texture is not completely loaded, including its mipmap
+ * levels; false otherwise.
+ */
+bool abcg::OpenGLTextureLoader::isLoading(GLuint textureID) const {
+  return std::ranges::any_of(m_pending, [textureID](auto const &texture) {
+    return texture.textureID == textureID;
+  });
+}
+
+abcg::OpenGLTextureLoader::Image
+abcg::OpenGLTextureLoader::decode(std::string const &path, bool forceRGB,
+                                  bool flipUpsideDown, bool flipLeftRight) {
+  SDL_Surface *const surface{IMG_Load(path.c_str())};
+  if (surface == nullptr) {
+    throw abcg::RuntimeError(
+        fmt::format("Failed to load texture file {}", path));
+  }
+
+  auto const freeSurface{
+      gsl::finally([surface] { SDL_FreeSurface(surface); })};
+
+  auto const isRGB{forceRGB || surface->format->BytesPerPixel == 3};
+  Image image{.pixels = {},
+              .width = surface->w,
+              .height = surface->h,
+              .format = static_cast<GLenum>(isRGB ? GL_RGB : GL_RGBA)};
+
+  // Enforce RGB/RGBA and copy rows without padding, flipping upside down in
+  // the same pass
+  auto const bytesPerPixel{isRGB ? 3UL : 4UL};
+  auto const width{gsl::narrow<std::size_t>(image.width)};
+  auto const height{gsl::narrow<std::size_t>(image.height)};
+  image.pixels.resize(width * height * bytesPerPixel);
+  if (!convertPixels(*surface,
+                     isRGB ? SDL_PIXELFORMAT_RGB24 : SDL_PIXELFORMAT_RGBA32,
+                     image.pixels, 0, flipUpsideDown)) {
+    throw abcg::RuntimeError(
+        fmt::format("Failed to convert texture file {}", path));
+  }
+
+  if (flipLeftRight) {
+    flipHorizontally(image.pixels, width, height, bytesPerPixel);
+  }
+
+  return image;
+}
+
+// Uploads the images of a texture through the pixel unpack buffer. Returns the
+// number of bytes uploaded.
+std::size_t abcg::OpenGLTextureLoader::upload(PendingTexture &texture) {
+  // Rethrows any exception thrown while decoding
+  std::vector<Image> images;
+  for (auto &face : texture.faces) {
+    images.push_back(face.get());
+  }
+  texture.faces.clear();
+
+  if (m_unpackBuffer == 0) {
+    glGenBuffers(1, &m_unpackBuffer);
+  }
+
+  GLint unpackAlignment{};
+  glGetIntegerv(GL_UNPACK_ALIGNMENT, &unpackAlignment);
+  glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+
+  glBindTexture(texture.target, texture.textureID);
+  glBindBuffer(GL_PIXEL_UNPACK_BUFFER, m_unpackBuffer);
+
+  std::size_t uploadedBytes{};
+  for (auto &&[image, target] : iter::zip(images, texture.faceTargets)) {
+    GLenum internalFormat{image.format};
+    if (texture.sRGBToLinear) {
+      internalFormat = image.format == GL_RGB ? GL_SRGB8 : GL_SRGB8_ALPHA8;
+    }
+
+    // Orphan the previous storage of the buffer, as it may still be in use by
+    // a previous transfer
+    auto const size{gsl::narrow<GLsizeiptr>(image.pixels.size())};
+    glBufferData(GL_PIXEL_UNPACK_BUFFER, size, nullptr, GL_STREAM_DRAW);
+    glBufferSubData(GL_PIXEL_UNPACK_BUFFER, 0, size, image.pixels.data());
+
+    // Pixels are read from offset 0 of the bound unpack buffer
+    glTexImage2D(target, 0, gsl::narrow<GLint>(internalFormat), image.width,
+                 image.height, 0, image.format, GL_UNSIGNED_BYTE, nullptr);
+
+    uploadedBytes += image.pixels.size();
+  }
+
+  glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+  glPixelStorei(GL_UNPACK_ALIGNMENT, unpackAlignment);
+
+  texture.uploaded = true;
+  texture.numReadyLevels = 1;
+  texture.numLevels = 1;
+  if (texture.generateMipmaps && !images.empty()) {
+    auto const size{std::max(images.front().width, images.front().height)};
+    texture.numLevels = gsl::narrow<GLint>(
+        std::bit_width(gsl::narrow<unsigned int>(std::max(size, 1))));
+
+    // Sample only the base level until the other levels are generated
+    glTexParameteri(texture.target, GL_TEXTURE_MAX_LEVEL, 0);
+  }
+
+  glBindTexture(texture.target, 0);
+
+  return uploadedBytes;
+}
+
+// Generates the next mipmap level of an uploaded texture from the previous
+// level. Returns true when all levels are generated.
+bool abcg::OpenGLTextureLoader::generateNextLevel(PendingTexture &texture) {
+  auto const level{texture.numReadyLevels};
+  glBindTexture(texture.target, texture.textureID);
+
+  // Restrict glGenerateMipmap to a single level
+  glTexParameteri(texture.target, GL_TEXTURE_BASE_LEVEL, level - 1);
+  glTexParameteri(texture.target, GL_TEXTURE_MAX_LEVEL, level);
+  glGenerateMipmap(texture.target);
+  glTexParameteri(texture.target, GL_TEXTURE_BASE_LEVEL, 0);
+
+  ++texture.numReadyLevels;
+  auto const done{texture.numReadyLevels == texture.numLevels};
+  if (done) {
+    // Restore the default maximum level
+    glTexParameteri(texture.target, GL_TEXTURE_MAX_LEVEL, 1000);
+  }
+
+  // Override minifying filtering
+  glTexParameteri(texture.target, GL_TEXTURE_MIN_FILTER,
+                  GL_LINEAR_MIPMAP_LINEAR);
+
+  glBindTexture(texture.target, 0);
+  return done;
+}
@@ -12,13 +12,19 @@
 #define ABCG_OPENGL_IMAGE_HPP_
 
 #include "abcgOpenGLExternal.hpp"
+#include "abcgThreadPool.hpp"
 
 #include <array>
+#include <cstddef>
+#include <future>
+#include <string>
 #include <string_view>
+#include <vector>
 
 namespace abcg {
 struct OpenGLTextureCreateInfo;
 struct OpenGLCubemapCreateInfo;
+class OpenGLTextureLoader;
 
 [[nodiscard]] GLuint
 loadOpenGLTexture(OpenGLTextureCreateInfo const &createInfo);
@@ -30,14 +36,18 @@ loadOpenGLCubemap(OpenGLCubemapCreateInfo const &createInfo);
  * @brief Configuration settings for creating a 2D texture for OpenGL.
  */
 struct abcg::OpenGLTextureCreateInfo {
-  /** @brief Path to the image file (PNG or JPEG). */
+  /** @brief Path to the image file (PNG or JPEG), or to a block-compressed
+   * KTX2/DDS file (see abcg::CompressedImage). */
   std::string_view path{};
-  /** @brief Whether to generate mipmap levels. */
+  /** @brief Whether to generate mipmap levels. For KTX2/DDS files, whether to
+   * use the mipmap levels stored in the file. */
   bool generateMipmaps{true};
-  /** @brief Whether to flip the image upside down. */
+  /** @brief Whether to flip the image upside down. Ignored for KTX2/DDS
+   * files, which must be flipped when converted. */
   bool flipUpsideDown{true};
   /** @brief Whether to apply gamma decoding (expansion) to convert an image in
-   * sRGB space to linear space. */
+   * sRGB space to linear space. This also applies to KTX2/DDS files, whose
+   * color space tag is ignored. */
   bool sRGBToLinear{false};
 };
 
@@ -55,4 +65,98 @@ struct abcg::OpenGLCubemapCreateInfo {
   bool rightHandedSystem{true};
 };
 
+/**
+ * @brief Loads OpenGL textures asynchronously.
+ *
+ * abcg::OpenGLTextureLoader::loadTexture and
+ * abcg::OpenGLTextureLoader::loadCubemap return immediately with the ID of a
+ * texture that contains a 1x1 placeholder image. The texture can be bound and
+ * sampled right away, while the image files are decoded and converted by a
+ * pool of worker threads.
+ *
+ * Decoded images are uploaded through a pixel unpack buffer by
+ * abcg::OpenGLTextureLoader::update, which must be called once per frame
+ * (e.g., in abcg::OpenGLWindow::onUpdate) from the thread that owns the
+ * OpenGL context. Each call uploads images up to a budget of bytes and
+ * generates at most one mipmap level for each uploaded texture, so that the
+ * cost of loading many large textures is spread across frames.
+ *
+ * @remark Before deleting a texture that may still be loading, call
+ * abcg::OpenGLTextureLoader::cancel. Otherwise, the pending image could be
+ * uploaded to a new texture that reuses the same ID.
+ */
+class abcg::OpenGLTextureLoader {
+public:
+  explicit OpenGLTextureLoader(
+      std::size_t numThreads = ThreadPool::getDefaultThreadCount());
+
+  [[nodiscard]] GLuint
+  loadTexture(OpenGLTextureCreateInfo const &createInfo,
+              std::array<GLubyte, 4> const &placeholderColor = {128, 128, 128,
+                                                                255});
+  [[nodiscard]] GLuint
+  loadCubemap(OpenGLCubemapCreateInfo const &createInfo,
+              std::array<GLubyte, 4> const &placeholderColor = {128, 128, 128,
+                                                                255});
+  void update();
+  void cancel(GLuint textureID);
+  void destroy();
+
+  [[nodiscard]] bool isLoading(GLuint textureID) const;
+
+  /**
+   * @brief Returns the number of textures not completely loaded.
+   *
+   * @return Number of textures whose images are being decoded or uploaded,
+   * or whose mipmap levels are being generated.
+   */
+  [[nodiscard]] std::size_t getPendingCount() const noexcept {
+    return m_pending.size();
+  }
+
+  /**
+   * @brief Sets the maximum number of bytes uploaded per call to
+   * abcg::OpenGLTextureLoader::update.
+   *
+   * At least one image is uploaded per call, even if it exceeds the budget.
+   *
+   * @param bytes Upload budget in bytes. The default is 32 MiB.
+   */
+  void setUploadBudget(std::size_t bytes) noexcept { m_uploadBudget = bytes; }
+
+private:
+  // Image decoded by a worker thread, with tightly packed rows
+  struct Image {
+    std::vector<std::byte> pixels;
+    GLsizei width{};
+    GLsizei height{};
+    GLenum format{};
+  };
+
+  struct PendingTexture {
+    GLuint textureID{};
+    GLenum target{};
+    bool sRGBToLinear{};
+    bool generateMipmaps{};
+    // One image for 2D textures, six for cubemaps
+    std::vector<GLenum> faceTargets;
+    std::vector<std::future<Image>> faces;
+    bool uploaded{};
+    // Number of mipmap levels of the complete texture, and number of levels
+    // with data so far
+    GLint numLevels{};
+    GLint numReadyLevels{};
+  };
+
+  std::vector<PendingTexture> m_pending;
+  GLuint m_unpackBuffer{};
+  std::size_t m_uploadBudget{std::size_t{32} << 20};
+  ThreadPool m_pool;
+
+  static Image decode(std::string const &path, bool forceRGB,
+                      bool flipUpsideDown, bool flipLeftRight);
+  std::size_t upload(PendingTexture &texture);
+  bool generateNextLevel(PendingTexture &texture);
+};
+
 #endif
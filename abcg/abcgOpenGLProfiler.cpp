@@ -0,0 +1,388 @@
+/**
+ * @file abcgOpenGLProfiler.cpp
+ * @brief Definition of abcg::OpenGLProfiler
+ *
+ * This file is part of ABCg (https://github.com/hbatagelo/abcg).
+ *
+ * @copyright (c) 2021--2023 Harlen Batagelo. All rights reserved.
+ * This project is released under the MIT License.
+ */
+
+#include "abcgOpenGLProfiler.hpp"
+
+#include <fmt/core.h>
+#include <fmt/format.h>
+
+#include <algorithm>
+#include <vector>
+
+#include "abcgProfilerCommon.hpp"
+
+namespace {
+// Number of queries generated at once when a slot runs out of queries
+constexpr std::size_t queryBlockSize{16};
+
+// Number of frames between calibrations of the GPU clock
+constexpr uint64_t calibrationInterval{64};
+
+// Draws the CPU and GPU scopes of a frame as rows of bars, one row per
+// nesting level
+void drawTimeline(abcg::OpenGLProfilerFrame const &frame) {
+  auto maxDepth{0};
+  auto begin{frame.begin};
+  auto end{frame.end};
+  std::vector<abcg::detail::ProfilerBar> bars;
+  for (auto const &event : frame.events) {
+    maxDepth = std::max(maxDepth, event.depth);
+    bars.push_back({.name = event.name,
+                    .label = "CPU",
+                    .row = event.depth,
+                    .begin = event.cpuBegin,
+                    .end = event.cpuEnd});
+    if (event.gpuBegin >= 0.0) {
+      begin = std::min(begin, event.gpuBegin);
+      end = std::max(end, event.gpuEnd);
+    }
+  }
+  // GPU rows are below the CPU rows
+  auto const rows{maxDepth + 1};
+  for (auto const &event : frame.events) {
+    if (event.gpuBegin >= 0.0) {
+      bars.push_back({.name = event.name,
+                      .label = "GPU",
+                      .row = rows + event.depth,
+                      .begin = event.gpuBegin,
+                      .end = event.gpuEnd});
+    }
+  }
+
+  abcg::detail::drawProfilerTimeline(bars, rows * 2, begin, end);
+  ImGui::Text("Frame %llu: %.3f ms (CPU), %.3f ms (CPU and GPU)",
+              static_cast<unsigned long long>(frame.number),
+              (frame.end - frame.begin) * 1000.0, (end - begin) * 1000.0);
+}
+} // namespace
+
+/**
+ * @brief Creates the profiler.
+ *
+ * The profiler is created disabled. Call abcg::OpenGLProfiler::setEnabled to
+ * start recording frames.
+ *
+ * @param historySize Number of frames kept in the history.
+ */
+void abcg::OpenGLProfiler::create(std::size_t historySize) {
+  destroy();
+
+  // The history must hold the frames whose queries are pending
+  m_frames.assign(std::max(historySize, m_querySlotCount + 1), {});
+  m_clock.restart();
+
+#if !defined(__EMSCRIPTEN__)
+  m_gpuSupported = GLEW_ARB_timer_query == GL_TRUE;
+  if (m_gpuSupported) {
+    calibrate();
+  }
+#endif
+}
+
+/**
+ * @brief Releases the query objects and the history of the profiler.
+ */
+void abcg::OpenGLProfiler::destroy() {
+  for (auto &slot : m_slots) {
+    if (!slot.queries.empty()) {
+      glDeleteQueries(gsl::narrow<GLsizei>(slot.queries.size()),
+                      slot.queries.data());
+    }
+    slot = {};
+  }
+  m_frames.clear();
+  m_openScopes.clear();
+  m_currentFrame = nullptr;
+  m_currentSlot = nullptr;
+  m_frameNumber = 0;
+  m_active = false;
+}
+
+/**
+ * @brief Sets whether the profiler records frames.
+ *
+ * @param enabled Whether to record frames, starting at the next call to
+ * abcg::OpenGLProfiler::beginFrame.
+ */
+void abcg::OpenGLProfiler::setEnabled(bool enabled) noexcept {
+  m_enabled = enabled;
+}
+
+/**
+ * @brief Returns whether the profiler records frames.
+ *
+ * @return `true` if the profiler is enabled.
+ */
+bool abcg::OpenGLProfiler::isEnabled() const noexcept { return m_enabled; }
+
+/**
+ * @brief Begins a frame.
+ *
+ * Reads the GPU times of the frame that used the same query slot, if they are
+ * available.
+ */
+void abcg::OpenGLProfiler::beginFrame() {
+  m_active = m_enabled && !m_paused && !m_frames.empty();
+  if (!m_active) {
+    return;
+  }
+
+  ++m_frameNumber;
+
+  m_currentSlot = &m_slots.at(m_frameNumber % m_slots.size());
+  resolve(*m_currentSlot);
+  m_currentSlot->frameNumber = m_frameNumber;
+  m_currentSlot->usedQueries = 0;
+  m_currentSlot->scopes.clear();
+
+  if (m_gpuSupported && m_frameNumber % calibrationInterval == 0) {
+    calibrate();
+  }
+
+  m_currentFrame = &m_frames.at(m_frameNumber % m_frames.size());
+  m_currentFrame->number = m_frameNumber;
+  m_currentFrame->begin = now();
+  m_currentFrame->end = m_currentFrame->begin;
+  m_currentFrame->gpuResolved = false;
+  m_currentFrame->events.clear();
+  m_openScopes.clear();
+}
+
+/**
+ * @brief Ends the frame.
+ *
+ * Scopes that were not ended are ended at this point.
+ */
+void abcg::OpenGLProfiler::endFrame() {
+  if (!m_active) {
+    return;
+  }
+
+  while (!m_openScopes.empty()) {
+    endScope();
+  }
+
+  m_currentFrame->end = now();
+  // There is nothing to wait for if no GPU scope was measured
+  m_currentFrame->gpuResolved = m_currentSlot->scopes.empty();
+  m_active = false;
+}
+
+/**
+ * @brief Begins a scope.
+ *
+ * Prefer using abcg::OpenGLProfiler::Scope, which ends the scope
+ * automatically. Scopes must end in the reverse order they begin.
+ *
+ * @param name Name of the scope. The string is not copied and must outlive
+ * the profiler (e.g., a string literal).
+ * @param gpu Whether to also measure the GPU time of the commands issued in
+ * the scope.
+ */
+void abcg::OpenGLProfiler::beginScope(std::string_view name,
+                                      [[maybe_unused]] bool gpu) {
+  if (!m_active) {
+    return;
+  }
+
+  auto &events{m_currentFrame->events};
+  auto &scope{m_openScopes.emplace_back()};
+  scope.event = events.size();
+  events.push_back(
+      {.name = name,
+       .depth = gsl::narrow<int>(m_openScopes.size() - 1),
+       .cpuBegin = now()});
+
+#if !defined(__EMSCRIPTEN__)
+  if (gpu && m_gpuSupported) {
+    auto &slot{*m_currentSlot};
+    if (slot.usedQueries + 2 > slot.queries.size()) {
+      auto const first{slot.queries.size()};
+      slot.queries.resize(first + queryBlockSize);
+      glGenQueries(gsl::narrow<GLsizei>(queryBlockSize),
+                   &slot.queries.at(first));
+    }
+    scope.query = slot.usedQueries;
+    slot.scopes.emplace_back(scope.event, slot.usedQueries);
+    glQueryCounter(slot.queries.at(slot.usedQueries), GL_TIMESTAMP);
+    slot.usedQueries += 2;
+  }
+#endif
+}
+
+/**
+ * @brief Ends the last scope that began.
+ */
+void abcg::OpenGLProfiler::endScope() {
+  if (!m_active || m_openScopes.empty()) {
+    return;
+  }
+
+  auto const scope{m_openScopes.back()};
+  m_openScopes.pop_back();
+
+#if !defined(__EMSCRIPTEN__)
+  if (scope.query.has_value()) {
+    glQueryCounter(m_currentSlot->queries.at(scope.query.value() + 1),
+                   GL_TIMESTAMP);
+  }
+#endif
+
+  m_currentFrame->events.at(scope.event).cpuEnd = now();
+}
+
+/**
+ * @brief Returns the frames of the history.
+ *
+ * @return Frames that have ended, from the oldest to the newest.
+ */
+std::vector<abcg::OpenGLProfilerFrame const *>
+abcg::OpenGLProfiler::getFrames() const {
+  std::vector<OpenGLProfilerFrame const *> frames;
+  frames.reserve(m_frames.size());
+  for (auto const offset : iter::range(m_frames.size())) {
+    auto const &frame{
+        m_frames.at((m_frameNumber + 1 + offset) % m_frames.size())};
+    if (frame.number == 0 || (m_active && &frame == m_currentFrame)) {
+      continue;
+    }
+    frames.push_back(&frame);
+  }
+  return frames;
+}
+
+/**
+ * @brief Returns the newest frame whose GPU times are available.
+ *
+ * @return Pointer to the frame, or nullptr if there is no such frame.
+ */
+abcg::OpenGLProfilerFrame const *
+abcg::OpenGLProfiler::getLastResolvedFrame() const {
+  auto const frames{getFrames()};
+  auto const iter{std::find_if(frames.rbegin(), frames.rend(), [](auto frame) {
+    return frame->gpuResolved;
+  })};
+  return iter != frames.rend() ? *iter : nullptr;
+}
+
+/**
+ * @brief Draws a Dear ImGui window with the frame times of the history and
+ * the timeline of the newest frame whose GPU times are available.
+ *
+ * This must be called between `ImGui::NewFrame` and `ImGui::Render` (e.g.,
+ * in abcg::OpenGLWindow::onPaintUI).
+ */
+void abcg::OpenGLProfiler::drawOverlay() {
+  ImGui::SetNextWindowPos(ImVec2(5, 70), ImGuiCond_FirstUseEver);
+  ImGui::SetNextWindowSize(ImVec2(480, 0), ImGuiCond_FirstUseEver);
+  if (!ImGui::Begin("Profiler")) {
+    ImGui::End();
+    return;
+  }
+
+  auto const frames{getFrames()};
+  std::vector<float> frameTimes;
+  frameTimes.reserve(frames.size());
+  for (auto const *frame : frames) {
+    frameTimes.push_back(
+        gsl::narrow_cast<float>((frame->end - frame->begin) * 1000.0));
+  }
+
+  detail::drawProfilerFrameTimes(frameTimes, m_paused);
+  detail::drawProfilerSaveButton(
+      "Save trace", "trace.json",
+      [this](std::string_view path) { saveChromeTrace(path); });
+
+  if (auto const *frame{getLastResolvedFrame()}) {
+    drawTimeline(*frame);
+  }
+
+  ImGui::End();
+}
+
+/**
+ * @brief Saves the frames of the history in the Chrome trace event format.
+ *
+ * The file can be opened in `chrome://tracing` or in Perfetto
+ * (https://ui.perfetto.dev). CPU and GPU scopes are shown as separate
+ * threads.
+ *
+ * @param path Path of the JSON file.
+ *
+ * @throw abcg::RuntimeError if the file cannot be written.
+ */
+void abcg::OpenGLProfiler::saveChromeTrace(std::string_view path) const {
+  detail::ChromeTrace trace;
+  trace.setThreadName(1, "CPU");
+  trace.setThreadName(2, "GPU");
+  for (auto const *frame : getFrames()) {
+    trace.addEvent(fmt::format("Frame {}", frame->number), 1, frame->begin,
+                   frame->end);
+    for (auto const &event : frame->events) {
+      trace.addEvent(event.name, 1, event.cpuBegin, event.cpuEnd);
+      if (event.gpuBegin >= 0.0) {
+        trace.addEvent(event.name, 2, event.gpuBegin, event.gpuEnd);
+      }
+    }
+  }
+  trace.save(path);
+}
+
+double abcg::OpenGLProfiler::now() const { return m_clock.elapsed(); }
+
+// Reads the GPU times of the scopes of a slot if all of them are available.
+// Otherwise, the times are dropped
+void abcg::OpenGLProfiler::resolve([[maybe_unused]] QuerySlot &slot) {
+#if !defined(__EMSCRIPTEN__)
+  if (slot.scopes.empty()) {
+    return;
+  }
+
+  auto &frame{m_frames.at(slot.frameNumber % m_frames.size())};
+  if (frame.number != slot.frameNumber) {
+    return;
+  }
+
+  for (auto const index : iter::range(slot.usedQueries)) {
+    GLint available{};
+    glGetQueryObjectiv(slot.queries.at(index), GL_QUERY_RESULT_AVAILABLE,
+                       &available);
+    if (available == GL_FALSE) {
+      return;
+    }
+  }
+
+  for (auto const &[eventIndex, queryIndex] : slot.scopes) {
+    GLuint64 begin{};
+    GLuint64 end{};
+    glGetQueryObjectui64v(slot.queries.at(queryIndex), GL_QUERY_RESULT,
+                          &begin);
+    glGetQueryObjectui64v(slot.queries.at(queryIndex + 1), GL_QUERY_RESULT,
+                          &end);
+    auto &event{frame.events.at(eventIndex)};
+    event.gpuBegin = toCPUTime(begin);
+    event.gpuEnd = toCPUTime(end);
+  }
+  frame.gpuResolved = true;
+#endif
+}
+
+// Associates the current GPU time with the current CPU time
+void abcg::OpenGLProfiler::calibrate() {
+#if !defined(__EMSCRIPTEN__)
+  glGetInteger64v(GL_TIMESTAMP, &m_gpuReference);
+  m_cpuReference = now();
+#endif
+}
+
+double abcg::OpenGLProfiler::toCPUTime(GLuint64 gpuTime) const {
+  auto const nanoseconds{static_cast<GLint64>(gpuTime) - m_gpuReference};
+  return m_cpuReference + static_cast<double>(nanoseconds) * 1e-9;
+}
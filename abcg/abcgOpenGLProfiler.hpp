@@ -0,0 +1,197 @@
+/**
+ * @file abcgOpenGLProfiler.hpp
+ * @brief Header file of abcg::OpenGLProfiler
+ *
+ * Declaration of abcg::OpenGLProfiler and related structures.
+ *
+ * This file is part of ABCg (https://github.com/hbatagelo/abcg).
+ *
+ * @copyright (c) 2021--2023 Harlen Batagelo. All rights reserved.
+ * This project is released under the MIT License.
+ */
+
+#ifndef ABCG_OPENGL_PROFILER_HPP_
+#define ABCG_OPENGL_PROFILER_HPP_
+
+#include "abcgExternal.hpp"
+#include "abcgOpenGLExternal.hpp"
+#include "abcgTimer.hpp"
+
+#include <array>
+#include <cstdint>
+#include <optional>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+namespace abcg {
+struct OpenGLProfilerEvent;
+struct OpenGLProfilerFrame;
+class OpenGLProfiler;
+} // namespace abcg
+
+/**
+ * @brief Timing of a scope measured by abcg::OpenGLProfiler.
+ *
+ * Times are in seconds since the profiler was created. GPU times are
+ * converted to the CPU clock.
+ */
+struct abcg::OpenGLProfilerEvent {
+  /** @brief Name of the scope. */
+  std::string_view name;
+  /** @brief Nesting level of the scope, starting at 0. */
+  int depth{};
+  /** @brief Time the scope began on the CPU. */
+  double cpuBegin{};
+  /** @brief Time the scope ended on the CPU. */
+  double cpuEnd{};
+  /** @brief Time the GPU began executing the commands of the scope, or a
+   * negative value if it was not measured. */
+  double gpuBegin{-1.0};
+  /** @brief Time the GPU finished executing the commands of the scope, or a
+   * negative value if it was not measured. */
+  double gpuEnd{-1.0};
+};
+
+/**
+ * @brief Scopes measured by abcg::OpenGLProfiler during a frame.
+ */
+struct abcg::OpenGLProfilerFrame {
+  /** @brief Sequential number of the frame, starting at 1. */
+  uint64_t number{};
+  /** @brief Time the frame began, in seconds since the profiler was created.
+   */
+  double begin{};
+  /** @brief Time the frame ended, in seconds since the profiler was created. */
+  double end{};
+  /** @brief Whether the GPU times of the events are available. */
+  bool gpuResolved{};
+  /** @brief Scopes of the frame, in the order they began. */
+  std::vector<OpenGLProfilerEvent> events;
+};
+
+/**
+ * @brief Frame profiler with CPU scopes and GPU timer queries.
+ *
+ * Each scope records the CPU time at which it begins and ends. GPU scopes
+ * also issue a pair of `GL_TIMESTAMP` queries. Queries are kept in a ring of
+ * frames and are read only after their results are available, a few frames
+ * later, so that reading them never stalls the pipeline. If the results of a
+ * frame are still not available when its slot is reused, its GPU times are
+ * dropped.
+ *
+ * abcg::OpenGLWindow owns a profiler and measures its own stages (update,
+ * UI, paint, UI rendering and buffer swap). Additional scopes can be added
+ * with abcg::OpenGLProfiler::Scope:
+ *
+ * @code
+ * void Window::onPaint() {
+ *   abcg::OpenGLProfiler::Scope const scope{getProfiler(), "Scene"};
+ *   // ...
+ * }
+ * @endcode
+ *
+ * The last frames can be shown in an overlay (see
+ * abcg::WindowSettings::showProfiler) and exported to the Chrome trace format
+ * with abcg::OpenGLProfiler::saveChromeTrace.
+ *
+ * @remark GPU timing is not available in WebGL.
+ */
+class abcg::OpenGLProfiler {
+public:
+  /**
+   * @brief RAII object that measures a scope of abcg::OpenGLProfiler.
+   *
+   * The scope begins when the object is constructed and ends when it is
+   * destroyed.
+   */
+  class Scope {
+  public:
+    /**
+     * @brief Begins a scope.
+     *
+     * @param profiler Profiler that measures the scope.
+     * @param name Name of the scope. The string is not copied and must outlive
+     * the profiler (e.g., a string literal).
+     * @param gpu Whether to also measure the GPU time of the commands issued
+     * in the scope.
+     */
+    Scope(OpenGLProfiler &profiler, std::string_view name, bool gpu = true)
+        : m_profiler{profiler} {
+      m_profiler.beginScope(name, gpu);
+    }
+    Scope(Scope const &) = delete;
+    Scope(Scope &&) = delete;
+    Scope &operator=(Scope const &) = delete;
+    Scope &operator=(Scope &&) = delete;
+    /**
+     * @brief Ends the scope.
+     */
+    ~Scope() { m_profiler.endScope(); }
+
+  private:
+    OpenGLProfiler &m_profiler;
+  };
+
+  void create(std::size_t historySize = 240);
+  void destroy();
+
+  void setEnabled(bool enabled) noexcept;
+  [[nodiscard]] bool isEnabled() const noexcept;
+
+  void beginFrame();
+  void endFrame();
+  void beginScope(std::string_view name, bool gpu = true);
+  void endScope();
+
+  [[nodiscard]] std::vector<OpenGLProfilerFrame const *> getFrames() const;
+  [[nodiscard]] OpenGLProfilerFrame const *getLastResolvedFrame() const;
+
+  void drawOverlay();
+  void saveChromeTrace(std::string_view path) const;
+
+private:
+  // Number of frames whose queries can be pending at the same time
+  static constexpr std::size_t m_querySlotCount{4};
+
+  // Timestamp queries issued during a frame
+  struct QuerySlot {
+    uint64_t frameNumber{};
+    std::vector<GLuint> queries;
+    std::size_t usedQueries{};
+    // Index of the event and of its first query
+    std::vector<std::pair<std::size_t, std::size_t>> scopes;
+  };
+
+  // Scope that has not ended yet
+  struct OpenScope {
+    std::size_t event{};
+    std::optional<std::size_t> query;
+  };
+
+  [[nodiscard]] double now() const;
+  void resolve(QuerySlot &slot);
+  void calibrate();
+  [[nodiscard]] double toCPUTime(GLuint64 gpuTime) const;
+
+  bool m_enabled{};
+  bool m_active{};
+  bool m_gpuSupported{};
+
+  Timer m_clock;
+  uint64_t m_frameNumber{};
+  std::vector<OpenGLProfilerFrame> m_frames;
+  OpenGLProfilerFrame *m_currentFrame{};
+  std::vector<OpenScope> m_openScopes;
+
+  std::array<QuerySlot, m_querySlotCount> m_slots;
+  QuerySlot *m_currentSlot{};
+
+  // GPU and CPU times at the last calibration
+  GLint64 m_gpuReference{};
+  double m_cpuReference{};
+
+  bool m_paused{};
+};
+
+#endif
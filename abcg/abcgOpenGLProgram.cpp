@@ -0,0 +1,371 @@
+/**
+ * @file abcgOpenGLProgram.cpp
+ * @brief Definition of abcg::OpenGLProgram
+ *
+ * This file is part of ABCg (https://github.com/hbatagelo/abcg).
+ *
+ * @copyright (c) 2021--2023 Harlen Batagelo. All rights reserved.
+ * This project is released under the MIT License.
+ */
+
+#include "abcgOpenGLProgram.hpp"
+
+#include <fmt/core.h>
+
+#include <algorithm>
+#include <string>
+
+#include "abcgException.hpp"
+#include "abcgOpenGLFunction.hpp"
+#include "abcgOpenGLShader.hpp"
+
+/**
+ * @brief Compiles and links a program and caches its variable locations.
+ *
+ * @param pathsOrSources Paths or source codes of the shaders to be compiled and
+ * linked to the program.
+ * @param throwOnError Whether to throw exceptions on compile/link errors.
+ *
+ * @throw abcg::RuntimeError on the same conditions as
+ * abcg::createOpenGLProgram, or if two variables have the same name hash.
+ */
+void abcg::OpenGLProgram::create(
+    std::vector<ShaderSource> const &pathsOrSources, bool throwOnError) {
+  create(createOpenGLProgram(pathsOrSources, throwOnError));
+}
+
+/**
+ * @brief Takes ownership of a linked program and caches its variable
+ * locations.
+ *
+ * @param program ID of the program object, or 0 to create an empty program.
+ *
+ * @throw abcg::RuntimeError if two variables have the same name hash.
+ */
+void abcg::OpenGLProgram::create(GLuint program) {
+  destroy();
+  m_program = program;
+  if (m_program != 0) {
+    introspect();
+  }
+}
+
+/**
+ * @brief Deletes the program object.
+ */
+void abcg::OpenGLProgram::destroy() {
+  abcg::glDeleteProgram(m_program);
+  m_program = 0;
+  m_uniforms.clear();
+  m_attribs.clear();
+}
+
+/**
+ * @brief Installs the program as part of the current rendering state.
+ */
+void abcg::OpenGLProgram::use() const { abcg::glUseProgram(m_program); }
+
+/**
+ * @brief Conversion to the ID of the program object.
+ */
+abcg::OpenGLProgram::operator GLuint() const noexcept { return m_program; }
+
+/**
+ * @brief Returns the location of a uniform variable.
+ *
+ * @param name Name of the variable.
+ *
+ * @return Location of the variable, or -1 if the variable is not active.
+ */
+GLint abcg::OpenGLProgram::getUniformLocation(OpenGLName name) const {
+  auto const *uniform{getUniform(name)};
+  return uniform != nullptr ? uniform->location : -1;
+}
+
+/**
+ * @brief Returns the location of an attribute variable.
+ *
+ * @param name Name of the variable.
+ *
+ * @return Location of the variable, or -1 if the variable is not active.
+ */
+GLint abcg::OpenGLProgram::getAttribLocation(OpenGLName name) const {
+  auto const *attrib{getAttrib(name)};
+  return attrib != nullptr ? attrib->location : -1;
+}
+
+/**
+ * @brief Returns the description of an active uniform variable.
+ *
+ * @param name Name of the variable. Uniform arrays can be named with or
+ * without the `[0]` suffix.
+ *
+ * @return Pointer to the description, or nullptr if the variable is not
+ * active.
+ */
+abcg::OpenGLVariable const *
+abcg::OpenGLProgram::getUniform(OpenGLName name) const {
+  auto const iter{m_uniforms.find(name.hash)};
+  return iter != m_uniforms.end() ? &iter->second : nullptr;
+}
+
+/**
+ * @brief Returns the description of an active attribute variable.
+ *
+ * @param name Name of the variable.
+ *
+ * @return Pointer to the description, or nullptr if the variable is not
+ * active.
+ */
+abcg::OpenGLVariable const *
+abcg::OpenGLProgram::getAttrib(OpenGLName name) const {
+  auto const iter{m_attribs.find(name.hash)};
+  return iter != m_attribs.end() ? &iter->second : nullptr;
+}
+
+/**
+ * @brief Sets an `int`, `bool` or sampler uniform variable.
+ *
+ * @param name Name of the variable.
+ * @param value Value of the variable.
+ */
+void abcg::OpenGLProgram::setUniform(OpenGLName name, GLint value) const {
+  abcg::glUniform1i(getUniformLocation(name), value);
+}
+
+/**
+ * @brief Sets a `uint` uniform variable.
+ *
+ * @param name Name of the variable.
+ * @param value Value of the variable.
+ */
+void abcg::OpenGLProgram::setUniform(OpenGLName name, GLuint value) const {
+  abcg::glUniform1ui(getUniformLocation(name), value);
+}
+
+/**
+ * @brief Sets a `float` uniform variable.
+ *
+ * @param name Name of the variable.
+ * @param value Value of the variable.
+ */
+void abcg::OpenGLProgram::setUniform(OpenGLName name, float value) const {
+  abcg::glUniform1f(getUniformLocation(name), value);
+}
+
+/**
+ * @brief Sets a `vec2` uniform variable.
+ *
+ * @param name Name of the variable.
+ * @param value Value of the variable.
+ */
+void abcg::OpenGLProgram::setUniform(OpenGLName name,
+                                     glm::vec2 const &value) const {
+  abcg::glUniform2fv(getUniformLocation(name), 1, &value.x);
+}
+
+/**
+ * @brief Sets a `vec3` uniform variable.
+ *
+ * @param name Name of the variable.
+ * @param value Value of the variable.
+ */
+void abcg::OpenGLProgram::setUniform(OpenGLName name,
+                                     glm::vec3 const &value) const {
+  abcg::glUniform3fv(getUniformLocation(name), 1, &value.x);
+}
+
+/**
+ * @brief Sets a `vec4` uniform variable.
+ *
+ * @param name Name of the variable.
+ * @param value Value of the variable.
+ */
+void abcg::OpenGLProgram::setUniform(OpenGLName name,
+                                     glm::vec4 const &value) const {
+  abcg::glUniform4fv(getUniformLocation(name), 1, &value.x);
+}
+
+/**
+ * @brief Sets an `ivec2` uniform variable.
+ *
+ * @param name Name of the variable.
+ * @param value Value of the variable.
+ */
+void abcg::OpenGLProgram::setUniform(OpenGLName name,
+                                     glm::ivec2 const &value) const {
+  abcg::glUniform2iv(getUniformLocation(name), 1, &value.x);
+}
+
+/**
+ * @brief Sets an `ivec3` uniform variable.
+ *
+ * @param name Name of the variable.
+ * @param value Value of the variable.
+ */
+void abcg::OpenGLProgram::setUniform(OpenGLName name,
+                                     glm::ivec3 const &value) const {
+  abcg::glUniform3iv(getUniformLocation(name), 1, &value.x);
+}
+
+/**
+ * @brief Sets an `ivec4` uniform variable.
+ *
+ * @param name Name of the variable.
+ * @param value Value of the variable.
+ */
+void abcg::OpenGLProgram::setUniform(OpenGLName name,
+                                     glm::ivec4 const &value) const {
+  abcg::glUniform4iv(getUniformLocation(name), 1, &value.x);
+}
+
+/**
+ * @brief Sets a `mat2` uniform variable.
+ *
+ * @param name Name of the variable.
+ * @param value Value of the variable.
+ */
+void abcg::OpenGLProgram::setUniform(OpenGLName name,
+                                     glm::mat2 const &value) const {
+  abcg::glUniformMatrix2fv(getUniformLocation(name), 1, GL_FALSE,
+                           &value[0][0]);
+}
+
+/**
+ * @brief Sets a `mat3` uniform variable.
+ *
+ * @param name Name of the variable.
+ * @param value Value of the variable.
+ */
+void abcg::OpenGLProgram::setUniform(OpenGLName name,
+                                     glm::mat3 const &value) const {
+  abcg::glUniformMatrix3fv(getUniformLocation(name), 1, GL_FALSE,
+                           &value[0][0]);
+}
+
+/**
+ * @brief Sets a `mat4` uniform variable.
+ *
+ * @param name Name of the variable.
+ * @param value Value of the variable.
+ */
+void abcg::OpenGLProgram::setUniform(OpenGLName name,
+                                     glm::mat4 const &value) const {
+  abcg::glUniformMatrix4fv(getUniformLocation(name), 1, GL_FALSE,
+                           &value[0][0]);
+}
+
+/**
+ * @brief Sets the elements of a `float` array uniform variable.
+ *
+ * @param name Name of the variable.
+ * @param values Values of the first elements of the array.
+ */
+void abcg::OpenGLProgram::setUniform(OpenGLName name,
+                                     std::span<float const> values) const {
+  abcg::glUniform1fv(getUniformLocation(name),
+                     gsl::narrow<GLsizei>(values.size()), values.data());
+}
+
+/**
+ * @brief Sets the elements of a `vec2` array uniform variable.
+ *
+ * @param name Name of the variable.
+ * @param values Values of the first elements of the array.
+ */
+void abcg::OpenGLProgram::setUniform(OpenGLName name,
+                                     std::span<glm::vec2 const> values) const {
+  abcg::glUniform2fv(getUniformLocation(name),
+                     gsl::narrow<GLsizei>(values.size()), &values.data()->x);
+}
+
+/**
+ * @brief Sets the elements of a `vec3` array uniform variable.
+ *
+ * @param name Name of the variable.
+ * @param values Values of the first elements of the array.
+ */
+void abcg::OpenGLProgram::setUniform(OpenGLName name,
+                                     std::span<glm::vec3 const> values) const {
+  abcg::glUniform3fv(getUniformLocation(name),
+                     gsl::narrow<GLsizei>(values.size()), &values.data()->x);
+}
+
+/**
+ * @brief Sets the elements of a `vec4` array uniform variable.
+ *
+ * @param name Name of the variable.
+ * @param values Values of the first elements of the array.
+ */
+void abcg::OpenGLProgram::setUniform(OpenGLName name,
+                                     std::span<glm::vec4 const> values) const {
+  abcg::glUniform4fv(getUniformLocation(name),
+                     gsl::narrow<GLsizei>(values.size()), &values.data()->x);
+}
+
+void abcg::OpenGLProgram::introspect() {
+  auto const insert{[](VariableTable &table, std::string_view name,
+                       OpenGLVariable const &variable) {
+    auto const [iter, inserted]{
+        table.try_emplace(OpenGLName{name}.hash, variable)};
+    if (!inserted && iter->second.location != variable.location) {
+      throw abcg::RuntimeError(
+          fmt::format("Name hash of variable {} is not unique", name));
+    }
+  }};
+
+  auto const getInteger{[this](GLenum parameter) {
+    GLint value{};
+    abcg::glGetProgramiv(m_program, parameter, &value);
+    return value;
+  }};
+
+  std::string name;
+  GLsizei length{};
+  GLint size{};
+  GLenum type{};
+
+  // Uniforms
+  name.resize(gsl::narrow<std::size_t>(
+      std::max(getInteger(GL_ACTIVE_UNIFORM_MAX_LENGTH), 1)));
+  for (auto const index : iter::range(getInteger(GL_ACTIVE_UNIFORMS))) {
+    abcg::glGetActiveUniform(m_program, gsl::narrow<GLuint>(index),
+                             gsl::narrow<GLsizei>(name.size()), &length, &size,
+                             &type, name.data());
+    // Members of uniform blocks have no location
+    auto const location{abcg::glGetUniformLocation(m_program, name.c_str())};
+    if (location < 0) {
+      continue;
+    }
+
+    std::string_view const uniformName{name.data(),
+                                       gsl::narrow<std::size_t>(length)};
+    OpenGLVariable const uniform{
+        .location = location, .type = type, .size = size};
+    insert(m_uniforms, uniformName, uniform);
+
+    // Arrays are reported as name[0], but are usually set by name only
+    if (uniformName.ends_with("[0]")) {
+      insert(m_uniforms, uniformName.substr(0, uniformName.size() - 3),
+             uniform);
+    }
+  }
+
+  // Attributes
+  name.resize(gsl::narrow<std::size_t>(
+      std::max(getInteger(GL_ACTIVE_ATTRIBUTE_MAX_LENGTH), 1)));
+  for (auto const index : iter::range(getInteger(GL_ACTIVE_ATTRIBUTES))) {
+    abcg::glGetActiveAttrib(m_program, gsl::narrow<GLuint>(index),
+                            gsl::narrow<GLsizei>(name.size()), &length, &size,
+                            &type, name.data());
+    // Built-in attributes (e.g. gl_VertexID) have no location
+    auto const location{abcg::glGetAttribLocation(m_program, name.c_str())};
+    if (location < 0) {
+      continue;
+    }
+
+    insert(m_attribs,
+           std::string_view{name.data(), gsl::narrow<std::size_t>(length)},
+           {.location = location, .type = type, .size = size});
+  }
+}
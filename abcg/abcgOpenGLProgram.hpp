@@ -0,0 +1,156 @@
+/**
+ * @file abcgOpenGLProgram.hpp
+ * @brief Header file of abcg::OpenGLProgram
+ *
+ * Declaration of abcg::OpenGLProgram and abcg::OpenGLName.
+ *
+ * This file is part of ABCg (https://github.com/hbatagelo/abcg).
+ *
+ * @copyright (c) 2021--2023 Harlen Batagelo. All rights reserved.
+ * This project is released under the MIT License.
+ */
+
+#ifndef ABCG_OPENGL_PROGRAM_HPP_
+#define ABCG_OPENGL_PROGRAM_HPP_
+
+#include "abcgExternal.hpp"
+#include "abcgOpenGLExternal.hpp"
+#include "abcgShader.hpp"
+
+#include <cstdint>
+#include <span>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+namespace abcg {
+struct OpenGLName;
+struct OpenGLVariable;
+class OpenGLProgram;
+} // namespace abcg
+
+/**
+ * @brief Hashed name of a uniform or attribute variable.
+ *
+ * Names given as string literals are hashed at compile time, so that looking
+ * up a variable of abcg::OpenGLProgram does not process the string at
+ * runtime:
+ *
+ * @code
+ * program.setUniform("viewMatrix", viewMatrix);
+ * @endcode
+ *
+ * Names known only at runtime must be converted explicitly:
+ *
+ * @code
+ * program.setUniform(abcg::OpenGLName{name}, value);
+ * @endcode
+ */
+struct abcg::OpenGLName {
+  /**
+   * @brief Constructs the name from a string literal, at compile time.
+   *
+   * @param name Null-terminated name of the variable.
+   */
+  consteval OpenGLName(char const *name) // NOLINT(hicpp-explicit-conversions)
+      : hash{fnv1a(std::string_view{name})} {}
+
+  /**
+   * @brief Constructs the name from a string known only at runtime.
+   *
+   * @param name Name of the variable.
+   */
+  explicit constexpr OpenGLName(std::string_view name) : hash{fnv1a(name)} {}
+
+  /** @brief 64-bit FNV-1a hash of the name. */
+  uint64_t hash{};
+
+private:
+  static constexpr uint64_t fnv1a(std::string_view name) {
+    uint64_t hash{14695981039346656037ULL};
+    for (auto const character : name) {
+      hash = (hash ^ static_cast<unsigned char>(character)) * 1099511628211ULL;
+    }
+    return hash;
+  }
+};
+
+/**
+ * @brief Active uniform or attribute variable of abcg::OpenGLProgram.
+ */
+struct abcg::OpenGLVariable {
+  /** @brief Location of the variable. */
+  GLint location{-1};
+  /** @brief Data type of the variable (e.g., `GL_FLOAT_VEC4`). */
+  GLenum type{};
+  /** @brief Number of elements (1 if the variable is not an array). */
+  GLint size{};
+};
+
+/**
+ * @brief OpenGL program object with cached variable locations.
+ *
+ * After the program is linked, its active uniform and attribute variables are
+ * queried once, and their locations are stored in tables indexed by the hash
+ * of the names. Getting a location or setting a uniform then costs a table
+ * lookup instead of a `glGetUniformLocation` or `glGetAttribLocation` call.
+ *
+ * As with `glGetUniformLocation`, the location of a variable that is not
+ * active in the program is -1, and setting it is ignored. This allows the
+ * same code to set the uniforms of programs that use a subset of them.
+ *
+ * @remark The setters modify the program currently in use. Call
+ * abcg::OpenGLProgram::use first.
+ */
+class abcg::OpenGLProgram {
+public:
+  void create(std::vector<ShaderSource> const &pathsOrSources,
+              bool throwOnError = true);
+  void create(GLuint program);
+  void destroy();
+
+  void use() const;
+
+  explicit operator GLuint() const noexcept;
+
+  [[nodiscard]] GLint getUniformLocation(OpenGLName name) const;
+  [[nodiscard]] GLint getAttribLocation(OpenGLName name) const;
+  [[nodiscard]] OpenGLVariable const *getUniform(OpenGLName name) const;
+  [[nodiscard]] OpenGLVariable const *getAttrib(OpenGLName name) const;
+
+  void setUniform(OpenGLName name, GLint value) const;
+  void setUniform(OpenGLName name, GLuint value) const;
+  void setUniform(OpenGLName name, float value) const;
+  void setUniform(OpenGLName name, glm::vec2 const &value) const;
+  void setUniform(OpenGLName name, glm::vec3 const &value) const;
+  void setUniform(OpenGLName name, glm::vec4 const &value) const;
+  void setUniform(OpenGLName name, glm::ivec2 const &value) const;
+  void setUniform(OpenGLName name, glm::ivec3 const &value) const;
+  void setUniform(OpenGLName name, glm::ivec4 const &value) const;
+  void setUniform(OpenGLName name, glm::mat2 const &value) const;
+  void setUniform(OpenGLName name, glm::mat3 const &value) const;
+  void setUniform(OpenGLName name, glm::mat4 const &value) const;
+  void setUniform(OpenGLName name, std::span<float const> values) const;
+  void setUniform(OpenGLName name, std::span<glm::vec2 const> values) const;
+  void setUniform(OpenGLName name, std::span<glm::vec3 const> values) const;
+  void setUniform(OpenGLName name, std::span<glm::vec4 const> values) const;
+
+private:
+  // The keys are already hashes. Where std::size_t is narrower than 64 bits,
+  // only the low bits are used
+  struct IdentityHash {
+    std::size_t operator()(uint64_t hash) const noexcept {
+      return gsl::narrow_cast<std::size_t>(hash);
+    }
+  };
+  using VariableTable =
+      std::unordered_map<uint64_t, OpenGLVariable, IdentityHash>;
+
+  void introspect();
+
+  GLuint m_program{};
+  VariableTable m_uniforms;
+  VariableTable m_attribs;
+};
+
+#endif
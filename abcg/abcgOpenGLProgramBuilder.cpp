@@ -0,0 +1,174 @@
+/**
+ * @file abcgOpenGLProgramBuilder.cpp
+ * @brief Definition of abcg::OpenGLProgramBuilder
+ *
+ * This file is part of ABCg (https://github.com/hbatagelo/abcg).
+ *
+ * @copyright (c) 2021--2023 Harlen Batagelo. All rights reserved.
+ * This project is released under the MIT License.
+ */
+
+#include "abcgOpenGLProgramBuilder.hpp"
+
+#include <fmt/core.h>
+
+#include <chrono>
+#include <exception>
+#include <utility>
+
+/**
+ * @brief Starts building a program.
+ *
+ * @param pathsOrSources Paths or source codes of the shaders to be compiled and
+ * linked to the program.
+ * @param callback Function called by abcg::OpenGLProgramBuilder::update with
+ * the ID of the program object when the build finishes, or with 0 if a
+ * shader could not be read, compiled or linked. In this case, the error is
+ * printed to the standard error.
+ */
+void abcg::OpenGLProgramBuilder::build(
+    std::vector<ShaderSource> const &pathsOrSources, Callback callback) {
+  if (!m_pool) {
+    // Files are read sequentially, so a single worker is enough
+    m_pool = std::make_unique<ThreadPool>(1);
+
+    // Let the driver use as many compiler threads as it wants
+#if !defined(__EMSCRIPTEN__)
+    if (GLEW_KHR_parallel_shader_compile == GL_TRUE) {
+      glMaxShaderCompilerThreadsKHR(0xFFFFFFFFU);
+      m_parallelCompile = true;
+    } else if (GLEW_ARB_parallel_shader_compile == GL_TRUE) {
+      glMaxShaderCompilerThreadsARB(0xFFFFFFFFU);
+      m_parallelCompile = true;
+    }
+#endif
+  }
+
+  auto &pending{m_pending.emplace_back()};
+  pending.sources = m_pool->submit(
+      [pathsOrSources] { return readOpenGLShaderSources(pathsOrSources); });
+  pending.callback = std::move(callback);
+}
+
+/**
+ * @brief Advances the builds and calls the callbacks of the finished ones.
+ *
+ * Each build advances at most one stage per call. This must be called from
+ * the thread that owns the OpenGL context. abcg::OpenGLWindow calls it once
+ * per frame for the builder returned by
+ * abcg::OpenGLWindow::getProgramBuilder.
+ */
+void abcg::OpenGLProgramBuilder::update() {
+  // Callbacks are called after the finished builds are removed, as they may
+  // start new builds
+  std::vector<std::pair<Callback, GLuint>> finished;
+  for (auto iter{m_pending.begin()}; iter != m_pending.end();) {
+    if (advance(*iter)) {
+      finished.emplace_back(std::move(iter->callback), iter->program);
+      iter = m_pending.erase(iter);
+    } else {
+      ++iter;
+    }
+  }
+
+  for (auto const &[callback, program] : finished) {
+    callback(program);
+  }
+}
+
+/**
+ * @brief Cancels all builds and releases their resources.
+ *
+ * The callbacks of the cancelled builds are not called.
+ */
+void abcg::OpenGLProgramBuilder::destroy() {
+  for (auto &pending : m_pending) {
+    if (pending.sources.valid()) {
+      pending.sources.wait();
+    }
+    for (auto const &shader : pending.shaders) {
+      glDeleteShader(shader.shader);
+    }
+    if (pending.program != 0) {
+      glDeleteProgram(pending.program);
+    }
+  }
+  m_pending.clear();
+  m_pool.reset();
+}
+
+// Advances a build by one stage. Returns true if the build has finished.
+bool abcg::OpenGLProgramBuilder::advance(PendingProgram &pending) {
+  try {
+    switch (pending.stage) {
+    case Stage::Reading:
+      if (pending.sources.wait_for(std::chrono::seconds{0}) !=
+          std::future_status::ready) {
+        return false;
+      }
+      pending.sourceCodes = pending.sources.get();
+      // A cached binary skips the compile and link stages
+      pending.program = loadOpenGLProgramBinary(pending.sourceCodes);
+      if (pending.program != 0) {
+        return true;
+      }
+      pending.shaders = triggerOpenGLShaderCompile(pending.sourceCodes);
+      pending.stage = Stage::Compiling;
+      return false;
+
+    case Stage::Compiling:
+      if (!isCompileComplete(pending)) {
+        return false;
+      }
+      // Both functions delete the shader objects
+      {
+        auto const shaders{std::exchange(pending.shaders, {})};
+        checkOpenGLShaderCompile(shaders);
+        pending.program = triggerOpenGLShaderLink(shaders);
+      }
+      pending.stage = Stage::Linking;
+      return false;
+
+    case Stage::Linking:
+      if (!isLinkComplete(pending)) {
+        return false;
+      }
+      checkOpenGLShaderLink(pending.program);
+      saveOpenGLProgramBinary(pending.program, pending.sourceCodes);
+      return true;
+    }
+  } catch (std::exception const &exception) {
+    // Resources were already released by the function that threw
+    fmt::print(stderr, "{}\n", exception.what());
+    pending.program = 0;
+  }
+  return true;
+}
+
+bool abcg::OpenGLProgramBuilder::isCompileComplete(
+    [[maybe_unused]] PendingProgram const &pending) const {
+#if !defined(__EMSCRIPTEN__)
+  if (m_parallelCompile) {
+    for (auto const &shader : pending.shaders) {
+      GLint complete{};
+      glGetShaderiv(shader.shader, GL_COMPLETION_STATUS_KHR, &complete);
+      if (complete == GL_FALSE) {
+        return false;
+      }
+    }
+  }
+#endif
+  return true;
+}
+
+bool abcg::OpenGLProgramBuilder::isLinkComplete(
+    [[maybe_unused]] PendingProgram const &pending) const {
+#if !defined(__EMSCRIPTEN__)
+  if (m_parallelCompile) {
+    GLint complete{};
+    glGetProgramiv(pending.program, GL_COMPLETION_STATUS_KHR, &complete);
+    return complete == GL_TRUE;
+  }
+#endif
+  return true;
+}
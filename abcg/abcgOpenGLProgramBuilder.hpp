@@ -0,0 +1,106 @@
+/**
+ * @file abcgOpenGLProgramBuilder.hpp
+ * @brief Header file of abcg::OpenGLProgramBuilder
+ *
+ * Declaration of abcg::OpenGLProgramBuilder
+ *
+ * This file is part of ABCg (https://github.com/hbatagelo/abcg).
+ *
+ * @copyright (c) 2021--2023 Harlen Batagelo. All rights reserved.
+ * This project is released under the MIT License.
+ */
+
+#ifndef ABCG_OPENGL_PROGRAM_BUILDER_HPP_
+#define ABCG_OPENGL_PROGRAM_BUILDER_HPP_
+
+#include "abcgOpenGLExternal.hpp"
+#include "abcgOpenGLShader.hpp"
+#include "abcgThreadPool.hpp"
+
+#include <functional>
+#include <future>
+#include <memory>
+#include <vector>
+
+namespace abcg {
+class OpenGLProgramBuilder;
+} // namespace abcg
+
+/**
+ * @brief Builds OpenGL programs across frames without blocking.
+ *
+ * abcg::OpenGLProgramBuilder::build returns immediately. The shader files are
+ * read by a worker thread, and each build then goes through the stages of
+ * abcg::triggerOpenGLShaderCompile, abcg::checkOpenGLShaderCompile,
+ * abcg::triggerOpenGLShaderLink and abcg::checkOpenGLShaderLink, advanced by
+ * abcg::OpenGLProgramBuilder::update. The compiles of all programs whose
+ * sources are ready are issued in the same call, so that the driver can run
+ * them concurrently.
+ *
+ * If `GL_KHR_parallel_shader_compile` (or `GL_ARB_parallel_shader_compile`)
+ * is supported, the driver compiles and links in background threads, and a
+ * stage is advanced only when `GL_COMPLETION_STATUS_KHR` reports that it has
+ * finished. Otherwise, each stage is advanced on the next call and the driver
+ * may block while it compiles.
+ *
+ * If the program binary cache is enabled (see
+ * abcg::setOpenGLProgramCacheDirectory), a build whose binary is in the cache
+ * finishes as soon as its sources are read, without compiling the shaders, and
+ * the binaries of the programs that are linked are added to the cache.
+ *
+ * Each abcg::OpenGLWindow owns a builder, updated once per frame before
+ * abcg::OpenGLWindow::onPaintUI (see abcg::OpenGLWindow::getProgramBuilder):
+ *
+ * @code
+ * getProgramBuilder().build(
+ *     {{.source = path + ".vert", .stage = abcg::ShaderStage::Vertex},
+ *      {.source = path + ".frag", .stage = abcg::ShaderStage::Fragment}},
+ *     [this](GLuint program) { m_program.create(program); });
+ * @endcode
+ */
+class abcg::OpenGLProgramBuilder {
+public:
+  /**
+   * @brief Function called with the ID of the program object when a build
+   * finishes, or with 0 if the build failed. The caller takes ownership of
+   * the program.
+   */
+  using Callback = std::function<void(GLuint program)>;
+
+  void build(std::vector<ShaderSource> const &pathsOrSources,
+             Callback callback);
+  void update();
+  void destroy();
+
+  /**
+   * @brief Returns the number of programs being built.
+   *
+   * @return Number of builds whose callbacks were not called yet.
+   */
+  [[nodiscard]] std::size_t getPendingCount() const noexcept {
+    return m_pending.size();
+  }
+
+private:
+  enum class Stage { Reading, Compiling, Linking };
+
+  struct PendingProgram {
+    Stage stage{Stage::Reading};
+    std::future<std::vector<ShaderSource>> sources;
+    std::vector<ShaderSource> sourceCodes;
+    std::vector<OpenGLShader> shaders;
+    GLuint program{};
+    Callback callback;
+  };
+
+  [[nodiscard]] bool advance(PendingProgram &pending);
+  [[nodiscard]] bool isCompileComplete(PendingProgram const &pending) const;
+  [[nodiscard]] bool isLinkComplete(PendingProgram const &pending) const;
+
+  std::vector<PendingProgram> m_pending;
+  // Created on the first build
+  std::unique_ptr<ThreadPool> m_pool;
+  bool m_parallelCompile{};
+};
+
+#endif
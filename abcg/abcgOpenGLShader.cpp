@@ -14,12 +14,17 @@
 #include <fmt/core.h>
 #include <gsl/gsl>
 
+#include <algorithm>
+#include <array>
+#include <cstring>
 #include <filesystem>
 #include <fstream>
 #include <sstream>
+#include <system_error>
 #include <vector>
 
 #include "abcgException.hpp"
+#include "abcgMappedFile.hpp"
 
 namespace {
 void printShaderInfoLog(GLuint const shader, std::string_view prefix) {
@@ -141,6 +146,163 @@ void deleteShaders(std::vector<abcg::OpenGLShader> const &shaderIDs) {
     throw abcg::RuntimeError("Unknown shader stage");
   }
 }
+
+// Directory of the program binary cache. The cache is disabled if empty.
+std::string &getProgramCacheDirectory() {
+  static std::string directory;
+  return directory;
+}
+
+#if !defined(__EMSCRIPTEN__)
+// Header at the beginning of a program binary cache file
+struct ProgramBinaryHeader {
+  std::array<char, 4> magic{'A', 'B', 'C', 'G'};
+  uint32_t headerVersion{1};
+  uint64_t key{};
+  uint32_t binaryFormat{};
+  uint32_t binarySize{};
+};
+
+[[nodiscard]] bool isProgramBinarySupported() {
+  if (GLEW_ARB_get_program_binary == GL_FALSE) {
+    return false;
+  }
+  GLint numFormats{};
+  glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &numFormats);
+  return numFormats > 0;
+}
+
+// Returns whether the driver accepts program binaries of the given format
+[[nodiscard]] bool isProgramBinaryFormatSupported(GLenum format) {
+  GLint numFormats{};
+  glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &numFormats);
+  if (numFormats <= 0) {
+    return false;
+  }
+  std::vector<GLint> formats(gsl::narrow<std::size_t>(numFormats));
+  glGetIntegerv(GL_PROGRAM_BINARY_FORMATS, formats.data());
+  return std::ranges::find(formats, gsl::narrow<GLint>(format)) !=
+         formats.end();
+}
+
+[[nodiscard]] bool isProgramCacheEnabled() {
+  return !getProgramCacheDirectory().empty() && isProgramBinarySupported();
+}
+
+// Returns a 64-bit FNV-1a hash of the shader sources and of the strings that
+// identify the driver, as a binary is only valid for the driver that created
+// it
+[[nodiscard]] uint64_t
+getProgramBinaryKey(std::vector<abcg::ShaderSource> const &sources) {
+  uint64_t hash{14695981039346656037ULL};
+  auto const combine{[&hash](std::string_view text) {
+    for (auto const character : text) {
+      hash = (hash ^ static_cast<unsigned char>(character)) * 1099511628211ULL;
+    }
+    // Hash a null character to separate consecutive strings
+    hash *= 1099511628211ULL;
+  }};
+
+  for (auto const name :
+       std::array<GLenum, 3>{GL_VENDOR, GL_RENDERER, GL_VERSION}) {
+    auto const *string{reinterpret_cast<char const *>(glGetString(name))};
+    combine(string != nullptr ? string : "");
+  }
+  for (auto const &source : sources) {
+    combine(fmt::format("{}", static_cast<int>(source.stage)));
+    combine(source.source);
+  }
+  return hash;
+}
+
+[[nodiscard]] std::filesystem::path getProgramBinaryPath(uint64_t key) {
+  return std::filesystem::path{getProgramCacheDirectory()} /
+         fmt::format("{:016x}.bin", key);
+}
+
+// Creates a program from a cached binary. Returns 0 if there is no binary for
+// this key, or if the driver rejects it (e.g. after a driver update).
+[[nodiscard]] GLuint loadProgramBinary(uint64_t key) {
+  abcg::MappedFile file;
+  if (!file.open(getProgramBinaryPath(key).string())) {
+    return 0;
+  }
+
+  auto const data{file.getData()};
+  ProgramBinaryHeader header{};
+  if (data.size() < sizeof(header)) {
+    return 0;
+  }
+  std::memcpy(&header, data.data(), sizeof(header));
+  if (header.magic != ProgramBinaryHeader{}.magic ||
+      header.headerVersion != ProgramBinaryHeader{}.headerVersion ||
+      header.key != key || data.size() - sizeof(header) != header.binarySize ||
+      // An unsupported format would make glProgramBinary raise an error
+      !isProgramBinaryFormatSupported(header.binaryFormat)) {
+    return 0;
+  }
+
+  auto const program{glCreateProgram()};
+  if (program == 0) {
+    return 0;
+  }
+  auto const binary{data.subspan(sizeof(header))};
+  glProgramBinary(program, header.binaryFormat, binary.data(),
+                  gsl::narrow<GLsizei>(binary.size()));
+
+  // A binary of a supported format that the driver rejects does not raise an
+  // error. It only leaves the program unlinked
+  GLint linkStatus{};
+  glGetProgramiv(program, GL_LINK_STATUS, &linkStatus);
+  if (linkStatus == GL_FALSE) {
+    glDeleteProgram(program);
+    return 0;
+  }
+  return program;
+}
+
+// Saves the binary of a linked program. Failures are ignored, as the cache is
+// only an optimization.
+void saveProgramBinary(GLuint program, uint64_t key) {
+  GLint length{};
+  glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &length);
+  if (length <= 0) {
+    return;
+  }
+
+  std::vector<char> binary(gsl::narrow<std::size_t>(length));
+  GLsizei binarySize{};
+  GLenum binaryFormat{};
+  glGetProgramBinary(program, length, &binarySize, &binaryFormat,
+                     binary.data());
+  if (binarySize <= 0) {
+    return;
+  }
+
+  ProgramBinaryHeader const header{
+      .key = key,
+      .binaryFormat = binaryFormat,
+      .binarySize = gsl::narrow<uint32_t>(binarySize)};
+
+  // Write to a temporary file first, so that a partially written binary is
+  // never loaded
+  auto const path{getProgramBinaryPath(key)};
+  auto tempPath{path};
+  tempPath += ".tmp";
+  std::error_code error;
+  std::filesystem::create_directories(path.parent_path(), error);
+  std::ofstream stream{tempPath, std::ios::binary | std::ios::trunc};
+  stream.write(reinterpret_cast<char const *>(&header), sizeof(header));
+  stream.write(binary.data(), binarySize);
+  stream.close();
+  if (stream) {
+    std::filesystem::rename(tempPath, path, error);
+  }
+  if (!stream || error) {
+    std::filesystem::remove(tempPath, error);
+  }
+}
+#endif
 } // namespace
 
 /**
@@ -150,6 +312,11 @@ void deleteShaders(std::vector<abcg::OpenGLShader> const &shaderIDs) {
  * linked to the program.
  * @param throwOnError Whether to throw exceptions on compile/link errors.
  *
+ * If a program binary cache directory was set with
+ * abcg::setOpenGLProgramCacheDirectory, the program is first looked up in the
+ * cache, and the shaders are compiled only if no valid binary is found. The
+ * binary of a newly linked program is then added to the cache.
+ *
  * @throw abcg::RuntimeError if the shader could not be read from file, or if
  * the program could not be created, or if the compilation of any shader has
  * failed, or if the linking has failed.
@@ -159,12 +326,18 @@ void deleteShaders(std::vector<abcg::OpenGLShader> const &shaderIDs) {
 GLuint
 abcg::createOpenGLProgram(std::vector<ShaderSource> const &pathsOrSources,
                           bool throwOnError) {
-  std::vector<ShaderSource> sources;
-  sources.reserve(pathsOrSources.size());
-  for (auto const &pathOrSource : pathsOrSources) {
-    sources.push_back(
-        {.source = toSource(pathOrSource.source), .stage = pathOrSource.stage});
+  auto const sources{readOpenGLShaderSources(pathsOrSources)};
+
+#if !defined(__EMSCRIPTEN__)
+  auto const useCache{isProgramCacheEnabled()};
+  uint64_t cacheKey{};
+  if (useCache) {
+    cacheKey = getProgramBinaryKey(sources);
+    if (auto const program{loadProgramBinary(cacheKey)}; program != 0) {
+      return program;
+    }
   }
+#endif
 
   std::vector<OpenGLShader> compiledShaders;
   compiledShaders.reserve(sources.size());
@@ -189,6 +362,13 @@ abcg::createOpenGLProgram(std::vector<ShaderSource> const &pathsOrSources,
     glAttachShader(shaderProgram, shader.shader);
   }
 
+#if !defined(__EMSCRIPTEN__)
+  if (useCache) {
+    glProgramParameteri(shaderProgram, GL_PROGRAM_BINARY_RETRIEVABLE_HINT,
+                        GL_TRUE);
+  }
+#endif
+
   glLinkProgram(shaderProgram);
 
   for (auto const &shader : compiledShaders) {
@@ -209,9 +389,38 @@ abcg::createOpenGLProgram(std::vector<ShaderSource> const &pathsOrSources,
     return 0U;
   }
 
+#if !defined(__EMSCRIPTEN__)
+  if (useCache) {
+    saveProgramBinary(shaderProgram, cacheKey);
+  }
+#endif
+
   return shaderProgram;
 }
 
+/**
+ * @brief Reads the source codes of a group of shaders.
+ *
+ * This function can be called from any thread, e.g. to read the shader files
+ * in the background before calling abcg::triggerOpenGLShaderCompile.
+ *
+ * @param pathsOrSources Paths or source codes of the shaders.
+ *
+ * @throw abcg::RuntimeError if the shader could not be read from file.
+ *
+ * @return Source codes of the shaders, with their stages.
+ */
+std::vector<abcg::ShaderSource> abcg::readOpenGLShaderSources(
+    std::vector<ShaderSource> const &pathsOrSources) {
+  std::vector<ShaderSource> sources;
+  sources.reserve(pathsOrSources.size());
+  for (auto const &pathOrSource : pathsOrSources) {
+    sources.push_back(
+        {.source = toSource(pathOrSource.source), .stage = pathOrSource.stage});
+  }
+  return sources;
+}
+
 /**
  * @brief Triggers the compilation of a group of shaders and returns
  * immediately.
@@ -237,12 +446,7 @@ abcg::createOpenGLProgram(std::vector<ShaderSource> const &pathsOrSources,
  */
 std::vector<abcg::OpenGLShader> abcg::triggerOpenGLShaderCompile(
     std::vector<ShaderSource> const &pathsOrSources) {
-  std::vector<ShaderSource> sources;
-  sources.reserve(pathsOrSources.size());
-  for (auto const &pathOrSource : pathsOrSources) {
-    sources.push_back(
-        {.source = toSource(pathOrSource.source), .stage = pathOrSource.stage});
-  }
+  auto const sources{readOpenGLShaderSources(pathsOrSources)};
 
   std::vector<OpenGLShader> compiledShaders;
   compiledShaders.reserve(sources.size());
@@ -304,6 +508,11 @@ bool abcg::checkOpenGLShaderCompile(std::vector<OpenGLShader> const &shaders,
  *
  * @return ID of the program object with the shaders attached, or 0 on error.
  *
+ * @remark If the program binary cache is enabled (see
+ * abcg::setOpenGLProgramCacheDirectory), the program is linked with
+ * `GL_PROGRAM_BINARY_RETRIEVABLE_HINT` so that its binary can be saved with
+ * abcg::saveOpenGLProgramBinary.
+ *
  * @sa abcg::checkOpenGLShaderLink.
  */
 GLuint abcg::triggerOpenGLShaderLink(std::vector<OpenGLShader> const &shaders,
@@ -321,6 +530,13 @@ GLuint abcg::triggerOpenGLShaderLink(std::vector<OpenGLShader> const &shaders,
     glAttachShader(shaderProgram, shader.shader);
   }
 
+#if !defined(__EMSCRIPTEN__)
+  if (isProgramCacheEnabled()) {
+    glProgramParameteri(shaderProgram, GL_PROGRAM_BINARY_RETRIEVABLE_HINT,
+                        GL_TRUE);
+  }
+#endif
+
   glLinkProgram(shaderProgram);
 
   for (auto const &shader : shaders) {
@@ -361,4 +577,81 @@ bool abcg::checkOpenGLShaderLink(GLuint shaderProgram, bool throwOnError) {
   }
 
   return true;
-}
\ No newline at end of file
+}
+
+/**
+ * @brief Creates a program object from the program binary cache.
+ *
+ * This can be called before abcg::triggerOpenGLShaderCompile to skip the
+ * compilation of programs that were already built.
+ *
+ * @param sources Source codes of the shaders (e.g., as returned by
+ * abcg::readOpenGLShaderSources).
+ *
+ * @return ID of the linked program object, or 0 if the cache is disabled
+ * or has no valid binary for these sources.
+ *
+ * @sa abcg::setOpenGLProgramCacheDirectory.
+ */
+GLuint abcg::loadOpenGLProgramBinary(
+    [[maybe_unused]] std::vector<ShaderSource> const &sources) {
+#if !defined(__EMSCRIPTEN__)
+  if (isProgramCacheEnabled()) {
+    return loadProgramBinary(getProgramBinaryKey(sources));
+  }
+#endif
+  return 0;
+}
+
+/**
+ * @brief Saves the binary of a linked program to the program binary cache.
+ *
+ * This should be called after abcg::checkOpenGLShaderLink succeeds. Nothing is
+ * saved if the cache is disabled. Write failures are ignored.
+ *
+ * @param program ID of the linked program object.
+ * @param sources Source codes of the shaders linked to the program.
+ *
+ * @sa abcg::setOpenGLProgramCacheDirectory.
+ */
+void abcg::saveOpenGLProgramBinary(
+    [[maybe_unused]] GLuint program,
+    [[maybe_unused]] std::vector<ShaderSource> const &sources) {
+#if !defined(__EMSCRIPTEN__)
+  if (isProgramCacheEnabled()) {
+    saveProgramBinary(program, getProgramBinaryKey(sources));
+  }
+#endif
+}
+
+/**
+ * @brief Sets the directory of the program binary cache.
+ *
+ * When set, abcg::createOpenGLProgram and abcg::OpenGLProgramBuilder save the
+ * binary of each program they link (retrieved with `glGetProgramBinary`) to
+ * this directory, and later builds with the same shader sources load the
+ * binary with `glProgramBinary` instead of compiling and linking the shaders
+ * again. Binaries are keyed by a
+ * hash of the shader sources and of the `GL_VENDOR`, `GL_RENDERER` and
+ * `GL_VERSION` strings. A binary rejected by the driver is ignored and the
+ * program is built from source.
+ *
+ * The cache is disabled by default. It is not available on WebGL, or if the
+ * driver supports no program binary format.
+ *
+ * @param path Path of the cache directory. It is created if it does not
+ * exist. An empty path disables the cache.
+ */
+void abcg::setOpenGLProgramCacheDirectory(std::string_view path) {
+  getProgramCacheDirectory() = path;
+}
+
+/**
+ * @brief Returns the directory of the program binary cache.
+ *
+ * @return Path of the cache directory, or an empty string if the cache is
+ * disabled.
+ */
+std::string const &abcg::getOpenGLProgramCacheDirectory() noexcept {
+  return getProgramCacheDirectory();
+}
@@ -14,6 +14,8 @@
 #include "abcgOpenGLExternal.hpp"
 #include "abcgShader.hpp"
 
+#include <string>
+#include <string_view>
 #include <vector>
 
 namespace abcg {
@@ -34,6 +36,8 @@ namespace abcg {
 [[nodiscard]] GLuint
 createOpenGLProgram(std::vector<ShaderSource> const &pathsOrSources,
                     bool throwOnError = true);
+[[nodiscard]] std::vector<ShaderSource>
+readOpenGLShaderSources(std::vector<ShaderSource> const &pathsOrSources);
 [[nodiscard]] std::vector<abcg::OpenGLShader>
 triggerOpenGLShaderCompile(std::vector<ShaderSource> const &pathsOrSources);
 bool checkOpenGLShaderCompile(std::vector<OpenGLShader> const &shaders,
@@ -41,6 +45,12 @@ bool checkOpenGLShaderCompile(std::vector<OpenGLShader> const &shaders,
 GLuint triggerOpenGLShaderLink(std::vector<OpenGLShader> const &shaders,
                                bool throwOnError = true);
 bool checkOpenGLShaderLink(GLuint shaderProgram, bool throwOnError = true);
+[[nodiscard]] GLuint
+loadOpenGLProgramBinary(std::vector<ShaderSource> const &sources);
+void saveOpenGLProgramBinary(GLuint program,
+                             std::vector<ShaderSource> const &sources);
+void setOpenGLProgramCacheDirectory(std::string_view path);
+[[nodiscard]] std::string const &getOpenGLProgramCacheDirectory() noexcept;
 } // namespace abcg
 
 #endif
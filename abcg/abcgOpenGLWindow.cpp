@@ -11,7 +11,6 @@
 #include "abcgOpenGLWindow.hpp"
 
 #include <SDL_events.h>
-#include <SDL_image.h>
 #include <imgui_impl_opengl3.h>
 #include <imgui_impl_sdl2.h>
 
@@ -19,6 +18,21 @@
 #include "abcgException.hpp"
 #include "abcgWindow.hpp"
 
+#if !defined(__EMSCRIPTEN__)
+namespace {
+// GLEW built for GLX reports GLEW_ERROR_NO_GLX_DISPLAY when the context was
+// created through EGL (e.g., in headless mode), although the OpenGL entry
+// points were loaded
+bool isEGLContextError([[maybe_unused]] GLenum error) {
+#if defined(GLEW_ERROR_NO_GLX_DISPLAY)
+  return error == GLEW_ERROR_NO_GLX_DISPLAY;
+#else
+  return false;
+#endif
+}
+} // namespace
+#endif
+
 /**
  * @brief Returns the configuration settings of the OpenGL context.
  *
@@ -44,36 +58,70 @@ void abcg::OpenGLWindow::setOpenGLSettings(
   m_openGLSettings = openGLSettings;
 }
 
+/**
+ * @brief Returns the program builder of the window.
+ *
+ * The builder is updated once per frame while the window is visible, after
+ * abcg::OpenGLWindow::onUpdate and before abcg::OpenGLWindow::onPaintUI, with
+ * the OpenGL context made current. Pending builds are cancelled
+ * after abcg::OpenGLWindow::onDestroy.
+ *
+ * @returns Reference to the abcg::OpenGLProgramBuilder of the window.
+ */
+abcg::OpenGLProgramBuilder &abcg::OpenGLWindow::getProgramBuilder() noexcept {
+  return m_programBuilder;
+}
+
+/**
+ * @brief Returns the frame profiler of the window.
+ *
+ * The profiler is enabled at window creation if
+ * abcg::WindowSettings::showProfiler is `true`. While enabled, it measures
+ * abcg::OpenGLWindow::onUpdate, abcg::OpenGLWindow::onPaintUI,
+ * abcg::OpenGLWindow::onPaint, the rendering of the UI and the buffer swap,
+ * along with any abcg::OpenGLProfiler::Scope created by the application.
+ *
+ * @returns Reference to the abcg::OpenGLProfiler of the window.
+ */
+abcg::OpenGLProfiler &abcg::OpenGLWindow::getProfiler() noexcept {
+  return m_profiler;
+}
+
+/**
+ * @brief Returns the frame capture of the window.
+ *
+ * Frames are captured once per frame while the window is visible, after
+ * abcg::OpenGLWindow::onPaint and before the UI is rendered. Pending captures
+ * are written after abcg::OpenGLWindow::onDestroy.
+ *
+ * @returns Reference to the abcg::OpenGLFrameCapture of the window.
+ */
+abcg::OpenGLFrameCapture &abcg::OpenGLWindow::getFrameCapture() noexcept {
+  return m_frameCapture;
+}
+
 /**
  * @brief Takes a snapshot of the screen and saves it to a file.
  *
+ * This reads and encodes the image synchronously, stalling the pipeline. Use
+ * abcg::OpenGLFrameCapture::requestScreenshot (see
+ * abcg::OpenGLWindow::getFrameCapture) to capture without stalling.
+ *
  * @param filename String view to the filename.
+ *
+ * @throw abcg::RuntimeError if the file cannot be written.
  */
 void abcg::OpenGLWindow::saveScreenshotPNG(std::string_view filename) const {
   auto const size{getWindowSize()};
-  auto const bitsPerPixel{8};
   auto const channels{4};
-  auto const pitch{gsl::narrow<long>(size.x * channels)};
 
   auto const numPixels{gsl::narrow<std::size_t>(size.x * size.y * channels)};
   std::vector<unsigned char> pixels(numPixels);
   glReadBuffer(m_openGLSettings.doubleBuffering ? GL_BACK : GL_FRONT);
   glReadPixels(0, 0, size.x, size.y, GL_RGBA, GL_UNSIGNED_BYTE, pixels.data());
 
-  // Flip upside down
-  for (auto const line : iter::range(size.y / 2)) {
-    std::swap_ranges(pixels.begin() + pitch * line,
-                     pixels.begin() + pitch * (line + 1),
-                     pixels.begin() + pitch * (size.y - line - 1));
-  }
-
-  if (auto *const surface{SDL_CreateRGBSurfaceFrom(
-          pixels.data(), size.x, size.y, channels * bitsPerPixel,
-          gsl::narrow<int>(pitch), 0x000000FF, 0x0000FF00, 0x00FF0000,
-          0xFF000000)}) {
-    IMG_SavePNG(surface, filename.data());
-    SDL_FreeSurface(surface);
-  }
+  OpenGLFrameCapture::writeImage(pixels, size, std::string{filename},
+                                 CaptureFormat::PNG);
 }
 
 /**
@@ -126,8 +174,9 @@ void abcg::OpenGLWindow::onPaint() {
  * This is not called when the window is minimized.
  *
  * Override it for custom behavior. By default, it shows a FPS counter if
- * abcg::WindowSettings::showFPS is set to `true`, and a toggle fullscreen
- * button if abcg::WindowSettings::showFullscreenButton is set to `true`.
+ * abcg::WindowSettings::showFPS is set to `true`, a toggle fullscreen
+ * button if abcg::WindowSettings::showFullscreenButton is set to `true`, and
+ * the profiler overlay if abcg::WindowSettings::showProfiler is set to `true`.
  */
 void abcg::OpenGLWindow::onPaintUI() {
   // FPS counter
@@ -190,6 +239,11 @@ void abcg::OpenGLWindow::onPaintUI() {
       ImGui::End();
     }
   }
+
+  // Profiler overlay
+  if (abcg::Window::getWindowSettings().showProfiler) {
+    m_profiler.drawOverlay();
+  }
 }
 
 /**
@@ -317,6 +371,16 @@ void abcg::OpenGLWindow::create() {
     break;
   }
 
+#if !defined(NDEBUG) && !defined(__EMSCRIPTEN__) && !defined(__APPLE__)
+  // Debug messages are guaranteed to be generated only by debug contexts
+  if (m_openGLSettings.errorCheck == OpenGLErrorCheck::DebugCallback) {
+    int contextFlags{};
+    SDL_GL_GetAttribute(SDL_GL_CONTEXT_FLAGS, &contextFlags);
+    SDL_GL_SetAttribute(SDL_GL_CONTEXT_FLAGS,
+                        contextFlags | SDL_GL_CONTEXT_DEBUG_FLAG);
+  }
+#endif
+
   SDL_GL_SetAttribute(SDL_GL_CONTEXT_MAJOR_VERSION, majorVersion);
   SDL_GL_SetAttribute(SDL_GL_CONTEXT_MINOR_VERSION, minorVersion);
   SDL_GL_SetAttribute(SDL_GL_DOUBLEBUFFER,
@@ -361,7 +425,7 @@ void abcg::OpenGLWindow::create() {
 #endif
 
 #if !defined(__EMSCRIPTEN__)
-  if (auto const err{glewInit()}; GLEW_OK != err) {
+  if (auto const err{glewInit()}; GLEW_OK != err && !isEGLContextError(err)) {
     throw abcg::Exception{
         fmt::format("Failed to initialize OpenGL loader: {}",
                     reinterpret_cast<char const *>(glewGetErrorString(err)))};
@@ -380,6 +444,9 @@ void abcg::OpenGLWindow::create() {
       "GLSL version...: {}\n",
       reinterpret_cast<char const *>(glGetString(GL_SHADING_LANGUAGE_VERSION)));
 
+  setupGLErrorCheck(m_openGLSettings.errorCheck,
+                    m_openGLSettings.errorCheckInterval);
+
   // Print out extensions
   // GLint numExtensions{};
   // glGetIntegerv(GL_NUM_EXTENSIONS, &numExtensions);
@@ -419,19 +486,36 @@ void abcg::OpenGLWindow::create() {
     throw abcg::RuntimeError("Failed to load font file");
   }
 
+  m_profiler.create();
+  m_profiler.setEnabled(abcg::Window::getWindowSettings().showProfiler);
+
   onCreate();
 
   onResize(getWindowSize());
 }
 
 void abcg::OpenGLWindow::paint() {
-  onUpdate();
+  m_profiler.beginFrame();
 
-  if (m_hidden || m_minimized)
+  {
+    OpenGLProfiler::Scope const scope{m_profiler, "onUpdate", false};
+    onUpdate();
+  }
+
+  if (m_hidden || m_minimized) {
+    m_profiler.endFrame();
     return;
+  }
 
   SDL_GL_MakeCurrent(abcg::Window::getSDLWindow(), m_GLContext);
 
+  beginGLErrorCheckFrame();
+
+  {
+    OpenGLProfiler::Scope const scope{m_profiler, "Program builds", false};
+    m_programBuilder.update();
+  }
+
 #if defined(__EMSCRIPTEN__)
   // Force window size in windowed mode
   EmscriptenFullscreenChangeEvent fullscreenStatus{};
@@ -447,23 +531,50 @@ void abcg::OpenGLWindow::paint() {
   ImGui_ImplSDL2_NewFrame();
   ImGui::NewFrame();
 
-  onPaintUI();
+  {
+    OpenGLProfiler::Scope const scope{m_profiler, "onPaintUI", false};
+    onPaintUI();
+    ImGui::Render();
+  }
 
-  ImGui::Render();
+  {
+    OpenGLProfiler::Scope const scope{m_profiler, "onPaint"};
+    onPaint();
+  }
 
-  onPaint();
+  {
+    OpenGLProfiler::Scope const scope{m_profiler, "Frame capture"};
+    m_frameCapture.capture(getWindowSize(), m_openGLSettings.doubleBuffering
+                                                ? GL_BACK
+                                                : GL_FRONT);
+  }
 
-  ImGui_ImplOpenGL3_RenderDrawData(ImGui::GetDrawData());
-  if (m_openGLSettings.doubleBuffering) {
-    SDL_GL_SwapWindow(abcg::Window::getSDLWindow());
-  } else {
-    glFinish();
+  {
+    OpenGLProfiler::Scope const scope{m_profiler, "UI rendering"};
+    ImGui_ImplOpenGL3_RenderDrawData(ImGui::GetDrawData());
   }
+
+  endGLErrorCheckFrame();
+
+  {
+    OpenGLProfiler::Scope const scope{m_profiler, "Swap", false};
+    if (m_openGLSettings.doubleBuffering) {
+      SDL_GL_SwapWindow(abcg::Window::getSDLWindow());
+    } else {
+      glFinish();
+    }
+  }
+
+  m_profiler.endFrame();
 }
 
 void abcg::OpenGLWindow::destroy() {
   onDestroy();
 
+  m_programBuilder.destroy();
+  m_profiler.destroy();
+  m_frameCapture.destroy();
+
   if (ImGui::GetCurrentContext() != nullptr) {
     ImGui_ImplOpenGL3_Shutdown();
     ImGui_ImplSDL2_Shutdown();
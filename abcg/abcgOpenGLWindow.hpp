@@ -16,7 +16,10 @@
 #include <string>
 
 #include "abcgExternal.hpp"
+#include "abcgOpenGLFrameCapture.hpp"
 #include "abcgOpenGLFunction.hpp"
+#include "abcgOpenGLProfiler.hpp"
+#include "abcgOpenGLProgramBuilder.hpp"
 #include "abcgWindow.hpp"
 
 namespace abcg {
@@ -77,6 +80,16 @@ struct abcg::OpenGLSettings {
   bool vSync{false};
   /** @brief Whether the output is double buffered. */
   bool doubleBuffering{true};
+  /** @brief How the OpenGL functions of the abcg namespace check for errors
+   * in debug builds.
+   *
+   * With abcg::OpenGLErrorCheck::DebugCallback, the context is created with
+   * the debug flag.
+   */
+  OpenGLErrorCheck errorCheck{OpenGLErrorCheck::EachCall};
+  /** @brief Number of frames between checked frames when #errorCheck is
+   * abcg::OpenGLErrorCheck::Sampled. */
+  int errorCheckInterval{60};
 };
 
 /**
@@ -101,6 +114,9 @@ public:
   [[nodiscard]] OpenGLSettings const &getOpenGLSettings() const noexcept;
   void setOpenGLSettings(OpenGLSettings const &openGLSettings) noexcept;
   void saveScreenshotPNG(std::string_view filename) const;
+  [[nodiscard]] OpenGLProgramBuilder &getProgramBuilder() noexcept;
+  [[nodiscard]] OpenGLProfiler &getProfiler() noexcept;
+  [[nodiscard]] OpenGLFrameCapture &getFrameCapture() noexcept;
 
 protected:
   virtual void onEvent(SDL_Event const &event);
@@ -123,6 +139,10 @@ private:
   SDL_GLContext m_GLContext{};
   bool m_hidden{};
   bool m_minimized{};
+
+  OpenGLProgramBuilder m_programBuilder;
+  OpenGLProfiler m_profiler;
+  OpenGLFrameCapture m_frameCapture;
 };
 
 #endif
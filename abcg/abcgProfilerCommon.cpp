@@ -0,0 +1,153 @@
+/**
+ * @file abcgProfilerCommon.cpp
+ * @brief Definition of helpers shared by the profilers of the graphics APIs.
+ *
+ * This file is part of ABCg (https://github.com/hbatagelo/abcg).
+ *
+ * @copyright (c) 2021--2023 Harlen Batagelo. All rights reserved.
+ * This project is released under the MIT License.
+ */
+
+#include "abcgProfilerCommon.hpp"
+
+#include <fmt/core.h>
+#include <fmt/format.h>
+
+#include <algorithm>
+#include <exception>
+#include <fstream>
+#include <iterator>
+
+#include "abcgException.hpp"
+
+namespace {
+std::string escapeJSON(std::string_view text) {
+  std::string escaped;
+  escaped.reserve(text.size());
+  for (auto const character : text) {
+    if (character == '"' || character == '\\') {
+      escaped += '\\';
+      escaped += character;
+    } else if (static_cast<unsigned char>(character) < 0x20) {
+      escaped += ' ';
+    } else {
+      escaped += character;
+    }
+  }
+  return escaped;
+}
+
+ImU32 getBarColor(std::string_view name) {
+  auto const hue{gsl::narrow_cast<float>(std::hash<std::string_view>{}(name) %
+                                         360) /
+                 360.0f};
+  return ImColor::HSV(hue, 0.5f, 0.8f);
+}
+} // namespace
+
+void abcg::detail::drawProfilerTimeline(std::span<ProfilerBar const> bars,
+                                        int rows, double begin, double end) {
+  auto const duration{std::max(end - begin, 1e-6)};
+
+  auto *drawList{ImGui::GetWindowDrawList()};
+  auto const origin{ImGui::GetCursorScreenPos()};
+  auto const width{std::max(ImGui::GetContentRegionAvail().x, 1.0f)};
+  auto const rowHeight{ImGui::GetTextLineHeightWithSpacing()};
+
+  for (auto const &bar : bars) {
+    auto const x0{origin.x + gsl::narrow_cast<float>((bar.begin - begin) /
+                                                     duration) *
+                                 width};
+    auto const x1{std::max(
+        origin.x +
+            gsl::narrow_cast<float>((bar.end - begin) / duration) * width,
+        x0 + 1.0f)};
+    auto const y0{origin.y + gsl::narrow_cast<float>(bar.row) * rowHeight};
+    ImVec2 const min{x0, y0};
+    ImVec2 const max{x1, y0 + rowHeight - 1.0f};
+
+    drawList->AddRectFilled(min, max, getBarColor(bar.name));
+    drawList->PushClipRect(min, max, true);
+    drawList->AddText(ImVec2(x0 + 2.0f, y0), IM_COL32_BLACK, bar.name.data(),
+                      bar.name.data() + bar.name.size());
+    drawList->PopClipRect();
+
+    if (ImGui::IsMouseHoveringRect(min, max)) {
+      auto const title{bar.label.empty()
+                           ? std::string{bar.name}
+                           : fmt::format("{} ({})", bar.name, bar.label)};
+      ImGui::SetTooltip("%s\n%.3f ms", title.c_str(),
+                        (bar.end - bar.begin) * 1000.0);
+    }
+  }
+
+  ImGui::Dummy(ImVec2(width, gsl::narrow_cast<float>(rows) * rowHeight));
+}
+
+void abcg::detail::drawProfilerFrameTimes(std::span<float const> frameTimes,
+                                          bool &paused) {
+  if (!frameTimes.empty()) {
+    auto const maxTime{std::ranges::max(frameTimes)};
+    auto const label{fmt::format("{:.2f} ms (max {:.2f} ms)",
+                                 frameTimes.back(), maxTime)};
+    ImGui::PlotHistogram("##FrameTimes", frameTimes.data(),
+                         gsl::narrow<int>(frameTimes.size()), 0, label.c_str(),
+                         0.0f, maxTime * 1.2f, ImVec2(-1, 60));
+  }
+
+  ImGui::Checkbox("Pause", &paused);
+}
+
+void abcg::detail::drawProfilerSaveButton(
+    char const *label, std::string_view path,
+    std::function<void(std::string_view)> const &save) {
+  ImGui::SameLine();
+  if (ImGui::Button(label)) {
+    try {
+      save(path);
+      fmt::print("Profiler data saved to {}\n", path);
+    } catch (std::exception const &exception) {
+      fmt::print(stderr, "{}\n", exception.what());
+    }
+  }
+}
+
+void abcg::detail::writeProfilerFile(std::string_view path,
+                                     std::string_view contents) {
+  std::ofstream stream{std::string{path}, std::ios::trunc};
+  stream << contents;
+  if (!stream) {
+    throw abcg::RuntimeError(fmt::format("Failed to write {}", path));
+  }
+}
+
+void abcg::detail::ChromeTrace::setProcessName(std::string_view name) {
+  fmt::format_to(std::back_inserter(m_events),
+                 "{}{{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":1,"
+                 "\"args\":{{\"name\":\"{}\"}}}}",
+                 m_events.empty() ? "" : ",\n", escapeJSON(name));
+}
+
+void abcg::detail::ChromeTrace::setThreadName(int thread,
+                                              std::string_view name) {
+  fmt::format_to(std::back_inserter(m_events),
+                 "{}{{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,"
+                 "\"tid\":{},\"args\":{{\"name\":\"{}\"}}}}",
+                 m_events.empty() ? "" : ",\n", thread, escapeJSON(name));
+}
+
+void abcg::detail::ChromeTrace::addEvent(std::string_view name, int thread,
+                                         double begin, double end) {
+  fmt::format_to(std::back_inserter(m_events),
+                 "{}{{\"name\":\"{}\",\"ph\":\"X\",\"pid\":1,\"tid\":{},"
+                 "\"ts\":{:.3f},\"dur\":{:.3f}}}",
+                 m_events.empty() ? "" : ",\n", escapeJSON(name), thread,
+                 begin * 1e6, (end - begin) * 1e6);
+}
+
+void abcg::detail::ChromeTrace::save(std::string_view path) const {
+  writeProfilerFile(
+      path, fmt::format("{{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n"
+                        "{}\n]}}\n",
+                        m_events));
+}
@@ -0,0 +1,73 @@
+/**
+ * @file abcgProfilerCommon.hpp
+ * @brief Declaration of helpers shared by the profilers of the graphics APIs.
+ *
+ * Internal header used by abcg::OpenGLProfiler and abcg::VulkanProfiler. It is
+ * not included by abcgOpenGL.hpp or abcgVulkan.hpp.
+ *
+ * This file is part of ABCg (https://github.com/hbatagelo/abcg).
+ *
+ * @copyright (c) 2021--2023 Harlen Batagelo. All rights reserved.
+ * This project is released under the MIT License.
+ */
+
+#ifndef ABCG_PROFILER_COMMON_HPP_
+#define ABCG_PROFILER_COMMON_HPP_
+
+#include "abcgExternal.hpp"
+
+#include <functional>
+#include <span>
+#include <string>
+#include <string_view>
+
+// @cond Skipped by Doxygen
+
+namespace abcg::detail {
+
+// Bar of a profiler timeline. Times are in seconds
+struct ProfilerBar {
+  std::string_view name;
+  // Shown in parentheses after the name in the tooltip, if not empty
+  std::string_view label;
+  int row{};
+  double begin{};
+  double end{};
+};
+
+// Draws bars in rows, scaled so that [begin, end] fills the width of the
+// current window
+void drawProfilerTimeline(std::span<ProfilerBar const> bars, int rows,
+                          double begin, double end);
+
+// Draws a histogram of the frame times, in milliseconds, and a checkbox that
+// pauses the profiler
+void drawProfilerFrameTimes(std::span<float const> frameTimes, bool &paused);
+
+// Draws a button, on the same line, that calls save with path and prints the
+// result
+void drawProfilerSaveButton(char const *label, std::string_view path,
+                            std::function<void(std::string_view)> const &save);
+
+// Writes contents to a text file. Throws abcg::RuntimeError on failure
+void writeProfilerFile(std::string_view path, std::string_view contents);
+
+// Events in the Chrome trace event format, which can be opened in
+// chrome://tracing or in Perfetto (https://ui.perfetto.dev)
+class ChromeTrace {
+public:
+  void setProcessName(std::string_view name);
+  void setThreadName(int thread, std::string_view name);
+  void addEvent(std::string_view name, int thread, double begin, double end);
+  void save(std::string_view path) const;
+
+private:
+  // Comma-separated JSON objects
+  std::string m_events;
+};
+
+} // namespace abcg::detail
+
+// @endcond
+
+#endif
@@ -0,0 +1,155 @@
+/**
+ * @file abcgThreadPool.cpp
+ * @brief Definition of abcg::ThreadPool members.
+ *
+ * This file is part of ABCg (https://github.com/hbatagelo/abcg).
+ *
+ * @copyright (c) 2021--2023 Harlen Batagelo. All rights reserved.
+ * This project is released under the MIT License.
+ */
+
+#include "abcgThreadPool.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <exception>
+
+/**
+ * @brief Creates the worker threads.
+ *
+ * @param numThreads Number of worker threads. If zero, tasks are executed
+ * synchronously in the thread that submits them.
+ */
+abcg::ThreadPool::ThreadPool(std::size_t numThreads) {
+  m_threads.reserve(numThreads);
+  for (std::size_t i{}; i < numThreads; ++i) {
+    m_threads.emplace_back([this] { workerLoop(); });
+  }
+}
+
+/**
+ * @brief Finishes the pending tasks and joins the worker threads.
+ */
+abcg::ThreadPool::~ThreadPool() {
+  {
+    std::scoped_lock const lock{m_mutex};
+    m_stopping = true;
+  }
+  m_condition.notify_all();
+  for (auto &thread : m_threads) {
+    thread.join();
+  }
+}
+
+/**
+ * @brief Calls a function for each index of a range, in parallel.
+ *
+ * The calling thread also executes iterations, so this function can be safely
+ * called from a task running in the same pool. It returns only after all
+ * iterations have completed. If any iteration throws, the first exception
+ * caught is rethrown in the calling thread.
+ *
+ * @param count Number of iterations.
+ * @param function Function called with each index in the range [0, count).
+ */
+void abcg::ThreadPool::parallelFor(
+    std::size_t count, std::function<void(std::size_t)> const &function) {
+  if (count == 0) {
+    return;
+  }
+  if (m_threads.empty() || count == 1) {
+    for (std::size_t index{}; index < count; ++index) {
+      function(index);
+    }
+    return;
+  }
+
+  // Shared with helper tasks that may start after this function returns
+  struct State {
+    std::function<void(std::size_t)> const *function{};
+    std::size_t count{};
+    std::atomic<std::size_t> next{};
+    std::atomic<std::size_t> completed{};
+    std::mutex mutex;
+    std::condition_variable finished;
+    std::exception_ptr exception;
+  };
+  auto state{std::make_shared<State>()};
+  state->function = &function;
+  state->count = count;
+
+  auto const run{[](State &shared) {
+    std::size_t index{};
+    while ((index = shared.next.fetch_add(1)) < shared.count) {
+      try {
+        (*shared.function)(index);
+      } catch (...) {
+        std::scoped_lock const lock{shared.mutex};
+        if (!shared.exception) {
+          shared.exception = std::current_exception();
+        }
+      }
+      if (shared.completed.fetch_add(1) + 1 == shared.count) {
+        std::scoped_lock const lock{shared.mutex};
+        shared.finished.notify_all();
+      }
+    }
+  }};
+
+  auto const numHelpers{std::min(m_threads.size(), count - 1)};
+  for (std::size_t i{}; i < numHelpers; ++i) {
+    enqueue([state, run] { run(*state); });
+  }
+  run(*state);
+
+  std::unique_lock lock{state->mutex};
+  state->finished.wait(lock, [&state] {
+    return state->completed.load() == state->count;
+  });
+  if (state->exception) {
+    std::rethrow_exception(state->exception);
+  }
+}
+
+/**
+ * @brief Returns the default number of worker threads.
+ *
+ * @return Number of hardware threads minus one (for the calling thread), or
+ * zero if threads are not supported.
+ */
+std::size_t abcg::ThreadPool::getDefaultThreadCount() noexcept {
+#if defined(__EMSCRIPTEN__) && !defined(__EMSCRIPTEN_PTHREADS__)
+  return 0;
+#else
+  auto const numHardwareThreads{std::thread::hardware_concurrency()};
+  return numHardwareThreads > 1 ? numHardwareThreads - 1 : 0;
+#endif
+}
+
+void abcg::ThreadPool::enqueue(std::function<void()> task) {
+  if (m_threads.empty()) {
+    task();
+    return;
+  }
+  {
+    std::scoped_lock const lock{m_mutex};
+    m_tasks.push_back(std::move(task));
+  }
+  m_condition.notify_one();
+}
+
+void abcg::ThreadPool::workerLoop() {
+  while (true) {
+    std::function<void()> task;
+    {
+      std::unique_lock lock{m_mutex};
+      m_condition.wait(lock, [this] { return m_stopping || !m_tasks.empty(); });
+      if (m_stopping && m_tasks.empty()) {
+        return;
+      }
+      task = std::move(m_tasks.front());
+      m_tasks.pop_front();
+    }
+    task();
+  }
+}
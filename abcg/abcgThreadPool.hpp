@@ -0,0 +1,101 @@
+/**
+ * @file abcgThreadPool.hpp
+ * @brief Header file of abcg::ThreadPool.
+ *
+ * Declaration of abcg::ThreadPool class.
+ *
+ * This file is part of ABCg (https://github.com/hbatagelo/abcg).
+ *
+ * @copyright (c) 2021--2023 Harlen Batagelo. All rights reserved.
+ * This project is released under the MIT License.
+ */
+
+#ifndef ABCG_THREAD_POOL_HPP_
+#define ABCG_THREAD_POOL_HPP_
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+namespace abcg {
+class ThreadPool;
+} // namespace abcg
+
+/**
+ * @brief Fixed-size pool of worker threads.
+ *
+ * Tasks are executed in FIFO order by the first available worker. A pool
+ * created with zero threads runs every task synchronously in the calling
+ * thread, which is the behavior on platforms without thread support (e.g.
+ * Emscripten without pthreads).
+ *
+ * @code
+ * abcg::ThreadPool pool;
+ * auto result{pool.submit([] { return 42; })};
+ * pool.parallelFor(1000, [&](std::size_t index) { data[index] *= 2; });
+ * fmt::print("{}\n", result.get());
+ * @endcode
+ */
+class abcg::ThreadPool {
+public:
+  explicit ThreadPool(std::size_t numThreads = getDefaultThreadCount());
+  ThreadPool(ThreadPool const &) = delete;
+  ThreadPool(ThreadPool &&) = delete;
+  ~ThreadPool();
+
+  ThreadPool &operator=(ThreadPool const &) = delete;
+  ThreadPool &operator=(ThreadPool &&) = delete;
+
+  /**
+   * @brief Submits a task to be executed by a worker thread.
+   *
+   * @tparam TFunction Type of the callable object.
+   *
+   * @param function Callable object with no arguments.
+   *
+   * @return Future holding the value returned by @a function, or the exception
+   * thrown by it.
+   */
+  template <typename TFunction>
+  [[nodiscard]] auto submit(TFunction &&function)
+      -> std::future<std::invoke_result_t<std::decay_t<TFunction>>> {
+    using Result = std::invoke_result_t<std::decay_t<TFunction>>;
+    auto task{std::make_shared<std::packaged_task<Result()>>(
+        std::forward<TFunction>(function))};
+    auto future{task->get_future()};
+    enqueue([task = std::move(task)] { (*task)(); });
+    return future;
+  }
+
+  void parallelFor(std::size_t count,
+                   std::function<void(std::size_t)> const &function);
+
+  /**
+   * @brief Returns the number of worker threads.
+   *
+   * @return Number of worker threads. Zero means that tasks run synchronously.
+   */
+  [[nodiscard]] std::size_t getThreadCount() const noexcept {
+    return m_threads.size();
+  }
+
+  [[nodiscard]] static std::size_t getDefaultThreadCount() noexcept;
+
+private:
+  std::vector<std::thread> m_threads;
+  std::deque<std::function<void()>> m_tasks;
+  std::mutex m_mutex;
+  std::condition_variable m_condition;
+  bool m_stopping{};
+
+  void enqueue(std::function<void()> task);
+  void workerLoop();
+};
+
+#endif
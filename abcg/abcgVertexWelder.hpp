@@ -0,0 +1,238 @@
+/**
+ * @file abcgVertexWelder.hpp
+ * @brief Header file of abcg::VertexWelder.
+ *
+ * Declaration and definition of abcg::VertexWelder class template.
+ *
+ * This file is part of ABCg (https://github.com/hbatagelo/abcg).
+ *
+ * @copyright (c) 2021--2023 Harlen Batagelo. All rights reserved.
+ * This project is released under the MIT License.
+ */
+
+#ifndef ABCG_VERTEX_WELDER_HPP_
+#define ABCG_VERTEX_WELDER_HPP_
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <span>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace abcg {
+template <typename TVertex, typename TIndex = std::uint32_t>
+class VertexWelder;
+} // namespace abcg
+
+/**
+ * @brief Merges duplicate vertices of a mesh and assigns them sequential
+ * indices.
+ *
+ * This is a flat open-addressing hash table with linear probing, specialized
+ * for the common pattern of building an indexed mesh from face corners:
+ * @code
+ * abcg::VertexWelder<Vertex> welder{numCorners};
+ * for (auto const &corner : corners) {
+ *   indices.push_back(welder.weld(toVertex(corner)));
+ * }
+ * vertices = welder.releaseVertices();
+ * @endcode
+ *
+ * Each call to abcg::VertexWelder::weld performs a single probe sequence that
+ * either finds the vertex or inserts it. Unique vertices are stored
+ * contiguously in insertion order, so the index of a vertex is the position
+ * of its first occurrence in the sequence of unique vertices.
+ *
+ * Vertices are hashed and compared by their packed bit representation, with
+ * negative zeros treated as positive zeros. Hence, vertices that compare
+ * equal with `operator==` are always merged.
+ *
+ * @tparam TVertex Vertex type. Must be a trivially copyable aggregate made
+ * only of 32-bit floating-point components (e.g. glm vectors).
+ * @tparam TIndex Unsigned integer type of the indices.
+ */
+template <typename TVertex, typename TIndex> class abcg::VertexWelder {
+  static_assert(std::is_trivially_copyable_v<TVertex>);
+  static_assert(sizeof(TVertex) % sizeof(std::uint32_t) == 0);
+  static_assert(std::is_unsigned_v<TIndex>);
+
+public:
+  /**
+   * @brief Constructs a welder and reserves space for the given number of
+   * corners.
+   *
+   * @param numCorners Expected number of calls to abcg::VertexWelder::weld,
+   * e.g. the size of the index array. This is an upper bound of the number of
+   * unique vertices.
+   */
+  explicit VertexWelder(std::size_t numCorners = 0) { reserve(numCorners); }
+
+  /**
+   * @brief Reserves space so that the table is not rehashed until the given
+   * number of unique vertices is inserted.
+   *
+   * @param numVertices Number of unique vertices.
+   */
+  void reserve(std::size_t numVertices) {
+    auto const capacity{slotCountFor(numVertices)};
+    if (capacity > m_slots.size()) {
+      rehash(capacity);
+    }
+  }
+
+  /**
+   * @brief Finds a vertex, inserting it if it is not found.
+   *
+   * @param vertex Vertex to be welded.
+   *
+   * @return Pair with the index of the vertex and a boolean that is true if
+   * the vertex was inserted by this call.
+   */
+  std::pair<TIndex, bool> insert(TVertex const &vertex) {
+    if (slotCountFor(m_vertices.size() + 1) > m_slots.size()) {
+      rehash(std::max(slotCountFor(m_vertices.size() + 1),
+                      m_slots.size() * 2));
+    }
+
+    auto const key{pack(vertex)};
+    auto const hashValue{hash(key)};
+    auto const tag{static_cast<std::uint32_t>(hashValue >> 32)};
+    auto const mask{m_slots.size() - 1};
+
+    for (auto slotIndex{static_cast<std::size_t>(hashValue) & mask};;
+         slotIndex = (slotIndex + 1) & mask) {
+      auto &slot{m_slots[slotIndex]};
+      if (slot.index == emptySlot) {
+        auto const index{static_cast<TIndex>(m_vertices.size())};
+        slot = {.tag = tag, .index = index};
+        m_vertices.push_back(vertex);
+        return {index, true};
+      }
+      if (slot.tag == tag && pack(m_vertices[slot.index]) == key) {
+        return {slot.index, false};
+      }
+    }
+  }
+
+  /**
+   * @brief Returns the index of a vertex, inserting it if it is not found.
+   *
+   * @param vertex Vertex to be welded.
+   *
+   * @return Index of the vertex in the array of unique vertices.
+   */
+  TIndex weld(TVertex const &vertex) { return insert(vertex).first; }
+
+  /**
+   * @brief Returns the unique vertices inserted so far.
+   *
+   * @return Read-only span of unique vertices in insertion order.
+   */
+  [[nodiscard]] std::span<TVertex const> getVertices() const noexcept {
+    return m_vertices;
+  }
+
+  /**
+   * @brief Moves out the array of unique vertices and clears the welder.
+   *
+   * @return Unique vertices in insertion order.
+   */
+  [[nodiscard]] std::vector<TVertex> releaseVertices() {
+    auto vertices{std::move(m_vertices)};
+    clear();
+    return vertices;
+  }
+
+  /**
+   * @brief Removes all vertices, keeping the allocated slots.
+   */
+  void clear() {
+    m_vertices.clear();
+    std::fill(m_slots.begin(), m_slots.end(), Slot{});
+  }
+
+  /**
+   * @brief Computes the hash of a vertex.
+   *
+   * The same hash is used internally for finding the slot of the vertex. It
+   * can be used for partitioning vertices among several welders (e.g. one per
+   * thread) by using its high bits, which are not used to select slots.
+   *
+   * @param vertex Vertex to be hashed.
+   *
+   * @return 64-bit hash value.
+   */
+  [[nodiscard]] static std::uint64_t hash(TVertex const &vertex) noexcept {
+    return hash(pack(vertex));
+  }
+
+private:
+  static constexpr auto numWords{sizeof(TVertex) / sizeof(std::uint32_t)};
+  static constexpr auto emptySlot{std::numeric_limits<TIndex>::max()};
+
+  using Key = std::array<std::uint32_t, numWords>;
+
+  struct Slot {
+    std::uint32_t tag{};
+    TIndex index{emptySlot};
+  };
+
+  std::vector<Slot> m_slots;
+  std::vector<TVertex> m_vertices;
+
+  // Keep the load factor below 3/4
+  static std::size_t slotCountFor(std::size_t numVertices) noexcept {
+    return std::bit_ceil(std::max(numVertices + numVertices / 3 + 1,
+                                  std::size_t{16}));
+  }
+
+  static Key pack(TVertex const &vertex) noexcept {
+    Key key;
+    std::memcpy(key.data(), &vertex, sizeof(TVertex));
+    for (auto &word : key) {
+      // Treat -0.0f as +0.0f
+      if (word == 0x80000000U) {
+        word = 0;
+      }
+    }
+    return key;
+  }
+
+  static std::uint64_t hash(Key const &key) noexcept {
+    std::uint64_t value{0x9e3779b97f4a7c15};
+    for (auto const word : key) {
+      value = (std::rotl(value, 5) ^ word) * 0x517cc1b727220a95;
+    }
+    // Final avalanche (MurmurHash3 fmix64)
+    value ^= value >> 33;
+    value *= 0xff51afd7ed558ccd;
+    value ^= value >> 33;
+    value *= 0xc4ceb9fe1a85ec53;
+    value ^= value >> 33;
+    return value;
+  }
+
+  void rehash(std::size_t capacity) {
+    std::vector<Slot> slots(capacity);
+    auto const mask{capacity - 1};
+    for (auto const &slot : m_slots) {
+      if (slot.index == emptySlot) {
+        continue;
+      }
+      auto slotIndex{static_cast<std::size_t>(hash(m_vertices[slot.index])) &
+                     mask};
+      while (slots[slotIndex].index != emptySlot) {
+        slotIndex = (slotIndex + 1) & mask;
+      }
+      slots[slotIndex] = slot;
+    }
+    m_slots = std::move(slots);
+  }
+};
+
+#endif
@@ -19,7 +19,10 @@
 #include "abcgVulkanBuffer.hpp"
 #include "abcgVulkanImage.hpp"
 #include "abcgVulkanPipeline.hpp"
+#include "abcgVulkanProfiler.hpp"
+#include "abcgVulkanRingBuffer.hpp"
 #include "abcgVulkanShader.hpp"
+#include "abcgVulkanUploadContext.hpp"
 #include "abcgVulkanWindow.hpp"
 
 #endif
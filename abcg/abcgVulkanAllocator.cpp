@@ -0,0 +1,465 @@
+/**
+ * @file abcgVulkanAllocator.cpp
+ * @brief Definition of abcg::VulkanAllocator
+ *
+ * This file is part of ABCg (https://github.com/hbatagelo/abcg).
+ *
+ * @copyright (c) 2021--2023 Harlen Batagelo. All rights reserved.
+ * This project is released under the MIT License.
+ */
+
+#include "abcgVulkanAllocator.hpp"
+
+#include <algorithm>
+#include <bit>
+#include <set>
+
+#include "abcgException.hpp"
+
+namespace {
+
+// Size of the smallest range, which is also its alignment. This is at least
+// the alignment required for uniform and storage buffer offsets and for
+// flushing non-coherent memory on common devices.
+constexpr vk::DeviceSize minRangeSize{256};
+
+using FreeRanges = std::vector<std::set<vk::DeviceSize>>;
+
+// Returns the size class of a range: class k holds ranges of
+// minRangeSize << k bytes
+uint32_t getOrder(vk::DeviceSize size) {
+  auto const rangeSize{std::bit_ceil(std::max(size, minRangeSize))};
+  return static_cast<uint32_t>(std::countr_zero(rangeSize) -
+                               std::countr_zero(minRangeSize));
+}
+
+vk::DeviceSize getRangeSize(uint32_t order) { return minRangeSize << order; }
+
+// Removes a free range of the given class, splitting a larger range if
+// required. Returns the offset of the range, or nothing if there is no free
+// range large enough.
+std::optional<vk::DeviceSize> takeRange(FreeRanges &freeRanges,
+                                        uint32_t order) {
+  auto sourceOrder{order};
+  while (sourceOrder < freeRanges.size() &&
+         freeRanges.at(sourceOrder).empty()) {
+    ++sourceOrder;
+  }
+  if (sourceOrder >= freeRanges.size()) {
+    return std::nullopt;
+  }
+
+  // Take the range with the lowest offset to keep the free space compact
+  auto &sourceRanges{freeRanges.at(sourceOrder)};
+  auto const offset{*sourceRanges.begin()};
+  sourceRanges.erase(sourceRanges.begin());
+
+  // Return the upper halves to the free lists
+  while (sourceOrder > order) {
+    --sourceOrder;
+    freeRanges.at(sourceOrder).insert(offset + getRangeSize(sourceOrder));
+  }
+  return offset;
+}
+
+// Returns a range to the free lists, merging it with its buddy for as long as
+// the buddy is free
+void releaseRange(FreeRanges &freeRanges, vk::DeviceSize offset,
+                  uint32_t order) {
+  while (order + 1 < freeRanges.size()) {
+    auto const buddy{offset ^ getRangeSize(order)};
+    if (freeRanges.at(order).erase(buddy) == 0) {
+      break;
+    }
+    offset = std::min(offset, buddy);
+    ++order;
+  }
+  freeRanges.at(order).insert(offset);
+}
+
+vk::DeviceSize alignUp(vk::DeviceSize value, vk::DeviceSize alignment) {
+  return (value + alignment - 1) / alignment * alignment;
+}
+
+} // namespace
+
+struct abcg::VulkanAllocator::Block {
+  vk::DeviceMemory memory;
+  std::byte *mappedData{};
+  vk::DeviceSize size{};
+  bool isCoherent{};
+  bool isDedicated{};
+  // Free offsets of each size class. Empty for dedicated blocks.
+  FreeRanges freeRanges;
+  std::size_t allocationCount{};
+  vk::DeviceSize requestedBytes{};
+  vk::DeviceSize allocatedBytes{};
+  Pool *pool{};
+};
+
+abcg::VulkanAllocator::VulkanAllocator() = default;
+
+abcg::VulkanAllocator::~VulkanAllocator() = default;
+
+/**
+ * @brief Initializes the allocator.
+ *
+ * No memory is allocated until the first call to
+ * abcg::VulkanAllocator::allocate.
+ *
+ * @param physicalDevice Physical device used for querying the memory types.
+ * @param device Logical device used for allocating memory.
+ * @param preferredBlockSize Size of the memory blocks, in bytes. It is rounded
+ * down to a power of two, and reduced to an eighth of the heap size for small
+ * heaps.
+ */
+void abcg::VulkanAllocator::create(vk::PhysicalDevice const &physicalDevice,
+                                   vk::Device const &device,
+                                   vk::DeviceSize preferredBlockSize) {
+  std::scoped_lock const lock{m_mutex};
+  m_device = device;
+  m_memoryProperties = physicalDevice.getMemoryProperties();
+  m_nonCoherentAtomSize = std::max(
+      physicalDevice.getProperties().limits.nonCoherentAtomSize,
+      vk::DeviceSize{1});
+  m_preferredBlockSize =
+      std::bit_floor(std::max(preferredBlockSize, minRangeSize));
+  m_pools.clear();
+  m_pools.resize(2 * m_memoryProperties.memoryTypeCount);
+}
+
+/**
+ * @brief Releases all memory blocks.
+ *
+ * Every resource that uses memory from the allocator must be destroyed before
+ * calling this function.
+ */
+void abcg::VulkanAllocator::destroy() {
+  std::scoped_lock const lock{m_mutex};
+  for (auto &pool : m_pools) {
+    for (auto const &block : pool.blocks) {
+      m_device.freeMemory(block->memory);
+    }
+  }
+  for (auto const &block : m_dedicatedBlocks) {
+    m_device.freeMemory(block->memory);
+  }
+  m_pools.clear();
+  m_dedicatedBlocks.clear();
+}
+
+/**
+ * @brief Selects a memory type.
+ *
+ * @param memoryTypeBits Bitmask of the memory types supported by the
+ * resource, as given by vk::MemoryRequirements::memoryTypeBits.
+ * @param requiredProperties Properties that the memory type must have.
+ * @param preferredProperties Additional properties that the memory type
+ * should have if possible.
+ *
+ * @return Index of the first memory type that has both the required and the
+ * preferred properties, or else of the first memory type that has the
+ * required properties. If no memory type qualifies, returns an empty
+ * optional.
+ */
+std::optional<uint32_t> abcg::VulkanAllocator::findMemoryType(
+    uint32_t memoryTypeBits, vk::MemoryPropertyFlags requiredProperties,
+    vk::MemoryPropertyFlags preferredProperties) const {
+  auto const find{[&](vk::MemoryPropertyFlags properties)
+                      -> std::optional<uint32_t> {
+    for (uint32_t index{}; index < m_memoryProperties.memoryTypeCount;
+         ++index) {
+      if ((memoryTypeBits & (1U << index)) != 0U &&
+          (m_memoryProperties.memoryTypes.at(index).propertyFlags &
+           properties) == properties) {
+        return index;
+      }
+    }
+    return std::nullopt;
+  }};
+
+  if (preferredProperties) {
+    if (auto const index{find(requiredProperties | preferredProperties)}) {
+      return index;
+    }
+  }
+  return find(requiredProperties);
+}
+
+/**
+ * @brief Allocates a range of device memory.
+ *
+ * @param requirements Size, alignment and supported memory types of the
+ * resource.
+ * @param properties Properties that the memory type must have.
+ * @param resourceType Whether the memory is for a buffer or linear image, or
+ * for an optimal-tiling image.
+ *
+ * @return Allocated range. The caller must bind it to the resource and
+ * release it with abcg::VulkanAllocator::free.
+ *
+ * @throw abcg::RuntimeError if no memory type has the required properties.
+ */
+abcg::VulkanAllocation
+abcg::VulkanAllocator::allocate(vk::MemoryRequirements const &requirements,
+                                vk::MemoryPropertyFlags properties,
+                                ResourceType resourceType) {
+  auto const memoryType{
+      findMemoryType(requirements.memoryTypeBits, properties)};
+  if (!memoryType.has_value()) {
+    throw abcg::RuntimeError("Failed to find suitable memory type");
+  }
+
+  std::scoped_lock const lock{m_mutex};
+
+  auto const rangeSize{
+      std::max({requirements.size, requirements.alignment, minRangeSize})};
+  if (rangeSize > getBlockSize(*memoryType) / 2) {
+    return allocateDedicated(requirements.size, *memoryType);
+  }
+
+  auto const order{getOrder(rangeSize)};
+  auto &pool{
+      m_pools.at(2 * *memoryType + static_cast<uint32_t>(resourceType))};
+
+  auto const makeAllocation{[&](Block &block, vk::DeviceSize offset) {
+    ++block.allocationCount;
+    block.requestedBytes += requirements.size;
+    block.allocatedBytes += getRangeSize(order);
+    return VulkanAllocation{
+        .memory = block.memory,
+        .offset = offset,
+        .size = requirements.size,
+        .mappedData = block.mappedData == nullptr ? nullptr
+                                                  : block.mappedData + offset,
+        .block = &block,
+        .order = order};
+  }};
+
+  for (auto const &block : pool.blocks) {
+    if (auto const offset{takeRange(block->freeRanges, order)}) {
+      return makeAllocation(*block, *offset);
+    }
+  }
+
+  auto &block{createBlock(pool, *memoryType)};
+  return makeAllocation(block, takeRange(block.freeRanges, order).value());
+}
+
+/**
+ * @brief Allocates memory for a buffer and binds it to the buffer.
+ *
+ * @param buffer Buffer object.
+ * @param properties Properties that the memory type must have.
+ *
+ * @return Allocated range.
+ *
+ * @throw abcg::RuntimeError if no memory type has the required properties.
+ */
+abcg::VulkanAllocation
+abcg::VulkanAllocator::allocateBuffer(vk::Buffer const &buffer,
+                                      vk::MemoryPropertyFlags properties) {
+  auto allocation{allocate(m_device.getBufferMemoryRequirements(buffer),
+                           properties, ResourceType::Linear)};
+  m_device.bindBufferMemory(buffer, allocation.memory, allocation.offset);
+  return allocation;
+}
+
+/**
+ * @brief Allocates memory for an image and binds it to the image.
+ *
+ * @param image Image object.
+ * @param tiling Tiling the image was created with.
+ * @param properties Properties that the memory type must have.
+ *
+ * @return Allocated range.
+ *
+ * @throw abcg::RuntimeError if no memory type has the required properties.
+ */
+abcg::VulkanAllocation
+abcg::VulkanAllocator::allocateImage(vk::Image const &image,
+                                     vk::ImageTiling tiling,
+                                     vk::MemoryPropertyFlags properties) {
+  auto allocation{allocate(m_device.getImageMemoryRequirements(image),
+                           properties,
+                           tiling == vk::ImageTiling::eOptimal
+                               ? ResourceType::Optimal
+                               : ResourceType::Linear)};
+  m_device.bindImageMemory(image, allocation.memory, allocation.offset);
+  return allocation;
+}
+
+/**
+ * @brief Releases a range of device memory.
+ *
+ * Empty blocks are released, except for the last block of each pool, which
+ * is kept for subsequent allocations.
+ *
+ * @param allocation Range returned by abcg::VulkanAllocator::allocate. It is
+ * reset to an empty range.
+ */
+void abcg::VulkanAllocator::free(VulkanAllocation &allocation) {
+  if (!allocation) {
+    return;
+  }
+
+  std::scoped_lock const lock{m_mutex};
+  auto *const block{static_cast<Block *>(allocation.block)};
+
+  if (block->isDedicated) {
+    m_device.freeMemory(block->memory);
+    std::erase_if(m_dedicatedBlocks,
+                  [block](auto const &other) { return other.get() == block; });
+  } else {
+    releaseRange(block->freeRanges, allocation.offset, allocation.order);
+    --block->allocationCount;
+    block->requestedBytes -= allocation.size;
+    block->allocatedBytes -= getRangeSize(allocation.order);
+
+    auto &blocks{block->pool->blocks};
+    if (block->allocationCount == 0 && blocks.size() > 1) {
+      m_device.freeMemory(block->memory);
+      std::erase_if(blocks, [block](auto const &other) {
+        return other.get() == block;
+      });
+    }
+  }
+
+  allocation = {};
+}
+
+/**
+ * @brief Makes host writes to a mapped range visible to the device.
+ *
+ * This is a no-op for host-coherent memory.
+ *
+ * @param allocation Range returned by abcg::VulkanAllocator::allocate.
+ * @param offset Offset of the written data from the beginning of the range.
+ * @param size Size of the written data, in bytes.
+ */
+void abcg::VulkanAllocator::flush(VulkanAllocation const &allocation,
+                                  vk::DeviceSize offset,
+                                  vk::DeviceSize size) const {
+  auto const *const block{static_cast<Block const *>(allocation.block)};
+  if (block == nullptr || block->mappedData == nullptr || block->isCoherent) {
+    return;
+  }
+
+  // The flushed range must be aligned to nonCoherentAtomSize. Block sizes and
+  // dedicated allocation sizes are multiples of it.
+  auto const begin{(allocation.offset + offset) / m_nonCoherentAtomSize *
+                   m_nonCoherentAtomSize};
+  auto const end{std::min(
+      alignUp(allocation.offset + offset + size, m_nonCoherentAtomSize),
+      block->size)};
+  m_device.flushMappedMemoryRanges(
+      {{.memory = block->memory, .offset = begin, .size = end - begin}});
+}
+
+/**
+ * @brief Returns usage and fragmentation statistics.
+ *
+ * @return Statistics of all blocks and dedicated allocations.
+ */
+abcg::VulkanAllocatorStatistics
+abcg::VulkanAllocator::getStatistics() const {
+  std::scoped_lock const lock{m_mutex};
+  VulkanAllocatorStatistics statistics{};
+  vk::DeviceSize freeBytes{};
+
+  for (auto const &pool : m_pools) {
+    for (auto const &block : pool.blocks) {
+      ++statistics.blockCount;
+      statistics.blockBytes += block->size;
+      statistics.allocationCount += block->allocationCount;
+      statistics.requestedBytes += block->requestedBytes;
+      statistics.allocatedBytes += block->allocatedBytes;
+      freeBytes += block->size - block->allocatedBytes;
+      for (uint32_t order{}; order < block->freeRanges.size(); ++order) {
+        if (!block->freeRanges.at(order).empty()) {
+          statistics.largestFreeRange =
+              std::max(statistics.largestFreeRange, getRangeSize(order));
+        }
+      }
+    }
+  }
+
+  for (auto const &block : m_dedicatedBlocks) {
+    ++statistics.dedicatedAllocationCount;
+    statistics.dedicatedBytes += block->size;
+  }
+
+  if (statistics.allocatedBytes > 0) {
+    statistics.internalFragmentation =
+        1.0f - static_cast<float>(statistics.requestedBytes) /
+                   static_cast<float>(statistics.allocatedBytes);
+  }
+  if (freeBytes > 0) {
+    statistics.externalFragmentation =
+        1.0f - static_cast<float>(statistics.largestFreeRange) /
+                   static_cast<float>(freeBytes);
+  }
+
+  return statistics;
+}
+
+vk::DeviceSize
+abcg::VulkanAllocator::getBlockSize(uint32_t memoryType) const noexcept {
+  // Use small blocks on small heaps (e.g. the 256 MB device-local and
+  // host-visible heap of GPUs without resizable BAR)
+  auto const &heap{m_memoryProperties.memoryHeaps.at(
+      m_memoryProperties.memoryTypes.at(memoryType).heapIndex)};
+  return std::bit_floor(
+      std::max(std::min(m_preferredBlockSize, heap.size / 8), minRangeSize));
+}
+
+abcg::VulkanAllocator::Block &
+abcg::VulkanAllocator::createBlock(Pool &pool, uint32_t memoryType) {
+  auto const &type{m_memoryProperties.memoryTypes.at(memoryType)};
+  auto const blockSize{getBlockSize(memoryType)};
+
+  auto block{std::make_unique<Block>()};
+  block->memory = m_device.allocateMemory(
+      {.allocationSize = blockSize, .memoryTypeIndex = memoryType});
+  block->size = blockSize;
+  block->isCoherent = static_cast<bool>(
+      type.propertyFlags & vk::MemoryPropertyFlagBits::eHostCoherent);
+  if (type.propertyFlags & vk::MemoryPropertyFlagBits::eHostVisible) {
+    block->mappedData = static_cast<std::byte *>(
+        m_device.mapMemory(block->memory, 0, VK_WHOLE_SIZE));
+  }
+  block->pool = &pool;
+
+  // Initially, the whole block is a single free range
+  auto const maxOrder{getOrder(blockSize)};
+  block->freeRanges.resize(maxOrder + 1);
+  block->freeRanges.at(maxOrder).insert(0);
+
+  pool.blocks.push_back(std::move(block));
+  return *pool.blocks.back();
+}
+
+abcg::VulkanAllocation
+abcg::VulkanAllocator::allocateDedicated(vk::DeviceSize size,
+                                         uint32_t memoryType) {
+  auto const &type{m_memoryProperties.memoryTypes.at(memoryType)};
+
+  auto block{std::make_unique<Block>()};
+  block->size = alignUp(size, m_nonCoherentAtomSize);
+  block->memory = m_device.allocateMemory(
+      {.allocationSize = block->size, .memoryTypeIndex = memoryType});
+  block->isCoherent = static_cast<bool>(
+      type.propertyFlags & vk::MemoryPropertyFlagBits::eHostCoherent);
+  block->isDedicated = true;
+  if (type.propertyFlags & vk::MemoryPropertyFlagBits::eHostVisible) {
+    block->mappedData = static_cast<std::byte *>(
+        m_device.mapMemory(block->memory, 0, VK_WHOLE_SIZE));
+  }
+
+  VulkanAllocation const allocation{.memory = block->memory,
+                                    .size = size,
+                                    .mappedData = block->mappedData,
+                                    .block = block.get()};
+  m_dedicatedBlocks.push_back(std::move(block));
+  return allocation;
+}
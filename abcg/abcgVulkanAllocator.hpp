@@ -0,0 +1,171 @@
+/**
+ * @file abcgVulkanAllocator.hpp
+ * @brief Header file of abcg::VulkanAllocator
+ *
+ * Declaration of abcg::VulkanAllocator and related structures.
+ *
+ * This file is part of ABCg (https://github.com/hbatagelo/abcg).
+ *
+ * @copyright (c) 2021--2023 Harlen Batagelo. All rights reserved.
+ * This project is released under the MIT License.
+ */
+
+#ifndef ABCG_VULKAN_ALLOCATOR_HPP_
+#define ABCG_VULKAN_ALLOCATOR_HPP_
+
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <vector>
+
+#include "abcgVulkanExternal.hpp"
+
+namespace abcg {
+struct VulkanAllocation;
+struct VulkanAllocatorStatistics;
+class VulkanAllocator;
+} // namespace abcg
+
+/**
+ * @brief Range of device memory returned by abcg::VulkanAllocator.
+ */
+struct abcg::VulkanAllocation {
+  /** @brief Device memory object that contains the range. */
+  vk::DeviceMemory memory;
+  /** @brief Offset of the range in the device memory object. */
+  vk::DeviceSize offset{};
+  /** @brief Size of the range, in bytes. */
+  vk::DeviceSize size{};
+  /**
+   * @brief Pointer to the beginning of the range if the memory is host
+   * visible, or nullptr otherwise. The memory stays mapped until the range is
+   * freed.
+   */
+  void *mappedData{};
+  /** @brief Opaque handle used by abcg::VulkanAllocator::free. */
+  void *block{};
+  /** @brief Size class of the range, used by abcg::VulkanAllocator::free. */
+  uint32_t order{};
+
+  /**
+   * @brief Returns whether the range is valid.
+   *
+   * @return True if memory was allocated; false otherwise.
+   */
+  explicit operator bool() const noexcept { return static_cast<bool>(memory); }
+};
+
+/**
+ * @brief Usage and fragmentation statistics of abcg::VulkanAllocator.
+ */
+struct abcg::VulkanAllocatorStatistics {
+  /** @brief Number of pooled memory blocks. */
+  std::size_t blockCount{};
+  /** @brief Total size of the pooled memory blocks, in bytes. */
+  vk::DeviceSize blockBytes{};
+  /** @brief Number of live ranges carved out of the pooled blocks. */
+  std::size_t allocationCount{};
+  /** @brief Sum of the sizes requested for the live pooled ranges. */
+  vk::DeviceSize requestedBytes{};
+  /** @brief Sum of the sizes of the live pooled ranges after rounding. */
+  vk::DeviceSize allocatedBytes{};
+  /** @brief Size of the largest free range among all blocks. */
+  vk::DeviceSize largestFreeRange{};
+  /** @brief Number of resources with a memory object of their own. */
+  std::size_t dedicatedAllocationCount{};
+  /** @brief Total size of the dedicated memory objects, in bytes. */
+  vk::DeviceSize dedicatedBytes{};
+  /**
+   * @brief Fraction of the allocated bytes wasted by rounding sizes up (0 if
+   * nothing is allocated).
+   */
+  float internalFragmentation{};
+  /**
+   * @brief One minus the ratio between the largest free range and the total
+   * free memory of the blocks (0 if the free memory is contiguous).
+   */
+  float externalFragmentation{};
+};
+
+/**
+ * @brief Sub-allocator of Vulkan device memory.
+ *
+ * Instead of calling `vkAllocateMemory` once per resource, the allocator
+ * reserves large memory blocks and carves buffers and images out of them with
+ * a buddy scheme: each range is rounded up to a power of two and freed ranges
+ * are merged with their buddies. This keeps the number of memory objects well
+ * below `maxMemoryAllocationCount` and avoids the cost of a driver allocation
+ * for every small resource.
+ *
+ * Blocks are kept separately for each memory type, and for linear resources
+ * (buffers and linear images) and optimal-tiling images, so that
+ * `bufferImageGranularity` never needs to be taken into account. Host-visible
+ * blocks are mapped once and remain mapped. Resources larger than half a block
+ * get a dedicated memory object.
+ *
+ * Each abcg::VulkanDevice owns an allocator, used by abcg::VulkanBuffer and
+ * abcg::VulkanImage. The member functions are thread-safe.
+ */
+class abcg::VulkanAllocator {
+public:
+  /** @brief Type of the resources stored in a memory block. */
+  enum class ResourceType { Linear, Optimal };
+
+  VulkanAllocator();
+  VulkanAllocator(VulkanAllocator const &) = delete;
+  VulkanAllocator(VulkanAllocator &&) = delete;
+  ~VulkanAllocator();
+
+  VulkanAllocator &operator=(VulkanAllocator const &) = delete;
+  VulkanAllocator &operator=(VulkanAllocator &&) = delete;
+
+  void create(vk::PhysicalDevice const &physicalDevice,
+              vk::Device const &device,
+              vk::DeviceSize preferredBlockSize = 64UL * 1024 * 1024);
+  void destroy();
+
+  [[nodiscard]] std::optional<uint32_t>
+  findMemoryType(uint32_t memoryTypeBits,
+                 vk::MemoryPropertyFlags requiredProperties,
+                 vk::MemoryPropertyFlags preferredProperties = {}) const;
+
+  [[nodiscard]] VulkanAllocation
+  allocate(vk::MemoryRequirements const &requirements,
+           vk::MemoryPropertyFlags properties, ResourceType resourceType);
+  [[nodiscard]] VulkanAllocation
+  allocateBuffer(vk::Buffer const &buffer, vk::MemoryPropertyFlags properties);
+  [[nodiscard]] VulkanAllocation
+  allocateImage(vk::Image const &image, vk::ImageTiling tiling,
+                vk::MemoryPropertyFlags properties);
+  void free(VulkanAllocation &allocation);
+
+  void flush(VulkanAllocation const &allocation, vk::DeviceSize offset,
+             vk::DeviceSize size) const;
+
+  [[nodiscard]] VulkanAllocatorStatistics getStatistics() const;
+
+private:
+  struct Block;
+  struct Pool {
+    std::vector<std::unique_ptr<Block>> blocks;
+  };
+
+  [[nodiscard]] vk::DeviceSize
+  getBlockSize(uint32_t memoryType) const noexcept;
+  [[nodiscard]] Block &createBlock(Pool &pool, uint32_t memoryType);
+  [[nodiscard]] VulkanAllocation allocateDedicated(vk::DeviceSize size,
+                                                   uint32_t memoryType);
+
+  vk::PhysicalDeviceMemoryProperties m_memoryProperties{};
+  vk::DeviceSize m_nonCoherentAtomSize{1};
+  vk::DeviceSize m_preferredBlockSize{};
+  // Pools indexed by 2 * memory type + resource type
+  std::vector<Pool> m_pools;
+  // Dedicated allocations, used for statistics and for releasing the memory
+  // left behind when the allocator is destroyed
+  std::vector<std::unique_ptr<Block>> m_dedicatedBlocks;
+  vk::Device m_device;
+  mutable std::mutex m_mutex;
+};
+
+#endif
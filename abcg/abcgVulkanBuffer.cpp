@@ -14,77 +14,94 @@
 
 #include <set>
 
-#include "abcgException.hpp"
-
 void abcg::VulkanBuffer::create(VulkanDevice const &device,
                                 VulkanBufferCreateInfo const &createInfo) {
+  if (!(createInfo.properties & vk::MemoryPropertyFlagBits::eHostVisible) &&
+      createInfo.data.has_value()) {
+    // Use a staging buffer for mapping, and a device local buffer as the final
+    // destination
+    VulkanUploadContext uploadContext;
+    uploadContext.create(device);
+    create(uploadContext, createInfo);
+    uploadContext.wait(uploadContext.submit());
+    uploadContext.destroy();
+    return;
+  }
+
   m_device = static_cast<vk::Device>(device);
+  m_allocator = &device.getAllocator();
 
-  if (createInfo.properties & vk::MemoryPropertyFlagBits::eHostVisible) {
-    std::tie(m_buffer, m_deviceMemory) = createBuffer(
-        device, createInfo.size, createInfo.usage, createInfo.properties);
+  std::tie(m_buffer, m_allocation) = createBuffer(
+      device, createInfo.size, createInfo.usage, createInfo.properties);
 
-    if (createInfo.data.has_value()) {
-      loadData(createInfo.data.value(), createInfo.size);
-    }
-  } else if (createInfo.data.has_value()) {
-    // Use a staging buffer for mapping, and a device local buffer as the final
-    // destination
-    auto [stagingBuffer, stagingBufferMemory]{createBuffer(
-        device, createInfo.size, vk::BufferUsageFlagBits::eTransferSrc,
-        vk::MemoryPropertyFlagBits::eHostVisible |
-            vk::MemoryPropertyFlagBits::eHostCoherent)};
-
-    // Copy data to mapped staging buffer
-    // Transfer of data to the GPU will happen in the background before the next
-    // call to vkQueueSubmit
-    void *data{m_device.mapMemory(stagingBufferMemory, vk::DeviceSize{0},
-                                  createInfo.size)};
-    memcpy(data, createInfo.data->get(), createInfo.size);
-    m_device.unmapMemory(stagingBufferMemory);
-
-    // Create buffer in device local memory
-    std::tie(m_buffer, m_deviceMemory) =
-        createBuffer(device, createInfo.size,
-                     createInfo.usage | vk::BufferUsageFlagBits::eTransferDst,
-                     vk::MemoryPropertyFlagBits::eDeviceLocal);
-
-    // Copy from staging buffer to device local buffer
-    device.withCommandBuffer(
-        [this, &stagingBuffer, &createInfo](const auto &commandBuffer) {
-          commandBuffer.copyBuffer(stagingBuffer, m_buffer,
-                                   {{.size = createInfo.size}});
-        },
-        vk::QueueFlagBits::eTransfer);
-
-    // Release staging buffer
-    m_device.destroyBuffer(stagingBuffer);
-    m_device.freeMemory(stagingBufferMemory);
+  if (createInfo.data.has_value()) {
+    loadData(createInfo.data.value(), createInfo.size);
   }
 }
 
+/**
+ * @brief Creates a buffer, recording the upload of its initial data to an
+ * upload context.
+ *
+ * If the buffer is host visible, the data is copied right away. Otherwise,
+ * the buffer must not be used until the batch of the upload context that
+ * contains the copy has completed.
+ *
+ * @param uploadContext Upload context that records the copy.
+ * @param createInfo Creation info structure.
+ */
+void abcg::VulkanBuffer::create(VulkanUploadContext &uploadContext,
+                                VulkanBufferCreateInfo const &createInfo) {
+  auto const &device{uploadContext.getDevice()};
+  if ((createInfo.properties & vk::MemoryPropertyFlagBits::eHostVisible) ||
+      !createInfo.data.has_value()) {
+    create(device, createInfo);
+    return;
+  }
+
+  m_device = static_cast<vk::Device>(device);
+  m_allocator = &device.getAllocator();
+
+  // Create buffer in device local memory
+  std::tie(m_buffer, m_allocation) =
+      createBuffer(device, createInfo.size,
+                   createInfo.usage | vk::BufferUsageFlagBits::eTransferDst,
+                   vk::MemoryPropertyFlagBits::eDeviceLocal);
+
+  // The data is copied to a staging buffer now, and from the staging buffer
+  // to the device local buffer when the batch is submitted
+  uploadContext.uploadBuffer(
+      m_buffer, {static_cast<std::byte const *>(createInfo.data->get()),
+                 createInfo.size});
+}
+
 void abcg::VulkanBuffer::destroy() {
   m_device.destroyBuffer(m_buffer);
-  m_device.freeMemory(m_deviceMemory);
+  if (m_allocator != nullptr) {
+    m_allocator->free(m_allocation);
+  }
 }
 
 /**
  * @brief Loads data to the buffer.
  *
+ * The buffer must have been created with host-visible memory.
+ *
  * @param data Pointer to the beginning of the data.
  * @param size Size of the data fo the copied, in bytes.
  * @param offset Offset from the beginning of the buffer memory.
  */
 void abcg::VulkanBuffer::loadData(gsl::not_null<void const *> data,
                                   vk::DeviceSize size, vk::DeviceSize offset) {
-  // Transfer of data to the GPU will happen in the background before the next
-  // call to vkQueueSubmit
-  auto *mappedData{m_device.mapMemory(m_deviceMemory, offset, size)};
-  memcpy(mappedData, data, size);
-  m_device.unmapMemory(m_deviceMemory);
+  // The memory is mapped for as long as the buffer exists. Transfer of data to
+  // the GPU will happen in the background before the next call to
+  // vkQueueSubmit.
+  memcpy(static_cast<std::byte *>(m_allocation.mappedData) + offset, data,
+         size);
+  m_allocator->flush(m_allocation, offset, size);
 }
 
-std::pair<vk::Buffer, vk::DeviceMemory> abcg::VulkanBuffer::createBuffer(
+std::pair<vk::Buffer, abcg::VulkanAllocation> abcg::VulkanBuffer::createBuffer(
     VulkanDevice const &device, vk::DeviceSize size, vk::BufferUsageFlags usage,
     vk::MemoryPropertyFlags properties) const {
   auto const &physicalDevice{device.getPhysicalDevice()};
@@ -111,23 +128,10 @@ std::pair<vk::Buffer, vk::DeviceMemory> abcg::VulkanBuffer::createBuffer(
            gsl::narrow<uint32_t>(queueFamilyIndices.size()),
        .pQueueFamilyIndices = queueFamilyIndices.data()})};
 
-  // Get memory requirements
-  auto const memoryRequirements{m_device.getBufferMemoryRequirements(buffer)};
-
-  // Allocate buffer memory
-  auto const memoryType{physicalDevice.findMemoryType(
-      memoryRequirements.memoryTypeBits, properties)};
-  if (!memoryType.has_value()) {
-    throw abcg::RuntimeError("Failed to find suitable memory type");
-  }
-  auto bufferMemory{
-      m_device.allocateMemory({.allocationSize = memoryRequirements.size,
-                               .memoryTypeIndex = memoryType.value()})};
+  // Allocate buffer memory and associate it to the buffer
+  auto allocation{device.getAllocator().allocateBuffer(buffer, properties)};
 
-  // Associate buffer memory to buffer
-  m_device.bindBufferMemory(buffer, bufferMemory, 0);
-
-  return {buffer, bufferMemory};
+  return {buffer, allocation};
 }
 
 /**
@@ -141,8 +145,20 @@ abcg::VulkanBuffer::operator vk::Buffer const &() const noexcept {
  * @brief Returns the opaque handle to the device memory object associated
  * with the buffer.
  *
- * @return Device memory object.
+ * @return Device memory object. The buffer starts at the offset given by
+ * abcg::VulkanBuffer::getAllocation.
  */
 vk::DeviceMemory const &abcg::VulkanBuffer::getDeviceMemory() const noexcept {
-  return m_deviceMemory;
+  return m_allocation.memory;
+}
+
+/**
+ * @brief Returns the range of device memory used by the buffer.
+ *
+ * @return Memory range, including its mapped address if the buffer is host
+ * visible.
+ */
+abcg::VulkanAllocation const &
+abcg::VulkanBuffer::getAllocation() const noexcept {
+  return m_allocation;
 }
\ No newline at end of file
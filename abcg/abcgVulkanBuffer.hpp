@@ -14,6 +14,7 @@
 #define ABCG_VULKAN_BUFFER_HPP_
 
 #include "abcgVulkanDevice.hpp"
+#include "abcgVulkanUploadContext.hpp"
 
 #include <gsl/pointers>
 
@@ -36,12 +37,20 @@ struct abcg::VulkanBufferCreateInfo {
  * @brief A class for representing a Vulkan buffer.
  *
  * This class provides helper functions for creating and managing vk::Buffer
- * objects.
+ * objects. The buffer memory is sub-allocated from the abcg::VulkanAllocator of
+ * the device, so several buffers may share the same vk::DeviceMemory at
+ * different offsets.
+ *
+ * Device-local buffers are filled through a staging buffer. Use an
+ * abcg::VulkanUploadContext to batch the copies of many buffers in a single
+ * submission.
  */
 class abcg::VulkanBuffer {
 public:
   void create(VulkanDevice const &device,
               VulkanBufferCreateInfo const &createInfo);
+  void create(VulkanUploadContext &uploadContext,
+              VulkanBufferCreateInfo const &createInfo);
   void destroy();
   void loadData(gsl::not_null<void const *> data, vk::DeviceSize size,
                 vk::DeviceSize offset = 0UL);
@@ -49,15 +58,17 @@ public:
   explicit operator vk::Buffer const &() const noexcept;
 
   [[nodiscard]] vk::DeviceMemory const &getDeviceMemory() const noexcept;
+  [[nodiscard]] VulkanAllocation const &getAllocation() const noexcept;
 
 private:
-  [[nodiscard]] std::pair<vk::Buffer, vk::DeviceMemory>
+  [[nodiscard]] std::pair<vk::Buffer, VulkanAllocation>
   createBuffer(VulkanDevice const &device, vk::DeviceSize size,
                vk::BufferUsageFlags usage,
                vk::MemoryPropertyFlags properties) const;
 
   vk::Buffer m_buffer;
-  vk::DeviceMemory m_deviceMemory;
+  VulkanAllocation m_allocation;
+  VulkanAllocator *m_allocator{};
   vk::Device m_device;
 };
 
@@ -9,17 +9,67 @@
  */
 
 #include "abcgVulkanDevice.hpp"
+#include "abcgMappedFile.hpp"
 
 #include <gsl/gsl>
 
+#include <array>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
 #include <set>
+#include <system_error>
+
+namespace {
+// Header at the beginning of the data returned by vkGetPipelineCacheData
+struct PipelineCacheHeader {
+  uint32_t headerSize{};
+  uint32_t headerVersion{};
+  uint32_t vendorID{};
+  uint32_t deviceID{};
+  std::array<uint8_t, VK_UUID_SIZE> pipelineCacheUUID{};
+};
+
+// Returns true if data was written by the same driver and device
+[[nodiscard]] bool
+isCompatible(std::span<std::byte const> data,
+             vk::PhysicalDeviceProperties const &properties) {
+  PipelineCacheHeader header{};
+  if (data.size() < sizeof(header)) {
+    return false;
+  }
+  std::memcpy(&header, data.data(), sizeof(header));
+  return header.headerSize >= sizeof(header) &&
+         header.headerVersion == VK_PIPELINE_CACHE_HEADER_VERSION_ONE &&
+         header.vendorID == properties.vendorID &&
+         header.deviceID == properties.deviceID &&
+         std::memcmp(header.pipelineCacheUUID.data(),
+                     properties.pipelineCacheUUID.data(), VK_UUID_SIZE) == 0;
+}
+
+// Returns the default path of the pipeline cache, or an empty string (which
+// disables the cache) if there is no temporary directory
+[[nodiscard]] std::string getDefaultPipelineCachePath() {
+  std::error_code error;
+  auto const tempDirectory{std::filesystem::temp_directory_path(error)};
+  if (error) {
+    return {};
+  }
+  return (tempDirectory / "abcg" / "pipeline.cache").string();
+}
+} // namespace
+
+std::string abcg::VulkanDevice::m_pipelineCachePath{
+    getDefaultPipelineCachePath()};
 
 void abcg::VulkanDevice::create(VulkanPhysicalDevice const &physicalDevice,
                                 std::vector<char const *> const &extensions) {
   m_physicalDevice = physicalDevice;
   auto const &queuesFamilies{m_physicalDevice.getQueuesFamilies()};
   auto const graphicsQueueFamily{queuesFamilies.graphics.value_or(0)};
-  auto const presentQueueFamily{queuesFamilies.present.value_or(0)};
+  // Without a surface, the present queue is the graphics queue
+  auto const presentQueueFamily{
+      queuesFamilies.present.value_or(graphicsQueueFamily)};
 
   std::set uniqueQueueFamilies{graphicsQueueFamily, presentQueueFamily};
   if (queuesFamilies.compute.has_value()) {
@@ -66,9 +116,18 @@ void abcg::VulkanDevice::create(VulkanPhysicalDevice const &physicalDevice,
   }
 
   createCommandPools();
+  createPipelineCache();
+
+  m_allocator = std::make_shared<VulkanAllocator>();
+  m_allocator->create(static_cast<vk::PhysicalDevice>(m_physicalDevice),
+                      m_device);
 }
 
 void abcg::VulkanDevice::destroy() {
+  if (m_allocator) {
+    m_allocator->destroy();
+  }
+  destroyPipelineCache();
   destroyCommandPools();
   m_device.destroy();
 }
@@ -109,6 +168,55 @@ abcg::VulkanDevice::getCommandPools() const noexcept {
   return m_commandPools;
 }
 
+/**
+ * @brief Returns the pipeline cache associated with this device.
+ *
+ * This is the cache used by abcg::VulkanPipeline::create when
+ * abcg::VulkanPipelineCreateInfo::pipelineCache is null.
+ *
+ * @return Pipeline cache.
+ */
+vk::PipelineCache const &
+abcg::VulkanDevice::getPipelineCache() const noexcept {
+  return m_pipelineCache;
+}
+
+/**
+ * @brief Returns the device memory allocator.
+ *
+ * The allocator is shared by all copies of this device.
+ *
+ * @return Device memory allocator.
+ */
+abcg::VulkanAllocator &abcg::VulkanDevice::getAllocator() const noexcept {
+  return *m_allocator;
+}
+
+/**
+ * @brief Sets the path of the pipeline cache file.
+ *
+ * By default, the file `abcg/pipeline.cache` in the temporary directory of the
+ * system is used.
+ *
+ * @param path Path of the pipeline cache file. An empty path disables loading
+ * and saving the cache. The pipeline cache object is still created.
+ *
+ * @remark This only affects devices created after the call.
+ */
+void abcg::VulkanDevice::setPipelineCachePath(std::string_view path) {
+  m_pipelineCachePath = path;
+}
+
+/**
+ * @brief Returns the path of the pipeline cache file.
+ *
+ * @return Path of the pipeline cache file, or an empty string if the cache is
+ * not persisted.
+ */
+std::string const &abcg::VulkanDevice::getPipelineCachePath() noexcept {
+  return m_pipelineCachePath;
+}
+
 /**
  * @brief Allocates and creates a command buffer to be immediately submitted and
  * released.
@@ -119,6 +227,10 @@ abcg::VulkanDevice::getCommandPools() const noexcept {
  * command pool is the default.
  * @param level Whether a primary (default) or secondary command buffer will be
  * created.
+ *
+ * @remark This function waits until the queue is idle. To upload data to many
+ * buffers and images, use abcg::VulkanUploadContext instead, which batches the
+ * copies and does not block.
  */
 void abcg::VulkanDevice::withCommandBuffer(
     std::function<void(vk::CommandBuffer const &commandBuffer)> const &fun,
@@ -213,3 +325,54 @@ void abcg::VulkanDevice::destroyCommandPools() {
 
   m_device.destroyCommandPool(m_commandPools.graphics);
 }
+
+void abcg::VulkanDevice::createPipelineCache() {
+  // Restore the initial data only if it was written for this device and
+  // driver, as some drivers do not validate it
+  abcg::MappedFile file;
+  std::span<std::byte const> initialData;
+  if (!m_pipelineCachePath.empty() && file.open(m_pipelineCachePath) &&
+      isCompatible(file.getData(),
+                   static_cast<vk::PhysicalDevice>(m_physicalDevice)
+                       .getProperties())) {
+    initialData = file.getData();
+  }
+
+  m_pipelineCache =
+      m_device.createPipelineCache({.initialDataSize = initialData.size(),
+                                    .pInitialData = initialData.data()});
+}
+
+void abcg::VulkanDevice::destroyPipelineCache() {
+  if (!m_pipelineCache) {
+    return;
+  }
+
+  if (!m_pipelineCachePath.empty()) {
+    auto const data{m_device.getPipelineCacheData(m_pipelineCache)};
+
+    // Write to a temporary file first, so that a partially written cache is
+    // never restored. Failures are ignored, as the cache is only an
+    // optimization.
+    std::filesystem::path const cachePath{m_pipelineCachePath};
+    auto tempPath{cachePath};
+    tempPath += ".tmp";
+    std::error_code error;
+    if (cachePath.has_parent_path()) {
+      std::filesystem::create_directories(cachePath.parent_path(), error);
+    }
+    std::ofstream stream{tempPath, std::ios::binary | std::ios::trunc};
+    stream.write(reinterpret_cast<char const *>(data.data()),
+                 gsl::narrow<std::streamsize>(data.size()));
+    stream.close();
+    if (stream) {
+      std::filesystem::rename(tempPath, cachePath, error);
+    }
+    if (!stream || error) {
+      std::filesystem::remove(tempPath, error);
+    }
+  }
+
+  m_device.destroyPipelineCache(m_pipelineCache);
+  m_pipelineCache = vk::PipelineCache{};
+}
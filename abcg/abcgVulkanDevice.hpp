@@ -13,9 +13,13 @@
 #ifndef ABCG_VULKAN_DEVICE_HPP_
 #define ABCG_VULKAN_DEVICE_HPP_
 
+#include "abcgVulkanAllocator.hpp"
 #include "abcgVulkanPhysicalDevice.hpp"
 
 #include <functional>
+#include <memory>
+#include <string>
+#include <string_view>
 
 namespace abcg {
 struct VulkanCommandPools;
@@ -50,7 +54,11 @@ struct abcg::VulkanQueues {
  * resources.
  *
  * This class creates and manages the Vulkan logical device, queues, descriptor
- * pool, and command pools.
+ * pool, command pools, pipeline cache, and device memory allocator.
+ *
+ * The pipeline cache is restored from disk when the device is created, and
+ * written back when it is destroyed. A cache file written for a different
+ * device or driver is discarded.
  */
 class abcg::VulkanDevice {
 public:
@@ -63,20 +71,32 @@ public:
   [[nodiscard]] VulkanPhysicalDevice const &getPhysicalDevice() const noexcept;
   [[nodiscard]] VulkanQueues const &getQueues() const noexcept;
   [[nodiscard]] VulkanCommandPools const &getCommandPools() const noexcept;
+  [[nodiscard]] vk::PipelineCache const &getPipelineCache() const noexcept;
+  [[nodiscard]] VulkanAllocator &getAllocator() const noexcept;
 
   void withCommandBuffer(
       std::function<void(vk::CommandBuffer const &commandBuffer)> const &fun,
       vk::QueueFlagBits queueFlag = vk::QueueFlagBits::eGraphics,
       vk::CommandBufferLevel level = vk::CommandBufferLevel::ePrimary) const;
 
+  static void setPipelineCachePath(std::string_view path);
+  [[nodiscard]] static std::string const &getPipelineCachePath() noexcept;
+
 private:
   void createCommandPools();
   void destroyCommandPools();
+  void createPipelineCache();
+  void destroyPipelineCache();
+
+  static std::string m_pipelineCachePath;
 
   vk::Device m_device;
   VulkanPhysicalDevice m_physicalDevice;
   VulkanCommandPools m_commandPools;
   VulkanQueues m_queues;
+  vk::PipelineCache m_pipelineCache;
+  // Shared with the copies of this device
+  std::shared_ptr<VulkanAllocator> m_allocator;
 };
 
 #endif
\ No newline at end of file
@@ -9,7 +9,7 @@
  */
 
 #include "abcgVulkanImage.hpp"
-#include "abcgVulkanBuffer.hpp"
+#include "abcgCompressedImage.hpp"
 
 #include <SDL_image.h>
 #include <cppitertools/itertools.hpp>
@@ -18,9 +18,63 @@
 
 #include "abcgException.hpp"
 
+namespace {
+
+vk::Format getVulkanFormat(abcg::CompressedFormat format, bool sRGB) {
+  switch (format) {
+  case abcg::CompressedFormat::BC1:
+    return sRGB ? vk::Format::eBc1RgbaSrgbBlock
+                : vk::Format::eBc1RgbaUnormBlock;
+  case abcg::CompressedFormat::BC3:
+    return sRGB ? vk::Format::eBc3SrgbBlock : vk::Format::eBc3UnormBlock;
+  case abcg::CompressedFormat::BC5:
+    return vk::Format::eBc5UnormBlock;
+  case abcg::CompressedFormat::BC7:
+    return sRGB ? vk::Format::eBc7SrgbBlock : vk::Format::eBc7UnormBlock;
+  }
+  return vk::Format::eUndefined;
+}
+
+} // namespace
+
 void abcg::VulkanImage::create(VulkanDevice const &device,
                                std::string_view path, bool generateMipmaps) {
+  VulkanUploadContext uploadContext;
+  uploadContext.create(device);
+  create(uploadContext, path, generateMipmaps);
+  uploadContext.wait(uploadContext.submit());
+  uploadContext.destroy();
+}
+
+/**
+ * @brief Creates an image from a texture file, recording the upload to an
+ * upload context.
+ *
+ * The image must not be used until the batch of the upload context that
+ * contains the upload has completed.
+ *
+ * @param uploadContext Upload context that records the upload.
+ * @param path Path to the texture file.
+ * @param generateMipmaps Whether to generate mipmap levels (or, for KTX2/DDS
+ * files, to use the levels stored in the file).
+ *
+ * The image is sampled as sRGB, whether or not the file is compressed. The
+ * color space tag of KTX2/DDS files is ignored.
+ *
+ * @throw abcg::RuntimeError if the file cannot be loaded or its format is not
+ * supported by the device.
+ */
+void abcg::VulkanImage::create(VulkanUploadContext &uploadContext,
+                               std::string_view path, bool generateMipmaps) {
+  auto const &device{uploadContext.getDevice()};
   m_device = static_cast<vk::Device>(device);
+  m_allocator = &device.getAllocator();
+
+  // Block-compressed images are copied as they are, without decoding
+  if (CompressedImage::isCompressedImagePath(path)) {
+    createCompressed(uploadContext, path, generateMipmaps);
+    return;
+  }
 
   // Load the bitmap
   if (SDL_Surface *const surface{IMG_Load(path.data())}) {
@@ -40,22 +94,25 @@ void abcg::VulkanImage::create(VulkanDevice const &device,
                     1;
     }
 
-    // Create staging buffer
-    abcg::VulkanBuffer stagingBuffer{};
-    stagingBuffer.create(
-        device, {.size = imageSize,
-                 .usage = vk::BufferUsageFlagBits::eTransferSrc,
-                 .properties = vk::MemoryPropertyFlagBits::eHostVisible |
-                               vk::MemoryPropertyFlagBits::eHostCoherent,
-                 .data = formattedSurface->pixels});
-
-    SDL_FreeSurface(formattedSurface);
-
     // TODO: Look for other formats if RGBA8 is not supported
     auto const imageFormat{vk::Format::eR8G8B8A8Srgb};
 
+    // Check if image format supports linear blitting
+    if (m_mipLevels > 1) {
+      vk::FormatProperties const formatProperties{
+          static_cast<vk::PhysicalDevice>(device.getPhysicalDevice())
+              .getFormatProperties(imageFormat)};
+      if (!(formatProperties.optimalTilingFeatures &
+            vk::FormatFeatureFlagBits::eSampledImageFilterLinear)) {
+        SDL_FreeSurface(formattedSurface);
+        // TODO: generate mip maps in software
+        throw abcg::RuntimeError(
+            "Texture image format does not support linear blitting");
+      }
+    }
+
     // Create image buffer
-    std::tie(m_image, m_deviceMemory) = createImage(
+    std::tie(m_image, m_allocation) = createImage(
         device,
         {.imageType = vk::ImageType::e2D,
          .format = imageFormat,
@@ -72,98 +129,158 @@ void abcg::VulkanImage::create(VulkanDevice const &device,
          .initialLayout = vk::ImageLayout::eUndefined},
         vk::MemoryPropertyFlagBits::eDeviceLocal);
 
-    transitionImageLayout(device, vk::ImageLayout::eUndefined,
-                          vk::ImageLayout::eTransferDstOptimal,
-                          {.aspectMask = vk::ImageAspectFlagBits::eColor,
-                           .levelCount = m_mipLevels,
-                           .layerCount = 1});
-
     vk::BufferImageCopy const region{
         .imageSubresource = {.aspectMask = vk::ImageAspectFlagBits::eColor,
                              .layerCount = 1},
         .imageExtent = {texWidth, texHeight, 1}};
 
-    // Execute the layout transition
-    device.withCommandBuffer(
-        [&stagingBuffer, this,
-         &region](vk::CommandBuffer const &commandBuffer) {
-          commandBuffer.copyBufferToImage(
-              static_cast<vk::Buffer>(stagingBuffer), m_image,
-              vk::ImageLayout::eTransferDstOptimal, region);
-        },
-        vk::QueueFlagBits::eTransfer);
-
-    // Generate the mipmap levels
-    if (m_mipLevels > 1) {
-      // Transitioned to vk::ImageLayout::eShaderReadOnlyOptimal while
-      // generating the mipmaps
-      createMipmaps(device, m_image, imageFormat, texWidth, texHeight,
-                    m_mipLevels);
-    } else {
-      transitionImageLayout(device, vk::ImageLayout::eTransferDstOptimal,
-                            vk::ImageLayout::eReadOnlyOptimal,
-                            {.aspectMask = vk::ImageAspectFlagBits::eColor,
-                             .levelCount = m_mipLevels,
-                             .layerCount = 1});
-    }
-
-    stagingBuffer.destroy();
+    // The pixels are copied to a staging buffer, so the surface can be
+    // released right away. When mipmaps are generated, the image is left in
+    // the transfer layout for the blits.
+    uploadContext.uploadImage(
+        m_image,
+        {static_cast<std::byte const *>(formattedSurface->pixels), imageSize},
+        {&region, 1},
+        {.aspectMask = vk::ImageAspectFlagBits::eColor,
+         .levelCount = m_mipLevels,
+         .layerCount = 1},
+        m_mipLevels > 1 ? vk::ImageLayout::eTransferDstOptimal
+                        : vk::ImageLayout::eShaderReadOnlyOptimal);
 
-    // Create image view
-    m_imageView = m_device.createImageView(
-        {.image = m_image,
-         .viewType = vk::ImageViewType::e2D,
-         .format = imageFormat,
-         .subresourceRange = {.aspectMask = vk::ImageAspectFlagBits::eColor,
-                              .levelCount = 1,
-                              .layerCount = 1}});
-
-    // Create sampler
-    vk::SamplerCreateInfo samplerCreateInfo{
-        .magFilter = vk::Filter::eLinear,
-        .minFilter = vk::Filter::eLinear,
-        .mipmapMode = vk::SamplerMipmapMode::eLinear,
-        .addressModeU = vk::SamplerAddressMode::eRepeat,
-        .addressModeV = vk::SamplerAddressMode::eRepeat,
-        .addressModeW = vk::SamplerAddressMode::eRepeat,
-        .mipLodBias = 0.0f,
-        .anisotropyEnable = VK_TRUE,
-        .maxAnisotropy =
-            static_cast<vk::PhysicalDevice>(device.getPhysicalDevice())
-                .getProperties()
-                .limits.maxSamplerAnisotropy,
-        .compareEnable = VK_FALSE,
-        .compareOp = vk::CompareOp::eAlways,
-        .minLod = 0.0f,
-        .maxLod = 0.0f,
-        .borderColor = vk::BorderColor::eIntOpaqueBlack,
-        .unnormalizedCoordinates = VK_FALSE};
+    SDL_FreeSurface(formattedSurface);
 
+    // Generate the mipmap levels
     if (m_mipLevels > 1) {
-      samplerCreateInfo.mipmapMode = vk::SamplerMipmapMode::eLinear;
-      samplerCreateInfo.maxLod = gsl::narrow<float>(m_mipLevels);
-      // samplerCreateInfo.minLod = gsl::narrow<float>(m_mipLevels >> 1);
+      uploadContext.generateMipmaps(m_image, texWidth, texHeight, m_mipLevels);
     }
-    m_sampler = m_device.createSampler(samplerCreateInfo);
 
-    // Create descriptor info
-    m_descriptorImageInfo = {.sampler = m_sampler,
-                             .imageView = m_imageView,
-                             .imageLayout =
-                                 vk::ImageLayout::eShaderReadOnlyOptimal};
+    createViewAndSampler(device, imageFormat);
   } else {
     throw abcg::RuntimeError(
         fmt::format("Failed to load texture file {}", path));
   }
 }
 
+void abcg::VulkanImage::createCompressed(VulkanUploadContext &uploadContext,
+                                         std::string_view path,
+                                         bool useMipmaps) {
+  auto const &device{uploadContext.getDevice()};
+  CompressedImage const image{path};
+  // As with uncompressed images, which are always sampled as sRGB, the color
+  // space is not chosen by the file. Formats without an sRGB variant (BC5)
+  // are sampled as linear.
+  auto const imageFormat{getVulkanFormat(image.getFormat(), true)};
+
+  // BCn formats are only available if the device supports the
+  // textureCompressionBC feature
+  vk::FormatProperties const formatProperties{
+      static_cast<vk::PhysicalDevice>(device.getPhysicalDevice())
+          .getFormatProperties(imageFormat)};
+  if (!(formatProperties.optimalTilingFeatures &
+        vk::FormatFeatureFlagBits::eSampledImage)) {
+    throw abcg::RuntimeError(fmt::format(
+        "The compressed format of texture file {} is not supported", path));
+  }
+
+  // Mipmap levels cannot be generated by blitting compressed images. Only the
+  // levels stored in the file are used.
+  auto const levels{image.getLevels().first(
+      useMipmaps ? image.getLevels().size() : 1)};
+  m_mipLevels = gsl::narrow<uint32_t>(levels.size());
+
+  // Pack all levels in one staging range, with one copy region per level.
+  // The size of each level is a multiple of the block size, so every offset
+  // is properly aligned.
+  std::vector<std::byte> data;
+  std::vector<vk::BufferImageCopy> regions;
+  for (auto &&[index, level] : iter::enumerate(levels)) {
+    regions.push_back(
+        {.bufferOffset = data.size(),
+         .imageSubresource = {.aspectMask = vk::ImageAspectFlagBits::eColor,
+                              .mipLevel = gsl::narrow<uint32_t>(index),
+                              .layerCount = 1},
+         .imageExtent = {level.width, level.height, 1}});
+    data.insert(data.end(), level.data.begin(), level.data.end());
+  }
+
+  std::tie(m_image, m_allocation) = createImage(
+      device,
+      {.imageType = vk::ImageType::e2D,
+       .format = imageFormat,
+       .extent = {.width = image.getWidth(),
+                  .height = image.getHeight(),
+                  .depth = 1},
+       .mipLevels = m_mipLevels,
+       .arrayLayers = 1,
+       .samples = vk::SampleCountFlagBits::e1,
+       .tiling = vk::ImageTiling::eOptimal,
+       .usage = vk::ImageUsageFlagBits::eTransferDst |
+                vk::ImageUsageFlagBits::eSampled,
+       .initialLayout = vk::ImageLayout::eUndefined},
+      vk::MemoryPropertyFlagBits::eDeviceLocal);
+
+  uploadContext.uploadImage(m_image, data, regions,
+                            {.aspectMask = vk::ImageAspectFlagBits::eColor,
+                             .levelCount = m_mipLevels,
+                             .layerCount = 1});
+
+  createViewAndSampler(device, imageFormat);
+}
+
+void abcg::VulkanImage::createViewAndSampler(VulkanDevice const &device,
+                                             vk::Format imageFormat) {
+  // Create image view
+  m_imageView = m_device.createImageView(
+      {.image = m_image,
+       .viewType = vk::ImageViewType::e2D,
+       .format = imageFormat,
+       .subresourceRange = {.aspectMask = vk::ImageAspectFlagBits::eColor,
+                            .levelCount = m_mipLevels,
+                            .layerCount = 1}});
+
+  // Create sampler
+  vk::SamplerCreateInfo samplerCreateInfo{
+      .magFilter = vk::Filter::eLinear,
+      .minFilter = vk::Filter::eLinear,
+      .mipmapMode = vk::SamplerMipmapMode::eLinear,
+      .addressModeU = vk::SamplerAddressMode::eRepeat,
+      .addressModeV = vk::SamplerAddressMode::eRepeat,
+      .addressModeW = vk::SamplerAddressMode::eRepeat,
+      .mipLodBias = 0.0f,
+      .anisotropyEnable = VK_TRUE,
+      .maxAnisotropy =
+          static_cast<vk::PhysicalDevice>(device.getPhysicalDevice())
+              .getProperties()
+              .limits.maxSamplerAnisotropy,
+      .compareEnable = VK_FALSE,
+      .compareOp = vk::CompareOp::eAlways,
+      .minLod = 0.0f,
+      .maxLod = 0.0f,
+      .borderColor = vk::BorderColor::eIntOpaqueBlack,
+      .unnormalizedCoordinates = VK_FALSE};
+
+  if (m_mipLevels > 1) {
+    samplerCreateInfo.mipmapMode = vk::SamplerMipmapMode::eLinear;
+    samplerCreateInfo.maxLod = gsl::narrow<float>(m_mipLevels);
+    // samplerCreateInfo.minLod = gsl::narrow<float>(m_mipLevels >> 1);
+  }
+  m_sampler = m_device.createSampler(samplerCreateInfo);
+
+  // Create descriptor info
+  m_descriptorImageInfo = {.sampler = m_sampler,
+                           .imageView = m_imageView,
+                           .imageLayout =
+                               vk::ImageLayout::eShaderReadOnlyOptimal};
+}
+
 void abcg::VulkanImage::create(VulkanDevice const &device,
                                VulkanImageCreateInfo const &createInfo) {
   m_device = static_cast<vk::Device>(device);
+  m_allocator = &device.getAllocator();
 
   // Create image only if createInfo.viewInfo.image is undefined
   if (!createInfo.viewInfo.image) {
-    std::tie(m_image, m_deviceMemory) =
+    std::tie(m_image, m_allocation) =
         createImage(device, createInfo.info, createInfo.properties);
   }
 
@@ -185,8 +302,8 @@ void abcg::VulkanImage::destroy() {
   if (m_image) {
     m_device.destroyImage(m_image);
   }
-  if (m_deviceMemory) {
-    m_device.freeMemory(m_deviceMemory);
+  if (m_allocator != nullptr) {
+    m_allocator->free(m_allocation);
   }
 }
 
@@ -201,10 +318,22 @@ abcg::VulkanImage::operator vk::Image const &() const noexcept {
  * @brief Returns the opaque handle to the device memory object associated
  * with this image.
  *
- * @return Device memory object.
+ * @return Device memory object. The image starts at the offset given by
+ * abcg::VulkanImage::getAllocation.
  */
 vk::DeviceMemory const &abcg::VulkanImage::getDeviceMemory() const noexcept {
-  return m_deviceMemory;
+  return m_allocation.memory;
+}
+
+/**
+ * @brief Returns the range of device memory used by this image.
+ *
+ * @return Memory range, or an empty range if the image was not created by this
+ * object (e.g. a swapchain image).
+ */
+abcg::VulkanAllocation const &
+abcg::VulkanImage::getAllocation() const noexcept {
+  return m_allocation;
 }
 
 /**
@@ -233,7 +362,8 @@ abcg::VulkanImage::getDescriptorImageInfo() const noexcept {
  * If the image is created with `generateMipmaps = false`, the number of
  * mipmap levels is always 1. Otherwise, it is computed as \f$\lfloor
  * \log_2(\max(w, h)) \rfloor + 1\f$, where \f$w\f$ and \f$h\f$ are the
- * texture width and height.
+ * texture width and height. For KTX2/DDS files, it is the number of levels
+ * stored in the file.
  *
  * @return Number of mipmap levels.
  */
@@ -241,187 +371,16 @@ uint32_t abcg::VulkanImage::getMipLevels() const noexcept {
   return m_mipLevels;
 }
 
-std::pair<vk::Image, vk::DeviceMemory>
+std::pair<vk::Image, abcg::VulkanAllocation>
 abcg::VulkanImage::createImage(VulkanDevice const &device,
                                vk::ImageCreateInfo const &imageInfo,
                                vk::MemoryPropertyFlags properties) const {
   // Create image object
   auto image{m_device.createImage(imageInfo)};
 
-  // Get memory requirements
-  auto const memoryRequirements{m_device.getImageMemoryRequirements(image)};
-
-  // Allocate image memory
-  auto const memoryType{device.getPhysicalDevice().findMemoryType(
-      memoryRequirements.memoryTypeBits, properties)};
-  if (!memoryType.has_value()) {
-    throw abcg::RuntimeError("Failed to find suitable memory type");
-  }
-  auto imageMemory{
-      m_device.allocateMemory({.allocationSize = memoryRequirements.size,
-                               .memoryTypeIndex = memoryType.value()})};
-
-  // Associate image memory to image
-  m_device.bindImageMemory(image, imageMemory, 0);
-
-  return {image, imageMemory};
-}
-
-void abcg::VulkanImage::transitionImageLayout(
-    VulkanDevice const &device, vk::ImageLayout oldImageLayout,
-    vk::ImageLayout newImageLayout,
-    vk::ImageSubresourceRange subresourceRange) const {
-
-  // Gets the corresponding access mask for a given image layout
-  auto accessMask{[](vk::ImageLayout layout) {
-    switch (layout) {
-    case vk::ImageLayout::eColorAttachmentOptimal:
-      return vk::AccessFlagBits::eColorAttachmentWrite;
-    case vk::ImageLayout::eDepthStencilAttachmentOptimal:
-      return vk::AccessFlagBits::eDepthStencilAttachmentWrite;
-    case vk::ImageLayout::eShaderReadOnlyOptimal:
-      return vk::AccessFlagBits::eShaderRead;
-    case vk::ImageLayout::eTransferSrcOptimal:
-      return vk::AccessFlagBits::eTransferRead;
-    case vk::ImageLayout::eTransferDstOptimal:
-      return vk::AccessFlagBits::eTransferWrite;
-    case vk::ImageLayout::ePreinitialized:
-      return vk::AccessFlagBits::eHostWrite;
-    default:
-      return vk::AccessFlagBits::eNone;
-    }
-  }};
-
-  // Gets the corresponding pipeline stage for a given image layout
-  auto stageMask{[](vk::ImageLayout layout) {
-    switch (layout) {
-    case vk::ImageLayout::eTransferDstOptimal:
-    case vk::ImageLayout::eTransferSrcOptimal:
-      return vk::PipelineStageFlagBits::eTransfer;
-    case vk::ImageLayout::eColorAttachmentOptimal:
-      return vk::PipelineStageFlagBits::eColorAttachmentOutput;
-    case vk::ImageLayout::eDepthStencilAttachmentOptimal:
-      return vk::PipelineStageFlagBits::eEarlyFragmentTests;
-    case vk::ImageLayout::eShaderReadOnlyOptimal:
-      return vk::PipelineStageFlagBits::eFragmentShader;
-    case vk::ImageLayout::ePreinitialized:
-      return vk::PipelineStageFlagBits::eHost;
-    case vk::ImageLayout::eUndefined:
-      return vk::PipelineStageFlagBits::eTopOfPipe;
-    default:
-      return vk::PipelineStageFlagBits::eBottomOfPipe;
-    }
-  }};
-
-  // Create image barrier
-  vk::ImageMemoryBarrier imageMemoryBarrier{
-      .srcAccessMask = accessMask(oldImageLayout),
-      .dstAccessMask = accessMask(newImageLayout),
-      .oldLayout = oldImageLayout,
-      .newLayout = newImageLayout,
-      .image = m_image,
-      .subresourceRange = subresourceRange};
-  auto srcStageMask{stageMask(oldImageLayout)};
-  auto destStageMask{stageMask(newImageLayout)};
-
-  // Execute the layout transition
-  device.withCommandBuffer(
-      [&](const auto &commandBuffer) {
-        commandBuffer.pipelineBarrier(srcStageMask, destStageMask,
-                                      vk::DependencyFlags(), nullptr, nullptr,
-                                      imageMemoryBarrier);
-      },
-      vk::QueueFlagBits::eTransfer);
-}
-
-void abcg::VulkanImage::createMipmaps(VulkanDevice const &device,
-                                      vk::Image image, vk::Format imageFormat,
-                                      uint32_t texWidth, uint32_t texHeight,
-                                      uint32_t mipLevels) {
-  // Check if image format supports linear blitting
-  vk::FormatProperties const formatProperties{
-      static_cast<vk::PhysicalDevice>(device.getPhysicalDevice())
-          .getFormatProperties(imageFormat)};
-
-  if (!(formatProperties.optimalTilingFeatures &
-        vk::FormatFeatureFlagBits::eSampledImageFilterLinear)) {
-    // TODO: generate mip maps in software
-    throw abcg::RuntimeError(
-        "Texture image format does not support linear blitting");
-  }
+  // Allocate image memory and associate it to the image
+  auto allocation{device.getAllocator().allocateImage(image, imageInfo.tiling,
+                                                      properties)};
 
-  device.withCommandBuffer(
-      [&](vk::CommandBuffer const &commandBuffer) {
-        vk::ImageMemoryBarrier barrier{
-            .srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
-            .dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
-            .image = image,
-            .subresourceRange = {.aspectMask = vk::ImageAspectFlagBits::eColor,
-                                 .levelCount = 1,
-                                 .baseArrayLayer = 0,
-                                 .layerCount = 1}};
-
-        auto mipWidth{gsl::narrow<int32_t>(texWidth)};
-        auto mipHeight{gsl::narrow<int32_t>(texHeight)};
-
-        for (auto const mipLevel : iter::range(1U, mipLevels)) {
-          barrier.subresourceRange.baseMipLevel = mipLevel - 1;
-          barrier.oldLayout = vk::ImageLayout::eTransferDstOptimal;
-          barrier.newLayout = vk::ImageLayout::eTransferSrcOptimal;
-          barrier.srcAccessMask = vk::AccessFlagBits::eTransferWrite;
-          barrier.dstAccessMask = vk::AccessFlagBits::eTransferRead;
-
-          commandBuffer.pipelineBarrier(vk::PipelineStageFlagBits::eTransfer,
-                                        vk::PipelineStageFlagBits::eTransfer,
-                                        vk::DependencyFlagBits{}, {}, {},
-                                        {{barrier}});
-
-          vk::ImageBlit blit{};
-          blit.srcOffsets[0] = vk::Offset3D{0, 0, 0};
-          blit.srcOffsets[1] = vk::Offset3D{mipWidth, mipHeight, 1};
-          blit.srcSubresource.aspectMask = vk::ImageAspectFlagBits::eColor;
-          blit.srcSubresource.mipLevel = mipLevel - 1;
-          blit.srcSubresource.baseArrayLayer = 0;
-          blit.srcSubresource.layerCount = 1;
-          blit.dstOffsets[0] = vk::Offset3D{0, 0, 0};
-          blit.dstOffsets[1] =
-              vk::Offset3D{mipWidth > 1 ? mipWidth / 2 : 1,
-                           mipHeight > 1 ? mipHeight / 2 : 1, 1};
-          blit.dstSubresource.aspectMask = vk::ImageAspectFlagBits::eColor;
-          blit.dstSubresource.mipLevel = mipLevel;
-          blit.dstSubresource.baseArrayLayer = 0;
-          blit.dstSubresource.layerCount = 1;
-
-          commandBuffer.blitImage(image, vk::ImageLayout::eTransferSrcOptimal,
-                                  image, vk::ImageLayout::eTransferDstOptimal,
-                                  {blit}, vk::Filter::eLinear);
-
-          barrier.oldLayout = vk::ImageLayout::eTransferSrcOptimal;
-          barrier.newLayout = vk::ImageLayout::eShaderReadOnlyOptimal;
-          barrier.srcAccessMask = vk::AccessFlagBits::eTransferRead;
-          barrier.dstAccessMask = vk::AccessFlagBits::eShaderRead;
-
-          commandBuffer.pipelineBarrier(
-              vk::PipelineStageFlagBits::eTransfer,
-              vk::PipelineStageFlagBits::eFragmentShader,
-              vk::DependencyFlagBits{}, {}, {}, {barrier});
-
-          if (mipWidth > 1)
-            mipWidth /= 2;
-          if (mipHeight > 1)
-            mipHeight /= 2;
-        }
-
-        barrier.subresourceRange.baseMipLevel = mipLevels - 1;
-        barrier.oldLayout = vk::ImageLayout::eTransferDstOptimal;
-        barrier.newLayout = vk::ImageLayout::eShaderReadOnlyOptimal;
-        barrier.srcAccessMask = vk::AccessFlagBits::eTransferWrite;
-        barrier.dstAccessMask = vk::AccessFlagBits::eShaderRead;
-
-        commandBuffer.pipelineBarrier(
-            vk::PipelineStageFlagBits::eTransfer,
-            vk::PipelineStageFlagBits::eFragmentShader,
-            vk::DependencyFlagBits{}, {}, {}, {barrier});
-      },
-      vk::QueueFlagBits::eGraphics);
+  return {image, allocation};
 }
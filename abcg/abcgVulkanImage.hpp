@@ -14,6 +14,7 @@
 #define ABCG_VULKAN_IMAGE_HPP_
 
 #include "abcgVulkanDevice.hpp"
+#include "abcgVulkanUploadContext.hpp"
 
 #include <gsl/pointers>
 
@@ -35,12 +36,19 @@ struct abcg::VulkanImageCreateInfo {
  * @brief A class for representing a Vulkan image.
  *
  * This class provides helper functions for creating and managing vk::Image
- * objects.
+ * objects. The image memory is sub-allocated from the abcg::VulkanAllocator of
+ * the device.
+ *
+ * Textures can be loaded in batches with an abcg::VulkanUploadContext, so
+ * that the uploads of many images are submitted at once instead of stalling
+ * the CPU on each image.
  */
 class abcg::VulkanImage {
 public:
   void create(VulkanDevice const &device, std::string_view path,
               bool generateMipmaps = true);
+  void create(VulkanUploadContext &uploadContext, std::string_view path,
+              bool generateMipmaps = true);
   void create(VulkanDevice const &device,
               VulkanImageCreateInfo const &createInfo);
   void destroy();
@@ -48,29 +56,24 @@ public:
   explicit operator vk::Image const &() const noexcept;
 
   [[nodiscard]] vk::DeviceMemory const &getDeviceMemory() const noexcept;
+  [[nodiscard]] VulkanAllocation const &getAllocation() const noexcept;
   [[nodiscard]] vk::ImageView const &getView() const noexcept;
   [[nodiscard]] vk::DescriptorImageInfo const &
   getDescriptorImageInfo() const noexcept;
   [[nodiscard]] uint32_t getMipLevels() const noexcept;
 
 private:
-  [[nodiscard]] std::pair<vk::Image, vk::DeviceMemory>
+  [[nodiscard]] std::pair<vk::Image, VulkanAllocation>
   createImage(VulkanDevice const &device, vk::ImageCreateInfo const &imageInfo,
               vk::MemoryPropertyFlags properties) const;
-  void transitionImageLayout(VulkanDevice const &device,
-                             vk::ImageLayout oldImageLayout,
-                             vk::ImageLayout newImageLayout,
-                             vk::ImageSubresourceRange subresourceRange = {
-                                 .aspectMask = vk::ImageAspectFlagBits::eColor,
-                                 .levelCount = 1,
-                                 .layerCount = 1}) const;
-
-  static void createMipmaps(VulkanDevice const &device, vk::Image image,
-                            vk::Format imageFormat, uint32_t texWidth,
-                            uint32_t texHeight, uint32_t mipLevels);
+  void createCompressed(VulkanUploadContext &uploadContext,
+                        std::string_view path, bool useMipmaps);
+  void createViewAndSampler(VulkanDevice const &device,
+                            vk::Format imageFormat);
 
   vk::Image m_image;
-  vk::DeviceMemory m_deviceMemory;
+  VulkanAllocation m_allocation;
+  VulkanAllocator *m_allocator{};
   vk::ImageView m_imageView;
   vk::Sampler m_sampler;
   vk::DescriptorImageInfo m_descriptorImageInfo;
@@ -140,8 +140,9 @@ void abcg::VulkanPhysicalDevice::checkQueueFamily(
     m_queuesFamilies.compute = queueFamilyIndex;
   }
 
-  // Check for present queue
-  if (!m_queuesFamilies.present.has_value() &&
+  // Check for present queue. Without a surface (headless mode), nothing is
+  // presented
+  if (m_surfaceKHR && !m_queuesFamilies.present.has_value() &&
       m_physicalDevice.getSurfaceSupportKHR(queueFamilyIndex, m_surfaceKHR) ==
           VK_TRUE) {
     // Take the first index with surface support
@@ -173,7 +174,7 @@ void abcg::VulkanPhysicalDevice::findQueueFamilies(
   }
 
   if (!m_queuesFamilies.graphics.has_value() ||
-      !m_queuesFamilies.present.has_value()) {
+      (m_surfaceKHR && !m_queuesFamilies.present.has_value())) {
     throw abcg::RuntimeError(
         "Device does not have a graphics or present queue");
   }
@@ -227,11 +228,14 @@ bool abcg::VulkanPhysicalDevice::isDeviceSuitable(
   auto swapchainIsAdequate{false};
 
   findQueueFamilies(useSeparateTransferQueue);
-  auto const &queueFamilyAdequate{m_queuesFamilies.graphics.has_value() &&
-                                  m_queuesFamilies.present.has_value()};
+  auto const &queueFamilyAdequate{
+      m_queuesFamilies.graphics.has_value() &&
+      (!m_surfaceKHR || m_queuesFamilies.present.has_value())};
 
   auto const &extensionsSupported{checkExtensionsSupport(extensions).empty()};
-  if (extensionsSupported) {
+  if (!m_surfaceKHR) {
+    swapchainIsAdequate = true;
+  } else if (extensionsSupported) {
     swapchainIsAdequate =
         !m_physicalDevice.getSurfaceFormatsKHR(m_surfaceKHR).empty() &&
         !m_physicalDevice.getSurfacePresentModesKHR(m_surfaceKHR).empty();
@@ -0,0 +1,482 @@
+/**
+ * @file abcgVulkanProfiler.cpp
+ * @brief Definition of abcg::VulkanProfiler
+ *
+ * This file is part of ABCg (https://github.com/hbatagelo/abcg).
+ *
+ * @copyright (c) 2021--2023 Harlen Batagelo. All rights reserved.
+ * This project is released under the MIT License.
+ */
+
+#include "abcgVulkanProfiler.hpp"
+
+#include <fmt/core.h>
+#include <fmt/format.h>
+
+#include <algorithm>
+#include <iterator>
+#include <limits>
+
+#include "abcgProfilerCommon.hpp"
+#include "abcgVulkanSwapchain.hpp"
+
+namespace {
+// Quotes a CSV field, doubling the quotes it contains
+std::string quoteCSV(std::string_view text) {
+  std::string quoted{"\""};
+  for (auto const character : text) {
+    if (character == '"') {
+      quoted += '"';
+    }
+    quoted += character;
+  }
+  quoted += '"';
+  return quoted;
+}
+
+// Draws the regions of a frame as rows of bars, one row per nesting level
+void drawTimeline(abcg::VulkanProfilerFrame const &frame) {
+  auto maxDepth{0};
+  std::vector<abcg::detail::ProfilerBar> bars;
+  bars.reserve(frame.regions.size());
+  for (auto const &region : frame.regions) {
+    maxDepth = std::max(maxDepth, region.depth);
+    bars.push_back({.name = region.name,
+                    .row = region.depth,
+                    .begin = region.begin,
+                    .end = region.end});
+  }
+
+  abcg::detail::drawProfilerTimeline(bars, maxDepth + 1, frame.begin,
+                                     frame.end);
+  ImGui::Text("Frame %llu: %.3f ms (GPU)",
+              static_cast<unsigned long long>(frame.number),
+              (frame.end - frame.begin) * 1000.0);
+}
+} // namespace
+
+/**
+ * @brief Begins a region.
+ *
+ * @param frame Frame whose command buffer is being recorded.
+ * @param name Name of the region.
+ */
+abcg::VulkanProfiler::Region::Region(VulkanFrame const &frame,
+                                     std::string_view name)
+    : m_frame{frame} {
+  if (m_frame.profiler != nullptr) {
+    m_frame.profiler->beginRegion(m_frame.commandBuffer, name);
+  }
+}
+
+/**
+ * @brief Ends the region.
+ */
+abcg::VulkanProfiler::Region::~Region() {
+  if (m_frame.profiler != nullptr) {
+    m_frame.profiler->endRegion(m_frame.commandBuffer);
+  }
+}
+
+/**
+ * @brief Creates the profiler.
+ *
+ * The profiler is created disabled. Call abcg::VulkanProfiler::setEnabled to
+ * start recording frames.
+ *
+ * @param device Vulkan device.
+ * @param framesInFlight Number of frames in flight of the swapchain.
+ * @param maxRegions Maximum number of regions measured in a frame, besides
+ * the passes of the swapchain. Regions that exceed this number are ignored.
+ * @param historySize Number of frames kept in the history.
+ */
+void abcg::VulkanProfiler::create(VulkanDevice const &device,
+                                  uint32_t framesInFlight, uint32_t maxRegions,
+                                  std::size_t historySize) {
+  destroy();
+
+  auto const &physicalDevice{device.getPhysicalDevice()};
+  auto const &vkPhysicalDevice{
+      static_cast<vk::PhysicalDevice>(physicalDevice)};
+  auto const properties{vkPhysicalDevice.getProperties()};
+
+  uint32_t validBits{};
+  if (auto const graphics{physicalDevice.getQueuesFamilies().graphics}) {
+    validBits = vkPhysicalDevice.getQueueFamilyProperties()
+                    .at(graphics.value())
+                    .timestampValidBits;
+  }
+
+  m_deviceName = properties.deviceName.data();
+  m_timestampPeriod = properties.limits.timestampPeriod;
+  m_timestampMask = validBits >= 64 ? std::numeric_limits<uint64_t>::max()
+                                    : (uint64_t{1} << validBits) - 1;
+  m_supported = validBits > 0 && m_timestampPeriod > 0.0;
+  m_frames.assign(std::max<std::size_t>(historySize, 1), {});
+
+  if (!m_supported) {
+    return;
+  }
+
+  m_device = static_cast<vk::Device>(device);
+  m_queriesPerSlot = m_passQueryCount + 2 * maxRegions;
+
+  m_slots.resize(std::max(framesInFlight, 1U));
+  for (auto const index : iter::range(m_slots.size())) {
+    m_slots.at(index).firstQuery =
+        gsl::narrow<uint32_t>(index) * m_queriesPerSlot;
+  }
+
+  m_queryPool = m_device.createQueryPool(
+      {.queryType = vk::QueryType::eTimestamp,
+       .queryCount =
+           gsl::narrow<uint32_t>(m_slots.size()) * m_queriesPerSlot});
+}
+
+/**
+ * @brief Releases the query pool and the history of the profiler.
+ *
+ * The commands that write to the queries must have finished executing.
+ */
+void abcg::VulkanProfiler::destroy() {
+  if (m_queryPool) {
+    m_device.destroyQueryPool(m_queryPool);
+    m_queryPool = vk::QueryPool{};
+  }
+  m_device = vk::Device{};
+  m_slots.clear();
+  m_frames.clear();
+  m_openRegions.clear();
+  m_currentSlot = nullptr;
+  m_epoch.reset();
+  m_frameNumber = 0;
+  m_nextFrame = 0;
+  m_frameCount = 0;
+  m_supported = false;
+  m_active = false;
+}
+
+/**
+ * @brief Sets whether the profiler records frames.
+ *
+ * @param enabled Whether to record frames, starting at the next call to
+ * abcg::VulkanProfiler::beginFrame.
+ */
+void abcg::VulkanProfiler::setEnabled(bool enabled) noexcept {
+  m_enabled = enabled;
+}
+
+/**
+ * @brief Returns whether the profiler records frames.
+ *
+ * @return `true` if the profiler is enabled.
+ */
+bool abcg::VulkanProfiler::isEnabled() const noexcept { return m_enabled; }
+
+/**
+ * @brief Returns whether the graphics queue supports timestamp queries.
+ *
+ * @return `true` if frames can be measured.
+ */
+bool abcg::VulkanProfiler::isSupported() const noexcept { return m_supported; }
+
+/**
+ * @brief Begins a frame.
+ *
+ * Reads the results of the frame that used the same frame in flight, resets
+ * its queries and writes the timestamp of the beginning of the frame. This is
+ * called by abcg::VulkanSwapchain::render.
+ *
+ * @param commandBuffer Command buffer submitted before the command buffers of
+ * the frame. It must be in the recording state and outside of a render pass.
+ * @param frameInFlightIndex Index of the frame in flight. The commands
+ * previously submitted by this frame in flight must have finished executing.
+ */
+void abcg::VulkanProfiler::beginFrame(vk::CommandBuffer const &commandBuffer,
+                                      uint32_t frameInFlightIndex) {
+  m_active = m_enabled && m_supported && !m_paused &&
+             frameInFlightIndex < m_slots.size();
+  if (!m_active) {
+    return;
+  }
+
+  m_currentSlot = &m_slots.at(frameInFlightIndex);
+  resolve(*m_currentSlot);
+
+  auto &slot{*m_currentSlot};
+  slot.frameNumber = ++m_frameNumber;
+  slot.usedQueries = m_passQueryCount;
+  slot.regions.clear();
+  m_openRegions.clear();
+
+  commandBuffer.resetQueryPool(m_queryPool, slot.firstQuery, m_queriesPerSlot);
+  commandBuffer.writeTimestamp(vk::PipelineStageFlagBits::eTopOfPipe,
+                               m_queryPool, slot.firstQuery);
+}
+
+/**
+ * @brief Writes the timestamp of the end of the main pass.
+ *
+ * This is called by abcg::VulkanSwapchain::render.
+ *
+ * @param commandBuffer UI command buffer, before the UI render pass begins.
+ */
+void abcg::VulkanProfiler::beginUIPass(vk::CommandBuffer const &commandBuffer) {
+  if (!m_active) {
+    return;
+  }
+
+  commandBuffer.writeTimestamp(vk::PipelineStageFlagBits::eBottomOfPipe,
+                               m_queryPool, m_currentSlot->firstQuery + 1);
+}
+
+/**
+ * @brief Ends the frame.
+ *
+ * Regions that were not ended are ended at this point. This is called by
+ * abcg::VulkanSwapchain::render.
+ *
+ * @param commandBuffer UI command buffer, after the UI render pass ends.
+ */
+void abcg::VulkanProfiler::endFrame(vk::CommandBuffer const &commandBuffer) {
+  if (!m_active) {
+    return;
+  }
+
+  while (!m_openRegions.empty()) {
+    endRegion(commandBuffer);
+  }
+
+  commandBuffer.writeTimestamp(vk::PipelineStageFlagBits::eBottomOfPipe,
+                               m_queryPool, m_currentSlot->firstQuery + 2);
+  m_active = false;
+}
+
+/**
+ * @brief Begins a region.
+ *
+ * Prefer using abcg::VulkanProfiler::Region, which ends the region
+ * automatically. Regions must end in the reverse order they begin.
+ *
+ * @param commandBuffer Command buffer in the recording state.
+ * @param name Name of the region. The string is not copied and must outlive
+ * the profiler (e.g., a string literal).
+ */
+void abcg::VulkanProfiler::beginRegion(vk::CommandBuffer const &commandBuffer,
+                                       std::string_view name) {
+  if (!m_active) {
+    return;
+  }
+
+  auto &slot{*m_currentSlot};
+  if (slot.usedQueries + 2 > m_queriesPerSlot) {
+    m_openRegions.emplace_back();
+    return;
+  }
+
+  m_openRegions.emplace_back(slot.regions.size());
+  // Regions are nested in the main pass
+  slot.regions.push_back(
+      {.name = name,
+       .depth = gsl::narrow<int>(m_openRegions.size()),
+       .query = slot.usedQueries});
+  commandBuffer.writeTimestamp(vk::PipelineStageFlagBits::eTopOfPipe,
+                               m_queryPool,
+                               slot.firstQuery + slot.usedQueries);
+  slot.usedQueries += 2;
+}
+
+/**
+ * @brief Ends the last region that began.
+ *
+ * @param commandBuffer Command buffer in the recording state.
+ */
+void abcg::VulkanProfiler::endRegion(vk::CommandBuffer const &commandBuffer) {
+  if (!m_active || m_openRegions.empty()) {
+    return;
+  }
+
+  auto const region{m_openRegions.back()};
+  m_openRegions.pop_back();
+
+  if (region.has_value()) {
+    auto const &slot{*m_currentSlot};
+    commandBuffer.writeTimestamp(
+        vk::PipelineStageFlagBits::eBottomOfPipe, m_queryPool,
+        slot.firstQuery + slot.regions.at(region.value()).query + 1);
+  }
+}
+
+/**
+ * @brief Returns the frames of the history.
+ *
+ * @return Frames whose results were read, from the oldest to the newest.
+ */
+std::vector<abcg::VulkanProfilerFrame const *>
+abcg::VulkanProfiler::getFrames() const {
+  std::vector<VulkanProfilerFrame const *> frames;
+  frames.reserve(m_frameCount);
+  auto const first{m_frameCount < m_frames.size() ? 0 : m_nextFrame};
+  for (auto const offset : iter::range(m_frameCount)) {
+    frames.push_back(&m_frames.at((first + offset) % m_frames.size()));
+  }
+  return frames;
+}
+
+/**
+ * @brief Draws a Dear ImGui window with the GPU frame times of the history
+ * and the timeline of the newest frame.
+ *
+ * This must be called between `ImGui::NewFrame` and `ImGui::Render` (e.g.,
+ * in abcg::VulkanWindow::onPaintUI).
+ */
+void abcg::VulkanProfiler::drawOverlay() {
+  ImGui::SetNextWindowPos(ImVec2(5, 70), ImGuiCond_FirstUseEver);
+  ImGui::SetNextWindowSize(ImVec2(480, 0), ImGuiCond_FirstUseEver);
+  if (!ImGui::Begin("Profiler")) {
+    ImGui::End();
+    return;
+  }
+
+  if (!m_supported) {
+    ImGui::TextUnformatted("Timestamp queries are not supported");
+    ImGui::End();
+    return;
+  }
+
+  ImGui::TextUnformatted(m_deviceName.c_str());
+
+  auto const frames{getFrames()};
+  std::vector<float> frameTimes;
+  frameTimes.reserve(frames.size());
+  for (auto const *frame : frames) {
+    frameTimes.push_back(
+        gsl::narrow_cast<float>((frame->end - frame->begin) * 1000.0));
+  }
+
+  detail::drawProfilerFrameTimes(frameTimes, m_paused);
+  detail::drawProfilerSaveButton(
+      "Save CSV", "profile.csv",
+      [this](std::string_view path) { saveCSV(path); });
+  detail::drawProfilerSaveButton(
+      "Save trace", "trace.json",
+      [this](std::string_view path) { saveChromeTrace(path); });
+
+  if (!frames.empty()) {
+    drawTimeline(*frames.back());
+  }
+
+  ImGui::End();
+}
+
+/**
+ * @brief Saves the regions of the frames of the history as comma-separated
+ * values.
+ *
+ * Each row contains the name of the physical device, the frame number, the
+ * region name, its nesting level, and its begin time, end time and duration
+ * in milliseconds. Files saved on different devices can be concatenated for
+ * comparison.
+ *
+ * @param path Path of the CSV file.
+ *
+ * @throw abcg::RuntimeError if the file cannot be written.
+ */
+void abcg::VulkanProfiler::saveCSV(std::string_view path) const {
+  std::string csv{"device,frame,region,depth,begin_ms,end_ms,duration_ms\n"};
+  auto const device{quoteCSV(m_deviceName)};
+
+  auto const addRow{[&](uint64_t frameNumber, std::string_view name, int depth,
+                        double begin, double end) {
+    fmt::format_to(std::back_inserter(csv),
+                   "{},{},{},{},{:.6f},{:.6f},{:.6f}\n", device, frameNumber,
+                   quoteCSV(name), depth, begin * 1000.0, end * 1000.0,
+                   (end - begin) * 1000.0);
+  }};
+
+  for (auto const *frame : getFrames()) {
+    addRow(frame->number, "Frame", -1, frame->begin, frame->end);
+    for (auto const &region : frame->regions) {
+      addRow(frame->number, region.name, region.depth, region.begin,
+             region.end);
+    }
+  }
+
+  detail::writeProfilerFile(path, csv);
+}
+
+/**
+ * @brief Saves the frames of the history in the Chrome trace event format.
+ *
+ * The file can be opened in `chrome://tracing` or in Perfetto
+ * (https://ui.perfetto.dev). The process is named after the physical device.
+ *
+ * @param path Path of the JSON file.
+ *
+ * @throw abcg::RuntimeError if the file cannot be written.
+ */
+void abcg::VulkanProfiler::saveChromeTrace(std::string_view path) const {
+  detail::ChromeTrace trace;
+  trace.setProcessName(m_deviceName);
+  trace.setThreadName(1, "GPU");
+  for (auto const *frame : getFrames()) {
+    trace.addEvent(fmt::format("Frame {}", frame->number), 1, frame->begin,
+                   frame->end);
+    for (auto const &region : frame->regions) {
+      trace.addEvent(region.name, 1, region.begin, region.end);
+    }
+  }
+  trace.save(path);
+}
+
+// Reads the timestamps of a slot into the history. The commands that wrote
+// them have finished executing, so the results are not waited for; if they
+// are still not available, the frame is dropped
+void abcg::VulkanProfiler::resolve(QuerySlot &slot) {
+  if (slot.usedQueries == 0) {
+    return;
+  }
+
+  auto const results{m_device.getQueryPoolResults<uint64_t>(
+      m_queryPool, slot.firstQuery, slot.usedQueries,
+      slot.usedQueries * sizeof(uint64_t), sizeof(uint64_t),
+      vk::QueryResultFlagBits::e64)};
+  slot.usedQueries = 0;
+  if (results.result != vk::Result::eSuccess) {
+    return;
+  }
+
+  auto const &timestamps{results.value};
+  if (!m_epoch.has_value()) {
+    m_epoch = timestamps.at(0);
+  }
+
+  auto &frame{m_frames.at(m_nextFrame)};
+  m_nextFrame = (m_nextFrame + 1) % m_frames.size();
+  m_frameCount = std::min(m_frameCount + 1, m_frames.size());
+
+  frame.number = slot.frameNumber;
+  frame.begin = toSeconds(timestamps.at(0));
+  frame.end = toSeconds(timestamps.at(2));
+  frame.regions.clear();
+  frame.regions.push_back({.name = "Main pass",
+                           .begin = frame.begin,
+                           .end = toSeconds(timestamps.at(1))});
+  for (auto const &region : slot.regions) {
+    frame.regions.push_back(
+        {.name = region.name,
+         .depth = region.depth,
+         .begin = toSeconds(timestamps.at(region.query)),
+         .end = toSeconds(timestamps.at(region.query + 1))});
+  }
+  frame.regions.push_back({.name = "UI pass",
+                           .begin = toSeconds(timestamps.at(1)),
+                           .end = frame.end});
+}
+
+// Converts a timestamp to seconds since the epoch. Timestamps wrap around
+// after timestampValidBits bits
+double abcg::VulkanProfiler::toSeconds(uint64_t timestamp) const {
+  auto const ticks{(timestamp - m_epoch.value_or(0)) & m_timestampMask};
+  return static_cast<double>(ticks) * m_timestampPeriod * 1e-9;
+}
@@ -0,0 +1,203 @@
+/**
+ * @file abcgVulkanProfiler.hpp
+ * @brief Header file of abcg::VulkanProfiler
+ *
+ * Declaration of abcg::VulkanProfiler and related structures.
+ *
+ * This file is part of ABCg (https://github.com/hbatagelo/abcg).
+ *
+ * @copyright (c) 2021--2023 Harlen Batagelo. All rights reserved.
+ * This project is released under the MIT License.
+ */
+
+#ifndef ABCG_VULKAN_PROFILER_HPP_
+#define ABCG_VULKAN_PROFILER_HPP_
+
+#include "abcgExternal.hpp"
+#include "abcgVulkanDevice.hpp"
+
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace abcg {
+struct VulkanFrame;
+struct VulkanProfilerRegion;
+struct VulkanProfilerFrame;
+class VulkanProfiler;
+} // namespace abcg
+
+/**
+ * @brief GPU timing of a region measured by abcg::VulkanProfiler.
+ *
+ * Times are in seconds since the beginning of the first frame measured by the
+ * profiler.
+ */
+struct abcg::VulkanProfilerRegion {
+  /** @brief Name of the region. */
+  std::string_view name;
+  /** @brief Nesting level of the region, starting at 0. */
+  int depth{};
+  /** @brief Time the GPU began executing the commands of the region. */
+  double begin{};
+  /** @brief Time the GPU finished executing the commands of the region. */
+  double end{};
+};
+
+/**
+ * @brief Regions measured by abcg::VulkanProfiler during a frame.
+ */
+struct abcg::VulkanProfilerFrame {
+  /** @brief Sequential number of the frame, starting at 1. */
+  uint64_t number{};
+  /** @brief Time the GPU began executing the frame. */
+  double begin{};
+  /** @brief Time the GPU finished executing the frame. */
+  double end{};
+  /** @brief Regions of the frame, in the order they began. */
+  std::vector<VulkanProfilerRegion> regions;
+};
+
+/**
+ * @brief GPU profiler with timestamp queries written at the passes of
+ * abcg::VulkanSwapchain::render.
+ *
+ * Each frame in flight has its own range of timestamp queries in a
+ * `vk::QueryPool`. The swapchain writes timestamps at the beginning of the
+ * frame, between the main pass and the UI pass, and at the end of the UI pass.
+ * The results of a frame are read when its frame in flight is reused, after
+ * its fence was waited for, so reading them never stalls the pipeline.
+ * Timestamps are converted to seconds with the `timestampPeriod` limit of the
+ * physical device.
+ *
+ * abcg::VulkanWindow owns a profiler (see abcg::VulkanWindow::getProfiler).
+ * Named regions can be added inside abcg::VulkanWindow::onPaint with
+ * abcg::VulkanProfiler::Region, while the command buffer of the frame is being
+ * recorded:
+ *
+ * @code
+ * void Window::onPaint(abcg::VulkanFrame const &frame) {
+ *   frame.commandBuffer.begin(...);
+ *   {
+ *     abcg::VulkanProfiler::Region const region{frame, "Scene"};
+ *     // ...
+ *   }
+ *   frame.commandBuffer.end();
+ * }
+ * @endcode
+ *
+ * The last frames can be shown in an overlay (see
+ * abcg::WindowSettings::showProfiler) and exported with
+ * abcg::VulkanProfiler::saveCSV and abcg::VulkanProfiler::saveChromeTrace.
+ *
+ * @remark Nothing is measured if the graphics queue does not support
+ * timestamps.
+ */
+class abcg::VulkanProfiler {
+public:
+  /**
+   * @brief RAII object that measures a region of abcg::VulkanProfiler.
+   *
+   * The region begins when the object is constructed and ends when it is
+   * destroyed. Both timestamps are written to abcg::VulkanFrame::commandBuffer,
+   * which must be in the recording state during the lifetime of the object.
+   * Nothing is measured if abcg::VulkanFrame::profiler is nullptr.
+   */
+  class Region {
+  public:
+    /**
+     * @brief Begins a region.
+     *
+     * @param frame Frame whose command buffer is being recorded.
+     * @param name Name of the region. The string is not copied and must
+     * outlive the profiler (e.g., a string literal).
+     */
+    Region(VulkanFrame const &frame, std::string_view name);
+    Region(Region const &) = delete;
+    Region(Region &&) = delete;
+    Region &operator=(Region const &) = delete;
+    Region &operator=(Region &&) = delete;
+    /**
+     * @brief Ends the region.
+     */
+    ~Region();
+
+  private:
+    VulkanFrame const &m_frame;
+  };
+
+  void create(VulkanDevice const &device, uint32_t framesInFlight,
+              uint32_t maxRegions = 64, std::size_t historySize = 240);
+  void destroy();
+
+  void setEnabled(bool enabled) noexcept;
+  [[nodiscard]] bool isEnabled() const noexcept;
+  [[nodiscard]] bool isSupported() const noexcept;
+
+  void beginFrame(vk::CommandBuffer const &commandBuffer,
+                  uint32_t frameInFlightIndex);
+  void beginUIPass(vk::CommandBuffer const &commandBuffer);
+  void endFrame(vk::CommandBuffer const &commandBuffer);
+  void beginRegion(vk::CommandBuffer const &commandBuffer,
+                   std::string_view name);
+  void endRegion(vk::CommandBuffer const &commandBuffer);
+
+  [[nodiscard]] std::vector<VulkanProfilerFrame const *> getFrames() const;
+
+  void drawOverlay();
+  void saveCSV(std::string_view path) const;
+  void saveChromeTrace(std::string_view path) const;
+
+private:
+  // Queries written by the swapchain: beginning of the frame, end of the main
+  // pass and end of the UI pass
+  static constexpr uint32_t m_passQueryCount{3};
+
+  // Region whose end timestamp may not be written yet
+  struct PendingRegion {
+    std::string_view name;
+    int depth{};
+    uint32_t query{};
+  };
+
+  // Range of queries of a frame in flight
+  struct QuerySlot {
+    uint32_t firstQuery{};
+    uint64_t frameNumber{};
+    uint32_t usedQueries{};
+    std::vector<PendingRegion> regions;
+  };
+
+  void resolve(QuerySlot &slot);
+  [[nodiscard]] double toSeconds(uint64_t timestamp) const;
+
+  bool m_enabled{};
+  bool m_active{};
+  bool m_supported{};
+
+  vk::Device m_device;
+  std::string m_deviceName;
+  vk::QueryPool m_queryPool;
+  uint32_t m_queriesPerSlot{};
+  double m_timestampPeriod{};
+  uint64_t m_timestampMask{};
+  std::optional<uint64_t> m_epoch;
+
+  uint64_t m_frameNumber{};
+  std::vector<QuerySlot> m_slots;
+  QuerySlot *m_currentSlot{};
+  // Indices of the open regions in the current slot, or nullopt for regions
+  // that were not measured because the slot ran out of queries
+  std::vector<std::optional<std::size_t>> m_openRegions;
+
+  // Resolved frames, in a ring that begins at m_nextFrame once it is full
+  std::vector<VulkanProfilerFrame> m_frames;
+  std::size_t m_nextFrame{};
+  std::size_t m_frameCount{};
+
+  bool m_paused{};
+};
+
+#endif
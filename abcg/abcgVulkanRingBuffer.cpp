@@ -0,0 +1,152 @@
+/**
+ * @file abcgVulkanRingBuffer.cpp
+ * @brief Definition of abcg::VulkanRingBuffer
+ *
+ * This file is part of ABCg (https://github.com/hbatagelo/abcg).
+ *
+ * @copyright (c) 2021--2023 Harlen Batagelo. All rights reserved.
+ * This project is released under the MIT License.
+ */
+
+#include "abcgVulkanRingBuffer.hpp"
+
+#include <fmt/core.h>
+
+#include <algorithm>
+
+#include "abcgException.hpp"
+
+namespace {
+// Alignment of the buffer size, so that any power-of-two alignment up to this
+// value is preserved when offsets wrap around
+constexpr vk::DeviceSize maxAlignment{4096};
+
+vk::DeviceSize alignUp(vk::DeviceSize value, vk::DeviceSize alignment) {
+  return (value + alignment - 1) / alignment * alignment;
+}
+} // namespace
+
+/**
+ * @brief Creates the buffer of the ring.
+ *
+ * @param device Vulkan device.
+ * @param size Size of the buffer, in bytes. It must hold the transient data of
+ * all frames in flight.
+ * @param usage Buffer usage flags (e.g.
+ * vk::BufferUsageFlagBits::eUniformBuffer).
+ * @param framesInFlight Maximum number of frames being recorded or executed at
+ * the same time.
+ */
+void abcg::VulkanRingBuffer::create(VulkanDevice const &device,
+                                    vk::DeviceSize size,
+                                    vk::BufferUsageFlags usage,
+                                    uint32_t framesInFlight) {
+  m_device = static_cast<vk::Device>(device);
+  m_allocator = &device.getAllocator();
+  m_size = alignUp(size, maxAlignment);
+
+  m_buffer = m_device.createBuffer(
+      {.size = m_size,
+       .usage = usage,
+       .sharingMode = vk::SharingMode::eExclusive});
+  m_allocation = m_allocator->allocateBuffer(
+      m_buffer, vk::MemoryPropertyFlagBits::eHostVisible |
+                    vk::MemoryPropertyFlagBits::eHostCoherent);
+
+  m_head = 0;
+  m_tail = 0;
+  m_frameBegins.assign(std::max(framesInFlight, 1U), 0);
+  m_frameIndex = 0;
+}
+
+/**
+ * @brief Destroys the buffer and releases its memory.
+ */
+void abcg::VulkanRingBuffer::destroy() {
+  if (!m_device) {
+    return;
+  }
+
+  m_device.destroyBuffer(m_buffer);
+  m_allocator->free(m_allocation);
+  m_buffer = vk::Buffer{};
+  m_device = vk::Device{};
+}
+
+/**
+ * @brief Starts a new frame.
+ *
+ * The ranges allocated by the frame that used the same frame slot become
+ * available for reuse.
+ *
+ * @remark This must be called only when the frame that started
+ * `framesInFlight` frames ago has finished executing on the device.
+ */
+void abcg::VulkanRingBuffer::beginFrame() {
+  m_frameIndex = (m_frameIndex + 1) % m_frameBegins.size();
+  m_frameBegins.at(m_frameIndex) = m_head;
+
+  // The oldest frame still in flight is the one that comes next in the ring
+  m_tail = m_frameBegins.at((m_frameIndex + 1) % m_frameBegins.size());
+}
+
+/**
+ * @brief Allocates a range of the buffer for the current frame.
+ *
+ * @param size Size of the range, in bytes.
+ * @param alignment Alignment of the offset of the range. Must be a power of
+ * two not larger than 4096.
+ *
+ * @return Range of the buffer and its mapped address.
+ *
+ * @throw abcg::RuntimeError if there is not enough free space in the ring.
+ */
+abcg::VulkanRingAllocation
+abcg::VulkanRingBuffer::allocate(vk::DeviceSize size,
+                                 vk::DeviceSize alignment) {
+  auto begin{alignUp(m_head, alignment)};
+
+  // Ranges do not wrap around the end of the buffer
+  if (begin % m_size + size > m_size) {
+    begin = alignUp(begin, m_size);
+  }
+
+  if (begin + size - m_tail > m_size) {
+    throw abcg::RuntimeError(fmt::format(
+        "Ring buffer of {} bytes is too small for the frames in flight",
+        m_size));
+  }
+  m_head = begin + size;
+
+  auto const offset{begin % m_size};
+  return {.buffer = m_buffer,
+          .offset = offset,
+          .mappedData =
+              static_cast<std::byte *>(m_allocation.mappedData) + offset};
+}
+
+/**
+ * @brief Conversion to vk::Buffer.
+ */
+abcg::VulkanRingBuffer::operator vk::Buffer const &() const noexcept {
+  return m_buffer;
+}
+
+/**
+ * @brief Returns the size of the buffer.
+ *
+ * @return Size of the buffer, in bytes.
+ */
+vk::DeviceSize abcg::VulkanRingBuffer::getSize() const noexcept {
+  return m_size;
+}
+
+/**
+ * @brief Returns the space used by the frames in flight.
+ *
+ * @return Number of bytes between the oldest range still in use and the end of
+ * the last allocated range.
+ */
+vk::DeviceSize abcg::VulkanRingBuffer::getUsedSize() const noexcept {
+  return m_head - m_tail;
+}
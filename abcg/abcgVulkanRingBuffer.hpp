@@ -0,0 +1,83 @@
+/**
+ * @file abcgVulkanRingBuffer.hpp
+ * @brief Header file of abcg::VulkanRingBuffer
+ *
+ * Declaration of abcg::VulkanRingBuffer
+ *
+ * This file is part of ABCg (https://github.com/hbatagelo/abcg).
+ *
+ * @copyright (c) 2021--2023 Harlen Batagelo. All rights reserved.
+ * This project is released under the MIT License.
+ */
+
+#ifndef ABCG_VULKAN_RING_BUFFER_HPP_
+#define ABCG_VULKAN_RING_BUFFER_HPP_
+
+#include "abcgVulkanDevice.hpp"
+
+namespace abcg {
+struct VulkanRingAllocation;
+class VulkanRingBuffer;
+} // namespace abcg
+
+/**
+ * @brief Range of a buffer returned by abcg::VulkanRingBuffer::allocate.
+ */
+struct abcg::VulkanRingAllocation {
+  /** @brief Buffer that contains the range. */
+  vk::Buffer buffer;
+  /** @brief Offset of the range in the buffer. */
+  vk::DeviceSize offset{};
+  /** @brief Mapped address of the beginning of the range. */
+  void *mappedData{};
+};
+
+/**
+ * @brief Linear ring pool of host-visible memory for per-frame transient
+ * data.
+ *
+ * The ring buffer hands out ranges of one persistently mapped buffer by
+ * bumping an offset, which is much cheaper than creating a buffer for each
+ * piece of data that lives for a single frame (e.g. uniform data and dynamic
+ * vertices). A range becomes available again once the frame that allocated it
+ * is no longer in flight:
+ *
+ * @code
+ * // Once per frame, after waiting for the fence of the frame:
+ * m_ringBuffer.beginFrame();
+ * auto const range{m_ringBuffer.allocate(sizeof(uniforms))};
+ * std::memcpy(range.mappedData, &uniforms, sizeof(uniforms));
+ * // Bind range.buffer at range.offset...
+ * @endcode
+ */
+class abcg::VulkanRingBuffer {
+public:
+  void create(VulkanDevice const &device, vk::DeviceSize size,
+              vk::BufferUsageFlags usage, uint32_t framesInFlight);
+  void destroy();
+
+  void beginFrame();
+  [[nodiscard]] VulkanRingAllocation allocate(vk::DeviceSize size,
+                                              vk::DeviceSize alignment = 256);
+
+  explicit operator vk::Buffer const &() const noexcept;
+
+  [[nodiscard]] vk::DeviceSize getSize() const noexcept;
+  [[nodiscard]] vk::DeviceSize getUsedSize() const noexcept;
+
+private:
+  vk::Buffer m_buffer;
+  VulkanAllocation m_allocation;
+  VulkanAllocator *m_allocator{};
+  vk::Device m_device;
+  vk::DeviceSize m_size{};
+
+  // Offsets grow monotonically and are wrapped around m_size when mapped to
+  // the buffer
+  vk::DeviceSize m_head{};
+  vk::DeviceSize m_tail{};
+  std::vector<vk::DeviceSize> m_frameBegins;
+  std::size_t m_frameIndex{};
+};
+
+#endif
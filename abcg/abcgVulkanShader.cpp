@@ -10,16 +10,43 @@
 
 #include "abcgVulkanShader.hpp"
 #include "abcgException.hpp"
+#include "abcgMappedFile.hpp"
+#include "abcgThreadPool.hpp"
 
 #include <glslang/SPIRV/GlslangToSpv.h>
 
+#include <cppitertools/itertools.hpp>
 #include <fmt/core.h>
-#include <gsl/gsl>
 
+#include <array>
+#include <cstring>
 #include <filesystem>
 #include <fstream>
+#include <functional>
+#include <span>
+#include <thread>
 
 namespace {
+// Default GLSL version and parsing rules used when compiling to SPIR-V
+constexpr int defaultVersion{100};
+constexpr int compileMessages{EShMsgSpvRules | EShMsgVulkanRules};
+
+// Increment whenever the compile options, the glslang version or the layout
+// of the cache file change
+constexpr std::uint32_t cacheVersion{1};
+constexpr std::array<char, 8> cacheMagic{'A', 'B', 'C', 'G', 'S', 'P', 'V',
+                                         '\0'};
+// First word of every SPIR-V module
+constexpr std::uint32_t spirvMagic{0x07230203};
+
+struct CacheHeader {
+  std::array<char, 8> magic{};
+  std::uint32_t version{};
+  std::uint32_t stage{};
+  std::uint64_t sourceSize{};
+  std::uint64_t key{};
+};
+
 TBuiltInResource InitResources() {
   TBuiltInResource Resources{
       .maxLights = 32,
@@ -234,12 +261,18 @@ abcgStageToVulkanStage(abcg::ShaderStage stage) {
   }
 }
 
+// Returns true if filenameOrText is the path of an existing file
+[[nodiscard]] bool isPath(std::string_view filenameOrText) {
+  static const std::size_t maxPathSize{260};
+  std::error_code error;
+  return filenameOrText.size() <= maxPathSize &&
+         std::filesystem::exists(filenameOrText, error);
+}
+
 // If filenameOrText is a filename, returns the contents of the file (assumed
 // to be in text format). Otherwise, returns filenameOrText.
 [[nodiscard]] std::string toSource(std::string_view filenameOrText) {
-  static const std::size_t maxPathSize{260};
-  if (filenameOrText.size() > maxPathSize ||
-      !std::filesystem::exists(filenameOrText)) {
+  if (!isPath(filenameOrText)) {
     return filenameOrText.data();
   }
   std::stringstream source;
@@ -252,18 +285,173 @@ abcgStageToVulkanStage(abcg::ShaderStage stage) {
   }
   return source.str();
 }
+
+// Initializes glslang on first use and finalizes it at program exit, instead
+// of once per compiled shader
+void initializeGlslang() {
+  static struct GlslangProcess {
+    GlslangProcess() { glslang::InitializeProcess(); }
+    GlslangProcess(GlslangProcess const &) = delete;
+    GlslangProcess(GlslangProcess &&) = delete;
+    GlslangProcess &operator=(GlslangProcess const &) = delete;
+    GlslangProcess &operator=(GlslangProcess &&) = delete;
+    ~GlslangProcess() { glslang::FinalizeProcess(); }
+  } const process;
+}
+
+// 64-bit FNV-1a
+[[nodiscard]] std::uint64_t hashBytes(std::span<std::byte const> data,
+                                      std::uint64_t hash = 0xcbf29ce484222325) {
+  constexpr std::uint64_t prime{0x100000001b3};
+  for (auto const byte : data) {
+    hash = (hash ^ static_cast<std::uint64_t>(byte)) * prime;
+  }
+  return hash;
+}
+
+// Hashes the source text together with everything else that changes the
+// generated SPIR-V
+[[nodiscard]] std::uint64_t getCacheKey(abcg::ShaderSource const &source) {
+  std::array const options{cacheVersion,
+                           static_cast<std::uint32_t>(source.stage),
+                           static_cast<std::uint32_t>(defaultVersion),
+                           static_cast<std::uint32_t>(compileMessages)};
+  return hashBytes(std::as_bytes(std::span{options}),
+                   hashBytes(std::as_bytes(std::span{source.source})));
+}
+
+// Copies a SPIR-V module. Returns an empty array if data is not SPIR-V.
+[[nodiscard]] std::vector<uint32_t>
+readSPIRV(std::span<std::byte const> data) {
+  if (data.size() < sizeof(uint32_t) || data.size() % sizeof(uint32_t) != 0) {
+    return {};
+  }
+  std::vector<uint32_t> code(data.size() / sizeof(uint32_t));
+  std::memcpy(code.data(), data.data(), data.size());
+  if (code.front() != spirvMagic) {
+    return {};
+  }
+  return code;
+}
+
+// Loads the file path + ".spv", provided that it is not older than path
+[[nodiscard]] std::vector<uint32_t>
+loadPrecompiled(std::string_view filenameOrText) {
+  if (!isPath(filenameOrText)) {
+    return {};
+  }
+  std::filesystem::path const sourcePath{filenameOrText};
+  auto spirvPath{sourcePath};
+  spirvPath += ".spv";
+
+  std::error_code error;
+  auto const sourceTime{std::filesystem::last_write_time(sourcePath, error)};
+  if (error) {
+    return {};
+  }
+  auto const spirvTime{std::filesystem::last_write_time(spirvPath, error)};
+  if (error || spirvTime < sourceTime) {
+    return {};
+  }
+
+  abcg::MappedFile const file{spirvPath.string()};
+  return readSPIRV(file.getData());
+}
+
+[[nodiscard]] std::filesystem::path
+getCachePath(std::string_view cacheDirectory, std::uint64_t key) {
+  return std::filesystem::path{cacheDirectory} /
+         fmt::format("{:016x}.spv", key);
+}
+
+[[nodiscard]] std::vector<uint32_t>
+loadCached(std::string_view cacheDirectory, std::uint64_t key,
+           abcg::ShaderSource const &source) {
+  abcg::MappedFile const file{getCachePath(cacheDirectory, key).string()};
+  auto const data{file.getData()};
+  CacheHeader header{};
+  if (data.size() < sizeof(header)) {
+    return {};
+  }
+  std::memcpy(&header, data.data(), sizeof(header));
+  if (header.magic != cacheMagic || header.version != cacheVersion ||
+      header.stage != static_cast<std::uint32_t>(source.stage) ||
+      header.sourceSize != source.source.size() || header.key != key) {
+    return {};
+  }
+  return readSPIRV(data.subspan(sizeof(header)));
+}
+
+// Writes to a temporary file first, so that a partially written file is never
+// loaded. Failures are ignored, as the cache is only an optimization.
+void saveCached(std::string_view cacheDirectory, std::uint64_t key,
+                abcg::ShaderSource const &source,
+                std::span<uint32_t const> code) {
+  std::error_code error;
+  std::filesystem::create_directories(cacheDirectory, error);
+  if (error) {
+    return;
+  }
+
+  auto const cachePath{getCachePath(cacheDirectory, key)};
+  auto tempPath{cachePath};
+  tempPath += fmt::format(
+      ".{}.tmp", std::hash<std::thread::id>{}(std::this_thread::get_id()));
+
+  CacheHeader const header{.magic = cacheMagic,
+                           .version = cacheVersion,
+                           .stage = static_cast<std::uint32_t>(source.stage),
+                           .sourceSize = source.source.size(),
+                           .key = key};
+  {
+    std::ofstream stream{tempPath, std::ios::binary | std::ios::trunc};
+    if (!stream) {
+      return;
+    }
+    stream.write(reinterpret_cast<char const *>(&header), sizeof(header));
+    stream.write(reinterpret_cast<char const *>(code.data()),
+                 static_cast<std::streamsize>(code.size_bytes()));
+    if (!stream) {
+      stream.close();
+      std::filesystem::remove(tempPath, error);
+      return;
+    }
+  }
+
+  std::filesystem::rename(tempPath, cachePath, error);
+  if (error) {
+    std::filesystem::remove(tempPath, error);
+  }
+}
+
+// Returns the default cache directory, or an empty string (which disables the
+// cache) if there is no temporary directory
+[[nodiscard]] std::string getDefaultCacheDirectory() {
+  std::error_code error;
+  auto const tempDirectory{std::filesystem::temp_directory_path(error)};
+  if (error) {
+    return {};
+  }
+  return (tempDirectory / "abcg" / "spirv").string();
+}
 } // namespace
 
-// Compiles the given GLSL shader source into Vulkan SPIR-V.
+// Compiles the given GLSL shader source into Vulkan SPIR-V. The compile and
+// link logs are included in the message of the exception thrown on failure,
+// rather than printed, so that shaders can be compiled concurrently.
 std::vector<uint32_t> GLSLtoSPV(abcg::ShaderSource shaderSource) {
-  // Prints out log info for compiling and linking
-  auto printLog{[](glslang::TShader &shader, std::string_view name) {
+  // Returns the log info for compiling and linking
+  auto getLog{[](glslang::TShader &shader, std::string_view name) {
+    std::string result;
     if (std::string const log{shader.getInfoLog()}; !log.empty()) {
-      fmt::print("Shader information log ({} shader):\n{}\n", name, log);
+      result += fmt::format("Shader information log ({} shader):\n{}\n", name,
+                            log);
     }
     if (std::string const log{shader.getInfoDebugLog()}; !log.empty()) {
-      fmt::print("Shader information debug log ({} shader):\n{}\n", name, log);
+      result += fmt::format(
+          "Shader information debug log ({} shader):\n{}\n", name, log);
     }
+    return result;
   }};
 
   auto const *data{shaderSource.source.data()};
@@ -272,17 +460,15 @@ std::vector<uint32_t> GLSLtoSPV(abcg::ShaderSource shaderSource) {
   shader.setStrings(&data, 1);
 
   // Enable SPIR-V and Vulkan rules when parsing GLSL
-  auto messages{gsl::narrow<EShMessages>(EShMsgSpvRules |
-                                         EShMsgVulkanRules /* |
-                         EShMsgEnhanced*/)};
+  auto messages{static_cast<EShMessages>(compileMessages)};
 
   // Compiles
   TBuiltInResource const resources{InitResources()};
-  if (!shader.parse(&resources, 100, false, messages)) {
+  if (!shader.parse(&resources, defaultVersion, false, messages)) {
     auto const *shaderStage{glslangStageToText(stage)};
-    printLog(shader, shaderStage);
-    throw abcg::RuntimeError(
-        fmt::format("Failed to compile {} shader", shaderStage));
+    throw abcg::RuntimeError(fmt::format("Failed to compile {} shader\n{}",
+                                         shaderStage,
+                                         getLog(shader, shaderStage)));
   }
 
   // Links
@@ -290,9 +476,9 @@ std::vector<uint32_t> GLSLtoSPV(abcg::ShaderSource shaderSource) {
   program.addShader(&shader);
   if (!program.link(messages)) {
     auto const *shaderStage{glslangStageToText(stage)};
-    printLog(shader, shaderStage);
-    throw abcg::RuntimeError(
-        fmt::format("Failed to link {} shader", shaderStage));
+    throw abcg::RuntimeError(fmt::format("Failed to link {} shader\n{}",
+                                         shaderStage,
+                                         getLog(shader, shaderStage)));
   }
 
   std::vector<uint32_t> outCode;
@@ -301,9 +487,45 @@ std::vector<uint32_t> GLSLtoSPV(abcg::ShaderSource shaderSource) {
   return outCode;
 }
 
+namespace {
+// Returns the SPIR-V code of a shader, looked up first in a precompiled file,
+// then in the cache, and compiled with glslang as a last resort
+[[nodiscard]] std::vector<uint32_t>
+compileShader(abcg::ShaderSource const &pathOrSource,
+              std::string_view cacheDirectory) {
+  if (auto shader{loadPrecompiled(pathOrSource.source)}; !shader.empty()) {
+    return shader;
+  }
+
+  abcg::ShaderSource const source{.source = toSource(pathOrSource.source),
+                                  .stage = pathOrSource.stage};
+  auto const key{getCacheKey(source)};
+  if (!cacheDirectory.empty()) {
+    if (auto shader{loadCached(cacheDirectory, key, source)};
+        !shader.empty()) {
+      return shader;
+    }
+  }
+
+  initializeGlslang();
+  auto shader{GLSLtoSPV(source)};
+  if (!cacheDirectory.empty()) {
+    saveCached(cacheDirectory, key, source, shader);
+  }
+  return shader;
+}
+} // namespace
+
+std::string abcg::VulkanShader::m_cacheDirectory{getDefaultCacheDirectory()};
+
 /**
  * @brief Compiles a GLSL shader to SPIR-V and creates its module.
  *
+ * The SPIR-V code is looked up first in a precompiled `.spv` file next to the
+ * shader file (if the shader is given by a path), then in the cache directory.
+ * glslang is only invoked if both lookups fail, in which case the compiled code
+ * is stored in the cache.
+ *
  * @param device Vulkan device to be used to create the shader module.
  * @param pathOrSource Path or source code of the GLSL shader to be compiled to
  * SPIR-V.
@@ -314,19 +536,81 @@ std::vector<uint32_t> GLSLtoSPV(abcg::ShaderSource shaderSource) {
 void abcg::VulkanShader::create(VulkanDevice const &device,
                                 ShaderSource const &pathOrSource) {
   m_device = static_cast<vk::Device>(device);
+  m_stage = abcgStageToVulkanStage(pathOrSource.stage);
 
-  ShaderSource const source{.source = toSource(pathOrSource.source),
-                            .stage = pathOrSource.stage};
-
-  glslang::InitializeProcess();
-  std::vector<uint32_t> shader{GLSLtoSPV(source)};
-  m_stage = abcgStageToVulkanStage(source.stage);
-  glslang::FinalizeProcess();
+  auto const shader{compileShader(pathOrSource, m_cacheDirectory)};
 
   m_module = m_device.createShaderModule(
       {.codeSize = shader.size() * sizeof(uint32_t), .pCode = shader.data()});
 }
 
+/**
+ * @brief Compiles a list of GLSL shaders concurrently and creates their
+ * modules.
+ *
+ * Each shader is looked up in the precompiled files and in the cache as in
+ * abcg::VulkanShader::create. The remaining shaders are compiled by the
+ * threads of @a pool, each with its own glslang shader object. The shader
+ * modules are created in the calling thread once all shaders are compiled.
+ *
+ * @param device Vulkan device to be used to create the shader modules.
+ * @param pathsOrSources Paths or source codes of the GLSL shaders.
+ * @param pool Thread pool used for compiling the shaders.
+ *
+ * @return Array of shaders in the same order as @a pathsOrSources.
+ *
+ * @throw abcg::RuntimeError if any shader could not be read from file or has
+ * failed to compile. The message lists every failed shader in the order of
+ * @a pathsOrSources, regardless of the order in which they were compiled. No
+ * shader module is created in this case.
+ */
+std::vector<abcg::VulkanShader>
+abcg::VulkanShader::createBatch(VulkanDevice const &device,
+                                std::span<ShaderSource const> pathsOrSources,
+                                ThreadPool &pool) {
+  std::vector<std::future<std::vector<uint32_t>>> results;
+  results.reserve(pathsOrSources.size());
+  for (auto const &pathOrSource : pathsOrSources) {
+    results.push_back(pool.submit([&pathOrSource] {
+      return compileShader(pathOrSource, m_cacheDirectory);
+    }));
+  }
+
+  // Wait for every task before reporting errors, as the tasks reference
+  // pathsOrSources
+  std::vector<std::vector<uint32_t>> codes;
+  codes.reserve(pathsOrSources.size());
+  std::string errors;
+  std::size_t numErrors{};
+  for (auto &&[index, result] : iter::enumerate(results)) {
+    try {
+      codes.push_back(result.get());
+    } catch (std::exception const &exception) {
+      auto const &source{pathsOrSources[index].source};
+      errors += fmt::format("{}{}: {}", errors.empty() ? "" : "\n",
+                            isPath(source) ? source
+                                           : fmt::format("Shader {}", index),
+                            exception.what());
+      ++numErrors;
+    }
+  }
+  if (numErrors > 0) {
+    throw abcg::RuntimeError(
+        fmt::format("Failed to compile {} of {} shaders\n{}", numErrors,
+                    pathsOrSources.size(), errors));
+  }
+
+  std::vector<VulkanShader> shaders(pathsOrSources.size());
+  for (auto &&[shader, pathOrSource, code] :
+       iter::zip(shaders, pathsOrSources, codes)) {
+    shader.m_device = static_cast<vk::Device>(device);
+    shader.m_stage = abcgStageToVulkanStage(pathOrSource.stage);
+    shader.m_module = shader.m_device.createShaderModule(
+        {.codeSize = code.size() * sizeof(uint32_t), .pCode = code.data()});
+  }
+  return shaders;
+}
+
 /**
  * @brief Destroys the shader module.
  */
@@ -354,4 +638,29 @@ vk::ShaderStageFlagBits const &abcg::VulkanShader::getStage() const noexcept {
  */
 vk::ShaderModule const &abcg::VulkanShader::getModule() const noexcept {
   return m_module;
-}
\ No newline at end of file
+}
+
+/**
+ * @brief Sets the directory of the SPIR-V cache.
+ *
+ * By default, the cache is stored in the `abcg/spirv` subdirectory of the
+ * temporary directory of the system. The directory is created on the first
+ * cache write.
+ *
+ * @param path Path of the cache directory. An empty path disables the cache.
+ *
+ * @remark This must not be called while shaders are being created.
+ */
+void abcg::VulkanShader::setCacheDirectory(std::string_view path) {
+  m_cacheDirectory = path;
+}
+
+/**
+ * @brief Returns the directory of the SPIR-V cache.
+ *
+ * @return Path of the cache directory, or an empty string if the cache is
+ * disabled.
+ */
+std::string const &abcg::VulkanShader::getCacheDirectory() noexcept {
+  return m_cacheDirectory;
+}
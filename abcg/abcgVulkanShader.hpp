@@ -11,10 +11,16 @@
 #ifndef ABCG_VULKAN_SHADER_HPP_
 #define ABCG_VULKAN_SHADER_HPP_
 
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+
 #include "abcgShader.hpp"
 #include "abcgVulkanDevice.hpp"
 
 namespace abcg {
+class ThreadPool;
 class VulkanShader;
 } // namespace abcg
 
@@ -23,16 +29,43 @@ class VulkanShader;
  *
  * This class compiles a GLSL shader into a Vulkan SPIR-V shader and creates the
  * corresponding vk::ShaderModule.
+ *
+ * Compiled SPIR-V is stored in an on-disk cache keyed by a hash of the
+ * source text, shader stage and compile options, so that glslang is only
+ * invoked the first time a given shader is created. If the shader is given by
+ * a path and a file with the same path plus the extension `.spv` exists and is
+ * not older than the source, the precompiled SPIR-V is loaded instead.
+ *
+ * Shaders that are not cached can be compiled concurrently with
+ * abcg::VulkanShader::createBatch:
+ * @code
+ * abcg::ThreadPool pool;
+ * std::array const sources{
+ *     abcg::ShaderSource{.source = assetsPath + "shader.vert",
+ *                        .stage = abcg::ShaderStage::Vertex},
+ *     abcg::ShaderSource{.source = assetsPath + "shader.frag",
+ *                        .stage = abcg::ShaderStage::Fragment}};
+ * auto shaders{abcg::VulkanShader::createBatch(device, sources, pool)};
+ * @endcode
  */
 class abcg::VulkanShader {
 public:
   void create(VulkanDevice const &device, ShaderSource const &pathOrSource);
   void destroy();
 
+  [[nodiscard]] static std::vector<VulkanShader>
+  createBatch(VulkanDevice const &device,
+              std::span<ShaderSource const> pathsOrSources, ThreadPool &pool);
+
   [[nodiscard]] vk::ShaderStageFlagBits const &getStage() const noexcept;
   [[nodiscard]] vk::ShaderModule const &getModule() const noexcept;
 
+  static void setCacheDirectory(std::string_view path);
+  [[nodiscard]] static std::string const &getCacheDirectory() noexcept;
+
 private:
+  static std::string m_cacheDirectory;
+
   vk::ShaderStageFlagBits m_stage{};
   vk::ShaderModule m_module;
   vk::Device m_device;
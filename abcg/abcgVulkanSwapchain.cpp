@@ -17,6 +17,7 @@
 #include "abcgException.hpp"
 #include "abcgVulkanDevice.hpp"
 #include "abcgVulkanPhysicalDevice.hpp"
+#include "abcgVulkanProfiler.hpp"
 #include "abcgVulkanWindow.hpp"
 
 namespace {
@@ -99,6 +100,12 @@ chooseSwapExtent(vk::SurfaceCapabilitiesKHR capabilities,
                                            capabilities.minImageExtent.height,
                                            capabilities.maxImageExtent.height)};
 }
+
+// Extent of the offscreen images used in place of the swapchain images
+[[nodiscard]] vk::Extent2D getOffscreenExtent(glm::ivec2 windowSize) {
+  return {.width = gsl::narrow<uint32_t>(std::max(windowSize.x, 1)),
+          .height = gsl::narrow<uint32_t>(std::max(windowSize.y, 1))};
+}
 } // namespace
 
 void abcg::VulkanSwapchain::create(VulkanDevice const &device,
@@ -120,44 +127,86 @@ void abcg::VulkanSwapchain::destroy() {
 
   destroyMSAAResources();
   destroyDepthResources();
+  destroyFramesInFlight();
   destroyFrames();
   destroyRenderPasses();
 
-  device.destroySwapchainKHR(m_swapchainKHR);
+  // In headless mode, VK_KHR_swapchain is not enabled and its commands must
+  // not be called
+  if (m_swapchainKHR) {
+    device.destroySwapchainKHR(m_swapchainKHR);
+    m_swapchainKHR = vk::SwapchainKHR{};
+  }
 }
 
 void abcg::VulkanSwapchain::render(
-    std::function<void(VulkanFrame const &)> const &fun) {
+    std::function<void(VulkanFrame const &)> const &fun,
+    VulkanProfiler *profiler) {
   auto const &device{static_cast<vk::Device>(m_device)};
+  auto const &frameInFlight{m_framesInFlight.at(m_currentFrameInFlight)};
 
-  // Get current set of semaphores
-  auto [presentCompleteSemaphore,
-        renderCompleteSemaphore]{m_frameSemaphores.at(m_currentSemaphore)};
+  // Wait until the commands submitted by this frame in flight framesInFlight
+  // frames ago have finished executing
+  while (vk::Result::eTimeout ==
+         device.waitForFences(frameInFlight.fence, VK_TRUE,
+                              std::numeric_limits<uint64_t>::max()))
+    ;
 
-  // Acquire an image from the swapchain
-  vk::Result result{};
-  try {
-    result = device.acquireNextImageKHR(
-        m_swapchainKHR, std::numeric_limits<uint64_t>::max(),
-        presentCompleteSemaphore, vk::Fence{}, &m_currentFrame);
-  } catch (vk::OutOfDateKHRError const &) {
-    result = vk::Result::eErrorOutOfDateKHR;
-  }
-  if (result == vk::Result::eErrorOutOfDateKHR ||
-      result == vk::Result::eSuboptimalKHR) {
-    m_swapChainRebuild = true;
-    return;
+  if (m_headless) {
+    // Offscreen images are used in turn
+    m_currentFrame =
+        (m_currentFrame + 1) % gsl::narrow<uint32_t>(m_frames.size());
+  } else {
+    // Acquire an image from the swapchain
+    vk::Result result{};
+    try {
+      result = device.acquireNextImageKHR(
+          m_swapchainKHR, std::numeric_limits<uint64_t>::max(),
+          frameInFlight.presentComplete, vk::Fence{}, &m_currentFrame);
+    } catch (vk::OutOfDateKHRError const &) {
+      result = vk::Result::eErrorOutOfDateKHR;
+    }
+    if (result == vk::Result::eErrorOutOfDateKHR ||
+        result == vk::Result::eSuboptimalKHR) {
+      m_swapChainRebuild = true;
+      return;
+    }
   }
 
-  auto const &frame{m_frames.at(m_currentFrame)};
+  auto &frame{m_frames.at(m_currentFrame)};
 
-  // Wait until command buffer for acquired image has finished executing
-  while (vk::Result::eTimeout ==
-         device.waitForFences(frame.fence, VK_TRUE,
-                              std::numeric_limits<uint64_t>::max()))
-    ;
-  device.resetFences(frame.fence);
-  device.resetCommandPool(frame.commandPool);
+  // The image may still be in use by another frame in flight if images are
+  // acquired out of order
+  if (frame.fence && frame.fence != frameInFlight.fence) {
+    while (vk::Result::eTimeout ==
+           device.waitForFences(frame.fence, VK_TRUE,
+                                std::numeric_limits<uint64_t>::max()))
+      ;
+  }
+  device.resetFences(frameInFlight.fence);
+  device.resetCommandPool(frameInFlight.commandPool);
+
+  frame.frameInFlightIndex = m_currentFrameInFlight;
+  frame.commandPool = frameInFlight.commandPool;
+  frame.commandBuffer = frameInFlight.commandBuffer;
+  frame.commandBufferUI = frameInFlight.commandBufferUI;
+  frame.fence = frameInFlight.fence;
+  if (m_hasUniformArena) {
+    m_uniformArena.beginFrame();
+    frame.uniformArena = &m_uniformArena;
+  }
+
+  // The profiler reads the timestamps of the frames of this frame in flight,
+  // which finished executing, and writes the timestamp of the new frame in a
+  // command buffer submitted before the main pass
+  frame.profiler = profiler;
+  if (profiler != nullptr) {
+    frameInFlight.commandBufferProfiler.begin(
+        {.flags = vk::CommandBufferUsageFlagBits::eOneTimeSubmit});
+    profiler->beginFrame(frameInFlight.commandBufferProfiler,
+                         m_currentFrameInFlight);
+    frameInFlight.commandBufferProfiler.end();
+  }
 
   // Main pass
   fun(frame);
@@ -166,6 +215,10 @@ void abcg::VulkanSwapchain::render(
   frame.commandBufferUI.begin(
       {.flags = vk::CommandBufferUsageFlagBits::eOneTimeSubmit});
 
+  if (profiler != nullptr) {
+    profiler->beginUIPass(frame.commandBufferUI);
+  }
+
   std::array<vk::ClearValue, 2> const clearValues{};
 
   frame.commandBufferUI.beginRenderPass(
@@ -181,33 +234,50 @@ void abcg::VulkanSwapchain::render(
 
   frame.commandBufferUI.endRenderPass();
 
+  if (profiler != nullptr) {
+    profiler->endFrame(frame.commandBufferUI);
+  }
+
   frame.commandBufferUI.end();
 
-  std::array waitSemaphores{presentCompleteSemaphore};
+  std::array waitSemaphores{frameInFlight.presentComplete};
   std::array waitStages{vk::PipelineStageFlags{
       vk::PipelineStageFlagBits::eColorAttachmentOutput}};
-  std::array commandBuffers{frame.commandBuffer, frame.commandBufferUI};
-  std::array signalSemaphores{renderCompleteSemaphore};
+  std::array commandBuffers{frameInFlight.commandBufferProfiler,
+                            frame.commandBuffer, frame.commandBufferUI};
+  // The profiler command buffer is recorded only when profiling
+  auto const firstCommandBuffer{profiler != nullptr ? 0U : 1U};
+  std::array signalSemaphores{
+      m_headless ? vk::Semaphore{}
+                 : m_renderCompleteSemaphores.at(m_currentFrame)};
+
+  // Offscreen images are neither acquired nor presented, so no semaphore is
+  // waited or signaled
+  auto const semaphoreCount{
+      m_headless ? 0U : gsl::narrow<uint32_t>(waitSemaphores.size())};
 
   // Submit command buffer
   m_device.getQueues().graphics.submit(
-      {{.waitSemaphoreCount = gsl::narrow<uint32_t>(waitSemaphores.size()),
+      {{.waitSemaphoreCount = semaphoreCount,
         .pWaitSemaphores = waitSemaphores.data(),
         .pWaitDstStageMask = waitStages.data(),
-        .commandBufferCount = commandBuffers.size(),
-        .pCommandBuffers = commandBuffers.data(),
-        .signalSemaphoreCount = gsl::narrow<uint32_t>(signalSemaphores.size()),
+        .commandBufferCount =
+            gsl::narrow<uint32_t>(commandBuffers.size()) - firstCommandBuffer,
+        .pCommandBuffers = &commandBuffers.at(firstCommandBuffer),
+        .signalSemaphoreCount = semaphoreCount,
         .pSignalSemaphores = signalSemaphores.data()}},
-      frame.fence);
+      frameInFlight.fence);
+
+  m_currentFrameInFlight = (m_currentFrameInFlight + 1) %
+                           gsl::narrow<uint32_t>(m_framesInFlight.size());
 }
 
 void abcg::VulkanSwapchain::present() {
-  if (m_swapChainRebuild)
+  if (m_swapChainRebuild || m_headless)
     return;
 
   // Set semaphores to wait
-  auto &frameSemaphore{m_frameSemaphores.at(m_currentSemaphore)};
-  std::array waitSemaphores{frameSemaphore.renderComplete};
+  std::array waitSemaphores{m_renderCompleteSemaphores.at(m_currentFrame)};
 
   // Set swapchains
   std::array swapchains{m_swapchainKHR};
@@ -227,16 +297,17 @@ void abcg::VulkanSwapchain::present() {
   if (result == vk::Result::eErrorOutOfDateKHR ||
       result == vk::Result::eSuboptimalKHR) {
     m_swapChainRebuild = true;
-    return;
   }
-
-  // Use the next set of semaphores
-  m_currentSemaphore =
-      (m_currentSemaphore + 1) % gsl::narrow<uint32_t>(m_frames.size());
 }
 
 bool abcg::VulkanSwapchain::checkRebuild(VulkanSettings const &settings,
                                          glm::ivec2 const &windowSize) {
+  // Offscreen images are not invalidated by the window, so they are rebuilt
+  // when the window size changes
+  if (m_headless && getOffscreenExtent(windowSize) != m_swapchainExtent) {
+    m_swapChainRebuild = true;
+  }
+
   if (!m_swapChainRebuild)
     return false;
 
@@ -249,6 +320,46 @@ bool abcg::VulkanSwapchain::checkRebuild(VulkanSettings const &settings,
   // Destroy old swapchain and in-flight frames data, if any
   destroy();
 
+  // Without a surface (headless mode), the frames render to offscreen images
+  m_headless = !m_device.getPhysicalDevice().getSurfaceKHR();
+  if (m_headless) {
+    m_swapchainImageFormat = vk::Format::eB8G8R8A8Unorm;
+    m_swapchainExtent = getOffscreenExtent(windowSize);
+  } else if (!createSwapchainKHR(settings, windowSize, oldSwapchain)) {
+    return false;
+  }
+
+  createRenderPasses(settings);
+
+  if (m_headless) {
+    createOffscreenFrames(settings);
+  } else {
+    createFrames();
+  }
+  createFramesInFlight(settings);
+
+  if (settings.depthBufferSize > 0 || settings.stencilBufferSize > 0) {
+    createDepthResources(settings);
+  }
+
+  if (m_device.getPhysicalDevice().getSampleCount() >
+      vk::SampleCountFlagBits::e1) {
+    createMSAAResources();
+  }
+
+  createFramebuffers(settings);
+
+  m_swapChainRebuild = false;
+
+  return true;
+}
+
+// Creates the swapchain of the window surface. Returns false if the surface
+// has zero size
+bool abcg::VulkanSwapchain::createSwapchainKHR(VulkanSettings const &settings,
+                                               glm::ivec2 const &windowSize,
+                                               vk::SwapchainKHR oldSwapchain) {
+  auto const &device{static_cast<vk::Device>(m_device)};
   auto const &physicalDevice{
       static_cast<vk::PhysicalDevice>(m_device.getPhysicalDevice())};
   auto const &surface{m_device.getPhysicalDevice().getSurfaceKHR()};
@@ -352,23 +463,6 @@ bool abcg::VulkanSwapchain::checkRebuild(VulkanSettings const &settings,
 
   device.destroySwapchainKHR(oldSwapchain);
 
-  createRenderPasses(settings);
-
-  createFrames();
-
-  if (settings.depthBufferSize > 0 || settings.stencilBufferSize > 0) {
-    createDepthResources(settings);
-  }
-
-  if (m_device.getPhysicalDevice().getSampleCount() >
-      vk::SampleCountFlagBits::e1) {
-    createMSAAResources();
-  }
-
-  createFramebuffers(settings);
-
-  m_swapChainRebuild = false;
-
   return true;
 }
 
@@ -389,9 +483,9 @@ abcg::VulkanDevice const &abcg::VulkanSwapchain::getDevice() const noexcept {
 }
 
 /**
- * @brief Returns the in-flight frames.
+ * @brief Returns the frames of the swapchain images.
  *
- * @return Container of in-flight frames.
+ * @return Container of frames, one for each swapchain image.
  */
 std::vector<abcg::VulkanFrame> const &
 abcg::VulkanSwapchain::getFrames() const noexcept {
@@ -408,6 +502,16 @@ abcg::VulkanSwapchain::getCurrentFrame() const noexcept {
   return m_frames[m_currentFrame];
 }
 
+/**
+ * @brief Returns the number of frames in flight.
+ *
+ * @return Number of frames the CPU can record ahead of the GPU, as set by
+ * abcg::VulkanSettings::framesInFlight.
+ */
+uint32_t abcg::VulkanSwapchain::getFramesInFlight() const noexcept {
+  return gsl::narrow_cast<uint32_t>(m_framesInFlight.size());
+}
+
 /**
  * @brief Returns the main render pass.
  *
@@ -452,8 +556,7 @@ void abcg::VulkanSwapchain::createFrames() {
   // Create image views
   m_currentFrame = 0;
   m_frames.resize(swapchainImages.size());
-  m_currentSemaphore = 0;
-  m_frameSemaphores.resize(swapchainImages.size());
+  m_renderCompleteSemaphores.resize(swapchainImages.size());
 
   for (auto &&[frame, image, index] :
        iter::zip(m_frames, swapchainImages, iter::range(m_frames.size()))) {
@@ -468,25 +571,150 @@ void abcg::VulkanSwapchain::createFrames() {
                                   .levelCount = 1,
                                   .layerCount = 1}}});
   }
+
+  for (auto &semaphore : m_renderCompleteSemaphores) {
+    semaphore = static_cast<vk::Device>(m_device).createSemaphore({});
+  }
+}
+
+// Creates the images used in place of the swapchain images in headless mode.
+// They can be copied from after rendering
+void abcg::VulkanSwapchain::createOffscreenFrames(
+    VulkanSettings const &settings) {
+  // Dear ImGui requires at least two images
+  auto const imageCount{std::max(settings.framesInFlight, 2)};
+
+  m_currentFrame = 0;
+  m_frames.resize(gsl::narrow<std::size_t>(imageCount));
+
+  for (auto &&[index, frame] : iter::enumerate(m_frames)) {
+    frame.index = gsl::narrow<uint32_t>(index);
+    frame.colorImage.create(
+        m_device,
+        {.info = {.imageType = vk::ImageType::e2D,
+                  .format = m_swapchainImageFormat,
+                  .extent = {.width = m_swapchainExtent.width,
+                             .height = m_swapchainExtent.height,
+                             .depth = 1},
+                  .mipLevels = 1,
+                  .arrayLayers = 1,
+                  .samples = vk::SampleCountFlagBits::e1,
+                  .tiling = vk::ImageTiling::eOptimal,
+                  .usage = vk::ImageUsageFlagBits::eColorAttachment |
+                           vk::ImageUsageFlagBits::eTransferSrc,
+                  .sharingMode = vk::SharingMode::eExclusive,
+                  .initialLayout = vk::ImageLayout::eUndefined},
+         .properties = vk::MemoryPropertyFlagBits::eDeviceLocal,
+         .viewInfo = {.viewType = vk::ImageViewType::e2D,
+                      .format = m_swapchainImageFormat,
+                      .subresourceRange = {.aspectMask =
+                                               vk::ImageAspectFlagBits::eColor,
+                                           .levelCount = 1,
+                                           .layerCount = 1}}});
+  }
 }
 
 void abcg::VulkanSwapchain::destroyFrames() {
   auto const &device{static_cast<vk::Device>(m_device)};
 
   for (auto &frame : m_frames) {
-    device.destroyCommandPool(frame.commandPool);
-    device.destroyFence(frame.fence);
     frame.colorImage.destroy();
     device.destroyFramebuffer(frame.framebufferMain);
   }
 
-  for (auto &frameSemaphore : m_frameSemaphores) {
-    device.destroySemaphore(frameSemaphore.presentComplete);
-    device.destroySemaphore(frameSemaphore.renderComplete);
+  for (auto &semaphore : m_renderCompleteSemaphores) {
+    device.destroySemaphore(semaphore);
   }
 
   m_frames.clear();
-  m_frameSemaphores.clear();
+  m_renderCompleteSemaphores.clear();
+}
+
+void abcg::VulkanSwapchain::createFramesInFlight(
+    VulkanSettings const &settings) {
+  auto const &device{static_cast<vk::Device>(m_device)};
+  auto const &queuesFamilies{m_device.getPhysicalDevice().getQueuesFamilies()};
+
+  if (!queuesFamilies.graphics.has_value()) {
+    throw abcg::RuntimeError("Graphics queue family not found");
+  }
+  auto const graphicsQueueFamily{queuesFamilies.graphics.value()};
+
+  auto const framesInFlight{
+      gsl::narrow<uint32_t>(std::max(settings.framesInFlight, 1))};
+
+  m_currentFrameInFlight = 0;
+  m_framesInFlight.resize(framesInFlight);
+
+  for (auto &frameInFlight : m_framesInFlight) {
+    // Each frame in flight has its own transient graphics command pool
+    frameInFlight.commandPool = device.createCommandPool(
+        {.flags = vk::CommandPoolCreateFlagBits::eTransient,
+         .queueFamilyIndex = graphicsQueueFamily});
+
+    // Create a primary command buffer
+    frameInFlight.commandBuffer =
+        device
+            .allocateCommandBuffers({.commandPool = frameInFlight.commandPool,
+                                     .level = vk::CommandBufferLevel::ePrimary,
+                                     .commandBufferCount = 1})
+            .front();
+
+    // Create a primary command buffer for the UI
+    frameInFlight.commandBufferUI =
+        device
+            .allocateCommandBuffers({.commandPool = frameInFlight.commandPool,
+                                     .level = vk::CommandBufferLevel::ePrimary,
+                                     .commandBufferCount = 1})
+            .front();
+
+    // Create a primary command buffer for the profiler timestamps
+    frameInFlight.commandBufferProfiler =
+        device
+            .allocateCommandBuffers({.commandPool = frameInFlight.commandPool,
+                                     .level = vk::CommandBufferLevel::ePrimary,
+                                     .commandBufferCount = 1})
+            .front();
+
+    // Create fence and semaphore
+    frameInFlight.fence =
+        device.createFence({.flags = vk::FenceCreateFlagBits::eSignaled});
+    frameInFlight.presentComplete = device.createSemaphore({});
+  }
+
+  // Until an image is acquired, associate each image with a frame in flight,
+  // so that the current frame can be used right after creation
+  for (auto &&[index, frame] : iter::enumerate(m_frames)) {
+    auto const &frameInFlight{m_framesInFlight.at(index % framesInFlight)};
+    frame.frameInFlightIndex = gsl::narrow<uint32_t>(index % framesInFlight);
+    frame.commandPool = frameInFlight.commandPool;
+    frame.commandBuffer = frameInFlight.commandBuffer;
+    frame.commandBufferUI = frameInFlight.commandBufferUI;
+    frame.fence = frameInFlight.fence;
+  }
+
+  m_hasUniformArena = settings.uniformArenaSize > 0;
+  if (m_hasUniformArena) {
+    m_uniformArena.create(m_device, settings.uniformArenaSize * framesInFlight,
+                          vk::BufferUsageFlagBits::eUniformBuffer,
+                          framesInFlight);
+  }
+}
+
+void abcg::VulkanSwapchain::destroyFramesInFlight() {
+  auto const &device{static_cast<vk::Device>(m_device)};
+
+  for (auto &frameInFlight : m_framesInFlight) {
+    device.destroyCommandPool(frameInFlight.commandPool);
+    device.destroyFence(frameInFlight.fence);
+    device.destroySemaphore(frameInFlight.presentComplete);
+  }
+  m_framesInFlight.clear();
+
+  if (m_hasUniformArena) {
+    m_uniformArena.destroy();
+    m_hasUniformArena = false;
+  }
 }
 
 // TODO:
@@ -635,6 +863,9 @@ void abcg::VulkanSwapchain::createRenderPasses(VulkanSettings const &settings) {
   std::vector<vk::AttachmentDescription> attachments;
   auto const &device{static_cast<vk::Device>(m_device)};
   auto const sampleCount{m_device.getPhysicalDevice().getSampleCount()};
+  // Offscreen images are left ready to be copied from
+  auto const presentLayout{m_headless ? vk::ImageLayout::eTransferSrcOptimal
+                                      : vk::ImageLayout::ePresentSrcKHR};
 
   //
   // Main render pass
@@ -651,7 +882,7 @@ void abcg::VulkanSwapchain::createRenderPasses(VulkanSettings const &settings) {
       // When multisampling is disabled, the image can be presented directly
       .finalLayout = sampleCount > vk::SampleCountFlagBits::e1
                          ? vk::ImageLayout::eColorAttachmentOptimal
-                         : vk::ImageLayout::ePresentSrcKHR};
+                         : presentLayout};
   attachments.push_back(colorAttachment);
 
   vk::AttachmentDescription depthAttachment{};
@@ -699,7 +930,7 @@ void abcg::VulkanSwapchain::createRenderPasses(VulkanSettings const &settings) {
                               .stencilStoreOp =
                                   vk::AttachmentStoreOp::eDontCare,
                               .initialLayout = vk::ImageLayout::eUndefined,
-                              .finalLayout = vk::ImageLayout::ePresentSrcKHR};
+                              .finalLayout = presentLayout};
 
     colorAttachmentResolveRef = {.attachment = attachmentCount++,
                                  .layout =
@@ -756,7 +987,7 @@ void abcg::VulkanSwapchain::createRenderPasses(VulkanSettings const &settings) {
   // main render pass
   colorAttachment.initialLayout = sampleCount > vk::SampleCountFlagBits::e1
                                       ? vk::ImageLayout::eColorAttachmentOptimal
-                                      : vk::ImageLayout::ePresentSrcKHR;
+                                      : presentLayout;
   attachments.push_back(colorAttachment);
 
   if (settings.depthBufferSize > 0 || settings.stencilBufferSize > 0) {
@@ -785,40 +1016,9 @@ void abcg::VulkanSwapchain::destroyRenderPasses() {
 
 void abcg::VulkanSwapchain::createFramebuffers(VulkanSettings const &settings) {
   auto const &device{static_cast<vk::Device>(m_device)};
-  auto const &queuesFamilies{m_device.getPhysicalDevice().getQueuesFamilies()};
   auto const sampleCount{m_device.getPhysicalDevice().getSampleCount()};
 
-  if (!queuesFamilies.graphics.has_value()) {
-    throw abcg::RuntimeError("Graphics queue family not found");
-  }
-  auto const graphicsQueueFamily{queuesFamilies.graphics.value()};
-
   for (auto &frame : m_frames) {
-    // Each frame has its own transient graphics command pool
-    frame.commandPool = device.createCommandPool(
-        {.flags = vk::CommandPoolCreateFlagBits::eTransient,
-         .queueFamilyIndex = graphicsQueueFamily});
-
-    // Create a primary command buffer
-    frame.commandBuffer =
-        device
-            .allocateCommandBuffers({.commandPool = frame.commandPool,
-                                     .level = vk::CommandBufferLevel::ePrimary,
-                                     .commandBufferCount = 1})
-            .front();
-
-    // Create a primary command buffer for the UI
-    frame.commandBufferUI =
-        device
-            .allocateCommandBuffers({.commandPool = frame.commandPool,
-                                     .level = vk::CommandBufferLevel::ePrimary,
-                                     .commandBufferCount = 1})
-            .front();
-
-    // Create fence
-    frame.fence =
-        device.createFence({.flags = vk::FenceCreateFlagBits::eSignaled});
-
     // Set attachments
     std::vector<vk::ImageView> attachments{};
     if (sampleCount > vk::SampleCountFlagBits::e1) {
@@ -848,10 +1048,4 @@ void abcg::VulkanSwapchain::createFramebuffers(VulkanSettings const &settings) {
          .height = m_swapchainExtent.height,
          .layers = 1});
   }
-
-  // Create semaphores
-  for (auto &frameSemaphore : m_frameSemaphores) {
-    frameSemaphore.presentComplete = device.createSemaphore({});
-    frameSemaphore.renderComplete = device.createSemaphore({});
-  }
 }
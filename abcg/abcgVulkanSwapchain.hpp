@@ -18,27 +18,45 @@
 
 #include "abcgVulkanDevice.hpp"
 #include "abcgVulkanImage.hpp"
+#include "abcgVulkanRingBuffer.hpp"
 
 namespace abcg {
 class VulkanSwapchain;
 struct VulkanFrame;
 struct VulkanSettings;
 class VulkanPipeline;
+class VulkanProfiler;
 class VulkanWindow;
 } // namespace abcg
 
 /**
  * @brief Data needed by a rendering frame.
  *
+ * The color image and framebuffer belong to the swapchain image being
+ * rendered to. The command pool, command buffers, fence and uniform arena
+ * belong to the frame in flight that renders to it.
  */
 struct abcg::VulkanFrame {
+  /** @brief Index of the swapchain image. */
   uint32_t index{};
+  /** @brief Index of the frame in flight, from 0 to framesInFlight - 1. */
+  uint32_t frameInFlightIndex{};
   vk::CommandPool commandPool;
   vk::CommandBuffer commandBuffer;
   vk::CommandBuffer commandBufferUI;
   vk::Fence fence;
   VulkanImage colorImage;
   vk::Framebuffer framebufferMain;
+  /**
+   * @brief Ring buffer for uniform data that lives for this frame only, or
+   * nullptr if abcg::VulkanSettings::uniformArenaSize is zero.
+   */
+  VulkanRingBuffer *uniformArena{};
+  /**
+   * @brief Profiler for measuring named regions with
+   * abcg::VulkanProfiler::Region, or nullptr if profiling is disabled.
+   */
+  VulkanProfiler *profiler{};
 };
 
 /**
@@ -46,13 +64,18 @@ struct abcg::VulkanFrame {
  *
  * This class creates and manages the list of image buffers and other resources
  * that are used for presentation.
+ *
+ * If the physical device has no surface (see abcg::WindowSettings::headless),
+ * no swapchain is created. The frames render to offscreen color images that
+ * are used in turn, and abcg::VulkanSwapchain::present does nothing.
  */
 class abcg::VulkanSwapchain {
 public:
   void create(VulkanDevice const &device, VulkanSettings const &settings,
               glm::ivec2 const &windowSize);
   void destroy();
-  void render(std::function<void(VulkanFrame const &)> const &fun);
+  void render(std::function<void(VulkanFrame const &)> const &fun,
+              VulkanProfiler *profiler = nullptr);
   void present();
   bool checkRebuild(VulkanSettings const &settings,
                     glm::ivec2 const &windowSize);
@@ -62,15 +85,24 @@ public:
   [[nodiscard]] VulkanDevice const &getDevice() const noexcept;
   [[nodiscard]] std::vector<VulkanFrame> const &getFrames() const noexcept;
   [[nodiscard]] VulkanFrame const &getCurrentFrame() const noexcept;
+  [[nodiscard]] uint32_t getFramesInFlight() const noexcept;
   [[nodiscard]] vk::RenderPass const &getMainRenderPass() const noexcept;
   [[nodiscard]] vk::RenderPass const &getUIRenderPass() const noexcept;
   [[nodiscard]] vk::Extent2D const &getExtent() const noexcept;
   [[nodiscard]] VulkanImage const &getDepthImage() const noexcept;
 
 private:
+  [[nodiscard]] bool createSwapchainKHR(VulkanSettings const &settings,
+                                        glm::ivec2 const &windowSize,
+                                        vk::SwapchainKHR oldSwapchain);
+
   void createFrames();
+  void createOffscreenFrames(VulkanSettings const &settings);
   void destroyFrames();
 
+  void createFramesInFlight(VulkanSettings const &settings);
+  void destroyFramesInFlight();
+
   [[nodiscard]] vk::Format getDepthFormat(VulkanSettings const &settings);
   void createDepthResources(VulkanSettings const &settings);
   void destroyDepthResources();
@@ -89,19 +121,32 @@ private:
   vk::Format m_swapchainImageFormat;
   vk::Extent2D m_swapchainExtent;
   bool m_swapChainRebuild{};
-
-  // Data for swapchain synchronization
-  struct FrameSemaphores {
+  // Whether the frames render to offscreen images because there is no surface
+  bool m_headless{};
+
+  // Resources of a frame in flight, reused every framesInFlight frames
+  struct FrameInFlight {
+    vk::CommandPool commandPool;
+    vk::CommandBuffer commandBuffer;
+    vk::CommandBuffer commandBufferUI;
+    // Submitted before the other command buffers when profiling
+    vk::CommandBuffer commandBufferProfiler;
+    vk::Fence fence;
     vk::Semaphore presentComplete;
-    vk::Semaphore renderComplete;
   };
 
+  // Index of the acquired swapchain image
   uint32_t m_currentFrame{};
+  // One frame for each swapchain image, and one render complete semaphore for
+  // each image, as an image cannot be presented twice before it is acquired
+  // again
   std::vector<VulkanFrame> m_frames;
-  // Current set of swapchain wait semaphores we're using (needs to be distinct
-  // from per frame data)
-  uint32_t m_currentSemaphore{};
-  std::vector<FrameSemaphores> m_frameSemaphores;
+  std::vector<vk::Semaphore> m_renderCompleteSemaphores;
+
+  uint32_t m_currentFrameInFlight{};
+  std::vector<FrameInFlight> m_framesInFlight;
+  VulkanRingBuffer m_uniformArena;
+  bool m_hasUniformArena{};
 
   VulkanImage m_depthImage;
   VulkanImage m_MSAAImage;
@@ -0,0 +1,483 @@
+/**
+ * @file abcgVulkanUploadContext.cpp
+ * @brief Definition of abcg::VulkanUploadContext
+ *
+ * This file is part of ABCg (https://github.com/hbatagelo/abcg).
+ *
+ * @copyright (c) 2021--2023 Harlen Batagelo. All rights reserved.
+ * This project is released under the MIT License.
+ */
+
+#include "abcgVulkanUploadContext.hpp"
+
+#include <cppitertools/itertools.hpp>
+#include <gsl/gsl>
+
+#include <cstring>
+#include <limits>
+
+namespace {
+// Gets the access mask of the first use of an image in the given layout
+vk::AccessFlags getDestinationAccessMask(vk::ImageLayout layout) {
+  switch (layout) {
+  case vk::ImageLayout::eShaderReadOnlyOptimal:
+  case vk::ImageLayout::eReadOnlyOptimal:
+    return vk::AccessFlagBits::eShaderRead;
+  case vk::ImageLayout::eTransferSrcOptimal:
+    return vk::AccessFlagBits::eTransferRead;
+  case vk::ImageLayout::eTransferDstOptimal:
+    return vk::AccessFlagBits::eTransferRead |
+           vk::AccessFlagBits::eTransferWrite;
+  case vk::ImageLayout::eColorAttachmentOptimal:
+    return vk::AccessFlagBits::eColorAttachmentRead |
+           vk::AccessFlagBits::eColorAttachmentWrite;
+  default:
+    return vk::AccessFlagBits::eMemoryRead;
+  }
+}
+} // namespace
+
+/**
+ * @brief Creates the upload context.
+ *
+ * If the device has a transfer queue, uploads are recorded to the transfer
+ * queue. Otherwise, the graphics queue is used.
+ *
+ * @param device Vulkan device.
+ */
+void abcg::VulkanUploadContext::create(VulkanDevice const &device) {
+  m_device = device;
+
+  auto const &queues{device.getQueues()};
+  auto const &commandPools{device.getCommandPools()};
+  auto const &queuesFamilies{device.getPhysicalDevice().getQueuesFamilies()};
+
+  m_graphicsQueue = queues.graphics;
+  m_graphicsCommandPool = commandPools.graphics;
+  m_graphicsQueueFamily = queuesFamilies.graphics.value_or(0);
+
+  if (queuesFamilies.transfer.has_value()) {
+    m_transferQueue = queues.transfer;
+    m_transferCommandPool = commandPools.transfer;
+    m_transferQueueFamily = queuesFamilies.transfer.value();
+  } else {
+    m_transferQueue = m_graphicsQueue;
+    m_transferCommandPool = m_graphicsCommandPool;
+    m_transferQueueFamily = m_graphicsQueueFamily;
+  }
+
+  m_ownershipTransfer = m_transferQueueFamily != m_graphicsQueueFamily;
+}
+
+/**
+ * @brief Waits for all submitted batches and releases the resources of the
+ * context.
+ *
+ * Uploads recorded after the last call to abcg::VulkanUploadContext::submit
+ * are discarded.
+ */
+void abcg::VulkanUploadContext::destroy() {
+  waitAll();
+  releaseBatch(m_recording);
+}
+
+/**
+ * @brief Records the upload of data to a buffer.
+ *
+ * The data is copied to a staging buffer before the function returns, so the
+ * source can be released right away.
+ *
+ * @param buffer Destination buffer. It must have been created with
+ * vk::BufferUsageFlagBits::eTransferDst and, if the transfer queue belongs to
+ * a separate family, with concurrent sharing mode (as abcg::VulkanBuffer
+ * does).
+ * @param data Data to be copied.
+ * @param offset Offset in the destination buffer, in bytes.
+ */
+void abcg::VulkanUploadContext::uploadBuffer(vk::Buffer const &buffer,
+                                             std::span<std::byte const> data,
+                                             vk::DeviceSize offset) {
+  if (data.empty()) {
+    return;
+  }
+
+  auto const &stagingBuffer{
+      m_recording.stagingBuffers.emplace_back(createStagingBuffer(data))};
+
+  getTransferCommandBuffer().copyBuffer(
+      stagingBuffer.buffer, buffer,
+      {{.dstOffset = offset, .size = data.size_bytes()}});
+}
+
+/**
+ * @brief Records the upload of data to an image.
+ *
+ * The image is transitioned from an undefined layout to
+ * vk::ImageLayout::eTransferDstOptimal, the regions are copied from a staging
+ * buffer, and then the image is transitioned to the final layout and made
+ * available to the graphics queue.
+ *
+ * @param image Destination image. It must have been created with
+ * vk::ImageUsageFlagBits::eTransferDst.
+ * @param data Data of all regions to be copied.
+ * @param regions Copy regions. The buffer offsets are relative to the
+ * beginning of `data`.
+ * @param subresourceRange Subresources to be transitioned.
+ * @param finalLayout Layout of the image when the batch completes. Use
+ * vk::ImageLayout::eTransferDstOptimal if mipmaps will be generated with
+ * abcg::VulkanUploadContext::generateMipmaps.
+ */
+void abcg::VulkanUploadContext::uploadImage(
+    vk::Image const &image, std::span<std::byte const> data,
+    std::span<vk::BufferImageCopy const> regions,
+    vk::ImageSubresourceRange const &subresourceRange,
+    vk::ImageLayout finalLayout) {
+  auto const &commandBuffer{getTransferCommandBuffer()};
+
+  commandBuffer.pipelineBarrier(
+      vk::PipelineStageFlagBits::eTopOfPipe,
+      vk::PipelineStageFlagBits::eTransfer, vk::DependencyFlags{}, nullptr,
+      nullptr,
+      vk::ImageMemoryBarrier{
+          .dstAccessMask = vk::AccessFlagBits::eTransferWrite,
+          .oldLayout = vk::ImageLayout::eUndefined,
+          .newLayout = vk::ImageLayout::eTransferDstOptimal,
+          .srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+          .dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+          .image = image,
+          .subresourceRange = subresourceRange});
+
+  if (!data.empty()) {
+    auto const &stagingBuffer{
+        m_recording.stagingBuffers.emplace_back(createStagingBuffer(data))};
+    commandBuffer.copyBufferToImage(stagingBuffer.buffer, image,
+                                    vk::ImageLayout::eTransferDstOptimal,
+                                    regions);
+  }
+
+  vk::ImageMemoryBarrier barrier{
+      .srcAccessMask = vk::AccessFlagBits::eTransferWrite,
+      .dstAccessMask = getDestinationAccessMask(finalLayout),
+      .oldLayout = vk::ImageLayout::eTransferDstOptimal,
+      .newLayout = finalLayout,
+      .srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+      .dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+      .image = image,
+      .subresourceRange = subresourceRange};
+
+  if (!m_ownershipTransfer) {
+    commandBuffer.pipelineBarrier(vk::PipelineStageFlagBits::eTransfer,
+                                  vk::PipelineStageFlagBits::eAllCommands,
+                                  vk::DependencyFlags{}, nullptr, nullptr,
+                                  barrier);
+    return;
+  }
+
+  // Release the image from the transfer queue family...
+  barrier.srcQueueFamilyIndex = m_transferQueueFamily;
+  barrier.dstQueueFamilyIndex = m_graphicsQueueFamily;
+  auto const dstAccessMask{barrier.dstAccessMask};
+  barrier.dstAccessMask = vk::AccessFlags{};
+  commandBuffer.pipelineBarrier(vk::PipelineStageFlagBits::eTransfer,
+                                vk::PipelineStageFlagBits::eBottomOfPipe,
+                                vk::DependencyFlags{}, nullptr, nullptr,
+                                barrier);
+
+  // ...and acquire it on the graphics queue family, with the same layout
+  // transition
+  barrier.srcAccessMask = vk::AccessFlags{};
+  barrier.dstAccessMask = dstAccessMask;
+  getGraphicsCommandBuffer().pipelineBarrier(
+      vk::PipelineStageFlagBits::eTopOfPipe,
+      vk::PipelineStageFlagBits::eAllCommands, vk::DependencyFlags{}, nullptr,
+      nullptr, barrier);
+}
+
+/**
+ * @brief Records the generation of the mipmap levels of an image.
+ *
+ * The commands are recorded to the graphics queue, after the uploads
+ * recorded so far. Each level is blitted from the previous one with linear
+ * filtering, and all levels are left in
+ * vk::ImageLayout::eShaderReadOnlyOptimal.
+ *
+ * @param image Image whose first level was uploaded with
+ * abcg::VulkanUploadContext::uploadImage with final layout
+ * vk::ImageLayout::eTransferDstOptimal. It must have been created with
+ * vk::ImageUsageFlagBits::eTransferSrc, and its format must support linear
+ * blitting.
+ * @param width Width of the first level.
+ * @param height Height of the first level.
+ * @param mipLevels Number of mipmap levels.
+ */
+void abcg::VulkanUploadContext::generateMipmaps(vk::Image const &image,
+                                                uint32_t width,
+                                                uint32_t height,
+                                                uint32_t mipLevels) {
+  auto const &commandBuffer{getGraphicsCommandBuffer()};
+
+  vk::ImageMemoryBarrier barrier{
+      .srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+      .dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+      .image = image,
+      .subresourceRange = {.aspectMask = vk::ImageAspectFlagBits::eColor,
+                           .levelCount = 1,
+                           .baseArrayLayer = 0,
+                           .layerCount = 1}};
+
+  auto mipWidth{gsl::narrow<int32_t>(width)};
+  auto mipHeight{gsl::narrow<int32_t>(height)};
+
+  for (auto const mipLevel : iter::range(1U, mipLevels)) {
+    barrier.subresourceRange.baseMipLevel = mipLevel - 1;
+    barrier.oldLayout = vk::ImageLayout::eTransferDstOptimal;
+    barrier.newLayout = vk::ImageLayout::eTransferSrcOptimal;
+    barrier.srcAccessMask = vk::AccessFlagBits::eTransferWrite;
+    barrier.dstAccessMask = vk::AccessFlagBits::eTransferRead;
+
+    commandBuffer.pipelineBarrier(vk::PipelineStageFlagBits::eTransfer,
+                                  vk::PipelineStageFlagBits::eTransfer,
+                                  vk::DependencyFlagBits{}, {}, {},
+                                  {{barrier}});
+
+    vk::ImageBlit blit{};
+    blit.srcOffsets[0] = vk::Offset3D{0, 0, 0};
+    blit.srcOffsets[1] = vk::Offset3D{mipWidth, mipHeight, 1};
+    blit.srcSubresource.aspectMask = vk::ImageAspectFlagBits::eColor;
+    blit.srcSubresource.mipLevel = mipLevel - 1;
+    blit.srcSubresource.baseArrayLayer = 0;
+    blit.srcSubresource.layerCount = 1;
+    blit.dstOffsets[0] = vk::Offset3D{0, 0, 0};
+    blit.dstOffsets[1] = vk::Offset3D{mipWidth > 1 ? mipWidth / 2 : 1,
+                                      mipHeight > 1 ? mipHeight / 2 : 1, 1};
+    blit.dstSubresource.aspectMask = vk::ImageAspectFlagBits::eColor;
+    blit.dstSubresource.mipLevel = mipLevel;
+    blit.dstSubresource.baseArrayLayer = 0;
+    blit.dstSubresource.layerCount = 1;
+
+    commandBuffer.blitImage(image, vk::ImageLayout::eTransferSrcOptimal, image,
+                            vk::ImageLayout::eTransferDstOptimal, {blit},
+                            vk::Filter::eLinear);
+
+    barrier.oldLayout = vk::ImageLayout::eTransferSrcOptimal;
+    barrier.newLayout = vk::ImageLayout::eShaderReadOnlyOptimal;
+    barrier.srcAccessMask = vk::AccessFlagBits::eTransferRead;
+    barrier.dstAccessMask = vk::AccessFlagBits::eShaderRead;
+
+    commandBuffer.pipelineBarrier(vk::PipelineStageFlagBits::eTransfer,
+                                  vk::PipelineStageFlagBits::eFragmentShader,
+                                  vk::DependencyFlagBits{}, {}, {}, {barrier});
+
+    if (mipWidth > 1)
+      mipWidth /= 2;
+    if (mipHeight > 1)
+      mipHeight /= 2;
+  }
+
+  barrier.subresourceRange.baseMipLevel = mipLevels - 1;
+  barrier.oldLayout = vk::ImageLayout::eTransferDstOptimal;
+  barrier.newLayout = vk::ImageLayout::eShaderReadOnlyOptimal;
+  barrier.srcAccessMask = vk::AccessFlagBits::eTransferWrite;
+  barrier.dstAccessMask = vk::AccessFlagBits::eShaderRead;
+
+  commandBuffer.pipelineBarrier(vk::PipelineStageFlagBits::eTransfer,
+                                vk::PipelineStageFlagBits::eFragmentShader,
+                                vk::DependencyFlagBits{}, {}, {}, {barrier});
+}
+
+/**
+ * @brief Submits the uploads recorded since the last submission.
+ *
+ * The function returns without waiting for the uploads to complete.
+ *
+ * @return Ticket of the batch. If nothing was recorded, this is the ticket of
+ * the previous batch.
+ */
+abcg::VulkanUploadTicket abcg::VulkanUploadContext::submit() {
+  retireCompletedBatches();
+
+  auto &batch{m_recording};
+  if (!batch.transferCommandBuffer && !batch.graphicsCommandBuffer) {
+    return {m_lastSubmitted};
+  }
+
+  auto const device{static_cast<vk::Device>(m_device)};
+  batch.ticket = ++m_lastSubmitted;
+  batch.fence = device.createFence({});
+
+  if (batch.transferCommandBuffer && batch.graphicsCommandBuffer) {
+    // The graphics queue waits for the transfers before acquiring the images
+    batch.transferCommandBuffer.end();
+    batch.graphicsCommandBuffer.end();
+    batch.semaphore = device.createSemaphore({});
+
+    m_transferQueue.submit(
+        {{.commandBufferCount = 1,
+          .pCommandBuffers = &batch.transferCommandBuffer,
+          .signalSemaphoreCount = 1,
+          .pSignalSemaphores = &batch.semaphore}},
+        vk::Fence{});
+
+    vk::PipelineStageFlags const waitStage{
+        vk::PipelineStageFlagBits::eAllCommands};
+    m_graphicsQueue.submit({{.waitSemaphoreCount = 1,
+                             .pWaitSemaphores = &batch.semaphore,
+                             .pWaitDstStageMask = &waitStage,
+                             .commandBufferCount = 1,
+                             .pCommandBuffers = &batch.graphicsCommandBuffer}},
+                           batch.fence);
+  } else if (batch.transferCommandBuffer) {
+    batch.transferCommandBuffer.end();
+    m_transferQueue.submit({{.commandBufferCount = 1,
+                             .pCommandBuffers = &batch.transferCommandBuffer}},
+                           batch.fence);
+  } else {
+    batch.graphicsCommandBuffer.end();
+    m_graphicsQueue.submit({{.commandBufferCount = 1,
+                             .pCommandBuffers = &batch.graphicsCommandBuffer}},
+                           batch.fence);
+  }
+
+  m_pending.push_back(std::move(batch));
+  m_recording = {};
+
+  return {m_lastSubmitted};
+}
+
+/**
+ * @brief Returns whether a batch of uploads has completed.
+ *
+ * This does not block. Staging memory of completed batches is released.
+ *
+ * @param ticket Ticket returned by abcg::VulkanUploadContext::submit.
+ *
+ * @return True if the batch and all batches submitted before it have
+ * completed; false otherwise.
+ */
+bool abcg::VulkanUploadContext::isComplete(VulkanUploadTicket ticket) {
+  retireCompletedBatches();
+  return ticket.value <= m_lastCompleted;
+}
+
+/**
+ * @brief Waits until a batch of uploads has completed.
+ *
+ * @param ticket Ticket returned by abcg::VulkanUploadContext::submit. All
+ * batches submitted before it are also waited on.
+ */
+void abcg::VulkanUploadContext::wait(VulkanUploadTicket ticket) {
+  auto const device{static_cast<vk::Device>(m_device)};
+  for (auto const &batch : m_pending) {
+    if (batch.ticket > ticket.value) {
+      break;
+    }
+    while (vk::Result::eTimeout ==
+           device.waitForFences(batch.fence, VK_TRUE,
+                                std::numeric_limits<uint64_t>::max()))
+      ;
+  }
+  retireCompletedBatches();
+}
+
+/**
+ * @brief Waits until all submitted batches have completed.
+ */
+void abcg::VulkanUploadContext::waitAll() { wait({m_lastSubmitted}); }
+
+/**
+ * @brief Returns the device used by this context.
+ *
+ * @return Vulkan device.
+ */
+abcg::VulkanDevice const &
+abcg::VulkanUploadContext::getDevice() const noexcept {
+  return m_device;
+}
+
+abcg::VulkanUploadContext::StagingBuffer
+abcg::VulkanUploadContext::createStagingBuffer(
+    std::span<std::byte const> data) {
+  StagingBuffer stagingBuffer{
+      .buffer = static_cast<vk::Device>(m_device).createBuffer(
+          {.size = data.size_bytes(),
+           .usage = vk::BufferUsageFlagBits::eTransferSrc,
+           .sharingMode = vk::SharingMode::eExclusive})};
+  stagingBuffer.allocation = m_device.getAllocator().allocateBuffer(
+      stagingBuffer.buffer, vk::MemoryPropertyFlagBits::eHostVisible |
+                                vk::MemoryPropertyFlagBits::eHostCoherent);
+  std::memcpy(stagingBuffer.allocation.mappedData, data.data(),
+              data.size_bytes());
+  return stagingBuffer;
+}
+
+vk::CommandBuffer const &
+abcg::VulkanUploadContext::getTransferCommandBuffer() {
+  auto &commandBuffer{m_recording.transferCommandBuffer};
+  if (!commandBuffer) {
+    commandBuffer = static_cast<vk::Device>(m_device)
+                        .allocateCommandBuffers(
+                            {.commandPool = m_transferCommandPool,
+                             .level = vk::CommandBufferLevel::ePrimary,
+                             .commandBufferCount = 1})
+                        .front();
+    commandBuffer.begin(
+        {.flags = vk::CommandBufferUsageFlagBits::eOneTimeSubmit});
+  }
+  return commandBuffer;
+}
+
+vk::CommandBuffer const &
+abcg::VulkanUploadContext::getGraphicsCommandBuffer() {
+  // Without an ownership transfer, the transfer queue is the graphics queue
+  if (!m_ownershipTransfer) {
+    return getTransferCommandBuffer();
+  }
+
+  auto &commandBuffer{m_recording.graphicsCommandBuffer};
+  if (!commandBuffer) {
+    commandBuffer = static_cast<vk::Device>(m_device)
+                        .allocateCommandBuffers(
+                            {.commandPool = m_graphicsCommandPool,
+                             .level = vk::CommandBufferLevel::ePrimary,
+                             .commandBufferCount = 1})
+                        .front();
+    commandBuffer.begin(
+        {.flags = vk::CommandBufferUsageFlagBits::eOneTimeSubmit});
+  }
+  return commandBuffer;
+}
+
+void abcg::VulkanUploadContext::releaseBatch(Batch &batch) {
+  auto const device{static_cast<vk::Device>(m_device)};
+
+  if (batch.transferCommandBuffer) {
+    device.freeCommandBuffers(m_transferCommandPool,
+                              batch.transferCommandBuffer);
+  }
+  if (batch.graphicsCommandBuffer) {
+    device.freeCommandBuffers(m_graphicsCommandPool,
+                              batch.graphicsCommandBuffer);
+  }
+  if (batch.semaphore) {
+    device.destroySemaphore(batch.semaphore);
+  }
+  if (batch.fence) {
+    device.destroyFence(batch.fence);
+  }
+  for (auto &stagingBuffer : batch.stagingBuffers) {
+    device.destroyBuffer(stagingBuffer.buffer);
+    m_device.getAllocator().free(stagingBuffer.allocation);
+  }
+  batch = {};
+}
+
+void abcg::VulkanUploadContext::retireCompletedBatches() {
+  auto const device{static_cast<vk::Device>(m_device)};
+  while (!m_pending.empty() &&
+         device.getFenceStatus(m_pending.front().fence) ==
+             vk::Result::eSuccess) {
+    m_lastCompleted = m_pending.front().ticket;
+    releaseBatch(m_pending.front());
+    m_pending.pop_front();
+  }
+}
@@ -0,0 +1,130 @@
+/**
+ * @file abcgVulkanUploadContext.hpp
+ * @brief Header file of abcg::VulkanUploadContext
+ *
+ * Declaration of abcg::VulkanUploadContext
+ *
+ * This file is part of ABCg (https://github.com/hbatagelo/abcg).
+ *
+ * @copyright (c) 2021--2023 Harlen Batagelo. All rights reserved.
+ * This project is released under the MIT License.
+ */
+
+#ifndef ABCG_VULKAN_UPLOAD_CONTEXT_HPP_
+#define ABCG_VULKAN_UPLOAD_CONTEXT_HPP_
+
+#include "abcgVulkanDevice.hpp"
+
+#include <deque>
+#include <span>
+
+namespace abcg {
+struct VulkanUploadTicket;
+class VulkanUploadContext;
+} // namespace abcg
+
+/**
+ * @brief Handle of a batch of uploads submitted by
+ * abcg::VulkanUploadContext::submit.
+ */
+struct abcg::VulkanUploadTicket {
+  /** @brief Sequence number of the batch. Batches are numbered from 1. */
+  uint64_t value{};
+};
+
+/**
+ * @brief Batched upload of buffer and image data to device memory.
+ *
+ * The upload context records any number of staging copies into one command
+ * buffer of the transfer queue, and submits them all at once with
+ * abcg::VulkanUploadContext::submit. The returned ticket can be polled with
+ * abcg::VulkanUploadContext::isComplete, or waited on with
+ * abcg::VulkanUploadContext::wait. Until then, the CPU is free to keep loading
+ * other resources:
+ *
+ * @code
+ * abcg::VulkanUploadContext uploadContext;
+ * uploadContext.create(getDevice());
+ * for (auto const &path : texturePaths) {
+ *   m_textures.emplace_back().create(uploadContext, path);
+ * }
+ * auto const ticket{uploadContext.submit()};
+ * // ...
+ * uploadContext.wait(ticket);
+ * uploadContext.destroy();
+ * @endcode
+ *
+ * When the transfer queue belongs to a family other than the graphics queue,
+ * the images are released by the transfer queue and acquired by the graphics
+ * queue, in a second command buffer that waits on a semaphore signaled by the
+ * first. Mipmap generation, which requires a graphics queue, is recorded in
+ * that second command buffer too. When both queues belong to the same
+ * family, a single command buffer is used.
+ *
+ * Staging memory is released when the batch that used it completes, the next
+ * time the context is polled or waited on.
+ *
+ * @remark The member functions are not thread-safe, as the command buffers
+ * are allocated from the command pools of abcg::VulkanDevice.
+ */
+class abcg::VulkanUploadContext {
+public:
+  void create(VulkanDevice const &device);
+  void destroy();
+
+  void uploadBuffer(vk::Buffer const &buffer, std::span<std::byte const> data,
+                    vk::DeviceSize offset = 0UL);
+  void uploadImage(vk::Image const &image, std::span<std::byte const> data,
+                   std::span<vk::BufferImageCopy const> regions,
+                   vk::ImageSubresourceRange const &subresourceRange,
+                   vk::ImageLayout finalLayout =
+                       vk::ImageLayout::eShaderReadOnlyOptimal);
+  void generateMipmaps(vk::Image const &image, uint32_t width,
+                       uint32_t height, uint32_t mipLevels);
+
+  [[nodiscard]] VulkanUploadTicket submit();
+  [[nodiscard]] bool isComplete(VulkanUploadTicket ticket);
+  void wait(VulkanUploadTicket ticket);
+  void waitAll();
+
+  [[nodiscard]] VulkanDevice const &getDevice() const noexcept;
+
+private:
+  struct StagingBuffer {
+    vk::Buffer buffer;
+    VulkanAllocation allocation;
+  };
+
+  struct Batch {
+    uint64_t ticket{};
+    vk::CommandBuffer transferCommandBuffer;
+    vk::CommandBuffer graphicsCommandBuffer;
+    vk::Semaphore semaphore;
+    vk::Fence fence;
+    std::vector<StagingBuffer> stagingBuffers;
+  };
+
+  [[nodiscard]] StagingBuffer createStagingBuffer(
+      std::span<std::byte const> data);
+  [[nodiscard]] vk::CommandBuffer const &getTransferCommandBuffer();
+  [[nodiscard]] vk::CommandBuffer const &getGraphicsCommandBuffer();
+  void releaseBatch(Batch &batch);
+  void retireCompletedBatches();
+
+  VulkanDevice m_device;
+  vk::Queue m_transferQueue;
+  vk::Queue m_graphicsQueue;
+  vk::CommandPool m_transferCommandPool;
+  vk::CommandPool m_graphicsCommandPool;
+  uint32_t m_transferQueueFamily{};
+  uint32_t m_graphicsQueueFamily{};
+  bool m_ownershipTransfer{};
+
+  // Batch being recorded, and submitted batches in submission order
+  Batch m_recording;
+  std::deque<Batch> m_pending;
+  uint64_t m_lastSubmitted{};
+  uint64_t m_lastCompleted{};
+};
+
+#endif
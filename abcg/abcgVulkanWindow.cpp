@@ -13,6 +13,7 @@
 #include <SDL_vulkan.h>
 #include <algorithm>
 #include <gsl/gsl>
+#include <string_view>
 #include <imgui_impl_sdl2.h>
 #include <imgui_impl_vulkan.h>
 
@@ -23,11 +24,14 @@
 #include "abcgWindow.hpp"
 
 namespace {
+// Returns the required instance extensions. If window is nullptr, the
+// extensions needed for creating a surface are not included
 [[nodiscard]] std::vector<char const *>
-getRequiredExtensions(gsl::not_null<SDL_Window *> window) {
+getRequiredExtensions(SDL_Window *window) {
   uint32_t extensionCount{};
-  if (SDL_Vulkan_GetInstanceExtensions(window, &extensionCount, nullptr) !=
-      SDL_TRUE) {
+  if (window != nullptr &&
+      SDL_Vulkan_GetInstanceExtensions(window, &extensionCount, nullptr) !=
+          SDL_TRUE) {
     throw abcg::SDLError(
         "SDL_Vulkan_GetInstanceExtensions failed to get number of "
         "required extensions");
@@ -110,6 +114,20 @@ abcg::VulkanSwapchain const &abcg::VulkanWindow::getSwapchain() const noexcept {
   return m_swapchain;
 }
 
+/**
+ * @brief Returns the GPU profiler of the window.
+ *
+ * The profiler is enabled at window creation if
+ * abcg::WindowSettings::showProfiler is `true`. While enabled, it measures the
+ * main pass and the UI pass of each frame, along with any
+ * abcg::VulkanProfiler::Region created in abcg::VulkanWindow::onPaint.
+ *
+ * @returns Reference to the abcg::VulkanProfiler of the window.
+ */
+abcg::VulkanProfiler &abcg::VulkanWindow::getProfiler() noexcept {
+  return m_profiler;
+}
+
 /**
  * @brief Custom event handler.
  *
@@ -155,8 +173,9 @@ void abcg::VulkanWindow::onPaint([[maybe_unused]] VulkanFrame const &frame) {}
  * This is not called when the window is minimized.
  *
  * Override it for custom behavior. By default, it shows a FPS counter if
- * abcg::WindowSettings::showFPS is set to `true`, and a toggle fullscreen
- * button if abcg::WindowSettings::showFullscreenButton is set to `true`.
+ * abcg::WindowSettings::showFPS is set to `true`, a toggle fullscreen
+ * button if abcg::WindowSettings::showFullscreenButton is set to `true`, and
+ * the profiler overlay if abcg::WindowSettings::showProfiler is set to `true`.
  */
 void abcg::VulkanWindow::onPaintUI() {
   // FPS counter
@@ -209,6 +228,11 @@ void abcg::VulkanWindow::onPaintUI() {
 
     ImGui::End();
   }
+
+  // Profiler overlay
+  if (abcg::Window::getWindowSettings().showProfiler) {
+    m_profiler.drawOverlay();
+  }
 }
 
 /**
@@ -267,18 +291,29 @@ void abcg::VulkanWindow::handleEvent(SDL_Event const &event) {
 }
 
 void abcg::VulkanWindow::create() {
+  // In headless mode, the window is used only for input and has no surface.
+  // The swapchain renders to offscreen images
+  auto const headless{abcg::Window::getWindowSettings().headless};
+  if (headless) {
+    std::erase_if(m_deviceExtensions, [](char const *extension) {
+      return std::string_view{extension} == VK_KHR_SWAPCHAIN_EXTENSION_NAME;
+    });
+  }
+
   // Create window fol Vulkan graphics
-  if (!createSDLWindow(SDL_WINDOW_VULKAN)) {
+  if (!createSDLWindow(headless ? SDL_WindowFlags{} : SDL_WINDOW_VULKAN)) {
     throw abcg::SDLError("SDL_CreateWindow failed");
   }
 
   // Create Vulkan instance
   auto const applicationName{abcg::Window::getWindowSettings().title};
-  auto const requiredExtensions{getRequiredExtensions(Window::getSDLWindow())};
+  auto const requiredExtensions{
+      getRequiredExtensions(headless ? nullptr : Window::getSDLWindow())};
   m_instance.create(m_layers, requiredExtensions, applicationName);
 
   // Create window surface
   if (VkSurfaceKHR surface{};
+      headless ||
       SDL_Vulkan_CreateSurface(abcg::Window::getSDLWindow(),
                                static_cast<vk::Instance>(m_instance),
                                &surface) == SDL_TRUE) {
@@ -307,6 +342,10 @@ void abcg::VulkanWindow::create() {
   // Create swapchain
   m_swapchain.create(m_device, m_vulkanSettings, getWindowSize());
 
+  // Create GPU profiler
+  m_profiler.create(m_device, m_swapchain.getFramesInFlight());
+  m_profiler.setEnabled(abcg::Window::getWindowSettings().showProfiler);
+
   // Create descriptor pool
   std::vector<vk::DescriptorPoolSize> const poolSizes{
       {{vk::DescriptorType::eSampler, 100},
@@ -356,7 +395,11 @@ void abcg::VulkanWindow::create() {
       .DescriptorPool = m_UIdescriptorPool,
       .Subpass = 0,
       .MinImageCount = 2,
-      .ImageCount = gsl::narrow<uint32_t>(m_swapchain.getFrames().size()),
+      // The UI buffers of an image must not be reused while a frame in
+      // flight may still read them
+      .ImageCount =
+          std::max(gsl::narrow<uint32_t>(m_swapchain.getFrames().size()),
+                   m_swapchain.getFramesInFlight()),
       .MSAASamples =
           static_cast<VkSampleCountFlagBits>(m_physicalDevice.getSampleCount()),
       .Allocator = nullptr,
@@ -419,7 +462,8 @@ void abcg::VulkanWindow::paint() {
 
   ImGui::Render();
 
-  m_swapchain.render([this](auto const &frame) { onPaint(frame); });
+  m_swapchain.render([this](auto const &frame) { onPaint(frame); },
+                     m_profiler.isEnabled() ? &m_profiler : nullptr);
   m_swapchain.present();
 }
 
@@ -433,10 +477,15 @@ void abcg::VulkanWindow::destroy() {
   ImGui::DestroyContext();
 
   static_cast<vk::Device>(m_device).destroyDescriptorPool(m_UIdescriptorPool);
+  m_profiler.destroy();
   m_swapchain.destroy();
   m_device.destroy();
   m_physicalDevice.destroy();
-  static_cast<vk::Instance>(m_instance).destroySurfaceKHR(m_surface);
+  // In headless mode, there is no surface and VK_KHR_surface is not enabled
+  if (m_surface) {
+    static_cast<vk::Instance>(m_instance).destroySurfaceKHR(m_surface);
+    m_surface = vk::SurfaceKHR{};
+  }
   m_instance.destroy();
 }
 
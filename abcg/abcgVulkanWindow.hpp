@@ -16,6 +16,7 @@
 #include "abcgVulkanDevice.hpp"
 #include "abcgVulkanInstance.hpp"
 #include "abcgVulkanPhysicalDevice.hpp"
+#include "abcgVulkanProfiler.hpp"
 #include "abcgVulkanSwapchain.hpp"
 #include "abcgWindow.hpp"
 
@@ -57,6 +58,24 @@ struct abcg::VulkanSettings {
    * comes first.
    */
   bool vSync{false};
+
+  /** @brief Number of frames the CPU can record ahead of the GPU.
+   *
+   * Each frame in flight has its own fence, command buffers and uniform
+   * arena, independently of the number of images of the swapchain. Two frames
+   * give double buffering of CPU work; three frames give more throughput at
+   * the cost of one extra frame of latency. Values smaller than 1 are treated
+   * as 1.
+   */
+  int framesInFlight{2};
+
+  /** @brief Size of the uniform arena of each frame in flight, in bytes.
+   *
+   * The arena is a host-visible ring buffer exposed by
+   * abcg::VulkanFrame::uniformArena for per-frame uniform data. It is not
+   * created if the size is zero.
+   */
+  std::size_t uniformArenaSize{256UL * 1024};
 };
 
 /**
@@ -84,6 +103,7 @@ public:
   [[nodiscard]] VulkanPhysicalDevice const &getPhysicalDevice() const noexcept;
   [[nodiscard]] VulkanDevice const &getDevice() const noexcept;
   [[nodiscard]] VulkanSwapchain const &getSwapchain() const noexcept;
+  [[nodiscard]] VulkanProfiler &getProfiler() noexcept;
 
 protected:
   virtual void onEvent(SDL_Event const &event);
@@ -113,6 +133,7 @@ private:
   VulkanPhysicalDevice m_physicalDevice;
   VulkanDevice m_device;
   VulkanSwapchain m_swapchain;
+  VulkanProfiler m_profiler;
   vk::SurfaceKHR m_surface;
   vk::DescriptorPool m_UIdescriptorPool;
   bool m_hidden{};
@@ -62,12 +62,38 @@ struct abcg::WindowSettings {
   bool showFPS{true};
   /** @brief Whether to show a button to toggle fullscreen on/off. */
   bool showFullscreenButton{true};
+  /** @brief Whether to enable the frame profiler and show its overlay.
+   *
+   * @sa abcg::OpenGLWindow::getProfiler.
+   * @sa abcg::VulkanWindow::getProfiler.
+   */
+  bool showProfiler{false};
   /** @brief HTML element ID used for registering the fullscreen callback when
    * the application is built for WebAssembly.
    */
   std::string fullscreenElementID{"#canvas"};
   /** @brief String containing the window title. */
   std::string title{"ABCg Window"};
+  /** @brief Whether to render offscreen, without a display.
+   *
+   * In headless mode, the window is created by the SDL offscreen video driver
+   * and is never shown. OpenGL contexts are created through EGL with pbuffer
+   * surfaces, and Vulkan windows render to offscreen images without a surface.
+   * This can be used for batch rendering on machines without a display or GPU
+   * (e.g., with Mesa's llvmpipe and lavapipe drivers).
+   *
+   * @remark This must be set before abcg::Application::run. It is overridden
+   * by the `ABCG_HEADLESS` environment variable, if set (`0` disables headless
+   * mode; any other value enables it).
+   */
+  bool headless{false};
+  /** @brief Number of frames to render before the application quits, or zero
+   * to run until the window is closed.
+   *
+   * @remark This is overridden by the `ABCG_FRAME_COUNT` environment variable,
+   * if set.
+   */
+  int frameCount{0};
 };
 
 /**
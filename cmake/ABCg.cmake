@@ -1,3 +1,110 @@
+# Compiles the GLSL shaders in the assets directory of the current project to
+# SPIR-V with glslangValidator, and copies the results to output_dir after
+# project_target is built. Each file keeps its path relative to the assets
+# directory, with the extension .spv appended, which is where
+# abcg::VulkanShader::create looks for precompiled shaders.
+function(precompile_shaders project_target output_dir)
+  find_program(GLSLANG_VALIDATOR glslangValidator)
+  if(NOT GLSLANG_VALIDATOR)
+    message("Not precompiling shaders of ${project_target} - glslangValidator "
+            "not found")
+    return()
+  endif()
+
+  set(assets_dir ${CMAKE_CURRENT_SOURCE_DIR}/assets)
+  file(
+    GLOB_RECURSE
+    shader_files
+    CONFIGURE_DEPENDS
+    ${assets_dir}/*.vert
+    ${assets_dir}/*.tesc
+    ${assets_dir}/*.tese
+    ${assets_dir}/*.geom
+    ${assets_dir}/*.frag
+    ${assets_dir}/*.comp)
+
+  set(spirv_files "")
+  foreach(shader_file ${shader_files})
+    file(RELATIVE_PATH relative_path ${assets_dir} ${shader_file})
+    set(spirv_file ${CMAKE_CURRENT_BINARY_DIR}/spirv/${relative_path}.spv)
+    get_filename_component(spirv_dir ${spirv_file} DIRECTORY)
+    add_custom_command(
+      OUTPUT ${spirv_file}
+      COMMAND ${CMAKE_COMMAND} -E make_directory ${spirv_dir}
+      COMMAND ${GLSLANG_VALIDATOR} -V --quiet ${shader_file} -o ${spirv_file}
+      DEPENDS ${shader_file}
+      COMMENT "Compiling ${relative_path} to SPIR-V")
+    list(APPEND spirv_files ${spirv_file})
+  endforeach()
+
+  if(spirv_files)
+    add_custom_target(${project_target}_spirv DEPENDS ${spirv_files})
+    add_dependencies(${project_target} ${project_target}_spirv)
+    add_custom_command(
+      TARGET ${project_target}
+      POST_BUILD
+      COMMAND ${CMAKE_COMMAND} -E copy_directory
+              ${CMAKE_CURRENT_BINARY_DIR}/spirv ${output_dir})
+  endif()
+endfunction()
+
+# Converts texture maps in the assets directory of the current project to
+# block-compressed KTX2 files with texconv, and copies the results to the
+# assets directory of project_target after it is built. This must be called
+# after enable_abcg. Each file keeps its path relative to the assets directory,
+# with the extension replaced by .ktx2, which is where the examples look for a
+# compressed version of a texture. Maps are flipped as abcg::loadOpenGLTexture
+# does by default. Color maps are listed after COLOR and are tagged as sRGB;
+# other maps (e.g., normal maps) are listed after DATA.
+function(compress_textures project_target)
+  if(NOT ENABLE_TEXTURE_COMPRESSION)
+    return()
+  endif()
+  if(NOT TARGET texconv)
+    message("Not compressing textures of ${project_target} - texconv not found")
+    return()
+  endif()
+
+  cmake_parse_arguments(PARSE_ARGV 1 arg "" "" "COLOR;DATA")
+
+  set(assets_dir ${CMAKE_CURRENT_SOURCE_DIR}/assets)
+  set(ktx2_files "")
+  foreach(texture_file ${arg_COLOR} ${arg_DATA})
+    set(options --flip-y)
+    if(texture_file IN_LIST arg_COLOR)
+      list(APPEND options --srgb)
+    endif()
+    string(REGEX REPLACE "\\.[^.]*$" ".ktx2" relative_path ${texture_file})
+    set(ktx2_file ${CMAKE_CURRENT_BINARY_DIR}/ktx2/${relative_path})
+    get_filename_component(ktx2_dir ${ktx2_file} DIRECTORY)
+    add_custom_command(
+      OUTPUT ${ktx2_file}
+      COMMAND ${CMAKE_COMMAND} -E make_directory ${ktx2_dir}
+      COMMAND texconv ${options} ${assets_dir}/${texture_file} ${ktx2_file}
+      DEPENDS texconv ${assets_dir}/${texture_file}
+      COMMENT "Compressing ${texture_file} to KTX2")
+    list(APPEND ktx2_files ${ktx2_file})
+  endforeach()
+
+  if(ktx2_files)
+    add_custom_target(${project_target}_ktx2 DEPENDS ${ktx2_files})
+    add_dependencies(${project_target} ${project_target}_ktx2)
+
+    # The assets directory is recreated whenever project_target is built
+    get_target_property(output_dir ${project_target} RUNTIME_OUTPUT_DIRECTORY)
+    if(MSVC AND ${output_dir} MATCHES "/out/build/")
+      set(assets_output_dir ${output_dir}/assets)
+    else()
+      set(assets_output_dir ${output_dir}/${project_target}/assets)
+    endif()
+    add_custom_command(
+      TARGET ${project_target}
+      POST_BUILD
+      COMMAND ${CMAKE_COMMAND} -E copy_directory
+              ${CMAKE_CURRENT_BINARY_DIR}/ktx2 ${assets_output_dir})
+  endif()
+endfunction()
+
 function(enable_abcg project_target)
 
   if(ARGC GREATER 1)
@@ -126,6 +233,12 @@ function(enable_abcg project_target)
             ${output_dir}/${project_target}.dir/assets)
       endif()
 
+      # Copy precompiled SPIR-V shaders to ${project_target}.dir/assets
+      if(${GRAPHICS_API} MATCHES "Vulkan" AND ENABLE_SHADER_PRECOMPILATION)
+        precompile_shaders(${project_target}
+                           ${output_dir}/${project_target}.dir/assets)
+      endif()
+
       # Take into account that, on Windows with MSVC, binaries are placed in a
       # subdirectory named after the build type
       set(build_type "")
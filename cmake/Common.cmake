@@ -22,6 +22,14 @@ if(NOT ${CMAKE_SYSTEM_NAME} MATCHES "Emscripten")
     option(ENABLE_IPO "Enable Interprocedural Optimization" ON)
   endif()
 
+  # Offline SPIR-V compilation of the shaders of Vulkan applications
+  option(ENABLE_SHADER_PRECOMPILATION
+         "Precompile GLSL shaders in assets directories to SPIR-V" OFF)
+
+  # Offline conversion of the texture maps of the examples to KTX2
+  option(ENABLE_TEXTURE_COMPRESSION
+         "Convert texture maps in assets directories to KTX2 with texconv" OFF)
+
   set(OPTIONS_TARGET options)
   set(SANITIZERS_TARGET sanitizers)
   set(WARNINGS_TARGET warnings)
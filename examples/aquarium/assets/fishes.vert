@@ -0,0 +1,28 @@
+#version 300 es
+
+layout(location = 0) in vec2 inPosition;
+
+// Per-fish attributes, advanced once every 9 instances
+layout(location = 1) in float inTranslationX;
+layout(location = 2) in float inTranslationY;
+layout(location = 3) in float inRotation;
+layout(location = 4) in float inScale;
+layout(location = 5) in vec4 inColor;
+
+out vec4 fragColor;
+
+void main() {
+  // Each fish is replicated over the 3x3 tiles of the wrap-around grid
+  int tile = gl_InstanceID % 9;
+  vec2 tileOffset = vec2(float(tile % 3 - 1), float(tile / 3 - 1)) * 2.0;
+
+  float sinAngle = sin(inRotation);
+  float cosAngle = cos(inRotation);
+  vec2 rotated = vec2(inPosition.x * cosAngle - inPosition.y * sinAngle,
+                      inPosition.x * sinAngle + inPosition.y * cosAngle);
+
+  vec2 translation = vec2(inTranslationX, inTranslationY);
+  vec2 newPosition = rotated * inScale + translation + tileOffset;
+  gl_Position = vec4(newPosition, 0, 1);
+  fragColor = inColor;
+}
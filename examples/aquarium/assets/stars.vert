@@ -1,15 +1,21 @@
 #version 300 es
 
-layout(location = 0) in vec2 inPosition;
+// The z coordinate is the index of the layer of the star
+layout(location = 0) in vec3 inPosition;
 layout(location = 1) in vec3 inColor;
 
-uniform vec2 translation;
-uniform float pointSize;
+uniform vec2 translations[5];
+uniform float pointSizes[5];
 
 out vec4 fragColor;
 
 void main() {
-  gl_PointSize = pointSize;
-  gl_Position = vec4(inPosition.xy + translation, 0, 1);
+  // Each star is replicated over the 3x3 tiles of the wrap-around grid
+  vec2 tileOffset =
+      vec2(float(gl_InstanceID % 3 - 1), float(gl_InstanceID / 3 - 1)) * 2.0;
+
+  int layer = int(inPosition.z);
+  gl_PointSize = pointSizes[layer];
+  gl_Position = vec4(inPosition.xy + translations[layer] + tileOffset, 0, 1);
   fragColor = vec4(inColor, 1);
-}
\ No newline at end of file
+}
@@ -1,7 +1,9 @@
 #include "fishes.hpp"
 
-#include <glm/gtx/fast_trigonometry.hpp>
-#include <glm/gtx/rotate_vector.hpp>
+#include <algorithm>
+#include <functional>
+
+#include "abcgThreadPool.hpp"
 
 void Fishes::create(GLuint program, int quantity) {
   destroy();
@@ -11,86 +13,153 @@ void Fishes::create(GLuint program, int quantity) {
 
   m_program = program;
 
-  // Get location of uniforms in the program
-  m_colorLoc = abcg::glGetUniformLocation(m_program, "color");
-  m_rotationLoc = abcg::glGetUniformLocation(m_program, "rotation");
-  m_scaleLoc = abcg::glGetUniformLocation(m_program, "scale");
-  m_translationLoc = abcg::glGetUniformLocation(m_program, "translation");
+  createMesh();
 
-  // Create asteroids
-  m_fishes.clear();
-  m_fishes.resize(quantity);
+  // Cells are as large as the largest fish
+  m_grid.create(0.3f);
 
-  for (auto &fish : m_fishes) {
-    fish = makeFish();
+  // Create fishes
+  m_fishes.resize(0);
+  m_appearances.clear();
+  m_maxScale = 0.0f;
 
-    // Make sure the asteroid won't collide with the ship
+  for ([[maybe_unused]] auto _ : iter::range(quantity)) {
+    // Make sure the fish won't collide with the carp
+    glm::vec2 translation{};
     do {
-      fish.m_translation = {m_randomDist(m_randomEngine),
-                                m_randomDist(m_randomEngine)};
-    } while (glm::length(fish.m_translation) < 0.5f);
+      translation = {m_randomDist(m_randomEngine),
+                     m_randomDist(m_randomEngine)};
+    } while (glm::length(translation) < 0.5f);
+
+    addFish(translation);
   }
 }
 
 void Fishes::paint() {
-  abcg::glUseProgram(m_program);
+  auto const count{m_fishes.size()};
+  if (count == 0)
+    return;
+
+  if (count != m_instanceCount) {
+    setupInstances();
+  }
 
-  for (auto const &fish : m_fishes) {
-    abcg::glBindVertexArray(fish.m_VAO);
+  // Upload the simulation arrays as they are. Respecifying the whole buffer
+  // lets the driver orphan the storage still being read by the previous frame.
+  auto const arraySize{gsl::narrow<GLsizeiptr>(count * sizeof(float))};
+  abcg::glBindBuffer(GL_ARRAY_BUFFER, m_dynamicVBO);
+  abcg::glBufferData(GL_ARRAY_BUFFER, arraySize * 3, nullptr, GL_STREAM_DRAW);
+  abcg::glBufferSubData(GL_ARRAY_BUFFER, 0, arraySize, m_fishes.px.data());
+  abcg::glBufferSubData(GL_ARRAY_BUFFER, arraySize, arraySize,
+                        m_fishes.py.data());
+  abcg::glBufferSubData(GL_ARRAY_BUFFER, arraySize * 2, arraySize,
+                        m_fishes.rotation.data());
+  abcg::glBindBuffer(GL_ARRAY_BUFFER, 0);
 
-    abcg::glUniform4fv(m_colorLoc, 1, &fish.m_color.r);
-    abcg::glUniform1f(m_scaleLoc, fish.m_scale);
-    abcg::glUniform1f(m_rotationLoc, fish.m_rotation);
+  abcg::glUseProgram(m_program);
+  abcg::glBindVertexArray(m_VAO);
 
-    for (auto i : {-2, 0, 2}) {
-      for (auto j : {-2, 0, 2}) { 
-        abcg::glUniform2f(m_translationLoc, fish.m_translation.x + j,
-                          fish.m_translation.y + i);
+  // Draw all fishes at once, 9 instances per fish for the wrap-around tiling
+  abcg::glDrawElementsInstanced(GL_TRIANGLES, 12, GL_UNSIGNED_INT, nullptr,
+                                gsl::narrow<GLsizei>(count * 9));
 
-        abcg::glDrawElements(GL_TRIANGLES, 12, GL_UNSIGNED_INT, nullptr);
-      }
-    }
-    abcg::glBindVertexArray(0);
-  }
-  
+  abcg::glBindVertexArray(0);
   abcg::glUseProgram(0);
 }
 
 void Fishes::destroy() {
-  for (auto &fish : m_fishes) {
-    abcg::glDeleteBuffers(1, &fish.m_VBO);
-    abcg::glDeleteBuffers(1, &fish.m_EBO);
-    abcg::glDeleteVertexArrays(1, &fish.m_VAO);
-  }
+  abcg::glDeleteBuffers(1, &m_VBO);
+  abcg::glDeleteBuffers(1, &m_EBO);
+  abcg::glDeleteBuffers(1, &m_dynamicVBO);
+  abcg::glDeleteBuffers(1, &m_staticVBO);
+  abcg::glDeleteVertexArrays(1, &m_VAO);
+  m_instanceCount = 0;
 }
 
 void Fishes::update(const Carp &carp, float deltaTime) {
-  for (auto &fish : m_fishes) {
-    fish.m_translation -= carp.m_velocity * deltaTime;
-    fish.m_rotation = glm::wrapAngle(
-        fish.m_rotation + fish.m_angularVelocity * deltaTime);
-    fish.m_translation += fish.m_velocity * deltaTime;
-
-    // Wrap-around
-    if (fish.m_translation.x < -1.0f)
-      fish.m_translation.x += 2.0f;
-    if (fish.m_translation.x > +1.0f)
-      fish.m_translation.x -= 2.0f;
-    if (fish.m_translation.y < -1.0f)
-      fish.m_translation.y += 2.0f;
-    if (fish.m_translation.y > +1.0f)
-      fish.m_translation.y -= 2.0f;
+  // Large populations are split among worker threads
+  if (m_fishes.size() > fishkernels::chunkSize && !m_pool) {
+    m_pool = std::make_unique<abcg::ThreadPool>();
   }
+
+  fishkernels::update(m_fishes, carp.m_velocity, deltaTime, m_pool.get());
+  m_grid.update(m_fishes);
+  bounce();
 }
 
-Fishes::Fish Fishes::makeFish(glm::vec2 translation,
-                                            float scale) {
-  Fish fish;
+// Makes the fishes that touch each other bounce apart. The fishes have the
+// same mass, so the components of their velocities along the line between
+// them are exchanged.
+void Fishes::bounce() {
+  m_grid.forEachPair(
+      2.0f * getCollisionRadius(m_maxScale),
+      [this](std::size_t first, std::size_t second, glm::vec2 offset) {
+        auto const distance{glm::length(offset)};
+        auto const minDistance{
+            getCollisionRadius(m_appearances[first].scale) +
+            getCollisionRadius(m_appearances[second].scale)};
+        if (distance >= minDistance || distance == 0.0f) {
+          return;
+        }
+
+        auto const normal{offset / distance};
+        glm::vec2 const relativeVelocity{
+            m_fishes.vx[second] - m_fishes.vx[first],
+            m_fishes.vy[second] - m_fishes.vy[first]};
+        // Only fishes that are approaching each other bounce
+        auto const approach{glm::dot(relativeVelocity, normal)};
+        if (approach >= 0.0f) {
+          return;
+        }
+
+        auto const impulse{approach * normal};
+        m_fishes.vx[first] += impulse.x;
+        m_fishes.vy[first] += impulse.y;
+        m_fishes.vx[second] -= impulse.x;
+        m_fishes.vy[second] -= impulse.y;
+      });
+}
 
+void Fishes::addFish(glm::vec2 translation, float scale) {
   auto &re{m_randomEngine}; // Shortcut
 
-  
- std::array positions{
+  // Get a random color (actually, a shade of red)
+  std::uniform_real_distribution randomIntensity(0.1f, 1.0f);
+  m_appearances.push_back(
+      {.scale = scale, .color = {randomIntensity(re), 0.0f, 0.0f, 1.0f}});
+  m_maxScale = std::max(m_maxScale, scale);
+
+  // Get a random direction
+  glm::vec2 const direction{m_randomDist(re), m_randomDist(re)};
+  auto const velocity{glm::normalize(direction) / 7.0f};
+
+  m_fishes.px.push_back(translation.x);
+  m_fishes.py.push_back(translation.y);
+  m_fishes.vx.push_back(velocity.x);
+  m_fishes.vy.push_back(velocity.y);
+  m_fishes.rotation.push_back(0.0f);
+
+  // Get a random angular velocity
+  m_fishes.angularVelocity.push_back(m_randomDist(re));
+}
+
+// Removes the fishes at the given indices. The grid is sorted again in the
+// next update, as the population changes.
+void Fishes::removeFishes(std::vector<std::size_t> indices) {
+  // Removing from the back keeps the indices still to be removed valid
+  std::ranges::sort(indices, std::greater{});
+  auto const [first, last]{std::ranges::unique(indices)};
+  indices.erase(first, last);
+
+  for (auto const index : indices) {
+    m_fishes.swapRemove(index);
+    m_appearances[index] = m_appearances.back();
+    m_appearances.pop_back();
+  }
+}
+
+void Fishes::createMesh() {
+  std::array positions{
       // Carp body
       glm::vec2{-03.5f, +8.5f}, glm::vec2{+03.5f, +8.5f},
       glm::vec2{0.0f, -15.5f},
@@ -109,68 +178,82 @@ Fishes::Fish Fishes::makeFish(glm::vec2 translation,
                            0,5,1 
                            };
 
-  // Get a random color (actually, a grayscale)
-  std::uniform_real_distribution randomIntensity(0.1f, 1.0f);
-  fish.m_color = glm::vec4(randomIntensity(re));
-
-  fish.m_color.a = 1.0f;
-  fish.m_color.b = 0.0f;
-  fish.m_color.g = 0.0f;
-  fish.m_rotation = 0.0f;
-  fish.m_scale = scale;
-  fish.m_translation = translation;
-
-  // Get a random angular velocity
-  fish.m_angularVelocity = m_randomDist(re);
-
-  // Get a random direction
-  glm::vec2 const direction{m_randomDist(re), m_randomDist(re)};
-  fish.m_velocity = glm::normalize(direction) / 7.0f;
-
-  // Create geometry data
-  // std::vector<glm::vec2> positions{{0, 0}};
-  // auto const step{M_PI * 2 / asteroid.m_polygonSides};
-  // std::uniform_real_distribution randomRadius(0.8f, 1.0f);
-  // for (auto const angle : iter::range(0.0, M_PI * 2, step)) {
-  //   auto const radius{randomRadius(re)};
-  //   positions.emplace_back(radius * std::cos(angle), radius * std::sin(angle));
-  // }
-  // positions.push_back(positions.at(1));
-
   // Generate VBO
-  abcg::glGenBuffers(1, &fish.m_VBO);
-  abcg::glBindBuffer(GL_ARRAY_BUFFER, fish.m_VBO);
+  abcg::glGenBuffers(1, &m_VBO);
+  abcg::glBindBuffer(GL_ARRAY_BUFFER, m_VBO);
   abcg::glBufferData(GL_ARRAY_BUFFER, sizeof(positions),
                      positions.data(), GL_STATIC_DRAW);
   abcg::glBindBuffer(GL_ARRAY_BUFFER, 0);
 
   // /  Generate EBO
-  abcg::glGenBuffers(1, &fish.m_EBO);
-  abcg::glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, fish.m_EBO);
+  abcg::glGenBuffers(1, &m_EBO);
+  abcg::glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_EBO);
   abcg::glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(indices), indices.data(),
                      GL_STATIC_DRAW);
   abcg::glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
 
+  // Generate VBOs of per-instance attributes. They are filled when the
+  // population changes (static VBO) and in paint() (dynamic VBO).
+  abcg::glGenBuffers(1, &m_dynamicVBO);
+  abcg::glGenBuffers(1, &m_staticVBO);
+
   // Get location of attributes in the program
   auto const positionAttribute{
       abcg::glGetAttribLocation(m_program, "inPosition")};
 
   // Create VAO
-  abcg::glGenVertexArrays(1, &fish.m_VAO);
+  abcg::glGenVertexArrays(1, &m_VAO);
 
   // Bind vertex attributes to current VAO
-  abcg::glBindVertexArray(fish.m_VAO);
+  abcg::glBindVertexArray(m_VAO);
 
-  abcg::glBindBuffer(GL_ARRAY_BUFFER, fish.m_VBO);
+  abcg::glBindBuffer(GL_ARRAY_BUFFER, m_VBO);
   abcg::glEnableVertexAttribArray(positionAttribute);
   abcg::glVertexAttribPointer(positionAttribute, 2, GL_FLOAT, GL_FALSE, 0,
                               nullptr);
   abcg::glBindBuffer(GL_ARRAY_BUFFER, 0);
 
-  abcg::glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, fish.m_EBO);
+  abcg::glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_EBO);
 
   // End of binding to current VAO
   abcg::glBindVertexArray(0);
-  
-  return fish;
-}
\ No newline at end of file
+}
+
+// Uploads the appearances and points the per-instance attributes to the
+// arrays of the current population
+void Fishes::setupInstances() {
+  m_instanceCount = m_fishes.size();
+
+  abcg::glBindBuffer(GL_ARRAY_BUFFER, m_staticVBO);
+  abcg::glBufferData(
+      GL_ARRAY_BUFFER,
+      gsl::narrow<GLsizeiptr>(m_appearances.size() * sizeof(FishAppearance)),
+      m_appearances.data(), GL_STATIC_DRAW);
+
+  abcg::glBindVertexArray(m_VAO);
+
+  // Per-instance attributes advance once every 9 instances, as each fish is
+  // drawn once for each tile of the 3x3 wrap-around grid
+  auto const setInstanceAttribute{[this](char const *name, GLint size,
+                                         GLsizei stride, std::size_t offset) {
+    auto const location{abcg::glGetAttribLocation(m_program, name)};
+    abcg::glEnableVertexAttribArray(location);
+    abcg::glVertexAttribPointer(location, size, GL_FLOAT, GL_FALSE, stride,
+                                reinterpret_cast<void *>(offset));
+    abcg::glVertexAttribDivisor(location, 9);
+  }};
+
+  setInstanceAttribute("inScale", 1, sizeof(FishAppearance),
+                       offsetof(FishAppearance, scale));
+  setInstanceAttribute("inColor", 4, sizeof(FishAppearance),
+                       offsetof(FishAppearance, color));
+
+  auto const arraySize{m_instanceCount * sizeof(float)};
+  abcg::glBindBuffer(GL_ARRAY_BUFFER, m_dynamicVBO);
+  setInstanceAttribute("inTranslationX", 1, 0, 0);
+  setInstanceAttribute("inTranslationY", 1, 0, arraySize);
+  setInstanceAttribute("inRotation", 1, 0, arraySize * 2);
+
+  abcg::glBindVertexArray(0);
+  abcg::glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
@@ -1,13 +1,16 @@
 #ifndef ASTEROIDS_HPP_
 #define ASTEROIDS_HPP_
 
-#include <list>
+#include <memory>
 #include <random>
+#include <vector>
 
 #include "abcgOpenGL.hpp"
 
 #include "gamedata.hpp"
 #include "carp.hpp"
+#include "fishkernels.hpp"
+#include "spatialgrid.hpp"
 
 class Fishes {
 public:
@@ -15,36 +18,55 @@ public:
   void paint();
   void destroy();
   void update(const Carp &ship, float deltaTime);
-  
-
-  struct Fish {
-    GLuint m_VAO{};
-    GLuint m_VBO{};
-    GLuint m_EBO{};
-
-    float m_angularVelocity{};
-    glm::vec4 m_color{1};
-    int m_polygonSides{};
-    float m_rotation{};
-    float m_scale{};
-    glm::vec2 m_translation{};
-    glm::vec2 m_velocity{};
-    bool m_hit{};
-  };
 
-  std::list<Fish> m_fishes;
+  // Simulation state of all fishes
+  FishArrays m_fishes;
+
+  // Fishes sorted by cell for collision and neighbor queries. It is updated
+  // after each simulation step.
+  SpatialGrid m_grid;
+
+  void addFish(glm::vec2 translation = {}, float scale = 0.15f);
+  void removeFishes(std::vector<std::size_t> indices);
 
-  Fish makeFish(glm::vec2 translation = {}, float scale = 0.15f);
+  // Radius of the collision circle of a fish of the given scale
+  [[nodiscard]] static float getCollisionRadius(float scale) {
+    return scale * 0.85f;
+  }
 
 private:
+  // Render-only attributes of a fish, which do not change after it is added
+  struct FishAppearance {
+    float scale{};
+    glm::vec4 color{};
+  };
+
   GLuint m_program{};
-  GLint m_colorLoc{};
-  GLint m_rotationLoc{};
-  GLint m_translationLoc{};
-  GLint m_scaleLoc{};
+
+  // Mesh shared by all fishes
+  GLuint m_VAO{};
+  GLuint m_VBO{};
+  GLuint m_EBO{};
+
+  // Per-instance attributes. The dynamic VBO holds the x translations, the y
+  // translations and the rotations of all fishes, one array after the other,
+  // and is updated every frame. The static VBO holds the appearances.
+  GLuint m_dynamicVBO{};
+  GLuint m_staticVBO{};
+  std::size_t m_instanceCount{};
+
+  std::vector<FishAppearance> m_appearances;
+  float m_maxScale{};
+
+  // Created only for populations large enough to be updated in parallel
+  std::unique_ptr<abcg::ThreadPool> m_pool;
 
   std::default_random_engine m_randomEngine;
   std::uniform_real_distribution<float> m_randomDist{-1.0f, 1.0f};
+
+  void createMesh();
+  void setupInstances();
+  void bounce();
 };
 
-#endif
\ No newline at end of file
+#endif
@@ -0,0 +1,208 @@
+#include "fishkernels.hpp"
+
+#include <numbers>
+
+#include "abcgCPUFeatures.hpp"
+#include "abcgThreadPool.hpp"
+
+#if defined(ABCG_CPU_X86_64)
+#include <immintrin.h>
+#endif
+
+void FishArrays::resize(std::size_t size) {
+  for (auto *array : {&px, &py, &vx, &vy, &rotation, &angularVelocity}) {
+    array->resize(size);
+  }
+}
+
+void FishArrays::swapRemove(std::size_t index) {
+  for (auto *array : {&px, &py, &vx, &vy, &rotation, &angularVelocity}) {
+    (*array)[index] = array->back();
+    array->pop_back();
+  }
+}
+
+namespace {
+
+constexpr auto twoPi{2.0f * std::numbers::pi_v<float>};
+
+// Parameters shared by all fishes
+struct Step {
+  glm::vec2 carpVelocity{};
+  float deltaTime{};
+};
+
+// Scalar kernel. This also processes the remainder of the SIMD kernels.
+
+void updateScalar(FishArrays &fishes, Step const &step, std::size_t begin,
+                  std::size_t end) {
+  auto const carpVx{step.carpVelocity.x};
+  auto const carpVy{step.carpVelocity.y};
+  auto const dt{step.deltaTime};
+  for (auto i{begin}; i < end; ++i) {
+    auto x{fishes.px[i] + (fishes.vx[i] - carpVx) * dt};
+    auto y{fishes.py[i] + (fishes.vy[i] - carpVy) * dt};
+    auto angle{fishes.rotation[i] + fishes.angularVelocity[i] * dt};
+
+    // Wrap-around
+    if (x < -1.0f)
+      x += 2.0f;
+    if (x > +1.0f)
+      x -= 2.0f;
+    if (y < -1.0f)
+      y += 2.0f;
+    if (y > +1.0f)
+      y -= 2.0f;
+    if (angle < 0.0f)
+      angle += twoPi;
+    if (angle >= twoPi)
+      angle -= twoPi;
+
+    fishes.px[i] = x;
+    fishes.py[i] = y;
+    fishes.rotation[i] = angle;
+  }
+}
+
+#if defined(ABCG_CPU_X86_64)
+
+// SSE2 kernel: 4 fishes per iteration. Returns the number of fishes processed.
+
+__m128 wrapSSE2(__m128 value, __m128 lower, __m128 upper, __m128 period,
+                bool inclusive) {
+  value = _mm_add_ps(value, _mm_and_ps(_mm_cmplt_ps(value, lower), period));
+  auto const above{inclusive ? _mm_cmpge_ps(value, upper)
+                             : _mm_cmpgt_ps(value, upper)};
+  return _mm_sub_ps(value, _mm_and_ps(above, period));
+}
+
+std::size_t updateSSE2(FishArrays &fishes, Step const &step,
+                       std::size_t begin, std::size_t end) {
+  auto const dt{_mm_set1_ps(step.deltaTime)};
+  auto const carpVx{_mm_set1_ps(step.carpVelocity.x)};
+  auto const carpVy{_mm_set1_ps(step.carpVelocity.y)};
+  auto const minusOne{_mm_set1_ps(-1.0f)};
+  auto const one{_mm_set1_ps(1.0f)};
+  auto const two{_mm_set1_ps(2.0f)};
+  auto const zero{_mm_setzero_ps()};
+  auto const period{_mm_set1_ps(twoPi)};
+
+  auto i{begin};
+  for (; i + 4 <= end; i += 4) {
+    auto x{_mm_loadu_ps(&fishes.px[i])};
+    auto y{_mm_loadu_ps(&fishes.py[i])};
+    auto angle{_mm_loadu_ps(&fishes.rotation[i])};
+
+    x = _mm_add_ps(
+        x, _mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(&fishes.vx[i]), carpVx), dt));
+    y = _mm_add_ps(
+        y, _mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(&fishes.vy[i]), carpVy), dt));
+    angle = _mm_add_ps(
+        angle, _mm_mul_ps(_mm_loadu_ps(&fishes.angularVelocity[i]), dt));
+
+    _mm_storeu_ps(&fishes.px[i], wrapSSE2(x, minusOne, one, two, false));
+    _mm_storeu_ps(&fishes.py[i], wrapSSE2(y, minusOne, one, two, false));
+    _mm_storeu_ps(&fishes.rotation[i],
+                  wrapSSE2(angle, zero, period, period, true));
+  }
+  return i - begin;
+}
+
+// AVX2 kernel: 8 fishes per iteration
+
+ABCG_TARGET_AVX2 __m256 wrapAVX2(__m256 value, __m256 lower, __m256 upper,
+                                 __m256 period, bool inclusive) {
+  value = _mm256_add_ps(
+      value, _mm256_and_ps(_mm256_cmp_ps(value, lower, _CMP_LT_OQ), period));
+  auto const above{inclusive ? _mm256_cmp_ps(value, upper, _CMP_GE_OQ)
+                             : _mm256_cmp_ps(value, upper, _CMP_GT_OQ)};
+  return _mm256_sub_ps(value, _mm256_and_ps(above, period));
+}
+
+ABCG_TARGET_AVX2 std::size_t updateAVX2(FishArrays &fishes, Step const &step,
+                                        std::size_t begin, std::size_t end) {
+  auto const dt{_mm256_set1_ps(step.deltaTime)};
+  auto const carpVx{_mm256_set1_ps(step.carpVelocity.x)};
+  auto const carpVy{_mm256_set1_ps(step.carpVelocity.y)};
+  auto const minusOne{_mm256_set1_ps(-1.0f)};
+  auto const one{_mm256_set1_ps(1.0f)};
+  auto const two{_mm256_set1_ps(2.0f)};
+  auto const zero{_mm256_setzero_ps()};
+  auto const period{_mm256_set1_ps(twoPi)};
+
+  auto i{begin};
+  for (; i + 8 <= end; i += 8) {
+    auto x{_mm256_loadu_ps(&fishes.px[i])};
+    auto y{_mm256_loadu_ps(&fishes.py[i])};
+    auto angle{_mm256_loadu_ps(&fishes.rotation[i])};
+
+    x = _mm256_add_ps(
+        x, _mm256_mul_ps(
+               _mm256_sub_ps(_mm256_loadu_ps(&fishes.vx[i]), carpVx), dt));
+    y = _mm256_add_ps(
+        y, _mm256_mul_ps(
+               _mm256_sub_ps(_mm256_loadu_ps(&fishes.vy[i]), carpVy), dt));
+    angle = _mm256_add_ps(
+        angle,
+        _mm256_mul_ps(_mm256_loadu_ps(&fishes.angularVelocity[i]), dt));
+
+    _mm256_storeu_ps(&fishes.px[i], wrapAVX2(x, minusOne, one, two, false));
+    _mm256_storeu_ps(&fishes.py[i], wrapAVX2(y, minusOne, one, two, false));
+    _mm256_storeu_ps(&fishes.rotation[i],
+                     wrapAVX2(angle, zero, period, period, true));
+  }
+  return i - begin;
+}
+
+fishkernels::InstructionSet detectInstructionSet() {
+  return abcg::cpuSupportsAVX2() ? fishkernels::InstructionSet::AVX2
+                                 : fishkernels::InstructionSet::SSE2;
+}
+
+#else
+
+fishkernels::InstructionSet detectInstructionSet() {
+  return fishkernels::InstructionSet::Scalar;
+}
+
+#endif
+
+void updateRange(FishArrays &fishes, Step const &step, std::size_t begin,
+                 std::size_t end, fishkernels::InstructionSet instructionSet) {
+  std::size_t processed{};
+#if defined(ABCG_CPU_X86_64)
+  if (instructionSet == fishkernels::InstructionSet::AVX2) {
+    processed = updateAVX2(fishes, step, begin, end);
+  } else if (instructionSet == fishkernels::InstructionSet::SSE2) {
+    processed = updateSSE2(fishes, step, begin, end);
+  }
+#endif
+  updateScalar(fishes, step, begin + processed, end);
+}
+
+} // namespace
+
+fishkernels::InstructionSet fishkernels::getInstructionSet() {
+  static auto const instructionSet{detectInstructionSet()};
+  return instructionSet;
+}
+
+void fishkernels::update(FishArrays &fishes, glm::vec2 carpVelocity,
+                         float deltaTime, abcg::ThreadPool *pool,
+                         InstructionSet instructionSet) {
+  Step const step{.carpVelocity = carpVelocity, .deltaTime = deltaTime};
+  auto const size{fishes.size()};
+
+  if (pool == nullptr || size <= chunkSize) {
+    updateRange(fishes, step, 0, size, instructionSet);
+    return;
+  }
+
+  // Each task updates a disjoint range of the arrays
+  auto const numChunks{(size + chunkSize - 1) / chunkSize};
+  pool->parallelFor(numChunks, [&](std::size_t chunk) {
+    auto const begin{chunk * chunkSize};
+    updateRange(fishes, step, begin, std::min(begin + chunkSize, size),
+                instructionSet);
+  });
+}
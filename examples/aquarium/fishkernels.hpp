@@ -0,0 +1,47 @@
+#ifndef FISHKERNELS_HPP_
+#define FISHKERNELS_HPP_
+
+#include "abcgOpenGL.hpp"
+
+namespace abcg {
+class ThreadPool;
+} // namespace abcg
+
+// Structure-of-arrays layout of the simulation state of the fishes, so that
+// the update kernel can process several fishes per instruction
+struct FishArrays {
+  std::vector<float> px, py;     // Translations
+  std::vector<float> vx, vy;     // Velocities
+  std::vector<float> rotation;   // Angles, in radians, in [0, 2*pi)
+  std::vector<float> angularVelocity;
+
+  void resize(std::size_t size);
+  // Removes the fish at index by moving the last fish into its place
+  void swapRemove(std::size_t index);
+  [[nodiscard]] std::size_t size() const { return px.size(); }
+  [[nodiscard]] bool empty() const { return px.empty(); }
+};
+
+namespace fishkernels {
+
+enum class InstructionSet { Scalar, SSE2, AVX2 };
+
+// Number of fishes updated by each task of the thread pool. Populations of
+// this size or smaller are updated on the calling thread.
+inline constexpr std::size_t chunkSize{16384};
+
+// Returns the best instruction set supported by the CPU (detected once)
+[[nodiscard]] InstructionSet getInstructionSet();
+
+// Moves the fishes by their velocities relative to the carp velocity, rotates
+// them, and wraps their translations and angles around. The time step must be
+// shorter than 2*pi seconds times the inverse of the largest angular
+// velocity. If a thread pool is given, large populations are split among its
+// threads.
+void update(FishArrays &fishes, glm::vec2 carpVelocity, float deltaTime,
+            abcg::ThreadPool *pool = nullptr,
+            InstructionSet instructionSet = getInstructionSet());
+
+} // namespace fishkernels
+
+#endif
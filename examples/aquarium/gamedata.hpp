@@ -4,7 +4,7 @@
 #include <bitset>
 
 enum class Input { Right, Left, Down, Up };
-enum class State { Playing };
+enum class State { Playing, Win };
 
 struct GameData {
   State m_state{State::Playing};
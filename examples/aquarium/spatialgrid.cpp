@@ -0,0 +1,75 @@
+#include "spatialgrid.hpp"
+
+void SpatialGrid::create(float cellSize) {
+  // Round the cell size up so that the cells tile the world exactly
+  m_dimension = std::max(1, static_cast<int>(2.0f / cellSize));
+  m_cellSize = 2.0f / static_cast<float>(m_dimension);
+
+  m_fishCells.clear();
+  m_cellStarts.assign(m_dimension * m_dimension + 1, 0);
+  m_sortedIndices.clear();
+  m_sortedTranslations.clear();
+}
+
+// Finds the cell of each fish. Fishes are sorted again only if the population
+// changed or if any fish moved to another cell. Otherwise, the order is kept
+// and only the sorted translations are refreshed.
+void SpatialGrid::update(FishArrays const &fishes) {
+  auto const count{fishes.size()};
+  auto changed{count != m_fishCells.size()};
+  m_fishCells.resize(count);
+
+  for (auto const index : iter::range(count)) {
+    auto const cell{cellOf(fishes.px[index], fishes.py[index])};
+    if (cell != m_fishCells[index]) {
+      m_fishCells[index] = cell;
+      changed = true;
+    }
+  }
+
+  if (changed) {
+    sort();
+  }
+
+  m_sortedTranslations.resize(count);
+  for (auto const slot : iter::range(count)) {
+    auto const index{m_sortedIndices[slot]};
+    m_sortedTranslations[slot] = {fishes.px[index], fishes.py[index]};
+  }
+}
+
+glm::vec2 SpatialGrid::wrappedOffset(glm::vec2 a, glm::vec2 b) {
+  auto offset{b - a};
+  for (auto const axis : {0, 1}) {
+    if (offset[axis] > 1.0f)
+      offset[axis] -= 2.0f;
+    if (offset[axis] < -1.0f)
+      offset[axis] += 2.0f;
+  }
+  return offset;
+}
+
+int SpatialGrid::cellOf(float x, float y) const {
+  auto const toCell{[this](float coordinate) {
+    auto const cell{static_cast<int>((coordinate + 1.0f) / m_cellSize)};
+    return std::clamp(cell, 0, m_dimension - 1);
+  }};
+  return toCell(y) * m_dimension + toCell(x);
+}
+
+// Counting sort of the fishes by cell
+void SpatialGrid::sort() {
+  std::fill(m_cellStarts.begin(), m_cellStarts.end(), 0);
+  for (auto const cell : m_fishCells) {
+    ++m_cellStarts[cell + 1];
+  }
+  for (auto const cell : iter::range(std::size_t{1}, m_cellStarts.size())) {
+    m_cellStarts[cell] += m_cellStarts[cell - 1];
+  }
+
+  m_sortedIndices.resize(m_fishCells.size());
+  auto next{m_cellStarts};
+  for (auto const index : iter::range(m_fishCells.size())) {
+    m_sortedIndices[next[m_fishCells[index]]++] = index;
+  }
+}
@@ -0,0 +1,125 @@
+#ifndef SPATIALGRID_HPP_
+#define SPATIALGRID_HPP_
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <utility>
+#include <vector>
+
+#include <cppitertools/range.hpp>
+#include <glm/geometric.hpp>
+#include <glm/vec2.hpp>
+
+#include "abcgOpenGL.hpp"
+
+#include "fishkernels.hpp"
+
+// Uniform grid over the toroidal [-1,1]x[-1,1] world of the fishes. The
+// fishes are sorted by cell so that the fishes of a cell are contiguous in
+// memory, and queries only visit the cells that overlap the query radius,
+// wrapping around the borders of the world.
+class SpatialGrid {
+public:
+  void create(float cellSize);
+  void update(FishArrays const &fishes);
+
+  // Calls f(index, offset) for each fish closer than radius to center, where
+  // offset is the shortest translation from center to the fish
+  template <typename F>
+  void forEachInRadius(glm::vec2 center, float radius, F &&f) const;
+
+  // Calls f(first, second, offset) once for each pair of fishes closer than
+  // radius to each other, where offset is the shortest translation from the
+  // first fish to the second
+  template <typename F> void forEachPair(float radius, F &&f) const;
+
+  // Shortest translation from a to b in the wrap-around world
+  [[nodiscard]] static glm::vec2 wrappedOffset(glm::vec2 a, glm::vec2 b);
+
+  [[nodiscard]] int getDimension() const { return m_dimension; }
+  [[nodiscard]] float getCellSize() const { return m_cellSize; }
+
+private:
+  int m_dimension{1};
+  float m_cellSize{2.0f};
+
+  // Cell of each fish, in the order of FishArrays
+  std::vector<int> m_fishCells;
+
+  // Fishes sorted by cell. The fishes of cell c are in the range
+  // [m_cellStarts[c], m_cellStarts[c + 1]) of m_sortedIndices and of the
+  // sorted translations.
+  std::vector<std::size_t> m_cellStarts;
+  std::vector<std::size_t> m_sortedIndices;
+  std::vector<glm::vec2> m_sortedTranslations;
+
+  [[nodiscard]] int cellOf(float x, float y) const;
+  void sort();
+
+  template <typename F>
+  void forEachCellAround(glm::vec2 center, float radius, F &&f) const;
+};
+
+template <typename F>
+void SpatialGrid::forEachCellAround(glm::vec2 center, float radius,
+                                    F &&f) const {
+  auto const cell{cellOf(center.x, center.y)};
+  auto const cellX{cell % m_dimension};
+  auto const cellY{cell / m_dimension};
+
+  // Cells visited on each side of the center cell. If the query spans the
+  // whole world, each cell is visited once.
+  auto const reach{static_cast<int>(std::ceil(radius / m_cellSize))};
+  auto const span{[&](int centerCell) {
+    if (2 * reach + 1 >= m_dimension) {
+      return std::pair{-centerCell, m_dimension - 1 - centerCell};
+    }
+    return std::pair{-reach, reach};
+  }};
+  auto const [firstX, lastX]{span(cellX)};
+  auto const [firstY, lastY]{span(cellY)};
+
+  for (auto j{firstY}; j <= lastY; ++j) {
+    auto const y{(cellY + j + m_dimension) % m_dimension};
+    for (auto i{firstX}; i <= lastX; ++i) {
+      auto const x{(cellX + i + m_dimension) % m_dimension};
+      f(y * m_dimension + x);
+    }
+  }
+}
+
+template <typename F>
+void SpatialGrid::forEachInRadius(glm::vec2 center, float radius,
+                                  F &&f) const {
+  auto const radiusSquared{radius * radius};
+  forEachCellAround(center, radius, [&](int cell) {
+    for (auto slot{m_cellStarts[cell]}; slot < m_cellStarts[cell + 1];
+         ++slot) {
+      auto const offset{wrappedOffset(center, m_sortedTranslations[slot])};
+      if (glm::dot(offset, offset) < radiusSquared) {
+        f(m_sortedIndices[slot], offset);
+      }
+    }
+  });
+}
+
+template <typename F> void SpatialGrid::forEachPair(float radius, F &&f) const {
+  auto const radiusSquared{radius * radius};
+  for (auto const first : iter::range(m_sortedIndices.size())) {
+    auto const center{m_sortedTranslations[first]};
+    forEachCellAround(center, radius, [&](int cell) {
+      // Each pair is found from both fishes. Only the one found from the
+      // fish that comes first in sorted order is reported.
+      for (auto second{std::max(m_cellStarts[cell], first + 1)};
+           second < m_cellStarts[cell + 1]; ++second) {
+        auto const offset{wrappedOffset(center, m_sortedTranslations[second])};
+        if (glm::dot(offset, offset) < radiusSquared) {
+          f(m_sortedIndices[first], m_sortedIndices[second], offset);
+        }
+      }
+    });
+  }
+}
+
+#endif
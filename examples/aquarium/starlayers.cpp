@@ -13,52 +13,56 @@ void StarLayers::create(GLuint program, int quantity) {
   m_program = program;
 
   // Get location of uniforms in the program
-  m_pointSizeLoc = abcg::glGetUniformLocation(m_program, "pointSize");
-  m_translationLoc = abcg::glGetUniformLocation(m_program, "translation");
+  m_pointSizesLoc = abcg::glGetUniformLocation(m_program, "pointSizes");
+  m_translationsLoc = abcg::glGetUniformLocation(m_program, "translations");
 
   // Get location of attributes in the program
   auto const positionAttribute{
       abcg::glGetAttribLocation(m_program, "inPosition")};
   auto const colorAttribute{abcg::glGetAttribLocation(m_program, "inColor")};
 
+  // Create geometry data for the stars of all layers. The z coordinate of
+  // each star is the index of its layer.
+  std::vector<glm::vec3> data;
+  m_quantity = 0;
   for (auto &&[index, layer] : iter::enumerate(m_starLayers)) {
-    // Create geometry data for the stars of this layer
     layer.m_pointSize = 10.0f / (1.0f + index);
     layer.m_quantity = quantity * (gsl::narrow<int>(index) + 1);
     layer.m_translation = {};
 
-    std::vector<glm::vec3> data;
     for ([[maybe_unused]] auto _ : iter::range(0, layer.m_quantity)) {
-      data.emplace_back(distPos(re), distPos(re), 0);
+      data.emplace_back(distPos(re), distPos(re),
+                        gsl::narrow_cast<float>(index));
       data.push_back(glm::vec3(distIntensity(re)));
     }
-
-    // Generate VBO
-    abcg::glGenBuffers(1, &layer.m_VBO);
-    abcg::glBindBuffer(GL_ARRAY_BUFFER, layer.m_VBO);
-    abcg::glBufferData(GL_ARRAY_BUFFER, data.size() * sizeof(glm::vec3),
-                       data.data(), GL_STATIC_DRAW);
-    abcg::glBindBuffer(GL_ARRAY_BUFFER, 0);
-
-    // Create VAO
-    abcg::glGenVertexArrays(1, &layer.m_VAO);
-
-    // Bind vertex attributes to current VAO
-    abcg::glBindVertexArray(layer.m_VAO);
-
-    abcg::glBindBuffer(GL_ARRAY_BUFFER, layer.m_VBO);
-    abcg::glEnableVertexAttribArray(positionAttribute);
-    abcg::glVertexAttribPointer(positionAttribute, 2, GL_FLOAT, GL_FALSE,
-                                sizeof(glm::vec3) * 2, nullptr);
-    abcg::glEnableVertexAttribArray(colorAttribute);
-    abcg::glVertexAttribPointer(colorAttribute, 3, GL_FLOAT, GL_FALSE,
-                                sizeof(glm::vec3) * 2,
-                                reinterpret_cast<void *>(sizeof(glm::vec3)));
-    abcg::glBindBuffer(GL_ARRAY_BUFFER, 0);
-
-    // End of binding to current VAO
-    abcg::glBindVertexArray(0);
+    m_quantity += layer.m_quantity;
   }
+
+  // Generate VBO
+  abcg::glGenBuffers(1, &m_VBO);
+  abcg::glBindBuffer(GL_ARRAY_BUFFER, m_VBO);
+  abcg::glBufferData(GL_ARRAY_BUFFER, data.size() * sizeof(glm::vec3),
+                     data.data(), GL_STATIC_DRAW);
+  abcg::glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+  // Create VAO
+  abcg::glGenVertexArrays(1, &m_VAO);
+
+  // Bind vertex attributes to current VAO
+  abcg::glBindVertexArray(m_VAO);
+
+  abcg::glBindBuffer(GL_ARRAY_BUFFER, m_VBO);
+  abcg::glEnableVertexAttribArray(positionAttribute);
+  abcg::glVertexAttribPointer(positionAttribute, 3, GL_FLOAT, GL_FALSE,
+                              sizeof(glm::vec3) * 2, nullptr);
+  abcg::glEnableVertexAttribArray(colorAttribute);
+  abcg::glVertexAttribPointer(colorAttribute, 3, GL_FLOAT, GL_FALSE,
+                              sizeof(glm::vec3) * 2,
+                              reinterpret_cast<void *>(sizeof(glm::vec3)));
+  abcg::glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+  // End of binding to current VAO
+  abcg::glBindVertexArray(0);
 }
 
 void StarLayers::paint() {
@@ -67,21 +71,24 @@ void StarLayers::paint() {
   abcg::glEnable(GL_BLEND);
   abcg::glBlendFunc(GL_ONE, GL_ONE);
 
-  for (auto const &layer : m_starLayers) {
-    abcg::glBindVertexArray(layer.m_VAO);
-    abcg::glUniform1f(m_pointSizeLoc, layer.m_pointSize);
-
-    for (auto const i : {-2, 0, 2}) {
-      for (auto const j : {-2, 0, 2}) {
-        abcg::glUniform2f(m_translationLoc, layer.m_translation.x + j,
-                          layer.m_translation.y + i);
-
-        abcg::glDrawArrays(GL_POINTS, 0, layer.m_quantity);
-      }
-    }
-
-    abcg::glBindVertexArray(0);
+  std::array<float, std::tuple_size_v<decltype(m_starLayers)>> pointSizes{};
+  std::array<glm::vec2, std::tuple_size_v<decltype(m_starLayers)>>
+      translations{};
+  for (auto &&[layer, pointSize, translation] :
+       iter::zip(m_starLayers, pointSizes, translations)) {
+    pointSize = layer.m_pointSize;
+    translation = layer.m_translation;
   }
+  abcg::glUniform1fv(m_pointSizesLoc, gsl::narrow<GLsizei>(pointSizes.size()),
+                     pointSizes.data());
+  abcg::glUniform2fv(m_translationsLoc,
+                     gsl::narrow<GLsizei>(translations.size()),
+                     &translations.front().x);
+
+  // Draw all layers at once, 9 instances for the wrap-around tiling
+  abcg::glBindVertexArray(m_VAO);
+  abcg::glDrawArraysInstanced(GL_POINTS, 0, m_quantity, 9);
+  abcg::glBindVertexArray(0);
 
   abcg::glDisable(GL_BLEND);
 
@@ -89,10 +96,8 @@ void StarLayers::paint() {
 }
 
 void StarLayers::destroy() {
-  for (auto &layer : m_starLayers) {
-    abcg::glDeleteBuffers(1, &layer.m_VBO);
-    abcg::glDeleteVertexArrays(1, &layer.m_VAO);
-  }
+  abcg::glDeleteBuffers(1, &m_VBO);
+  abcg::glDeleteVertexArrays(1, &m_VAO);
 }
 
 void StarLayers::update(const Carp &ship, float deltaTime) {
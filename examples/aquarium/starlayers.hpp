@@ -18,13 +18,15 @@ public:
 
 private:
   GLuint m_program{};
-  GLint m_pointSizeLoc{};
-  GLint m_translationLoc{};
+  GLint m_pointSizesLoc{};
+  GLint m_translationsLoc{};
 
-  struct StarLayer {
-    GLuint m_VAO{};
-    GLuint m_VBO{};
+  // Stars of all layers, drawn with a single call
+  GLuint m_VAO{};
+  GLuint m_VBO{};
+  int m_quantity{};
 
+  struct StarLayer {
     float m_pointSize{};
     int m_quantity{};
     glm::vec2 m_translation{};
@@ -65,6 +65,13 @@ void Window::onCreate() {
                                  {.source = assetsPath + "objects.frag",
                                   .stage = abcg::ShaderStage::Fragment}});
 
+  // Create program to render the fishes with instancing
+  m_fishesProgram =
+      abcg::createOpenGLProgram({{.source = assetsPath + "fishes.vert",
+                                  .stage = abcg::ShaderStage::Vertex},
+                                 {.source = assetsPath + "objects.frag",
+                                  .stage = abcg::ShaderStage::Fragment}});
+
   // Create program to render the stars
   m_starsProgram =
       abcg::createOpenGLProgram({{.source = assetsPath + "stars.vert",
@@ -90,7 +97,7 @@ void Window::restart() {
 
   m_starLayers.create(m_starsProgram, 25);
   m_carp.create(m_objectsProgram);
-  m_fishes.create(m_objectsProgram, 3);
+  m_fishes.create(m_fishesProgram, 3);
 }
 
 void Window::onUpdate() {
@@ -107,7 +114,10 @@ void Window::onUpdate() {
   m_starLayers.update(m_carp, deltaTime);
   m_fishes.update(m_carp, deltaTime);
 
-  
+  if (m_gameData.m_state == State::Playing) {
+    checkCollisions();
+    checkWinCondition();
+  }
 }
 
 void Window::onPaint() {
@@ -134,6 +144,10 @@ void Window::onPaintUI() {
     ImGui::Begin(" ", nullptr, flags);
     ImGui::PushFont(m_font);
 
+    if (m_gameData.m_state == State::Win) {
+      ImGui::Text("*You Win!*");
+    }
+
     ImGui::PopFont();
     ImGui::End();
   }
@@ -148,6 +162,7 @@ void Window::onResize(glm::ivec2 const &size) {
 void Window::onDestroy() {
   abcg::glDeleteProgram(m_starsProgram);
   abcg::glDeleteProgram(m_objectsProgram);
+  abcg::glDeleteProgram(m_fishesProgram);
 
   m_fishes.destroy();
   m_carp.destroy();
@@ -155,55 +170,24 @@ void Window::onDestroy() {
 }
 
 void Window::checkCollisions() {
-  // Check collision between ship and asteroids
-  for (auto const &asteroid : m_fishes.m_fishes) {
-    auto const asteroidTranslation{asteroid.m_translation};
-    auto const distance{
-        glm::distance(m_carp.m_translation, asteroidTranslation)};
-
+  // The carp eats the fishes it touches. Only the fishes in the cells around
+  // the carp are tested.
+  std::vector<std::size_t> eaten;
+  m_fishes.m_grid.forEachInRadius(
+      m_carp.m_translation,
+      m_carp.m_scale * 0.9f + Fishes::getCollisionRadius(0.15f),
+      [&eaten](std::size_t index, [[maybe_unused]] glm::vec2 offset) {
+        eaten.push_back(index);
+      });
+
+  if (!eaten.empty()) {
+    m_fishes.removeFishes(std::move(eaten));
   }
-
-  // Check collision between bullets and asteroids
-  // for (auto &bullet : m_bullets.m_bullets) {
-  //   if (bullet.m_dead)
-  //     continue;
-
-  //   for (auto &asteroid : m_fishes.m_fishes) {
-  //     for (auto const i : {-2, 0, 2}) {
-  //       for (auto const j : {-2, 0, 2}) {
-  //         auto const asteroidTranslation{asteroid.m_translation +
-  //                                        glm::vec2(i, j)};
-  //         auto const distance{
-  //             glm::distance(bullet.m_translation, asteroidTranslation)};
-
-  //         if (distance < m_bullets.m_scale + asteroid.m_scale * 0.85f) {
-  //           asteroid.m_hit = true;
-  //           bullet.m_dead = true;
-  //         }
-  //       }
-  //     }
-  //   }
-
-    // Break asteroids marked as hit
-  //   for (auto const &asteroid : m_fishes.m_fishes) {
-  //     if (asteroid.m_hit && asteroid.m_scale > 0.10f) {
-  //       std::uniform_real_distribution randomDist{-1.0f, 1.0f};
-  //       std::generate_n(std::back_inserter(m_fishes.m_fishes), 3, [&]() {
-  //         glm::vec2 const offset{randomDist(m_randomEngine),
-  //                                randomDist(m_randomEngine)};
-  //         auto const newScale{asteroid.m_scale * 0.5f};
-  //         return m_fishes.makeAsteroid(
-  //             asteroid.m_translation + offset * newScale, newScale);
-  //       });
-  //     }
-  //   }
-
-  //   m_fishes.m_fishes.remove_if([](auto const &a) { return a.m_hit; });
-  // }
 }
 
 void Window::checkWinCondition() {
   if (m_fishes.m_fishes.empty()) {
+    m_gameData.m_state = State::Win;
     m_restartWaitTimer.restart();
   }
 }
\ No newline at end of file
@@ -24,6 +24,7 @@ private:
 
   GLuint m_starsProgram{};
   GLuint m_objectsProgram{};
+  GLuint m_fishesProgram{};
 
   GameData m_gameData;
 
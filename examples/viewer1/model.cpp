@@ -1,15 +1,5 @@
 #include "model.hpp"
 
-#include <unordered_map>
-
-// Explicit specialization of std::hash for Vertex
-template <> struct std::hash<Vertex> {
-  size_t operator()(Vertex const &vertex) const noexcept {
-    auto const h1{std::hash<glm::vec3>()(vertex.position)};
-    return h1;
-  }
-};
-
 void Model::createBuffers() {
   // Delete previous buffers
   abcg::glDeleteBuffers(1, &m_EBO);
@@ -53,8 +43,14 @@ void Model::loadObj(std::string_view path, bool standardize) {
   m_vertices.clear();
   m_indices.clear();
 
-  // A key:value map with key=Vertex and value=index
-  std::unordered_map<Vertex, GLuint> hash{};
+  std::size_t numIndices{};
+  for (auto const &shape : shapes) {
+    numIndices += shape.mesh.indices.size();
+  }
+  m_indices.reserve(numIndices);
+
+  // Merges duplicate vertices, assigning indices in order of first occurrence
+  abcg::VertexWelder<Vertex> welder{numIndices};
 
   // Loop over shapes
   for (auto const &shape : shapes) {
@@ -71,18 +67,12 @@ void Model::loadObj(std::string_view path, bool standardize) {
 
       Vertex const vertex{.position = {vx, vy, vz}};
 
-      // If hash doesn't contain this vertex
-      if (!hash.contains(vertex)) {
-        // Add this index (size of m_vertices)
-        hash[vertex] = m_vertices.size();
-        // Add this vertex
-        m_vertices.push_back(vertex);
-      }
-
-      m_indices.push_back(hash[vertex]);
+      m_indices.push_back(welder.weld(vertex));
     }
   }
 
+  m_vertices = welder.releaseVertices();
+
   if (standardize) {
     Model::standardize();
   }
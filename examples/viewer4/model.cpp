@@ -1,18 +1,52 @@
 #include "model.hpp"
 
+#include <cstring>
 #include <filesystem>
-#include <unordered_map>
-
-// Explicit specialization of std::hash for Vertex
-template <> struct std::hash<Vertex> {
-  size_t operator()(Vertex const &vertex) const noexcept {
-    auto const h1{std::hash<glm::vec3>()(vertex.position)};
-    auto const h2{std::hash<glm::vec3>()(vertex.normal)};
-    auto const h3{std::hash<glm::vec2>()(vertex.texCoord)};
-    return abcg::hashCombine(h1, h2, h3);
-  }
+#include <fstream>
+#include <sstream>
+
+namespace {
+// Material properties stored as user data of the mesh cache. It is followed
+// by the null-terminated name of the diffuse texture.
+struct CachedMaterial {
+  glm::vec4 Ka{};
+  glm::vec4 Kd{};
+  glm::vec4 Ks{};
+  float shininess{};
+  std::uint32_t hasNormals{};
+  std::uint32_t hasTexCoords{};
 };
 
+// Increment whenever Vertex or CachedMaterial changes
+constexpr std::size_t cacheLayoutVersion{1};
+
+// Returns the paths of the material files named by the mtllib statements of
+// an OBJ file. As in tinyobj, the first file of each statement that exists is
+// used
+std::vector<std::string> findMaterialPaths(std::string_view path,
+                                           std::string_view basePath) {
+  std::vector<std::string> materialPaths;
+  std::ifstream stream{std::string{path}};
+  std::string line;
+  while (std::getline(stream, line)) {
+    std::istringstream tokens{line};
+    std::string keyword;
+    if (!(tokens >> keyword) || keyword != "mtllib")
+      continue;
+
+    std::string name;
+    while (tokens >> name) {
+      auto materialPath{fmt::format("{}{}", basePath, name)};
+      if (std::filesystem::exists(materialPath)) {
+        materialPaths.push_back(std::move(materialPath));
+        break;
+      }
+    }
+  }
+  return materialPaths;
+}
+} // namespace
+
 void Model::computeNormals() {
   // Clear previous vertex normals
   for (auto &vertex : m_vertices) {
@@ -45,7 +79,8 @@ void Model::computeNormals() {
   m_hasNormals = true;
 }
 
-void Model::createBuffers() {
+void Model::createBuffers(std::span<Vertex const> vertices,
+                          std::span<GLuint const> indices) {
   // Delete previous buffers
   abcg::glDeleteBuffers(1, &m_EBO);
   abcg::glDeleteBuffers(1, &m_VBO);
@@ -54,22 +89,98 @@ void Model::createBuffers() {
   abcg::glGenBuffers(1, &m_VBO);
   abcg::glBindBuffer(GL_ARRAY_BUFFER, m_VBO);
   abcg::glBufferData(GL_ARRAY_BUFFER,
-                     sizeof(m_vertices.at(0)) * m_vertices.size(),
-                     m_vertices.data(), GL_STATIC_DRAW);
+                     gsl::narrow<GLsizeiptr>(vertices.size_bytes()),
+                     vertices.data(), GL_STATIC_DRAW);
   abcg::glBindBuffer(GL_ARRAY_BUFFER, 0);
 
   // EBO
   abcg::glGenBuffers(1, &m_EBO);
   abcg::glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_EBO);
   abcg::glBufferData(GL_ELEMENT_ARRAY_BUFFER,
-                     sizeof(m_indices.at(0)) * m_indices.size(),
-                     m_indices.data(), GL_STATIC_DRAW);
+                     gsl::narrow<GLsizeiptr>(indices.size_bytes()),
+                     indices.data(), GL_STATIC_DRAW);
   abcg::glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+
+  m_numIndices = gsl::narrow<GLsizei>(indices.size());
+}
+
+// nota: carrega o modelo do cache binario, se existir e estiver atualizado
+bool Model::loadCache(abcg::MeshCacheKey const &key,
+                      std::string_view basePath) {
+  abcg::MeshCache cache;
+  if (!cache.load(key)) {
+    return false;
+  }
+
+  auto const userData{cache.getUserData()};
+  if (userData.size() < sizeof(CachedMaterial)) {
+    return false;
+  }
+
+  CachedMaterial material{};
+  std::memcpy(&material, userData.data(), sizeof(material));
+
+  // Texture name
+  std::string_view const name{
+      reinterpret_cast<char const *>(userData.data()) + sizeof(material),
+      userData.size() - sizeof(material)};
+  if (name.empty() || name.back() != '\0') {
+    return false;
+  }
+  auto const diffuseTexName{name.substr(0, name.size() - 1)};
+
+  m_Ka = material.Ka;
+  m_Kd = material.Kd;
+  m_Ks = material.Ks;
+  m_shininess = material.shininess;
+  m_hasNormals = material.hasNormals != 0;
+  m_hasTexCoords = material.hasTexCoords != 0;
+
+  if (!diffuseTexName.empty())
+    loadDiffuseTexture(fmt::format("{}{}", basePath, diffuseTexName));
+
+  // Upload straight from the mapped file
+  m_vertices.clear();
+  m_indices.clear();
+  createBuffers(cache.getVertices<Vertex>(), cache.getIndices());
+
+  return true;
+}
+
+void Model::saveCache(abcg::MeshCacheKey const &key,
+                      std::string_view basePath,
+                      std::string_view diffuseTexName) const {
+  CachedMaterial const material{.Ka = m_Ka,
+                                .Kd = m_Kd,
+                                .Ks = m_Ks,
+                                .shininess = m_shininess,
+                                .hasNormals = m_hasNormals ? 1U : 0U,
+                                .hasTexCoords = m_hasTexCoords ? 1U : 0U};
+
+  std::vector<std::byte> userData(sizeof(material));
+  std::memcpy(userData.data(), &material, sizeof(material));
+  auto const bytes{std::as_bytes(std::span{diffuseTexName})};
+  userData.insert(userData.end(), bytes.begin(), bytes.end());
+  userData.push_back(std::byte{0});
+
+  // Failing to write the cache (e.g. read-only directory) is not an error
+  // The materials come from the MTL files, so the cache depends on them too
+  abcg::MeshCache::save<Vertex>(key, m_vertices, m_indices, userData,
+                                findMaterialPaths(key.sourcePath, basePath));
 }
 
 void Model::loadDiffuseTexture(std::string_view path) {
   if (!std::filesystem::exists(path))
     return;
+
+  // Prefer a block-compressed version of the texture, if one was created with
+  // tools/texconv
+  auto const compressedPath{
+      std::filesystem::path{path}.replace_extension(".ktx2").string()};
+  if (std::filesystem::exists(compressedPath)) {
+    path = compressedPath;
+  }
+
   // nota: deleta se tiver uma textura anterior
   abcg::glDeleteTextures(1, &m_diffuseTexture);
   // nota: carrega textura
@@ -78,6 +189,17 @@ void Model::loadDiffuseTexture(std::string_view path) {
 // nota: le o modelo
 void Model::loadObj(std::string_view path, bool standardize) {
   auto const basePath{std::filesystem::path{path}.parent_path().string() + "/"};
+
+  abcg::MeshCacheKey const cacheKey{
+      .sourcePath = path,
+      .vertexSize = sizeof(Vertex),
+      .options = abcg::hashCombine(cacheLayoutVersion, standardize)};
+
+  // Skip parsing if a valid binary cache exists next to the OBJ file
+  if (loadCache(cacheKey, basePath)) {
+    return;
+  }
+
   // nota: procura o mtl (textura)
   tinyobj::ObjReaderConfig readerConfig;
   readerConfig.mtl_search_path = basePath; // Path to material files
@@ -106,8 +228,14 @@ void Model::loadObj(std::string_view path, bool standardize) {
   m_hasNormals = false;
   m_hasTexCoords = false;
 
-  // A key:value map with key=Vertex and value=index
-  std::unordered_map<Vertex, GLuint> hash{};
+  std::size_t numIndices{};
+  for (auto const &shape : shapes) {
+    numIndices += shape.mesh.indices.size();
+  }
+  m_indices.reserve(numIndices);
+
+  // Merges duplicate vertices, assigning indices in order of first occurrence
+  abcg::VertexWelder<Vertex> welder{numIndices};
 
   // Loop over shapes
   for (auto const &shape : shapes) {
@@ -144,18 +272,14 @@ void Model::loadObj(std::string_view path, bool standardize) {
       Vertex const vertex{
           .position = position, .normal = normal, .texCoord = texCoord};
 
-      // If hash doesn't contain this vertex
-      if (!hash.contains(vertex)) {
-        // Add this index (size of m_vertices)
-        hash[vertex] = m_vertices.size();
-        // Add this vertex
-        m_vertices.push_back(vertex);
-      }
-
-      m_indices.push_back(hash[vertex]);
+      m_indices.push_back(welder.weld(vertex));
     }
   }
 
+  m_vertices = welder.releaseVertices();
+
+  std::string diffuseTexName;
+
   // Use properties of first material, if available
   if (!materials.empty()) {
     auto const &mat{materials.at(0)}; // First material
@@ -164,8 +288,10 @@ void Model::loadObj(std::string_view path, bool standardize) {
     m_Ks = {mat.specular[0], mat.specular[1], mat.specular[2], 1};
     m_shininess = mat.shininess;
 
-    if (!mat.diffuse_texname.empty())
-      loadDiffuseTexture(basePath + mat.diffuse_texname);
+    diffuseTexName = mat.diffuse_texname;
+
+    if (!diffuseTexName.empty())
+      loadDiffuseTexture(basePath + diffuseTexName);
   } else {
     // Default values
     m_Ka = {0.1f, 0.1f, 0.1f, 1.0f};
@@ -182,7 +308,8 @@ void Model::loadObj(std::string_view path, bool standardize) {
     computeNormals();
   }
 
-  createBuffers();
+  createBuffers(m_vertices, m_indices);
+  saveCache(cacheKey, basePath, diffuseTexName);
 }
 
 void Model::render(int numTriangles) const {
@@ -200,7 +327,7 @@ void Model::render(int numTriangles) const {
   abcg::glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
   abcg::glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
 
-  auto const numIndices{(numTriangles < 0) ? m_indices.size()
+  auto const numIndices{(numTriangles < 0) ? m_numIndices
                                            : numTriangles * 3};
 
   abcg::glDrawElements(GL_TRIANGLES, numIndices, GL_UNSIGNED_INT, nullptr);
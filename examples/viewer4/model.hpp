@@ -20,9 +20,7 @@ public:
   void setupVAO(GLuint program);
   void destroy();
 
-  [[nodiscard]] int getNumTriangles() const {
-    return gsl::narrow<int>(m_indices.size()) / 3;
-  }
+  [[nodiscard]] int getNumTriangles() const { return m_numIndices / 3; }
 
   [[nodiscard]] glm::vec4 getKa() const { return m_Ka; }
   [[nodiscard]] glm::vec4 getKd() const { return m_Kd; }
@@ -45,12 +43,18 @@ private:
 
   std::vector<Vertex> m_vertices;
   std::vector<GLuint> m_indices;
+  // Number of indices uploaded to the EBO
+  GLsizei m_numIndices{};
 
   bool m_hasNormals{false};
   bool m_hasTexCoords{false};
 
   void computeNormals();
-  void createBuffers();
+  void createBuffers(std::span<Vertex const> vertices,
+                     std::span<GLuint const> indices);
+  bool loadCache(abcg::MeshCacheKey const &key, std::string_view basePath);
+  void saveCache(abcg::MeshCacheKey const &key, std::string_view basePath,
+                 std::string_view diffuseTexName) const;
   void standardize();
 };
 
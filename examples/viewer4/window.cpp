@@ -153,7 +153,7 @@ void Window::onPaintUI() {
   // File browser for textures
   static ImGui::FileBrowser fileDialogTex;
   fileDialogTex.SetTitle("Load Texture");
-  fileDialogTex.SetTypeFilters({".jpg", ".png"});
+  fileDialogTex.SetTypeFilters({".jpg", ".png", ".ktx2", ".dds"});
   fileDialogTex.SetWindowSize(scaledWidth, scaledHeight);
 
 #if defined(__EMSCRIPTEN__)
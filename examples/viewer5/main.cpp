@@ -1,9 +1,20 @@
+#include <filesystem>
+#include <system_error>
+
 #include "window.hpp"
 
 int main(int argc, char **argv) {
   try {
     abcg::Application app(argc, argv);
 
+    // Reuse the shader programs linked in previous runs
+    std::error_code error;
+    if (auto const tempPath{std::filesystem::temp_directory_path(error)};
+        !error) {
+      abcg::setOpenGLProgramCacheDirectory(
+          (tempPath / "abcg" / "viewer5").string());
+    }
+
     Window window;
     window.setOpenGLSettings({.samples = 4});
     window.setWindowSettings({
@@ -0,0 +1,714 @@
+#include "meshkernels.hpp"
+
+#include <array>
+#include <cmath>
+#include <tuple>
+
+#include "abcgCPUFeatures.hpp"
+
+#if defined(ABCG_CPU_X86_64)
+#include <immintrin.h>
+#endif
+
+void VertexArrays::resize(std::size_t size) {
+  for (auto *array : {&px, &py, &pz, &nx, &ny, &nz, &s, &t, &tx, &ty, &tz,
+                      &tw}) {
+    array->resize(size);
+  }
+}
+
+namespace {
+
+// Per-face vectors (face normals, tangents or bitangents)
+struct FaceVectors {
+  std::vector<float> x, y, z;
+
+  explicit FaceVectors(std::size_t size) : x(size), y(size), z(size) {}
+};
+
+// Adds each face vector to the three vertices of the face, in face order
+void accumulate(std::span<GLuint const> indices, FaceVectors const &faces,
+                std::vector<float> &x, std::vector<float> &y,
+                std::vector<float> &z) {
+  auto const numFaces{indices.size() / 3};
+  for (std::size_t face{}; face < numFaces; ++face) {
+    for (std::size_t corner{}; corner < 3; ++corner) {
+      auto const index{indices[face * 3 + corner]};
+      x[index] += faces.x[face];
+      y[index] += faces.y[face];
+      z[index] += faces.z[face];
+    }
+  }
+}
+
+// Scalar kernels. These also process the remainder of the SIMD kernels.
+
+void boundsScalar(VertexArrays const &vertices, std::size_t begin,
+                  glm::vec3 &min, glm::vec3 &max) {
+  for (auto i{begin}; i < vertices.size(); ++i) {
+    glm::vec3 const position{vertices.px[i], vertices.py[i], vertices.pz[i]};
+    max = glm::max(max, position);
+    min = glm::min(min, position);
+  }
+}
+
+void transformScalar(VertexArrays &vertices, std::size_t begin,
+                     glm::vec3 const &center, float scaling) {
+  for (auto i{begin}; i < vertices.size(); ++i) {
+    vertices.px[i] = (vertices.px[i] - center.x) * scaling;
+    vertices.py[i] = (vertices.py[i] - center.y) * scaling;
+    vertices.pz[i] = (vertices.pz[i] - center.z) * scaling;
+  }
+}
+
+void faceNormalsScalar(VertexArrays const &vertices,
+                       std::span<GLuint const> indices, std::size_t begin,
+                       FaceVectors &normals) {
+  auto const &[px, py, pz]{std::tie(vertices.px, vertices.py, vertices.pz)};
+  for (auto face{begin}; face < indices.size() / 3; ++face) {
+    auto const a{indices[face * 3 + 0]};
+    auto const b{indices[face * 3 + 1]};
+    auto const c{indices[face * 3 + 2]};
+
+    auto const e1x{px[b] - px[a]};
+    auto const e1y{py[b] - py[a]};
+    auto const e1z{pz[b] - pz[a]};
+    auto const e2x{px[c] - px[b]};
+    auto const e2y{py[c] - py[b]};
+    auto const e2z{pz[c] - pz[b]};
+
+    normals.x[face] = e1y * e2z - e2y * e1z;
+    normals.y[face] = e1z * e2x - e2z * e1x;
+    normals.z[face] = e1x * e2y - e2x * e1y;
+  }
+}
+
+void normalizeScalar(std::vector<float> &x, std::vector<float> &y,
+                     std::vector<float> &z, std::size_t begin) {
+  for (auto i{begin}; i < x.size(); ++i) {
+    auto const invLength{1.0f /
+                         std::sqrt(x[i] * x[i] + y[i] * y[i] + z[i] * z[i])};
+    x[i] *= invLength;
+    y[i] *= invLength;
+    z[i] *= invLength;
+  }
+}
+
+void faceTangentsScalar(VertexArrays const &vertices,
+                        std::span<GLuint const> indices, std::size_t begin,
+                        FaceVectors &tangents, FaceVectors &bitangents) {
+  auto const &[px, py, pz]{std::tie(vertices.px, vertices.py, vertices.pz)};
+  auto const &[s, t]{std::tie(vertices.s, vertices.t)};
+  for (auto face{begin}; face < indices.size() / 3; ++face) {
+    auto const i1{indices[face * 3 + 0]};
+    auto const i2{indices[face * 3 + 1]};
+    auto const i3{indices[face * 3 + 2]};
+
+    auto const e1x{px[i2] - px[i1]};
+    auto const e1y{py[i2] - py[i1]};
+    auto const e1z{pz[i2] - pz[i1]};
+    auto const e2x{px[i3] - px[i1]};
+    auto const e2y{py[i3] - py[i1]};
+    auto const e2z{pz[i3] - pz[i1]};
+    auto const delta1s{s[i2] - s[i1]};
+    auto const delta1t{t[i2] - t[i1]};
+    auto const delta2s{s[i3] - s[i1]};
+    auto const delta2t{t[i3] - t[i1]};
+
+    // Inverse of the matrix of texture coordinate deltas
+    auto const r{1.0f / (delta1s * delta2t - delta2s * delta1t)};
+    auto const m00{delta2t * r};
+    auto const m01{-delta1t * r};
+    auto const m10{-delta2s * r};
+    auto const m11{delta1s * r};
+
+    tangents.x[face] = m00 * e1x + m01 * e2x;
+    tangents.y[face] = m00 * e1y + m01 * e2y;
+    tangents.z[face] = m00 * e1z + m01 * e2z;
+    bitangents.x[face] = m10 * e1x + m11 * e2x;
+    bitangents.y[face] = m10 * e1y + m11 * e2y;
+    bitangents.z[face] = m10 * e1z + m11 * e2z;
+  }
+}
+
+void orthogonalizeScalar(VertexArrays &vertices, FaceVectors const &bitangents,
+                         std::size_t begin) {
+  for (auto i{begin}; i < vertices.size(); ++i) {
+    auto const nx{vertices.nx[i]};
+    auto const ny{vertices.ny[i]};
+    auto const nz{vertices.nz[i]};
+    auto const tx{vertices.tx[i]};
+    auto const ty{vertices.ty[i]};
+    auto const tz{vertices.tz[i]};
+
+    // Orthogonalize t with respect to n
+    auto const dot{nx * tx + ny * ty + nz * tz};
+    auto ox{tx - nx * dot};
+    auto oy{ty - ny * dot};
+    auto oz{tz - nz * dot};
+    auto const invLength{1.0f / std::sqrt(ox * ox + oy * oy + oz * oz)};
+    vertices.tx[i] = ox * invLength;
+    vertices.ty[i] = oy * invLength;
+    vertices.tz[i] = oz * invLength;
+
+    // Compute handedness of re-orthogonalized basis
+    auto const bx{ny * tz - ty * nz};
+    auto const by{nz * tx - tz * nx};
+    auto const bz{nx * ty - tx * ny};
+    auto const handedness{bx * bitangents.x[i] + by * bitangents.y[i] +
+                          bz * bitangents.z[i]};
+    vertices.tw[i] = (handedness < 0.0f) ? -1.0f : 1.0f;
+  }
+}
+
+#if defined(ABCG_CPU_X86_64)
+
+// SSE2 kernels (4 lanes). They return the number of elements processed.
+
+__m128 gatherSSE2(std::vector<float> const &array, GLuint const *indices) {
+  return _mm_setr_ps(array[indices[0]], array[indices[3]], array[indices[6]],
+                     array[indices[9]]);
+}
+
+std::size_t boundsSSE2(VertexArrays const &vertices, glm::vec3 &min,
+                       glm::vec3 &max) {
+  auto const count{vertices.size() / 4 * 4};
+  if (count == 0)
+    return 0;
+
+  std::array minLanes{_mm_set1_ps(min.x), _mm_set1_ps(min.y),
+                      _mm_set1_ps(min.z)};
+  std::array maxLanes{_mm_set1_ps(max.x), _mm_set1_ps(max.y),
+                      _mm_set1_ps(max.z)};
+  std::array const arrays{vertices.px.data(), vertices.py.data(),
+                          vertices.pz.data()};
+  for (std::size_t i{}; i < count; i += 4) {
+    for (auto const axis : {0, 1, 2}) {
+      auto const value{_mm_loadu_ps(arrays[axis] + i)};
+      minLanes[axis] = _mm_min_ps(value, minLanes[axis]);
+      maxLanes[axis] = _mm_max_ps(value, maxLanes[axis]);
+    }
+  }
+
+  for (auto const axis : {0, 1, 2}) {
+    alignas(16) std::array<float, 4> minValues{};
+    alignas(16) std::array<float, 4> maxValues{};
+    _mm_store_ps(minValues.data(), minLanes[axis]);
+    _mm_store_ps(maxValues.data(), maxLanes[axis]);
+    for (auto const lane : iter::range(4)) {
+      min[axis] = glm::min(min[axis], minValues[lane]);
+      max[axis] = glm::max(max[axis], maxValues[lane]);
+    }
+  }
+  return count;
+}
+
+std::size_t transformSSE2(VertexArrays &vertices, glm::vec3 const &center,
+                          float scaling) {
+  auto const count{vertices.size() / 4 * 4};
+  auto const scale{_mm_set1_ps(scaling)};
+  std::array const arrays{vertices.px.data(), vertices.py.data(),
+                          vertices.pz.data()};
+  for (auto const axis : {0, 1, 2}) {
+    auto const offset{_mm_set1_ps(center[axis])};
+    for (std::size_t i{}; i < count; i += 4) {
+      auto const value{_mm_loadu_ps(arrays[axis] + i)};
+      _mm_storeu_ps(arrays[axis] + i,
+                    _mm_mul_ps(_mm_sub_ps(value, offset), scale));
+    }
+  }
+  return count;
+}
+
+std::size_t faceNormalsSSE2(VertexArrays const &vertices,
+                            std::span<GLuint const> indices,
+                            FaceVectors &normals) {
+  auto const count{indices.size() / 3 / 4 * 4};
+  for (std::size_t face{}; face < count; face += 4) {
+    auto const *const a{indices.data() + face * 3 + 0};
+    auto const *const b{indices.data() + face * 3 + 1};
+    auto const *const c{indices.data() + face * 3 + 2};
+
+    auto const ax{gatherSSE2(vertices.px, a)};
+    auto const ay{gatherSSE2(vertices.py, a)};
+    auto const az{gatherSSE2(vertices.pz, a)};
+    auto const bx{gatherSSE2(vertices.px, b)};
+    auto const by{gatherSSE2(vertices.py, b)};
+    auto const bz{gatherSSE2(vertices.pz, b)};
+    auto const cx{gatherSSE2(vertices.px, c)};
+    auto const cy{gatherSSE2(vertices.py, c)};
+    auto const cz{gatherSSE2(vertices.pz, c)};
+
+    auto const e1x{_mm_sub_ps(bx, ax)};
+    auto const e1y{_mm_sub_ps(by, ay)};
+    auto const e1z{_mm_sub_ps(bz, az)};
+    auto const e2x{_mm_sub_ps(cx, bx)};
+    auto const e2y{_mm_sub_ps(cy, by)};
+    auto const e2z{_mm_sub_ps(cz, bz)};
+
+    _mm_storeu_ps(normals.x.data() + face,
+                  _mm_sub_ps(_mm_mul_ps(e1y, e2z), _mm_mul_ps(e2y, e1z)));
+    _mm_storeu_ps(normals.y.data() + face,
+                  _mm_sub_ps(_mm_mul_ps(e1z, e2x), _mm_mul_ps(e2z, e1x)));
+    _mm_storeu_ps(normals.z.data() + face,
+                  _mm_sub_ps(_mm_mul_ps(e1x, e2y), _mm_mul_ps(e2x, e1y)));
+  }
+  return count;
+}
+
+std::size_t normalizeSSE2(std::vector<float> &x, std::vector<float> &y,
+                          std::vector<float> &z) {
+  auto const count{x.size() / 4 * 4};
+  auto const one{_mm_set1_ps(1.0f)};
+  for (std::size_t i{}; i < count; i += 4) {
+    auto const vx{_mm_loadu_ps(x.data() + i)};
+    auto const vy{_mm_loadu_ps(y.data() + i)};
+    auto const vz{_mm_loadu_ps(z.data() + i)};
+    auto const lengthSquared{
+        _mm_add_ps(_mm_add_ps(_mm_mul_ps(vx, vx), _mm_mul_ps(vy, vy)),
+                   _mm_mul_ps(vz, vz))};
+    auto const invLength{_mm_div_ps(one, _mm_sqrt_ps(lengthSquared))};
+    _mm_storeu_ps(x.data() + i, _mm_mul_ps(vx, invLength));
+    _mm_storeu_ps(y.data() + i, _mm_mul_ps(vy, invLength));
+    _mm_storeu_ps(z.data() + i, _mm_mul_ps(vz, invLength));
+  }
+  return count;
+}
+
+std::size_t faceTangentsSSE2(VertexArrays const &vertices,
+                             std::span<GLuint const> indices,
+                             FaceVectors &tangents, FaceVectors &bitangents) {
+  auto const count{indices.size() / 3 / 4 * 4};
+  auto const one{_mm_set1_ps(1.0f)};
+  auto const signMask{_mm_set1_ps(-0.0f)};
+  for (std::size_t face{}; face < count; face += 4) {
+    auto const *const i1{indices.data() + face * 3 + 0};
+    auto const *const i2{indices.data() + face * 3 + 1};
+    auto const *const i3{indices.data() + face * 3 + 2};
+
+    auto const p1x{gatherSSE2(vertices.px, i1)};
+    auto const p1y{gatherSSE2(vertices.py, i1)};
+    auto const p1z{gatherSSE2(vertices.pz, i1)};
+    auto const s1{gatherSSE2(vertices.s, i1)};
+    auto const t1{gatherSSE2(vertices.t, i1)};
+
+    auto const e1x{_mm_sub_ps(gatherSSE2(vertices.px, i2), p1x)};
+    auto const e1y{_mm_sub_ps(gatherSSE2(vertices.py, i2), p1y)};
+    auto const e1z{_mm_sub_ps(gatherSSE2(vertices.pz, i2), p1z)};
+    auto const e2x{_mm_sub_ps(gatherSSE2(vertices.px, i3), p1x)};
+    auto const e2y{_mm_sub_ps(gatherSSE2(vertices.py, i3), p1y)};
+    auto const e2z{_mm_sub_ps(gatherSSE2(vertices.pz, i3), p1z)};
+    auto const delta1s{_mm_sub_ps(gatherSSE2(vertices.s, i2), s1)};
+    auto const delta1t{_mm_sub_ps(gatherSSE2(vertices.t, i2), t1)};
+    auto const delta2s{_mm_sub_ps(gatherSSE2(vertices.s, i3), s1)};
+    auto const delta2t{_mm_sub_ps(gatherSSE2(vertices.t, i3), t1)};
+
+    auto const r{_mm_div_ps(one, _mm_sub_ps(_mm_mul_ps(delta1s, delta2t),
+                                            _mm_mul_ps(delta2s, delta1t)))};
+    auto const m00{_mm_mul_ps(delta2t, r)};
+    auto const m01{_mm_mul_ps(_mm_xor_ps(delta1t, signMask), r)};
+    auto const m10{_mm_mul_ps(_mm_xor_ps(delta2s, signMask), r)};
+    auto const m11{_mm_mul_ps(delta1s, r)};
+
+    auto const combine{[](__m128 ma, __m128 va, __m128 mb, __m128 vb) {
+      return _mm_add_ps(_mm_mul_ps(ma, va), _mm_mul_ps(mb, vb));
+    }};
+    _mm_storeu_ps(tangents.x.data() + face, combine(m00, e1x, m01, e2x));
+    _mm_storeu_ps(tangents.y.data() + face, combine(m00, e1y, m01, e2y));
+    _mm_storeu_ps(tangents.z.data() + face, combine(m00, e1z, m01, e2z));
+    _mm_storeu_ps(bitangents.x.data() + face, combine(m10, e1x, m11, e2x));
+    _mm_storeu_ps(bitangents.y.data() + face, combine(m10, e1y, m11, e2y));
+    _mm_storeu_ps(bitangents.z.data() + face, combine(m10, e1z, m11, e2z));
+  }
+  return count;
+}
+
+std::size_t orthogonalizeSSE2(VertexArrays &vertices,
+                              FaceVectors const &bitangents) {
+  auto const count{vertices.size() / 4 * 4};
+  auto const one{_mm_set1_ps(1.0f)};
+  auto const minusOne{_mm_set1_ps(-1.0f)};
+  auto const zero{_mm_setzero_ps()};
+  for (std::size_t i{}; i < count; i += 4) {
+    auto const nx{_mm_loadu_ps(vertices.nx.data() + i)};
+    auto const ny{_mm_loadu_ps(vertices.ny.data() + i)};
+    auto const nz{_mm_loadu_ps(vertices.nz.data() + i)};
+    auto const tx{_mm_loadu_ps(vertices.tx.data() + i)};
+    auto const ty{_mm_loadu_ps(vertices.ty.data() + i)};
+    auto const tz{_mm_loadu_ps(vertices.tz.data() + i)};
+
+    auto const dot{
+        _mm_add_ps(_mm_add_ps(_mm_mul_ps(nx, tx), _mm_mul_ps(ny, ty)),
+                   _mm_mul_ps(nz, tz))};
+    auto const ox{_mm_sub_ps(tx, _mm_mul_ps(nx, dot))};
+    auto const oy{_mm_sub_ps(ty, _mm_mul_ps(ny, dot))};
+    auto const oz{_mm_sub_ps(tz, _mm_mul_ps(nz, dot))};
+    auto const invLength{_mm_div_ps(
+        one, _mm_sqrt_ps(_mm_add_ps(
+                 _mm_add_ps(_mm_mul_ps(ox, ox), _mm_mul_ps(oy, oy)),
+                 _mm_mul_ps(oz, oz))))};
+    _mm_storeu_ps(vertices.tx.data() + i, _mm_mul_ps(ox, invLength));
+    _mm_storeu_ps(vertices.ty.data() + i, _mm_mul_ps(oy, invLength));
+    _mm_storeu_ps(vertices.tz.data() + i, _mm_mul_ps(oz, invLength));
+
+    auto const bx{_mm_sub_ps(_mm_mul_ps(ny, tz), _mm_mul_ps(ty, nz))};
+    auto const by{_mm_sub_ps(_mm_mul_ps(nz, tx), _mm_mul_ps(tz, nx))};
+    auto const bz{_mm_sub_ps(_mm_mul_ps(nx, ty), _mm_mul_ps(tx, ny))};
+    auto const handedness{_mm_add_ps(
+        _mm_add_ps(_mm_mul_ps(bx, _mm_loadu_ps(bitangents.x.data() + i)),
+                   _mm_mul_ps(by, _mm_loadu_ps(bitangents.y.data() + i))),
+        _mm_mul_ps(bz, _mm_loadu_ps(bitangents.z.data() + i)))};
+    auto const negative{_mm_cmplt_ps(handedness, zero)};
+    _mm_storeu_ps(vertices.tw.data() + i,
+                  _mm_or_ps(_mm_and_ps(negative, minusOne),
+                            _mm_andnot_ps(negative, one)));
+  }
+  return count;
+}
+
+// AVX2 kernels (8 lanes, hardware gathers). They return the number of
+// elements processed.
+
+ABCG_TARGET_AVX2 __m256 gatherAVX2(std::vector<float> const &array,
+                                   __m256i indices) {
+  return _mm256_i32gather_ps(array.data(), indices, 4);
+}
+
+// Indices of a corner of 8 consecutive faces
+ABCG_TARGET_AVX2 __m256i cornerIndicesAVX2(std::span<GLuint const> indices,
+                                           std::size_t face,
+                                           std::size_t corner) {
+  auto const offsets{_mm256_setr_epi32(0, 3, 6, 9, 12, 15, 18, 21)};
+  return _mm256_i32gather_epi32(
+      reinterpret_cast<int const *>(indices.data() + face * 3 + corner),
+      offsets, 4);
+}
+
+ABCG_TARGET_AVX2 std::size_t boundsAVX2(VertexArrays const &vertices,
+                                        glm::vec3 &min, glm::vec3 &max) {
+  auto const count{vertices.size() / 8 * 8};
+  if (count == 0)
+    return 0;
+
+  std::array minLanes{_mm256_set1_ps(min.x), _mm256_set1_ps(min.y),
+                      _mm256_set1_ps(min.z)};
+  std::array maxLanes{_mm256_set1_ps(max.x), _mm256_set1_ps(max.y),
+                      _mm256_set1_ps(max.z)};
+  std::array const arrays{vertices.px.data(), vertices.py.data(),
+                          vertices.pz.data()};
+  for (std::size_t i{}; i < count; i += 8) {
+    for (auto const axis : {0, 1, 2}) {
+      auto const value{_mm256_loadu_ps(arrays[axis] + i)};
+      minLanes[axis] = _mm256_min_ps(value, minLanes[axis]);
+      maxLanes[axis] = _mm256_max_ps(value, maxLanes[axis]);
+    }
+  }
+
+  for (auto const axis : {0, 1, 2}) {
+    alignas(32) std::array<float, 8> minValues{};
+    alignas(32) std::array<float, 8> maxValues{};
+    _mm256_store_ps(minValues.data(), minLanes[axis]);
+    _mm256_store_ps(maxValues.data(), maxLanes[axis]);
+    for (auto const lane : iter::range(8)) {
+      min[axis] = glm::min(min[axis], minValues[lane]);
+      max[axis] = glm::max(max[axis], maxValues[lane]);
+    }
+  }
+  return count;
+}
+
+ABCG_TARGET_AVX2 std::size_t transformAVX2(VertexArrays &vertices,
+                                           glm::vec3 const &center,
+                                           float scaling) {
+  auto const count{vertices.size() / 8 * 8};
+  auto const scale{_mm256_set1_ps(scaling)};
+  std::array const arrays{vertices.px.data(), vertices.py.data(),
+                          vertices.pz.data()};
+  for (auto const axis : {0, 1, 2}) {
+    auto const offset{_mm256_set1_ps(center[axis])};
+    for (std::size_t i{}; i < count; i += 8) {
+      auto const value{_mm256_loadu_ps(arrays[axis] + i)};
+      _mm256_storeu_ps(arrays[axis] + i,
+                       _mm256_mul_ps(_mm256_sub_ps(value, offset), scale));
+    }
+  }
+  return count;
+}
+
+ABCG_TARGET_AVX2 std::size_t faceNormalsAVX2(VertexArrays const &vertices,
+                                             std::span<GLuint const> indices,
+                                             FaceVectors &normals) {
+  auto const count{indices.size() / 3 / 8 * 8};
+  for (std::size_t face{}; face < count; face += 8) {
+    auto const a{cornerIndicesAVX2(indices, face, 0)};
+    auto const b{cornerIndicesAVX2(indices, face, 1)};
+    auto const c{cornerIndicesAVX2(indices, face, 2)};
+
+    auto const ax{gatherAVX2(vertices.px, a)};
+    auto const ay{gatherAVX2(vertices.py, a)};
+    auto const az{gatherAVX2(vertices.pz, a)};
+    auto const bx{gatherAVX2(vertices.px, b)};
+    auto const by{gatherAVX2(vertices.py, b)};
+    auto const bz{gatherAVX2(vertices.pz, b)};
+    auto const cx{gatherAVX2(vertices.px, c)};
+    auto const cy{gatherAVX2(vertices.py, c)};
+    auto const cz{gatherAVX2(vertices.pz, c)};
+
+    auto const e1x{_mm256_sub_ps(bx, ax)};
+    auto const e1y{_mm256_sub_ps(by, ay)};
+    auto const e1z{_mm256_sub_ps(bz, az)};
+    auto const e2x{_mm256_sub_ps(cx, bx)};
+    auto const e2y{_mm256_sub_ps(cy, by)};
+    auto const e2z{_mm256_sub_ps(cz, bz)};
+
+    _mm256_storeu_ps(
+        normals.x.data() + face,
+        _mm256_sub_ps(_mm256_mul_ps(e1y, e2z), _mm256_mul_ps(e2y, e1z)));
+    _mm256_storeu_ps(
+        normals.y.data() + face,
+        _mm256_sub_ps(_mm256_mul_ps(e1z, e2x), _mm256_mul_ps(e2z, e1x)));
+    _mm256_storeu_ps(
+        normals.z.data() + face,
+        _mm256_sub_ps(_mm256_mul_ps(e1x, e2y), _mm256_mul_ps(e2x, e1y)));
+  }
+  return count;
+}
+
+ABCG_TARGET_AVX2 std::size_t normalizeAVX2(std::vector<float> &x,
+                                           std::vector<float> &y,
+                                           std::vector<float> &z) {
+  auto const count{x.size() / 8 * 8};
+  auto const one{_mm256_set1_ps(1.0f)};
+  for (std::size_t i{}; i < count; i += 8) {
+    auto const vx{_mm256_loadu_ps(x.data() + i)};
+    auto const vy{_mm256_loadu_ps(y.data() + i)};
+    auto const vz{_mm256_loadu_ps(z.data() + i)};
+    auto const lengthSquared{_mm256_add_ps(
+        _mm256_add_ps(_mm256_mul_ps(vx, vx), _mm256_mul_ps(vy, vy)),
+        _mm256_mul_ps(vz, vz))};
+    auto const invLength{_mm256_div_ps(one, _mm256_sqrt_ps(lengthSquared))};
+    _mm256_storeu_ps(x.data() + i, _mm256_mul_ps(vx, invLength));
+    _mm256_storeu_ps(y.data() + i, _mm256_mul_ps(vy, invLength));
+    _mm256_storeu_ps(z.data() + i, _mm256_mul_ps(vz, invLength));
+  }
+  return count;
+}
+
+ABCG_TARGET_AVX2 __m256 combineAVX2(__m256 ma, __m256 va, __m256 mb,
+                                    __m256 vb) {
+  return _mm256_add_ps(_mm256_mul_ps(ma, va), _mm256_mul_ps(mb, vb));
+}
+
+ABCG_TARGET_AVX2 std::size_t faceTangentsAVX2(VertexArrays const &vertices,
+                                              std::span<GLuint const> indices,
+                                              FaceVectors &tangents,
+                                              FaceVectors &bitangents) {
+  auto const count{indices.size() / 3 / 8 * 8};
+  auto const one{_mm256_set1_ps(1.0f)};
+  auto const signMask{_mm256_set1_ps(-0.0f)};
+  for (std::size_t face{}; face < count; face += 8) {
+    auto const i1{cornerIndicesAVX2(indices, face, 0)};
+    auto const i2{cornerIndicesAVX2(indices, face, 1)};
+    auto const i3{cornerIndicesAVX2(indices, face, 2)};
+
+    auto const p1x{gatherAVX2(vertices.px, i1)};
+    auto const p1y{gatherAVX2(vertices.py, i1)};
+    auto const p1z{gatherAVX2(vertices.pz, i1)};
+    auto const s1{gatherAVX2(vertices.s, i1)};
+    auto const t1{gatherAVX2(vertices.t, i1)};
+
+    auto const e1x{_mm256_sub_ps(gatherAVX2(vertices.px, i2), p1x)};
+    auto const e1y{_mm256_sub_ps(gatherAVX2(vertices.py, i2), p1y)};
+    auto const e1z{_mm256_sub_ps(gatherAVX2(vertices.pz, i2), p1z)};
+    auto const e2x{_mm256_sub_ps(gatherAVX2(vertices.px, i3), p1x)};
+    auto const e2y{_mm256_sub_ps(gatherAVX2(vertices.py, i3), p1y)};
+    auto const e2z{_mm256_sub_ps(gatherAVX2(vertices.pz, i3), p1z)};
+    auto const delta1s{_mm256_sub_ps(gatherAVX2(vertices.s, i2), s1)};
+    auto const delta1t{_mm256_sub_ps(gatherAVX2(vertices.t, i2), t1)};
+    auto const delta2s{_mm256_sub_ps(gatherAVX2(vertices.s, i3), s1)};
+    auto const delta2t{_mm256_sub_ps(gatherAVX2(vertices.t, i3), t1)};
+
+    auto const r{
+        _mm256_div_ps(one, _mm256_sub_ps(_mm256_mul_ps(delta1s, delta2t),
+                                         _mm256_mul_ps(delta2s, delta1t)))};
+    auto const m00{_mm256_mul_ps(delta2t, r)};
+    auto const m01{_mm256_mul_ps(_mm256_xor_ps(delta1t, signMask), r)};
+    auto const m10{_mm256_mul_ps(_mm256_xor_ps(delta2s, signMask), r)};
+    auto const m11{_mm256_mul_ps(delta1s, r)};
+
+    _mm256_storeu_ps(tangents.x.data() + face, combineAVX2(m00, e1x, m01, e2x));
+    _mm256_storeu_ps(tangents.y.data() + face, combineAVX2(m00, e1y, m01, e2y));
+    _mm256_storeu_ps(tangents.z.data() + face, combineAVX2(m00, e1z, m01, e2z));
+    _mm256_storeu_ps(bitangents.x.data() + face,
+                     combineAVX2(m10, e1x, m11, e2x));
+    _mm256_storeu_ps(bitangents.y.data() + face,
+                     combineAVX2(m10, e1y, m11, e2y));
+    _mm256_storeu_ps(bitangents.z.data() + face,
+                     combineAVX2(m10, e1z, m11, e2z));
+  }
+  return count;
+}
+
+ABCG_TARGET_AVX2 std::size_t orthogonalizeAVX2(VertexArrays &vertices,
+                                               FaceVectors const &bitangents) {
+  auto const count{vertices.size() / 8 * 8};
+  auto const one{_mm256_set1_ps(1.0f)};
+  auto const minusOne{_mm256_set1_ps(-1.0f)};
+  auto const zero{_mm256_setzero_ps()};
+  for (std::size_t i{}; i < count; i += 8) {
+    auto const nx{_mm256_loadu_ps(vertices.nx.data() + i)};
+    auto const ny{_mm256_loadu_ps(vertices.ny.data() + i)};
+    auto const nz{_mm256_loadu_ps(vertices.nz.data() + i)};
+    auto const tx{_mm256_loadu_ps(vertices.tx.data() + i)};
+    auto const ty{_mm256_loadu_ps(vertices.ty.data() + i)};
+    auto const tz{_mm256_loadu_ps(vertices.tz.data() + i)};
+
+    auto const dot{_mm256_add_ps(
+        _mm256_add_ps(_mm256_mul_ps(nx, tx), _mm256_mul_ps(ny, ty)),
+        _mm256_mul_ps(nz, tz))};
+    auto const ox{_mm256_sub_ps(tx, _mm256_mul_ps(nx, dot))};
+    auto const oy{_mm256_sub_ps(ty, _mm256_mul_ps(ny, dot))};
+    auto const oz{_mm256_sub_ps(tz, _mm256_mul_ps(nz, dot))};
+    auto const invLength{_mm256_div_ps(
+        one, _mm256_sqrt_ps(_mm256_add_ps(
+                 _mm256_add_ps(_mm256_mul_ps(ox, ox), _mm256_mul_ps(oy, oy)),
+                 _mm256_mul_ps(oz, oz))))};
+    _mm256_storeu_ps(vertices.tx.data() + i, _mm256_mul_ps(ox, invLength));
+    _mm256_storeu_ps(vertices.ty.data() + i, _mm256_mul_ps(oy, invLength));
+    _mm256_storeu_ps(vertices.tz.data() + i, _mm256_mul_ps(oz, invLength));
+
+    auto const bx{_mm256_sub_ps(_mm256_mul_ps(ny, tz), _mm256_mul_ps(ty, nz))};
+    auto const by{_mm256_sub_ps(_mm256_mul_ps(nz, tx), _mm256_mul_ps(tz, nx))};
+    auto const bz{_mm256_sub_ps(_mm256_mul_ps(nx, ty), _mm256_mul_ps(tx, ny))};
+    auto const handedness{_mm256_add_ps(
+        _mm256_add_ps(
+            _mm256_mul_ps(bx, _mm256_loadu_ps(bitangents.x.data() + i)),
+            _mm256_mul_ps(by, _mm256_loadu_ps(bitangents.y.data() + i))),
+        _mm256_mul_ps(bz, _mm256_loadu_ps(bitangents.z.data() + i)))};
+    _mm256_storeu_ps(
+        vertices.tw.data() + i,
+        _mm256_blendv_ps(one, minusOne,
+                         _mm256_cmp_ps(handedness, zero, _CMP_LT_OQ)));
+  }
+  return count;
+}
+
+meshkernels::InstructionSet detectInstructionSet() {
+  return abcg::cpuSupportsAVX2() ? meshkernels::InstructionSet::AVX2
+                                 : meshkernels::InstructionSet::SSE2;
+}
+
+#else
+
+meshkernels::InstructionSet detectInstructionSet() {
+  return meshkernels::InstructionSet::Scalar;
+}
+
+#endif
+
+} // namespace
+
+meshkernels::InstructionSet meshkernels::getInstructionSet() {
+  static auto const instructionSet{detectInstructionSet()};
+  return instructionSet;
+}
+
+void meshkernels::standardize(VertexArrays &vertices,
+                              InstructionSet instructionSet) {
+  // Get bounds
+  glm::vec3 max(std::numeric_limits<float>::lowest());
+  glm::vec3 min(std::numeric_limits<float>::max());
+  std::size_t processed{};
+#if defined(ABCG_CPU_X86_64)
+  if (instructionSet == InstructionSet::AVX2) {
+    processed = boundsAVX2(vertices, min, max);
+  } else if (instructionSet == InstructionSet::SSE2) {
+    processed = boundsSSE2(vertices, min, max);
+  }
+#endif
+  boundsScalar(vertices, processed, min, max);
+
+  // Center and scale
+  auto const center{(min + max) / 2.0f};
+  auto const scaling{2.0f / glm::length(max - min)};
+  processed = 0;
+#if defined(ABCG_CPU_X86_64)
+  if (instructionSet == InstructionSet::AVX2) {
+    processed = transformAVX2(vertices, center, scaling);
+  } else if (instructionSet == InstructionSet::SSE2) {
+    processed = transformSSE2(vertices, center, scaling);
+  }
+#endif
+  transformScalar(vertices, processed, center, scaling);
+}
+
+void meshkernels::computeNormals(VertexArrays &vertices,
+                                 std::span<GLuint const> indices,
+                                 InstructionSet instructionSet) {
+  // Compute face normals
+  FaceVectors faceNormals(indices.size() / 3);
+  std::size_t processed{};
+#if defined(ABCG_CPU_X86_64)
+  if (instructionSet == InstructionSet::AVX2) {
+    processed = faceNormalsAVX2(vertices, indices, faceNormals);
+  } else if (instructionSet == InstructionSet::SSE2) {
+    processed = faceNormalsSSE2(vertices, indices, faceNormals);
+  }
+#endif
+  faceNormalsScalar(vertices, indices, processed, faceNormals);
+
+  // Accumulate on vertices, replacing previous vertex normals
+  std::ranges::fill(vertices.nx, 0.0f);
+  std::ranges::fill(vertices.ny, 0.0f);
+  std::ranges::fill(vertices.nz, 0.0f);
+  accumulate(indices, faceNormals, vertices.nx, vertices.ny, vertices.nz);
+
+  // Normalize
+  processed = 0;
+#if defined(ABCG_CPU_X86_64)
+  if (instructionSet == InstructionSet::AVX2) {
+    processed = normalizeAVX2(vertices.nx, vertices.ny, vertices.nz);
+  } else if (instructionSet == InstructionSet::SSE2) {
+    processed = normalizeSSE2(vertices.nx, vertices.ny, vertices.nz);
+  }
+#endif
+  normalizeScalar(vertices.nx, vertices.ny, vertices.nz, processed);
+}
+
+void meshkernels::computeTangents(VertexArrays &vertices,
+                                  std::span<GLuint const> indices,
+                                  InstructionSet instructionSet) {
+  // Compute face tangents and bitangents
+  auto const numFaces{indices.size() / 3};
+  FaceVectors faceTangents(numFaces);
+  FaceVectors faceBitangents(numFaces);
+  std::size_t processed{};
+#if defined(ABCG_CPU_X86_64)
+  if (instructionSet == InstructionSet::AVX2) {
+    processed =
+        faceTangentsAVX2(vertices, indices, faceTangents, faceBitangents);
+  } else if (instructionSet == InstructionSet::SSE2) {
+    processed =
+        faceTangentsSSE2(vertices, indices, faceTangents, faceBitangents);
+  }
+#endif
+  faceTangentsScalar(vertices, indices, processed, faceTangents,
+                     faceBitangents);
+
+  // Accumulate on vertices
+  FaceVectors bitangents(vertices.size());
+  accumulate(indices, faceTangents, vertices.tx, vertices.ty, vertices.tz);
+  accumulate(indices, faceBitangents, bitangents.x, bitangents.y,
+             bitangents.z);
+
+  // Orthogonalize and compute handedness
+  processed = 0;
+#if defined(ABCG_CPU_X86_64)
+  if (instructionSet == InstructionSet::AVX2) {
+    processed = orthogonalizeAVX2(vertices, bitangents);
+  } else if (instructionSet == InstructionSet::SSE2) {
+    processed = orthogonalizeSSE2(vertices, bitangents);
+  }
+#endif
+  orthogonalizeScalar(vertices, bitangents, processed);
+}
@@ -0,0 +1,41 @@
+#ifndef MESHKERNELS_HPP_
+#define MESHKERNELS_HPP_
+
+#include "abcgOpenGL.hpp"
+
+// Structure-of-arrays staging layout of the vertex attributes, so that the
+// kernels below can process several vertices or faces per instruction
+struct VertexArrays {
+  std::vector<float> px, py, pz; // Positions
+  std::vector<float> nx, ny, nz; // Normals
+  std::vector<float> s, t;       // Texture coordinates
+  std::vector<float> tx, ty, tz; // Tangents
+  std::vector<float> tw;         // Handedness of the tangent frame
+
+  void resize(std::size_t size);
+  [[nodiscard]] std::size_t size() const { return px.size(); }
+};
+
+namespace meshkernels {
+
+enum class InstructionSet { Scalar, SSE2, AVX2 };
+
+// Returns the best instruction set supported by the CPU (detected once)
+[[nodiscard]] InstructionSet getInstructionSet();
+
+// Centers the positions at the origin and scales the diagonal of their
+// bounding box to 2
+void standardize(VertexArrays &vertices,
+                 InstructionSet instructionSet = getInstructionSet());
+
+// Computes smooth normals as the normalized sum of the face normals
+void computeNormals(VertexArrays &vertices, std::span<GLuint const> indices,
+                    InstructionSet instructionSet = getInstructionSet());
+
+// Computes tangents and their handedness from the texture coordinates
+void computeTangents(VertexArrays &vertices, std::span<GLuint const> indices,
+                     InstructionSet instructionSet = getInstructionSet());
+
+} // namespace meshkernels
+
+#endif
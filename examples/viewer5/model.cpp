@@ -1,270 +1,397 @@
 #include "model.hpp"
 
+#include <algorithm>
+#include <cstring>
 #include <filesystem>
-#include <unordered_map>
-
-// Explicit specialization of std::hash for Vertex
-template <> struct std::hash<Vertex> {
-  size_t operator()(Vertex const &vertex) const noexcept {
-    auto const h1{std::hash<glm::vec3>()(vertex.position)};
-    auto const h2{std::hash<glm::vec3>()(vertex.normal)};
-    auto const h3{std::hash<glm::vec2>()(vertex.texCoord)};
-    return abcg::hashCombine(h1, h2, h3);
-  }
+
+namespace {
+// Material properties stored as user data of the mesh cache. It is followed
+// by the null-terminated names of the diffuse and normal textures.
+struct CachedMaterial {
+  glm::vec4 Ka{};
+  glm::vec4 Kd{};
+  glm::vec4 Ks{};
+  float shininess{};
+  std::uint32_t hasNormals{};
+  std::uint32_t hasTexCoords{};
 };
 
-void Model::computeNormals() {
-  // Clear previous vertex normals
-  for (auto &vertex : m_vertices) {
-    vertex.normal = glm::vec3(0.0f);
-  }
+// Increment whenever Vertex or CachedMaterial changes
+constexpr std::size_t cacheLayoutVersion{2};
 
-  // Compute face normals
-  for (auto const offset : iter::range(0UL, m_indices.size(), 3UL)) {
-    // Get face vertices
-    auto &a{m_vertices.at(m_indices.at(offset + 0))};
-    auto &b{m_vertices.at(m_indices.at(offset + 1))};
-    auto &c{m_vertices.at(m_indices.at(offset + 2))};
-
-    // Compute normal
-    auto const edge1{b.position - a.position};
-    auto const edge2{c.position - b.position};
-    auto const normal{glm::cross(edge1, edge2)};
-
-    // Accumulate on vertices
-    a.normal += normal;
-    b.normal += normal;
-    c.normal += normal;
-  }
+// Minimum number of face corners processed by each task
+constexpr std::size_t minCornersPerBlock{1 << 16};
 
-  // Normalize
-  for (auto &vertex : m_vertices) {
-    vertex.normal = glm::normalize(vertex.normal);
-  }
+using Welder = abcg::VertexWelder<Vertex, GLuint>;
 
-  m_hasNormals = true;
+Vertex toVertex(ObjData const &obj, ObjIndex const &index) {
+  Vertex vertex{.position = obj.positions[index.position]};
+  if (index.normal >= 0) {
+    vertex.normal = obj.normals[index.normal];
+  }
+  if (index.texCoord >= 0) {
+    vertex.texCoord = obj.texCoords[index.texCoord];
+  }
+  return vertex;
 }
 
-void Model::computeTangents() {
-  // Reserve space for bitangents
-  std::vector bitangents(m_vertices.size(), glm::vec3(0));
-
-  // Compute face tangents and bitangents
-  for (auto const offset : iter::range(0UL, m_indices.size(), 3UL)) {
-    // Get face indices
-    auto const i1{m_indices.at(offset + 0)};
-    auto const i2{m_indices.at(offset + 1)};
-    auto const i3{m_indices.at(offset + 2)};
-
-    // Get face vertices
-    auto &v1{m_vertices.at(i1)};
-    auto &v2{m_vertices.at(i2)};
-    auto &v3{m_vertices.at(i3)};
-
-    auto const e1{v2.position - v1.position};
-    auto const e2{v3.position - v1.position};
-    auto const delta1{v2.texCoord - v1.texCoord};
-    auto const delta2{v3.texCoord - v1.texCoord};
-
-    glm::mat2 M;
-    M[0][0] = delta2.t;
-    M[0][1] = -delta1.t;
-    M[1][0] = -delta2.s;
-    M[1][1] = delta1.s;
-    M *= (1.0f / (delta1.s * delta2.t - delta2.s * delta1.t));
-
-    auto const tangent{glm::vec4(M[0][0] * e1.x + M[0][1] * e2.x,
-                                 M[0][0] * e1.y + M[0][1] * e2.y,
-                                 M[0][0] * e1.z + M[0][1] * e2.z, 0.0f)};
-
-    auto const bitangent{glm::vec3(M[1][0] * e1.x + M[1][1] * e2.x,
-                                   M[1][0] * e1.y + M[1][1] * e2.y,
-                                   M[1][0] * e1.z + M[1][1] * e2.z)};
-
-    // Accumulate on vertices
-    v1.tangent += tangent;
-    v2.tangent += tangent;
-    v3.tangent += tangent;
-
-    bitangents.at(i1) += bitangent;
-    bitangents.at(i2) += bitangent;
-    bitangents.at(i3) += bitangent;
-  }
+// Deduplicates the face corners of an OBJ file in parallel.
+//
+// Corners are distributed among shards according to their hash. Each shard is
+// deduplicated by a single task with its own abcg::VertexWelder, visiting the
+// corners in file order, so that each corner is mapped to the first corner
+// with the same vertex. Unique vertices are then numbered by their first
+// occurrence in the file. The result is the same as welding every corner
+// serially with a single welder, regardless of the number of threads.
+void weldVertices(ObjData const &obj, abcg::ThreadPool &pool,
+                  std::vector<Vertex> &vertices, std::vector<GLuint> &indices) {
+  auto const numCorners{obj.corners.size()};
+  auto const maxTasks{(pool.getThreadCount() + 1) * 4};
+  auto const numBlocks{
+      std::clamp(numCorners / minCornersPerBlock, std::size_t{1}, maxTasks)};
+  auto const numShards{numBlocks == 1 ? std::size_t{1} : maxTasks};
+  auto const blockRange{[&](std::size_t block) {
+    return std::pair{block * numCorners / numBlocks,
+                     (block + 1) * numCorners / numBlocks};
+  }};
+
+  // Corners of each (block, shard) pair, in file order
+  std::vector<std::vector<std::vector<GLuint>>> buckets(
+      numBlocks, std::vector<std::vector<GLuint>>(numShards));
+  pool.parallelFor(numBlocks, [&](std::size_t block) {
+    auto const [begin, end] = blockRange(block);
+    auto &blockBuckets{buckets[block]};
+    for (auto &bucket : blockBuckets) {
+      bucket.reserve((end - begin) / numShards);
+    }
+    for (auto const corner : iter::range(begin, end)) {
+      auto const hash{Welder::hash(toVertex(obj, obj.corners[corner]))};
+      // Use the high bits, as the low bits select the slots of the welder
+      auto const shard{static_cast<std::size_t>(hash >> 32) % numShards};
+      blockBuckets[shard].push_back(gsl::narrow_cast<GLuint>(corner));
+    }
+  });
+
+  // First corner with the same vertex as each corner
+  std::vector<GLuint> firstCorners(numCorners);
+  pool.parallelFor(numShards, [&](std::size_t shard) {
+    std::size_t numShardCorners{};
+    for (auto const &blockBuckets : buckets) {
+      numShardCorners += blockBuckets[shard].size();
+    }
 
-  for (auto &&[i, vertex] : iter::enumerate(m_vertices)) {
-    auto const &n{vertex.normal};
-    auto const &t{glm::vec3(vertex.tangent)};
+    Welder welder{numShardCorners};
+    // First corner of each vertex of the welder
+    std::vector<GLuint> welderFirstCorners;
+    for (auto const &blockBuckets : buckets) {
+      for (auto const corner : blockBuckets[shard]) {
+        auto const [index, inserted]{
+            welder.insert(toVertex(obj, obj.corners[corner]))};
+        if (inserted) {
+          welderFirstCorners.push_back(corner);
+        }
+        firstCorners[corner] = welderFirstCorners[index];
+      }
+    }
+  });
+  buckets.clear();
+
+  // Number the unique vertices in file order
+  std::vector<std::size_t> blockOffsets(numBlocks + 1);
+  pool.parallelFor(numBlocks, [&](std::size_t block) {
+    auto const [begin, end] = blockRange(block);
+    blockOffsets[block + 1] = gsl::narrow_cast<std::size_t>(
+        std::count_if(std::next(firstCorners.begin(), begin),
+                      std::next(firstCorners.begin(), end),
+                      [&, corner = begin](GLuint first) mutable {
+                        return first == corner++;
+                      }));
+  });
+  for (auto const block : iter::range(numBlocks)) {
+    blockOffsets[block + 1] += blockOffsets[block];
+  }
 
-    // Orthogonalize t with respect to n
-    auto const tangent{t - n * glm::dot(n, t)};
-    vertex.tangent = glm::vec4(glm::normalize(tangent), 0);
+  vertices.resize(blockOffsets.back());
+  indices.resize(numCorners);
+  pool.parallelFor(numBlocks, [&](std::size_t block) {
+    auto const [begin, end] = blockRange(block);
+    auto vertexIndex{blockOffsets[block]};
+    for (auto const corner : iter::range(begin, end)) {
+      if (firstCorners[corner] == corner) {
+        vertices[vertexIndex] = toVertex(obj, obj.corners[corner]);
+        indices[corner] = gsl::narrow_cast<GLuint>(vertexIndex++);
+      }
+    }
+  });
+
+  // Remaining corners reuse the index of their first occurrence
+  pool.parallelFor(numBlocks, [&](std::size_t block) {
+    auto const [begin, end] = blockRange(block);
+    for (auto const corner : iter::range(begin, end)) {
+      if (auto const first{firstCorners[corner]}; first != corner) {
+        indices[corner] = indices[first];
+      }
+    }
+  });
+}
 
-    // Compute handedness of re-orthogonalized basis
-    auto const b{glm::cross(n, t)};
-    auto const handedness{glm::dot(b, bitangents.at(i))};
-    vertex.tangent.w = (handedness < 0.0f) ? -1.0f : 1.0f;
+VertexArrays toVertexArrays(std::span<Vertex const> vertices) {
+  VertexArrays arrays;
+  arrays.resize(vertices.size());
+  for (auto &&[index, vertex] : iter::enumerate(vertices)) {
+    arrays.px[index] = vertex.position.x;
+    arrays.py[index] = vertex.position.y;
+    arrays.pz[index] = vertex.position.z;
+    arrays.nx[index] = vertex.normal.x;
+    arrays.ny[index] = vertex.normal.y;
+    arrays.nz[index] = vertex.normal.z;
+    arrays.s[index] = vertex.texCoord.s;
+    arrays.t[index] = vertex.texCoord.t;
+    arrays.tx[index] = vertex.tangent.x;
+    arrays.ty[index] = vertex.tangent.y;
+    arrays.tz[index] = vertex.tangent.z;
+    arrays.tw[index] = vertex.tangent.w;
   }
+  return arrays;
 }
 
-void Model::createBuffers() {
-  // Delete previous buffers
-  abcg::glDeleteBuffers(1, &m_EBO);
-  abcg::glDeleteBuffers(1, &m_VBO);
-
-  // VBO
-  abcg::glGenBuffers(1, &m_VBO);
-  abcg::glBindBuffer(GL_ARRAY_BUFFER, m_VBO);
-  abcg::glBufferData(GL_ARRAY_BUFFER,
-                     sizeof(m_vertices.at(0)) * m_vertices.size(),
-                     m_vertices.data(), GL_STATIC_DRAW);
-  abcg::glBindBuffer(GL_ARRAY_BUFFER, 0);
-
-  // EBO
-  abcg::glGenBuffers(1, &m_EBO);
-  abcg::glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_EBO);
-  abcg::glBufferData(GL_ELEMENT_ARRAY_BUFFER,
-                     sizeof(m_indices.at(0)) * m_indices.size(),
-                     m_indices.data(), GL_STATIC_DRAW);
-  abcg::glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+void fromVertexArrays(VertexArrays const &arrays, std::span<Vertex> vertices) {
+  for (auto &&[index, vertex] : iter::enumerate(vertices)) {
+    vertex.position = {arrays.px[index], arrays.py[index], arrays.pz[index]};
+    vertex.normal = {arrays.nx[index], arrays.ny[index], arrays.nz[index]};
+    vertex.texCoord = {arrays.s[index], arrays.t[index]};
+    vertex.tangent = {arrays.tx[index], arrays.ty[index], arrays.tz[index],
+                      arrays.tw[index]};
+  }
 }
 
-void Model::loadDiffuseTexture(std::string_view path) {
-  if (!std::filesystem::exists(path))
-    return;
+bool loadCache(MeshData &mesh, abcg::MeshCacheKey const &key) {
+  if (!mesh.cache.load(key)) {
+    return false;
+  }
 
-  abcg::glDeleteTextures(1, &m_diffuseTexture);
-  m_diffuseTexture = abcg::loadOpenGLTexture({.path = path});
-}
+  auto const userData{mesh.cache.getUserData()};
+  if (userData.size() < sizeof(CachedMaterial)) {
+    mesh.cache.close();
+    return false;
+  }
 
-void Model::loadNormalTexture(std::string_view path) {
-  // nota: carrega textura
-  if (!std::filesystem::exists(path))
-    return;
+  CachedMaterial material{};
+  std::memcpy(&material, userData.data(), sizeof(material));
+
+  // Texture names
+  std::string_view const names{
+      reinterpret_cast<char const *>(userData.data()) + sizeof(material),
+      userData.size() - sizeof(material)};
+  auto const separator{names.find('\0')};
+  if (separator == std::string_view::npos || names.back() != '\0') {
+    mesh.cache.close();
+    return false;
+  }
 
-  abcg::glDeleteTextures(1, &m_normalTexture);
-  m_normalTexture = abcg::loadOpenGLTexture({.path = path});
+  mesh.Ka = material.Ka;
+  mesh.Kd = material.Kd;
+  mesh.Ks = material.Ks;
+  mesh.shininess = material.shininess;
+  mesh.hasNormals = material.hasNormals != 0;
+  mesh.hasTexCoords = material.hasTexCoords != 0;
+  mesh.diffuseTexName = names.substr(0, separator);
+  mesh.normalTexName =
+      names.substr(separator + 1, names.size() - separator - 2);
+
+  return true;
 }
 
-void Model::loadObj(std::string_view path, bool standardize) {
-  auto const basePath{std::filesystem::path{path}.parent_path().string() + "/"};
+void saveCache(MeshData const &mesh, abcg::MeshCacheKey const &key,
+               std::span<std::string const> materialPaths) {
+  CachedMaterial const material{.Ka = mesh.Ka,
+                                .Kd = mesh.Kd,
+                                .Ks = mesh.Ks,
+                                .shininess = mesh.shininess,
+                                .hasNormals = mesh.hasNormals ? 1U : 0U,
+                                .hasTexCoords = mesh.hasTexCoords ? 1U : 0U};
+
+  std::vector<std::byte> userData(sizeof(material));
+  std::memcpy(userData.data(), &material, sizeof(material));
+  for (std::string_view const name :
+       {mesh.diffuseTexName, mesh.normalTexName}) {
+    auto const bytes{std::as_bytes(std::span{name})};
+    userData.insert(userData.end(), bytes.begin(), bytes.end());
+    userData.push_back(std::byte{0});
+  }
 
-  tinyobj::ObjReaderConfig readerConfig;
-  readerConfig.mtl_search_path = basePath; // Path to material files
+  // Failing to write the cache (e.g. read-only directory) is not an error
+  // The materials come from the MTL files, so the cache depends on them too
+  abcg::MeshCache::save<Vertex>(key, mesh.vertices, mesh.indices, userData,
+                                materialPaths);
+}
 
-  tinyobj::ObjReader reader;
+// Returns the path of a block-compressed version of the texture, if one was
+// created with tools/texconv
+std::string getPreferredTexturePath(std::string_view path) {
+  auto compressedPath{
+      std::filesystem::path{path}.replace_extension(".ktx2").string()};
+  return std::filesystem::exists(compressedPath) ? compressedPath
+                                                 : std::string{path};
+}
+} // namespace
 
-  if (!reader.ParseFromFile(path.data(), readerConfig)) {
-    if (!reader.Error().empty()) {
-      throw abcg::RuntimeError(
-          fmt::format("Failed to load model {} ({})", path, reader.Error()));
-    }
-    throw abcg::RuntimeError(fmt::format("Failed to load model {}", path));
+std::span<Vertex const> MeshData::getVertices() const {
+  if (cache.isLoaded()) {
+    return cache.getVertices<Vertex>();
   }
+  return vertices;
+}
 
-  if (!reader.Warning().empty()) {
-    fmt::print("Warning: {}\n", reader.Warning());
+std::span<GLuint const> MeshData::getIndices() const {
+  if (cache.isLoaded()) {
+    return cache.getIndices();
   }
+  return indices;
+}
 
-  auto const &attrib{reader.GetAttrib()};
-  auto const &shapes{reader.GetShapes()};
-  auto const &materials{reader.GetMaterials()};
-
-  m_vertices.clear();
-  m_indices.clear();
-
-  m_hasNormals = false;
-  m_hasTexCoords = false;
-
-  // A key:value map with key=Vertex and value=index
-  std::unordered_map<Vertex, GLuint> hash{};
-
-  // Loop over shapes
-  for (auto const &shape : shapes) {
-    // Loop over indices
-    for (auto const offset : iter::range(shape.mesh.indices.size())) {
-      // Access to vertex
-      auto const index{shape.mesh.indices.at(offset)};
-
-      // Position
-      auto const startIndex{3 * index.vertex_index};
-      glm::vec3 position{attrib.vertices.at(startIndex + 0),
-                         attrib.vertices.at(startIndex + 1),
-                         attrib.vertices.at(startIndex + 2)};
-
-      // Normal
-      glm::vec3 normal{};
-      if (index.normal_index >= 0) {
-        m_hasNormals = true;
-        auto const normalStartIndex{3 * index.normal_index};
-        normal = {attrib.normals.at(normalStartIndex + 0),
-                  attrib.normals.at(normalStartIndex + 1),
-                  attrib.normals.at(normalStartIndex + 2)};
-      }
+MeshData loadMeshData(std::string_view path, bool standardize,
+                      abcg::ThreadPool &pool) {
+  MeshData mesh;
+  mesh.basePath = std::filesystem::path{path}.parent_path().string() + "/";
 
-      // Texture coordinates
-      glm::vec2 texCoord{};
-      if (index.texcoord_index >= 0) {
-        m_hasTexCoords = true;
-        auto const texCoordsStartIndex{2 * index.texcoord_index};
-        texCoord = {attrib.texcoords.at(texCoordsStartIndex + 0),
-                    attrib.texcoords.at(texCoordsStartIndex + 1)};
-      }
+  abcg::MeshCacheKey const cacheKey{
+      .sourcePath = path,
+      .vertexSize = sizeof(Vertex),
+      .options = abcg::hashCombine(cacheLayoutVersion, standardize)};
 
-      Vertex const vertex{
-          .position = position, .normal = normal, .texCoord = texCoord};
+  // Skip parsing if a valid binary cache exists next to the OBJ file
+  if (loadCache(mesh, cacheKey)) {
+    return mesh;
+  }
 
-      // If hash doesn't contain this vertex
-      if (!hash.contains(vertex)) {
-        // Add this index (size of m_vertices)
-        hash[vertex] = m_vertices.size();
-        // Add this vertex
-        m_vertices.push_back(vertex);
-      }
+  // Parse and weld vertices using all threads of the pool
+  auto const obj{parseObj(path, pool)};
+  auto const &materials{obj.materials};
 
-      m_indices.push_back(hash[vertex]);
-    }
-  }
+  mesh.hasNormals = std::ranges::any_of(
+      obj.corners, [](ObjIndex const &index) { return index.normal >= 0; });
+  mesh.hasTexCoords = std::ranges::any_of(
+      obj.corners, [](ObjIndex const &index) { return index.texCoord >= 0; });
+
+  weldVertices(obj, pool, mesh.vertices, mesh.indices);
 
   // Use properties of first material, if available
   if (!materials.empty()) {
     auto const &mat{materials.at(0)}; // First material
-    m_Ka = {mat.ambient[0], mat.ambient[1], mat.ambient[2], 1};
-    m_Kd = {mat.diffuse[0], mat.diffuse[1], mat.diffuse[2], 1};
-    m_Ks = {mat.specular[0], mat.specular[1], mat.specular[2], 1};
-    m_shininess = mat.shininess;
-
-    if (!mat.diffuse_texname.empty())
-      loadDiffuseTexture(basePath + mat.diffuse_texname);
-
-    if (!mat.normal_texname.empty()) {
-      loadNormalTexture(basePath + mat.normal_texname);
-    } else if (!mat.bump_texname.empty()) {
-      loadNormalTexture(basePath + mat.bump_texname);
-    }
+    mesh.Ka = {mat.ambient[0], mat.ambient[1], mat.ambient[2], 1};
+    mesh.Kd = {mat.diffuse[0], mat.diffuse[1], mat.diffuse[2], 1};
+    mesh.Ks = {mat.specular[0], mat.specular[1], mat.specular[2], 1};
+    mesh.shininess = mat.shininess;
+
+    mesh.diffuseTexName = mat.diffuse_texname;
+    mesh.normalTexName =
+        mat.normal_texname.empty() ? mat.bump_texname : mat.normal_texname;
   } else {
     // Default values
-    m_Ka = {0.1f, 0.1f, 0.1f, 1.0f};
-    m_Kd = {0.7f, 0.7f, 0.7f, 1.0f};
-    m_Ks = {1.0f, 1.0f, 1.0f, 1.0f};
-    m_shininess = 25.0f;
+    mesh.Ka = {0.1f, 0.1f, 0.1f, 1.0f};
+    mesh.Kd = {0.7f, 0.7f, 0.7f, 1.0f};
+    mesh.Ks = {1.0f, 1.0f, 1.0f, 1.0f};
+    mesh.shininess = 25.0f;
   }
 
+  // Process vertex attributes in a structure-of-arrays layout
+  auto vertices{toVertexArrays(mesh.vertices)};
+
   if (standardize) {
-    Model::standardize();
+    // Center to origin and normalize largest bound to [-1, 1]
+    meshkernels::standardize(vertices);
   }
 
-  if (!m_hasNormals) {
-    computeNormals();
+  if (!mesh.hasNormals) {
+    meshkernels::computeNormals(vertices, mesh.indices);
+    mesh.hasNormals = true;
+  }
+
+  if (mesh.hasTexCoords) {
+    meshkernels::computeTangents(vertices, mesh.indices);
+  }
+
+  fromVertexArrays(vertices, mesh.vertices);
+
+  saveCache(mesh, cacheKey, obj.materialPaths);
+  return mesh;
+}
+
+void Model::loadDiffuseTexture(std::string_view path) {
+  if (!std::filesystem::exists(path))
+    return;
+
+  auto const texturePath{getPreferredTexturePath(path)};
+  deleteTexture(m_diffuseTexture);
+  if (m_textureLoader != nullptr) {
+    m_diffuseTexture = m_textureLoader->loadTexture({.path = texturePath});
+  } else {
+    m_diffuseTexture = abcg::loadOpenGLTexture({.path = texturePath});
+  }
+}
+
+void Model::loadNormalTexture(std::string_view path) {
+  // nota: carrega textura
+  if (!std::filesystem::exists(path))
+    return;
+
+  auto const texturePath{getPreferredTexturePath(path)};
+  deleteTexture(m_normalTexture);
+  if (m_textureLoader != nullptr) {
+    // Flat normal until the texture is loaded
+    m_normalTexture = m_textureLoader->loadTexture({.path = texturePath},
+                                                   {128, 128, 255, 255});
+  } else {
+    m_normalTexture = abcg::loadOpenGLTexture({.path = texturePath});
   }
+}
+
+// Textures are loaded in the background with the given loader, which must be
+// updated every frame
+void Model::setTextureLoader(abcg::OpenGLTextureLoader &loader) {
+  m_textureLoader = &loader;
+}
 
-  if (m_hasTexCoords) {
-    computeTangents();
+void Model::deleteTexture(GLuint &texture) {
+  if (m_textureLoader != nullptr) {
+    m_textureLoader->cancel(texture);
   }
+  abcg::glDeleteTextures(1, &texture);
+  texture = 0;
+}
+
+// Takes ownership of buffers already filled with the vertices and indices of
+// the mesh (see ModelLoader)
+void Model::setMesh(MeshData const &mesh, GLuint VBO, GLuint EBO) {
+  abcg::glDeleteBuffers(1, &m_EBO);
+  abcg::glDeleteBuffers(1, &m_VBO);
+  m_VBO = VBO;
+  m_EBO = EBO;
+  m_numIndices = gsl::narrow<GLsizei>(mesh.getIndices().size());
 
-  createBuffers();
+  setMaterial(mesh);
+}
+
+void Model::setMaterial(MeshData const &mesh) {
+  m_Ka = mesh.Ka;
+  m_Kd = mesh.Kd;
+  m_Ks = mesh.Ks;
+  m_shininess = mesh.shininess;
+  m_hasTexCoords = mesh.hasTexCoords;
+
+  if (!mesh.diffuseTexName.empty())
+    loadDiffuseTexture(mesh.basePath + mesh.diffuseTexName);
+
+  if (!mesh.normalTexName.empty())
+    loadNormalTexture(mesh.basePath + mesh.normalTexName);
 }
 
 void Model::render(int numTriangles) const {
+  // Nothing to render until a mesh is set
+  if (m_VAO == 0)
+    return;
+
   abcg::glBindVertexArray(m_VAO);
 
   abcg::glActiveTexture(GL_TEXTURE0);
@@ -281,7 +408,7 @@ void Model::render(int numTriangles) const {
   abcg::glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
   abcg::glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
 
-  auto const numIndices{(numTriangles < 0) ? m_indices.size()
+  auto const numIndices{(numTriangles < 0) ? m_numIndices
                                            : numTriangles * 3};
 
   abcg::glDrawElements(GL_TRIANGLES, numIndices, GL_UNSIGNED_INT, nullptr);
@@ -289,7 +416,7 @@ void Model::render(int numTriangles) const {
   abcg::glBindVertexArray(0);
 }
 
-void Model::setupVAO(GLuint program) {
+void Model::setupVAO(abcg::OpenGLProgram const &program) {
   // Release previous VAO
   abcg::glDeleteVertexArrays(1, &m_VAO);
 
@@ -302,15 +429,14 @@ void Model::setupVAO(GLuint program) {
   abcg::glBindBuffer(GL_ARRAY_BUFFER, m_VBO);
 
   // Bind vertex attributes
-  auto const positionAttribute{
-      abcg::glGetAttribLocation(program, "inPosition")};
+  auto const positionAttribute{program.getAttribLocation("inPosition")};
   if (positionAttribute >= 0) {
     abcg::glEnableVertexAttribArray(positionAttribute);
     abcg::glVertexAttribPointer(positionAttribute, 3, GL_FLOAT, GL_FALSE,
                                 sizeof(Vertex), nullptr);
   }
 
-  auto const normalAttribute{abcg::glGetAttribLocation(program, "inNormal")};
+  auto const normalAttribute{program.getAttribLocation("inNormal")};
   if (normalAttribute >= 0) {
     abcg::glEnableVertexAttribArray(normalAttribute);
     auto const offset{offsetof(Vertex, normal)};
@@ -319,8 +445,7 @@ void Model::setupVAO(GLuint program) {
                                 reinterpret_cast<void *>(offset));
   }
 
-  auto const texCoordAttribute{
-      abcg::glGetAttribLocation(program, "inTexCoord")};
+  auto const texCoordAttribute{program.getAttribLocation("inTexCoord")};
   if (texCoordAttribute >= 0) {
     abcg::glEnableVertexAttribArray(texCoordAttribute);
     auto const offset{offsetof(Vertex, texCoord)};
@@ -329,8 +454,7 @@ void Model::setupVAO(GLuint program) {
                                 reinterpret_cast<void *>(offset));
   }
 
-  auto const tangentCoordAttribute{
-      abcg::glGetAttribLocation(program, "inTangent")};
+  auto const tangentCoordAttribute{program.getAttribLocation("inTangent")};
   if (tangentCoordAttribute >= 0) {
     abcg::glEnableVertexAttribArray(tangentCoordAttribute);
     auto const offset{offsetof(Vertex, tangent)};
@@ -344,28 +468,9 @@ void Model::setupVAO(GLuint program) {
   abcg::glBindVertexArray(0);
 }
 
-void Model::standardize() {
-  // Center to origin and normalize largest bound to [-1, 1]
-
-  // Get bounds
-  glm::vec3 max(std::numeric_limits<float>::lowest());
-  glm::vec3 min(std::numeric_limits<float>::max());
-  for (auto const &vertex : m_vertices) {
-    max = glm::max(max, vertex.position);
-    min = glm::min(min, vertex.position);
-  }
-
-  // Center and scale
-  auto const center{(min + max) / 2.0f};
-  auto const scaling{2.0f / glm::length(max - min)};
-  for (auto &vertex : m_vertices) {
-    vertex.position = (vertex.position - center) * scaling;
-  }
-}
-
 void Model::destroy() {
-  abcg::glDeleteTextures(1, &m_normalTexture);
-  abcg::glDeleteTextures(1, &m_diffuseTexture);
+  deleteTexture(m_normalTexture);
+  deleteTexture(m_diffuseTexture);
   abcg::glDeleteBuffers(1, &m_EBO);
   abcg::glDeleteBuffers(1, &m_VBO);
   abcg::glDeleteVertexArrays(1, &m_VAO);
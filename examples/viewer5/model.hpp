@@ -3,6 +3,9 @@
 
 #include "abcgOpenGL.hpp"
 
+#include "meshkernels.hpp"
+#include "objparser.hpp"
+
 struct Vertex {
   glm::vec3 position{};
   glm::vec3 normal{};
@@ -12,18 +15,41 @@ struct Vertex {
   friend bool operator==(Vertex const &, Vertex const &) = default;
 };
 
+// Geometry and material of a model, loaded without touching OpenGL so that it
+// can be produced by a worker thread
+struct MeshData {
+  std::vector<Vertex> vertices;
+  std::vector<GLuint> indices;
+  // Mapped cache file. When loaded, vertices and indices are read from it.
+  abcg::MeshCache cache;
+
+  glm::vec4 Ka{};
+  glm::vec4 Kd{};
+  glm::vec4 Ks{};
+  float shininess{};
+  bool hasNormals{false};
+  bool hasTexCoords{false};
+
+  // Directory of the OBJ file, ending with a slash
+  std::string basePath;
+  std::string diffuseTexName;
+  std::string normalTexName;
+
+  [[nodiscard]] std::span<Vertex const> getVertices() const;
+  [[nodiscard]] std::span<GLuint const> getIndices() const;
+};
+
 class Model {
 public:
   void loadDiffuseTexture(std::string_view path);
   void loadNormalTexture(std::string_view path);
-  void loadObj(std::string_view path, bool standardize = true);
+  void setMesh(MeshData const &mesh, GLuint VBO, GLuint EBO);
+  void setTextureLoader(abcg::OpenGLTextureLoader &loader);
   void render(int numTriangles = -1) const;
-  void setupVAO(GLuint program);
+  void setupVAO(abcg::OpenGLProgram const &program);
   void destroy();
 
-  [[nodiscard]] int getNumTriangles() const {
-    return gsl::narrow<int>(m_indices.size()) / 3;
-  }
+  [[nodiscard]] int getNumTriangles() const { return m_numIndices / 3; }
 
   [[nodiscard]] glm::vec4 getKa() const { return m_Ka; }
   [[nodiscard]] glm::vec4 getKd() const { return m_Kd; }
@@ -43,17 +69,20 @@ private:
   float m_shininess{};
   GLuint m_diffuseTexture{};
   GLuint m_normalTexture{};
+  abcg::OpenGLTextureLoader *m_textureLoader{};
 
-  std::vector<Vertex> m_vertices;
-  std::vector<GLuint> m_indices;
+  // Number of indices uploaded to the EBO
+  GLsizei m_numIndices{};
 
-  bool m_hasNormals{false};
   bool m_hasTexCoords{false};
 
-  void computeNormals();
-  void computeTangents();
-  void createBuffers();
-  void standardize();
+  void deleteTexture(GLuint &texture);
+  void setMaterial(MeshData const &mesh);
 };
 
+// Loads the mesh and material of an OBJ file without OpenGL calls, so it is
+// safe to call from any thread (see ModelLoader)
+[[nodiscard]] MeshData loadMeshData(std::string_view path, bool standardize,
+                                    abcg::ThreadPool &pool);
+
 #endif
\ No newline at end of file
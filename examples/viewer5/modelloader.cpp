@@ -0,0 +1,176 @@
+#include "modelloader.hpp"
+
+#include <chrono>
+
+// Starts loading a model on the worker thread. If a model is still being
+// processed, it is discarded when done and this one is loaded next.
+void ModelLoader::load(std::string_view path, bool standardize) {
+  if (m_state == State::Processing) {
+    m_pendingLoad.emplace(path, standardize);
+    return;
+  }
+
+  // Discard a model being uploaded
+  deleteBuffers();
+  m_mesh.reset();
+
+  m_future = m_worker.submit([this, path = std::string{path}, standardize] {
+    return loadMeshData(path, standardize, m_pool);
+  });
+  m_state = State::Processing;
+}
+
+// Advances the loading of the current model. Must be called once per frame
+// from the thread that owns the OpenGL context. Returns true when the model is
+// ready to be handed over with transferTo().
+bool ModelLoader::update() {
+  if (m_state == State::Processing) {
+    if (m_future.wait_for(std::chrono::seconds{0}) !=
+        std::future_status::ready) {
+      return false;
+    }
+
+    m_state = State::Idle;
+
+    // A superseded model is discarded without being retrieved, so an error
+    // raised while processing it does not cancel the pending load
+    if (m_pendingLoad) {
+      auto const [path, standardize]{
+          *std::exchange(m_pendingLoad, std::nullopt)};
+      load(path, standardize);
+      return false;
+    }
+
+    // Rethrows any exception thrown by the worker
+    m_mesh = m_future.get();
+    createBuffers();
+    m_state = State::Uploading;
+  }
+
+  if (m_state == State::Uploading) {
+    auto const vertexBytes{std::as_bytes(m_mesh->getVertices())};
+    auto const indexBytes{std::as_bytes(m_mesh->getIndices())};
+
+    auto const vertexSize{std::min(
+        vertexBytes.size() - m_uploadedVertexBytes, m_uploadBudget)};
+    auto const indexSize{std::min(indexBytes.size() - m_uploadedIndexBytes,
+                                  m_uploadBudget - vertexSize)};
+
+    if (vertexSize + indexSize > 0) {
+      // Orphan the storage of the staging buffer, so that writing to it does
+      // not wait for the copies issued in the previous frame. The vertex and
+      // index slices share the new storage.
+      abcg::glBindBuffer(GL_COPY_READ_BUFFER, m_stagingBuffer);
+      abcg::glBufferData(GL_COPY_READ_BUFFER,
+                         gsl::narrow<GLsizeiptr>(vertexSize + indexSize),
+                         nullptr, GL_STREAM_DRAW);
+      uploadSlice(vertexBytes, m_VBO, m_uploadedVertexBytes, vertexSize, 0);
+      uploadSlice(indexBytes, m_EBO, m_uploadedIndexBytes, indexSize,
+                  vertexSize);
+      abcg::glBindBuffer(GL_COPY_READ_BUFFER, 0);
+    }
+
+    if (m_uploadedVertexBytes == vertexBytes.size() &&
+        m_uploadedIndexBytes == indexBytes.size()) {
+      m_state = State::Ready;
+    }
+  }
+
+  return m_state == State::Ready;
+}
+
+// Hands the loaded buffers and material over to a model. The model takes
+// ownership of the buffers.
+void ModelLoader::transferTo(Model &model) {
+  if (m_state != State::Ready) {
+    return;
+  }
+
+  model.setMesh(*m_mesh, m_VBO, m_EBO);
+  m_VBO = 0;
+  m_EBO = 0;
+  m_mesh.reset();
+  m_state = State::Idle;
+}
+
+void ModelLoader::destroy() {
+  deleteBuffers();
+  abcg::glDeleteBuffers(1, &m_stagingBuffer);
+  m_stagingBuffer = 0;
+  m_mesh.reset();
+  m_pendingLoad.reset();
+  m_state = State::Idle;
+}
+
+// Returns the fraction of bytes already uploaded
+float ModelLoader::getProgress() const {
+  if (m_state == State::Ready) {
+    return 1.0f;
+  }
+  if (m_state != State::Uploading) {
+    return 0.0f;
+  }
+
+  auto const totalBytes{m_mesh->getVertices().size_bytes() +
+                        m_mesh->getIndices().size_bytes()};
+  if (totalBytes == 0) {
+    return 1.0f;
+  }
+  return gsl::narrow_cast<float>(m_uploadedVertexBytes + m_uploadedIndexBytes) /
+         gsl::narrow_cast<float>(totalBytes);
+}
+
+void ModelLoader::createBuffers() {
+  deleteBuffers();
+
+  // Allocate storage without data. Data is copied later from the staging
+  // buffer.
+  auto const allocate{[](GLuint &buffer, std::size_t size) {
+    abcg::glGenBuffers(1, &buffer);
+    abcg::glBindBuffer(GL_COPY_WRITE_BUFFER, buffer);
+    abcg::glBufferData(GL_COPY_WRITE_BUFFER, gsl::narrow<GLsizeiptr>(size),
+                       nullptr, GL_STATIC_DRAW);
+  }};
+  allocate(m_VBO, m_mesh->getVertices().size_bytes());
+  allocate(m_EBO, m_mesh->getIndices().size_bytes());
+  abcg::glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+
+  if (m_stagingBuffer == 0) {
+    abcg::glGenBuffers(1, &m_stagingBuffer);
+  }
+
+  m_uploadedVertexBytes = 0;
+  m_uploadedIndexBytes = 0;
+}
+
+void ModelLoader::deleteBuffers() {
+  abcg::glDeleteBuffers(1, &m_EBO);
+  abcg::glDeleteBuffers(1, &m_VBO);
+  m_EBO = 0;
+  m_VBO = 0;
+}
+
+// Copies size bytes of data, starting at offset, to the buffer through the
+// staging buffer bound to GL_COPY_READ_BUFFER, at stagingOffset
+void ModelLoader::uploadSlice(std::span<std::byte const> data, GLuint buffer,
+                              std::size_t &offset, std::size_t size,
+                              std::size_t stagingOffset) {
+  if (size == 0) {
+    return;
+  }
+
+  abcg::glBufferSubData(GL_COPY_READ_BUFFER,
+                        gsl::narrow<GLintptr>(stagingOffset),
+                        gsl::narrow<GLsizeiptr>(size),
+                        data.subspan(offset, size).data());
+
+  // Copy on the GPU to the final buffer
+  abcg::glBindBuffer(GL_COPY_WRITE_BUFFER, buffer);
+  abcg::glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER,
+                            gsl::narrow<GLintptr>(stagingOffset),
+                            gsl::narrow<GLintptr>(offset),
+                            gsl::narrow<GLsizeiptr>(size));
+  abcg::glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+
+  offset += size;
+}
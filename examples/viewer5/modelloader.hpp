@@ -0,0 +1,60 @@
+#ifndef MODELLOADER_HPP_
+#define MODELLOADER_HPP_
+
+#include <future>
+#include <optional>
+
+#include "model.hpp"
+
+// Loads models in the background without stalling the rendering thread.
+//
+// Parsing, welding and tangent generation run on a worker thread. The
+// resulting vertices and indices are then uploaded by the rendering thread in
+// slices of bounded size, one slice per call to update() (i.e. per frame). The
+// current model can be rendered until the new one is handed over by
+// transferTo().
+class ModelLoader {
+public:
+  void load(std::string_view path, bool standardize = true);
+  [[nodiscard]] bool update();
+  void transferTo(Model &model);
+  void destroy();
+
+  [[nodiscard]] bool isLoading() const { return m_state != State::Idle; }
+  [[nodiscard]] float getProgress() const;
+
+private:
+  enum class State { Idle, Processing, Uploading, Ready };
+
+  // Maximum number of bytes uploaded per frame
+  static constexpr std::size_t m_uploadBudget{16 << 20};
+
+  // Threads used for parsing and welding
+  abcg::ThreadPool m_pool;
+#if defined(__EMSCRIPTEN__) && !defined(__EMSCRIPTEN_PTHREADS__)
+  // Without threads, models are loaded synchronously
+  abcg::ThreadPool m_worker{0};
+#else
+  abcg::ThreadPool m_worker{1};
+#endif
+
+  State m_state{State::Idle};
+  std::future<MeshData> m_future;
+  std::optional<MeshData> m_mesh;
+  // Load requested while another model is being processed
+  std::optional<std::pair<std::string, bool>> m_pendingLoad;
+
+  GLuint m_stagingBuffer{};
+  GLuint m_VBO{};
+  GLuint m_EBO{};
+  std::size_t m_uploadedVertexBytes{};
+  std::size_t m_uploadedIndexBytes{};
+
+  void createBuffers();
+  void deleteBuffers();
+  void uploadSlice(std::span<std::byte const> data, GLuint buffer,
+                   std::size_t &offset, std::size_t size,
+                   std::size_t stagingOffset);
+};
+
+#endif
@@ -0,0 +1,348 @@
+#include "objparser.hpp"
+
+#include <charconv>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+
+namespace {
+// Minimum size of a chunk, so that small files are parsed by a single task
+constexpr std::size_t minChunkSize{1 << 20};
+
+// Bits of ObjIndex components that are relative to the current vertex count
+enum RelativeBits {
+  relativePosition = 1,
+  relativeNormal = 2,
+  relativeTexCoord = 4
+};
+
+struct Chunk {
+  std::string_view text;
+
+  std::vector<glm::vec3> positions{};
+  std::vector<glm::vec3> normals{};
+  std::vector<glm::vec2> texCoords{};
+  std::vector<ObjIndex> corners{};
+  // Corners with negative indices (offset into corners, RelativeBits)
+  std::vector<std::pair<std::size_t, int>> relativeCorners{};
+  // File names of each mtllib statement
+  std::vector<std::vector<std::string>> materialLibraries{};
+};
+
+bool isSpace(char character) { return character == ' ' || character == '\t'; }
+
+void skipSpaces(char const *&ptr, char const *end) {
+  while (ptr != end && isSpace(*ptr))
+    ++ptr;
+}
+
+void skipToken(char const *&ptr, char const *end) {
+  while (ptr != end && !isSpace(*ptr))
+    ++ptr;
+}
+
+float parseFloat(char const *&ptr, char const *end) {
+  skipSpaces(ptr, end);
+  if (ptr != end && *ptr == '+')
+    ++ptr;
+
+  float value{};
+#if defined(__cpp_lib_to_chars)
+  auto const result{std::from_chars(ptr, end, value)};
+  if (result.ec == std::errc::invalid_argument) {
+    skipToken(ptr, end);
+  } else {
+    ptr = result.ptr;
+  }
+#else
+  // std::strtof requires a null-terminated string
+  std::array<char, 64> buffer{};
+  auto const *const tokenBegin{ptr};
+  skipToken(ptr, end);
+  auto const length{
+      std::min(static_cast<std::size_t>(ptr - tokenBegin), buffer.size() - 1)};
+  std::memcpy(buffer.data(), tokenBegin, length);
+  value = std::strtof(buffer.data(), nullptr);
+#endif
+  return value;
+}
+
+// Returns 0 if there is no integer at ptr
+int parseInt(char const *&ptr, char const *end) {
+  if (ptr != end && *ptr == '+')
+    ++ptr;
+
+  int value{};
+  auto const result{std::from_chars(ptr, end, value)};
+  ptr = result.ptr;
+  return result.ec == std::errc{} ? value : 0;
+}
+
+// Converts a one-based or negative OBJ index into a zero-based index. Negative
+// indices are relative to the attributes read so far, so they are stored
+// relative to the start of the chunk and fixed up after all chunks are parsed.
+int toChunkIndex(int index, std::size_t count, int relativeBit,
+                 int &relativeBits) {
+  if (index > 0) {
+    return index - 1;
+  }
+  if (index < 0) {
+    relativeBits |= relativeBit;
+    return gsl::narrow<int>(count) + index;
+  }
+  throw abcg::RuntimeError("Invalid zero index in face");
+}
+
+void parseFace(char const *ptr, char const *end, Chunk &chunk) {
+  thread_local std::vector<ObjIndex> face;
+  thread_local std::vector<int> faceRelativeBits;
+  face.clear();
+  faceRelativeBits.clear();
+
+  while (true) {
+    skipSpaces(ptr, end);
+    if (ptr == end)
+      break;
+
+    ObjIndex index{};
+    int relativeBits{};
+
+    index.position =
+        toChunkIndex(parseInt(ptr, end), chunk.positions.size(),
+                     relativePosition, relativeBits);
+    if (ptr != end && *ptr == '/') {
+      ++ptr;
+      if (ptr != end && *ptr != '/') {
+        index.texCoord =
+            toChunkIndex(parseInt(ptr, end), chunk.texCoords.size(),
+                         relativeTexCoord, relativeBits);
+      }
+      if (ptr != end && *ptr == '/') {
+        ++ptr;
+        index.normal = toChunkIndex(parseInt(ptr, end), chunk.normals.size(),
+                                    relativeNormal, relativeBits);
+      }
+    }
+    skipToken(ptr, end);
+
+    face.push_back(index);
+    faceRelativeBits.push_back(relativeBits);
+  }
+
+  // Triangulate as a fan. For convex polygons, this gives the same triangles
+  // as the ear clipping used by tinyobjloader.
+  for (std::size_t k{2}; k < face.size(); ++k) {
+    for (auto const corner : {std::size_t{0}, k - 1, k}) {
+      if (faceRelativeBits[corner] != 0) {
+        chunk.relativeCorners.emplace_back(chunk.corners.size(),
+                                           faceRelativeBits[corner]);
+      }
+      chunk.corners.push_back(face[corner]);
+    }
+  }
+}
+
+void parseLine(char const *ptr, char const *end, Chunk &chunk) {
+  skipSpaces(ptr, end);
+  if (ptr == end || *ptr == '#')
+    return;
+
+  auto const *const keywordBegin{ptr};
+  skipToken(ptr, end);
+  std::string_view const keyword{keywordBegin,
+                                 static_cast<std::size_t>(ptr - keywordBegin)};
+
+  if (keyword == "v") {
+    auto const x{parseFloat(ptr, end)};
+    auto const y{parseFloat(ptr, end)};
+    auto const z{parseFloat(ptr, end)};
+    chunk.positions.emplace_back(x, y, z);
+  } else if (keyword == "vn") {
+    auto const x{parseFloat(ptr, end)};
+    auto const y{parseFloat(ptr, end)};
+    auto const z{parseFloat(ptr, end)};
+    chunk.normals.emplace_back(x, y, z);
+  } else if (keyword == "vt") {
+    auto const u{parseFloat(ptr, end)};
+    auto const v{parseFloat(ptr, end)};
+    chunk.texCoords.emplace_back(u, v);
+  } else if (keyword == "f") {
+    parseFace(ptr, end, chunk);
+  } else if (keyword == "mtllib") {
+    std::vector<std::string> fileNames;
+    while (true) {
+      skipSpaces(ptr, end);
+      if (ptr == end)
+        break;
+      auto const *const nameBegin{ptr};
+      skipToken(ptr, end);
+      fileNames.emplace_back(nameBegin, ptr);
+    }
+    chunk.materialLibraries.push_back(std::move(fileNames));
+  }
+}
+
+void parseChunk(Chunk &chunk) {
+  auto const *ptr{chunk.text.data()};
+  auto const *const end{ptr + chunk.text.size()};
+
+  while (ptr < end) {
+    auto const *lineEnd{static_cast<char const *>(
+        std::memchr(ptr, '\n', static_cast<std::size_t>(end - ptr)))};
+    if (lineEnd == nullptr)
+      lineEnd = end;
+
+    auto const *contentEnd{lineEnd};
+    if (contentEnd != ptr && *(contentEnd - 1) == '\r')
+      --contentEnd;
+
+    parseLine(ptr, contentEnd, chunk);
+    ptr = lineEnd + 1;
+  }
+}
+
+// Splits text into chunks that begin at the start of a line
+std::vector<Chunk> splitIntoChunks(std::string_view text,
+                                   std::size_t maxChunks) {
+  auto const numChunks{
+      std::clamp(text.size() / minChunkSize, std::size_t{1}, maxChunks)};
+
+  std::vector<Chunk> chunks;
+  chunks.reserve(numChunks);
+
+  std::size_t begin{};
+  for (auto const index : iter::range(std::size_t{1}, numChunks + 1)) {
+    auto end{text.size()};
+    if (index < numChunks) {
+      end = std::max(begin, index * text.size() / numChunks);
+      end = text.find('\n', end);
+      end = (end == std::string_view::npos) ? text.size() : end + 1;
+    }
+    if (end > begin) {
+      chunks.push_back({.text = text.substr(begin, end - begin)});
+    }
+    begin = end;
+  }
+  return chunks;
+}
+
+// Loads the materials of all mtllib statements into data
+void loadMaterials(std::vector<Chunk> const &chunks, std::string_view basePath,
+                   ObjData &data) {
+  auto &materials{data.materials};
+  std::map<std::string, int> materialMap;
+
+  for (auto const &chunk : chunks) {
+    for (auto const &fileNames : chunk.materialLibraries) {
+      // Use the first file that can be opened
+      auto const found{std::ranges::any_of(fileNames, [&](auto const &name) {
+        auto path{fmt::format("{}{}", basePath, name)};
+        std::ifstream stream{path};
+        if (!stream)
+          return false;
+
+        std::string warning;
+        std::string error;
+        tinyobj::LoadMtl(&materialMap, &materials, &stream, &warning, &error);
+        if (!warning.empty()) {
+          fmt::print("Warning: {}\n", warning);
+        }
+        data.materialPaths.push_back(std::move(path));
+        return true;
+      })};
+      if (!found && !fileNames.empty()) {
+        fmt::print("Warning: Material file {} not found\n", fileNames.front());
+      }
+    }
+  }
+}
+} // namespace
+
+ObjData parseObj(std::string_view path, abcg::ThreadPool &pool) {
+  abcg::MappedFile const file{path};
+  if (!file.isOpen()) {
+    throw abcg::RuntimeError(fmt::format("Failed to load model {}", path));
+  }
+
+  auto const bytes{file.getData()};
+  std::string_view const text{reinterpret_cast<char const *>(bytes.data()),
+                              bytes.size()};
+
+  // Parse chunks in parallel
+  auto chunks{splitIntoChunks(text, (pool.getThreadCount() + 1) * 4)};
+  pool.parallelFor(chunks.size(),
+                   [&](std::size_t index) { parseChunk(chunks[index]); });
+
+  // Offsets of each chunk in the concatenated arrays
+  struct Offsets {
+    std::size_t positions{};
+    std::size_t normals{};
+    std::size_t texCoords{};
+    std::size_t corners{};
+  };
+  std::vector<Offsets> offsets(chunks.size() + 1);
+  for (auto &&[index, chunk] : iter::enumerate(chunks)) {
+    auto const &offset{offsets[index]};
+    offsets[index + 1] = {
+        .positions = offset.positions + chunk.positions.size(),
+        .normals = offset.normals + chunk.normals.size(),
+        .texCoords = offset.texCoords + chunk.texCoords.size(),
+        .corners = offset.corners + chunk.corners.size()};
+  }
+
+  auto const &total{offsets.back()};
+  ObjData data;
+  data.positions.resize(total.positions);
+  data.normals.resize(total.normals);
+  data.texCoords.resize(total.texCoords);
+  data.corners.resize(total.corners);
+
+  // Concatenate chunks in file order, resolving relative indices
+  pool.parallelFor(chunks.size(), [&](std::size_t index) {
+    auto &chunk{chunks[index]};
+    auto const &offset{offsets[index]};
+
+    std::ranges::copy(chunk.positions,
+                      std::next(data.positions.begin(),
+                                gsl::narrow<std::ptrdiff_t>(offset.positions)));
+    std::ranges::copy(chunk.normals,
+                      std::next(data.normals.begin(),
+                                gsl::narrow<std::ptrdiff_t>(offset.normals)));
+    std::ranges::copy(chunk.texCoords,
+                      std::next(data.texCoords.begin(),
+                                gsl::narrow<std::ptrdiff_t>(offset.texCoords)));
+
+    for (auto const &[cornerIndex, relativeBits] : chunk.relativeCorners) {
+      auto &corner{chunk.corners[cornerIndex]};
+      if ((relativeBits & relativePosition) != 0)
+        corner.position += gsl::narrow<int>(offset.positions);
+      if ((relativeBits & relativeNormal) != 0)
+        corner.normal += gsl::narrow<int>(offset.normals);
+      if ((relativeBits & relativeTexCoord) != 0)
+        corner.texCoord += gsl::narrow<int>(offset.texCoords);
+    }
+
+    auto const isValid{[](int value, std::size_t count, bool optional) {
+      return (optional && value == -1) ||
+             (value >= 0 && static_cast<std::size_t>(value) < count);
+    }};
+    for (auto const &corner : chunk.corners) {
+      if (!isValid(corner.position, total.positions, false) ||
+          !isValid(corner.normal, total.normals, true) ||
+          !isValid(corner.texCoord, total.texCoords, true)) {
+        throw abcg::RuntimeError(
+            fmt::format("Failed to load model {} (index out of range)", path));
+      }
+    }
+
+    std::ranges::copy(chunk.corners,
+                      std::next(data.corners.begin(),
+                                gsl::narrow<std::ptrdiff_t>(offset.corners)));
+  });
+
+  auto const basePath{std::filesystem::path{path}.parent_path().string() + "/"};
+  loadMaterials(chunks, basePath, data);
+
+  return data;
+}
@@ -0,0 +1,28 @@
+#ifndef OBJPARSER_HPP_
+#define OBJPARSER_HPP_
+
+#include "abcgOpenGL.hpp"
+
+// Zero-based attribute indices of a face corner (-1 if absent)
+struct ObjIndex {
+  int position{-1};
+  int normal{-1};
+  int texCoord{-1};
+};
+
+struct ObjData {
+  std::vector<glm::vec3> positions;
+  std::vector<glm::vec3> normals;
+  std::vector<glm::vec2> texCoords;
+  // Triangulated faces, three corners per triangle, in file order
+  std::vector<ObjIndex> corners;
+  std::vector<tinyobj::material_t> materials;
+  // Paths of the material files that were loaded
+  std::vector<std::string> materialPaths;
+};
+
+// Parses a Wavefront OBJ file in line-aligned chunks on a thread pool. The
+// result does not depend on the number of threads of the pool.
+ObjData parseObj(std::string_view path, abcg::ThreadPool &pool);
+
+#endif
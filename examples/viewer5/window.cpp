@@ -38,32 +38,46 @@ void Window::onCreate() {
   abcg::glClearColor(0, 0, 0, 1);
   abcg::glEnable(GL_DEPTH_TEST);
 
-  // Create programs
-  for (auto const &name : m_shaderNames) {
+  // Build programs in the background. Nothing is rendered until the current
+  // program is ready.
+  m_programs.resize(m_shaderNames.size());
+  for (auto &&[index, name] : iter::enumerate(m_shaderNames)) {
     auto const path{assetsPath + "shaders/" + name};
-    auto const program{abcg::createOpenGLProgram(
+    getProgramBuilder().build(
         {{.source = path + ".vert", .stage = abcg::ShaderStage::Vertex},
-         {.source = path + ".frag", .stage = abcg::ShaderStage::Fragment}})};
-    m_programs.push_back(program);
+         {.source = path + ".frag", .stage = abcg::ShaderStage::Fragment}},
+        [this, index = gsl::narrow<int>(index)](GLuint program) {
+          m_programs.at(index).create(program);
+          // Set up VAO if a model was loaded and this is the program in use
+          if (index == m_currentProgramIndex && m_model.getNumTriangles() > 0) {
+            m_model.setupVAO(m_programs.at(index));
+          }
+        });
   }
 
+  // Load textures in the background
+  m_model.setTextureLoader(m_textureLoader);
+
   // Load default model
   loadModel(assetsPath + "roman_lamp.obj");
-  m_mappingMode = 3; // "From mesh" option
 
   // Initial trackball spin
   m_trackBallModel.setAxis(glm::normalize(glm::vec3(1, 1, 1)));
   m_trackBallModel.setVelocity(0.1f);
 }
 
-void Window::loadModel(std::string_view path) {
+// The model is loaded in the background. The current model is rendered until
+// the new one is swapped in by swapModel.
+void Window::loadModel(std::string_view path) { m_modelLoader.load(path); }
+
+void Window::swapModel() {
   auto const assetsPath{abcg::Application::getAssetsPath()};
 
   m_model.destroy();
 
   m_model.loadDiffuseTexture(assetsPath + "maps/pattern.png");
   m_model.loadNormalTexture(assetsPath + "maps/pattern_normal.png");
-  m_model.loadObj(path);
+  m_modelLoader.transferTo(m_model);
   m_model.setupVAO(m_programs.at(m_currentProgramIndex));
   m_trianglesToDraw = m_model.getNumTriangles();
 
@@ -72,6 +86,14 @@ void Window::loadModel(std::string_view path) {
   m_Kd = m_model.getKd();
   m_Ks = m_model.getKs();
   m_shininess = m_model.getShininess();
+
+  if (m_model.isUVMapped()) {
+    // Use mesh texture coordinates if available...
+    m_mappingMode = 3;
+  } else {
+    // ...or triplanar mapping otherwise
+    m_mappingMode = 0;
+  }
 }
 
 void Window::onPaint() {
@@ -79,53 +101,38 @@ void Window::onPaint() {
 
   abcg::glViewport(0, 0, m_viewportSize.x, m_viewportSize.y);
 
-  // Use currently selected program
-  auto const program{m_programs.at(m_currentProgramIndex)};
-  abcg::glUseProgram(program);
-
-  // Get location of uniform variables
-  auto const viewMatrixLoc{abcg::glGetUniformLocation(program, "viewMatrix")};
-  auto const projMatrixLoc{abcg::glGetUniformLocation(program, "projMatrix")};
-  auto const modelMatrixLoc{abcg::glGetUniformLocation(program, "modelMatrix")};
-  auto const normalMatrixLoc{
-      abcg::glGetUniformLocation(program, "normalMatrix")};
-  auto const lightDirLoc{
-      abcg::glGetUniformLocation(program, "lightDirWorldSpace")};
-  auto const shininessLoc{abcg::glGetUniformLocation(program, "shininess")};
-  auto const IaLoc{abcg::glGetUniformLocation(program, "Ia")};
-  auto const IdLoc{abcg::glGetUniformLocation(program, "Id")};
-  auto const IsLoc{abcg::glGetUniformLocation(program, "Is")};
-  auto const KaLoc{abcg::glGetUniformLocation(program, "Ka")};
-  auto const KdLoc{abcg::glGetUniformLocation(program, "Kd")};
-  auto const KsLoc{abcg::glGetUniformLocation(program, "Ks")};
-  auto const diffuseTexLoc{abcg::glGetUniformLocation(program, "diffuseTex")};
-  auto const normalTexLoc{abcg::glGetUniformLocation(program, "normalTex")};
-  auto const mappingModeLoc{abcg::glGetUniformLocation(program, "mappingMode")};
+  // Use currently selected program. Uniform locations were cached when the
+  // program was created.
+  auto const &program{m_programs.at(m_currentProgramIndex)};
+  if (static_cast<GLuint>(program) == 0) {
+    return;
+  }
+  program.use();
 
   // Set uniform variables that have the same value for every model
-  abcg::glUniformMatrix4fv(viewMatrixLoc, 1, GL_FALSE, &m_viewMatrix[0][0]);
-  abcg::glUniformMatrix4fv(projMatrixLoc, 1, GL_FALSE, &m_projMatrix[0][0]);
-  abcg::glUniform1i(diffuseTexLoc, 0);
-  abcg::glUniform1i(normalTexLoc, 1);
-  abcg::glUniform1i(mappingModeLoc, m_mappingMode);
+  program.setUniform("viewMatrix", m_viewMatrix);
+  program.setUniform("projMatrix", m_projMatrix);
+  program.setUniform("diffuseTex", 0);
+  program.setUniform("normalTex", 1);
+  program.setUniform("mappingMode", m_mappingMode);
 
   auto const lightDirRotated{m_trackBallLight.getRotation() * m_lightDir};
-  abcg::glUniform4fv(lightDirLoc, 1, &lightDirRotated.x);
-  abcg::glUniform4fv(IaLoc, 1, &m_Ia.x);
-  abcg::glUniform4fv(IdLoc, 1, &m_Id.x);
-  abcg::glUniform4fv(IsLoc, 1, &m_Is.x);
+  program.setUniform("lightDirWorldSpace", lightDirRotated);
+  program.setUniform("Ia", m_Ia);
+  program.setUniform("Id", m_Id);
+  program.setUniform("Is", m_Is);
 
   // Set uniform variables for the current model
-  abcg::glUniformMatrix4fv(modelMatrixLoc, 1, GL_FALSE, &m_modelMatrix[0][0]);
+  program.setUniform("modelMatrix", m_modelMatrix);
 
   auto const modelViewMatrix{glm::mat3(m_viewMatrix * m_modelMatrix)};
   auto const normalMatrix{glm::inverseTranspose(modelViewMatrix)};
-  abcg::glUniformMatrix3fv(normalMatrixLoc, 1, GL_FALSE, &normalMatrix[0][0]);
+  program.setUniform("normalMatrix", normalMatrix);
 
-  abcg::glUniform4fv(KaLoc, 1, &m_Ka.x);
-  abcg::glUniform4fv(KdLoc, 1, &m_Kd.x);
-  abcg::glUniform4fv(KsLoc, 1, &m_Ks.x);
-  abcg::glUniform1f(shininessLoc, m_shininess);
+  program.setUniform("Ka", m_Ka);
+  program.setUniform("Kd", m_Kd);
+  program.setUniform("Ks", m_Ks);
+  program.setUniform("shininess", m_shininess);
 
   m_model.render(m_trianglesToDraw);
 
@@ -133,6 +140,14 @@ void Window::onPaint() {
 }
 
 void Window::onUpdate() {
+  // Upload the next slice of the model being loaded, if any
+  if (m_modelLoader.update()) {
+    swapModel();
+  }
+
+  // Upload decoded textures and generate their mipmap levels
+  m_textureLoader.update();
+
   m_modelMatrix = m_trackBallModel.getRotation();
 
   m_viewMatrix =
@@ -155,13 +170,13 @@ void Window::onPaintUI() {
   // File browser for textures
   static ImGui::FileBrowser fileDialogDiffuseMap;
   fileDialogDiffuseMap.SetTitle("Load Diffuse Map");
-  fileDialogDiffuseMap.SetTypeFilters({".jpg", ".png"});
+  fileDialogDiffuseMap.SetTypeFilters({".jpg", ".png", ".ktx2", ".dds"});
   fileDialogDiffuseMap.SetWindowSize(scaledWidth, scaledHeight);
 
   // File browser for normal maps
   static ImGui::FileBrowser fileDialogNormalMap;
   fileDialogNormalMap.SetTitle("Load Normal Map");
-  fileDialogNormalMap.SetTypeFilters({".jpg", ".png"});
+  fileDialogNormalMap.SetTypeFilters({".jpg", ".png", ".ktx2", ".dds"});
   fileDialogNormalMap.SetWindowSize(scaledWidth, scaledHeight);
 
 #if defined(__EMSCRIPTEN__)
@@ -179,6 +194,10 @@ void Window::onPaintUI() {
       // Add extra space for static text
       widgetSize.y += 26;
     }
+    if (m_modelLoader.isLoading()) {
+      // Add extra space for progress bar
+      widgetSize.y += 26;
+    }
 
     ImGui::SetNextWindowPos(ImVec2(m_viewportSize.x - widgetSize.x - 5, 5));
     ImGui::SetNextWindowSize(widgetSize);
@@ -306,6 +325,11 @@ void Window::onPaintUI() {
       ImGui::TextColored(ImVec4(1, 1, 0, 1), "Mesh has no UV coords.");
     }
 
+    if (m_modelLoader.isLoading()) {
+      ImGui::ProgressBar(m_modelLoader.getProgress(), ImVec2(-1, 0),
+                         "Loading model...");
+    }
+
     // UV mapping box
     {
       std::vector<std::string> comboItems{"Triplanar", "Cylindrical",
@@ -372,14 +396,6 @@ void Window::onPaintUI() {
   if (fileDialogModel.HasSelected()) {
     loadModel(fileDialogModel.GetSelected().string());
     fileDialogModel.ClearSelected();
-
-    if (m_model.isUVMapped()) {
-      // Use mesh texture coordinates if available...
-      m_mappingMode = 3;
-    } else {
-      // ...or triplanar mapping otherwise
-      m_mappingMode = 0;
-    }
   }
 
   fileDialogDiffuseMap.Display();
@@ -402,8 +418,10 @@ void Window::onResize(glm::ivec2 const &size) {
 }
 
 void Window::onDestroy() {
+  m_modelLoader.destroy();
   m_model.destroy();
-  for (auto const &program : m_programs) {
-    abcg::glDeleteProgram(program);
+  m_textureLoader.destroy();
+  for (auto &program : m_programs) {
+    program.destroy();
   }
 }
\ No newline at end of file
@@ -3,6 +3,7 @@
 
 #include "abcgOpenGL.hpp"
 #include "model.hpp"
+#include "modelloader.hpp"
 #include "trackball.hpp"
 
 class Window : public abcg::OpenGLWindow {
@@ -19,6 +20,8 @@ private:
   glm::ivec2 m_viewportSize{};
 
   Model m_model;
+  ModelLoader m_modelLoader;
+  abcg::OpenGLTextureLoader m_textureLoader;
   int m_trianglesToDraw{};
 
   TrackBall m_trackBallModel;
@@ -33,7 +36,7 @@ private:
   std::vector<char const *> m_shaderNames{
       "normalmapping", "texture", "blinnphong", "phong",
       "gouraud",       "normal",  "depth"};
-  std::vector<GLuint> m_programs;
+  std::vector<abcg::OpenGLProgram> m_programs;
   int m_currentProgramIndex{};
 
   // Mapping mode
@@ -51,6 +54,7 @@ private:
   float m_shininess{};
 
   void loadModel(std::string_view path);
+  void swapModel();
 };
 
 #endif
\ No newline at end of file
@@ -0,0 +1,336 @@
+#include "bcencoder.hpp"
+
+#include <cppitertools/itertools.hpp>
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstring>
+
+#include "abcgException.hpp"
+
+namespace {
+
+using Color = std::array<float, 3>;
+// Texels of a 4x4 block in row-major order
+using Block = std::array<std::array<std::uint8_t, 4>, 16>;
+
+// Fraction of the first endpoint in each entry of the BC1 palette
+constexpr std::array<float, 4> bc1Weights{1.0f, 0.0f, 2.0f / 3.0f,
+                                          1.0f / 3.0f};
+
+struct BC1Fit {
+  std::uint16_t color0{};
+  std::uint16_t color1{};
+  std::uint32_t indices{};
+  float error{};
+};
+
+// Reads the block at (blockX, blockY). Texels outside the image are clamped
+// to the edge.
+Block fetchBlock(RGBAImage const &image, std::uint32_t blockX,
+                 std::uint32_t blockY) {
+  Block block{};
+  for (auto const index : iter::range(16U)) {
+    auto const x{std::min(blockX * 4 + index % 4, image.width - 1)};
+    auto const y{std::min(blockY * 4 + index / 4, image.height - 1)};
+    auto const offset{(std::size_t{y} * image.width + x) * 4};
+    std::memcpy(block.at(index).data(), &image.pixels.at(offset), 4);
+  }
+  return block;
+}
+
+std::uint16_t packRGB565(Color const &color) {
+  auto const quantize{[](float value, float maxValue) {
+    return static_cast<std::uint16_t>(
+        std::lround(std::clamp(value, 0.0f, 255.0f) * maxValue / 255.0f));
+  }};
+  return static_cast<std::uint16_t>(quantize(color[0], 31.0f) << 11 |
+                                    quantize(color[1], 63.0f) << 5 |
+                                    quantize(color[2], 31.0f));
+}
+
+Color unpackRGB565(std::uint16_t packed) {
+  auto const red{(packed >> 11) & 31};
+  auto const green{(packed >> 5) & 63};
+  auto const blue{packed & 31};
+  return {static_cast<float>(red << 3 | red >> 2),
+          static_cast<float>(green << 2 | green >> 4),
+          static_cast<float>(blue << 3 | blue >> 2)};
+}
+
+float distanceSquared(Color const &a, Color const &b) {
+  auto const dr{a[0] - b[0]};
+  auto const dg{a[1] - b[1]};
+  auto const db{a[2] - b[2]};
+  return dr * dr + dg * dg + db * db;
+}
+
+// Selects the nearest palette entry for each texel. The endpoints are sorted
+// so that the block is decoded in 4-color mode.
+BC1Fit fitIndices(std::array<Color, 16> const &texels, std::uint16_t color0,
+                  std::uint16_t color1) {
+  if (color0 < color1) {
+    std::swap(color0, color1);
+  }
+  BC1Fit fit{.color0 = color0, .color1 = color1};
+
+  auto const endpoint0{unpackRGB565(color0)};
+  auto const endpoint1{unpackRGB565(color1)};
+  std::array<Color, 4> palette{};
+  for (auto const index : iter::range(palette.size())) {
+    for (auto const channel : iter::range(3)) {
+      palette.at(index).at(channel) =
+          bc1Weights.at(index) * endpoint0.at(channel) +
+          (1.0f - bc1Weights.at(index)) * endpoint1.at(channel);
+    }
+  }
+  // With equal endpoints, the block would be decoded in 3-color mode, but
+  // index 0 still refers to the first endpoint
+  auto const numEntries{color0 == color1 ? 1U : 4U};
+
+  for (auto &&[texelIndex, texel] : iter::enumerate(texels)) {
+    auto bestIndex{0U};
+    auto bestError{distanceSquared(texel, palette[0])};
+    for (auto const index : iter::range(1U, numEntries)) {
+      if (auto const error{distanceSquared(texel, palette.at(index))};
+          error < bestError) {
+        bestIndex = index;
+        bestError = error;
+      }
+    }
+    fit.indices |= bestIndex << (2 * texelIndex);
+    fit.error += bestError;
+  }
+  return fit;
+}
+
+// Solves for the endpoints that minimize the squared error of the given
+// indices
+BC1Fit refitEndpoints(std::array<Color, 16> const &texels,
+                      BC1Fit const &fit) {
+  float aa{};
+  float bb{};
+  float ab{};
+  Color ax{};
+  Color bx{};
+  for (auto &&[texelIndex, texel] : iter::enumerate(texels)) {
+    auto const a{bc1Weights.at((fit.indices >> (2 * texelIndex)) & 3)};
+    auto const b{1.0f - a};
+    aa += a * a;
+    bb += b * b;
+    ab += a * b;
+    for (auto const channel : iter::range(3)) {
+      ax.at(channel) += a * texel.at(channel);
+      bx.at(channel) += b * texel.at(channel);
+    }
+  }
+
+  auto const determinant{aa * bb - ab * ab};
+  if (std::abs(determinant) < 1e-6f) {
+    return fit;
+  }
+
+  Color endpoint0{};
+  Color endpoint1{};
+  for (auto const channel : iter::range(3)) {
+    endpoint0.at(channel) =
+        (bb * ax.at(channel) - ab * bx.at(channel)) / determinant;
+    endpoint1.at(channel) =
+        (aa * bx.at(channel) - ab * ax.at(channel)) / determinant;
+  }
+  auto const refit{
+      fitIndices(texels, packRGB565(endpoint0), packRGB565(endpoint1))};
+  return refit.error < fit.error ? refit : fit;
+}
+
+// Fits the color endpoints to the principal axis of the texel colors, then
+// refines them by least squares
+void encodeBC1(Block const &block, std::byte *output) {
+  std::array<Color, 16> texels{};
+  Color mean{};
+  for (auto &&[texel, source] : iter::zip(texels, block)) {
+    for (auto const channel : iter::range(3)) {
+      texel.at(channel) = source.at(channel);
+      mean.at(channel) += texel.at(channel) / 16.0f;
+    }
+  }
+
+  // Covariance matrix of the colors
+  std::array<std::array<float, 3>, 3> covariance{};
+  for (auto const &texel : texels) {
+    for (auto const row : iter::range(3)) {
+      for (auto const column : iter::range(3)) {
+        covariance.at(row).at(column) +=
+            (texel.at(row) - mean.at(row)) *
+            (texel.at(column) - mean.at(column));
+      }
+    }
+  }
+
+  // Principal axis by power iteration
+  Color axis{1.0f, 1.0f, 1.0f};
+  for ([[maybe_unused]] auto const iteration : iter::range(8)) {
+    Color product{};
+    for (auto const row : iter::range(3)) {
+      for (auto const column : iter::range(3)) {
+        product.at(row) += covariance.at(row).at(column) * axis.at(column);
+      }
+    }
+    auto const length{std::sqrt(product[0] * product[0] +
+                                product[1] * product[1] +
+                                product[2] * product[2])};
+    if (length < 1e-6f) {
+      break;
+    }
+    for (auto const channel : iter::range(3)) {
+      axis.at(channel) = product.at(channel) / length;
+    }
+  }
+
+  auto minProjection{0.0f};
+  auto maxProjection{0.0f};
+  for (auto const &texel : texels) {
+    auto const projection{(texel[0] - mean[0]) * axis[0] +
+                          (texel[1] - mean[1]) * axis[1] +
+                          (texel[2] - mean[2]) * axis[2]};
+    minProjection = std::min(minProjection, projection);
+    maxProjection = std::max(maxProjection, projection);
+  }
+
+  // Inset the endpoints slightly, as the extreme texels are rarely the best
+  // endpoints after quantization
+  auto const inset{(maxProjection - minProjection) / 16.0f};
+  Color endpoint0{};
+  Color endpoint1{};
+  for (auto const channel : iter::range(3)) {
+    endpoint0.at(channel) =
+        mean.at(channel) + axis.at(channel) * (maxProjection - inset);
+    endpoint1.at(channel) =
+        mean.at(channel) + axis.at(channel) * (minProjection + inset);
+  }
+
+  auto const fit{refitEndpoints(
+      texels,
+      fitIndices(texels, packRGB565(endpoint0), packRGB565(endpoint1)))};
+
+  std::memcpy(output, &fit.color0, 2);
+  std::memcpy(output + 2, &fit.color1, 2);
+  std::memcpy(output + 4, &fit.indices, 4);
+}
+
+// Encodes one channel of a block with 8 interpolated values between the
+// minimum and maximum
+void encodeBC4(Block const &block, std::size_t channel, std::byte *output) {
+  std::array<int, 16> values{};
+  for (auto &&[value, texel] : iter::zip(values, block)) {
+    value = texel.at(channel);
+  }
+  auto const [minValue, maxValue]{std::ranges::minmax(values)};
+
+  std::uint64_t bits{static_cast<std::uint64_t>(maxValue) |
+                     static_cast<std::uint64_t>(minValue) << 8};
+  if (maxValue != minValue) {
+    std::array<int, 8> palette{maxValue, minValue};
+    for (auto const index : iter::range(2, 8)) {
+      palette.at(index) =
+          ((8 - index) * maxValue + (index - 1) * minValue + 3) / 7;
+    }
+
+    for (auto &&[texelIndex, value] : iter::enumerate(values)) {
+      std::uint64_t bestIndex{};
+      auto bestError{std::abs(value - palette[0])};
+      for (auto const index : iter::range(1, 8)) {
+        if (auto const error{std::abs(value - palette.at(index))};
+            error < bestError) {
+          bestIndex = static_cast<std::uint64_t>(index);
+          bestError = error;
+        }
+      }
+      bits |= bestIndex << (16 + 3 * texelIndex);
+    }
+  }
+  std::memcpy(output, &bits, 8);
+}
+
+} // namespace
+
+RGBAImage bcencoder::downsample(RGBAImage const &image, bool sRGB) {
+  static auto const toLinear{[] {
+    std::array<float, 256> table{};
+    for (auto &&[index, value] : iter::enumerate(table)) {
+      auto const color{static_cast<float>(index) / 255.0f};
+      value = color <= 0.04045f ? color / 12.92f
+                                : std::pow((color + 0.055f) / 1.055f, 2.4f);
+    }
+    return table;
+  }()};
+  auto const fromLinear{[](float value) {
+    value = value <= 0.0031308f
+                ? value * 12.92f
+                : 1.055f * std::pow(value, 1.0f / 2.4f) - 0.055f;
+    return std::clamp(value, 0.0f, 1.0f) * 255.0f;
+  }};
+
+  RGBAImage result{.width = std::max(image.width / 2, 1U),
+                   .height = std::max(image.height / 2, 1U),
+                   .pixels = {}};
+  result.pixels.resize(std::size_t{result.width} * result.height * 4);
+
+  for (auto const y : iter::range(result.height)) {
+    for (auto const x : iter::range(result.width)) {
+      for (auto const channel : iter::range(4U)) {
+        auto const isLinearized{sRGB && channel < 3};
+        auto sum{0.0f};
+        for (auto const &[dx, dy] : {std::pair{0U, 0U}, std::pair{1U, 0U},
+                                    std::pair{0U, 1U}, std::pair{1U, 1U}}) {
+          auto const sourceX{std::min(x * 2 + dx, image.width - 1)};
+          auto const sourceY{std::min(y * 2 + dy, image.height - 1)};
+          auto const value{image.pixels.at(
+              (std::size_t{sourceY} * image.width + sourceX) * 4 + channel)};
+          sum += isLinearized ? toLinear.at(value) : value;
+        }
+        auto const average{sum / 4.0f};
+        result.pixels.at((std::size_t{y} * result.width + x) * 4 + channel) =
+            static_cast<std::uint8_t>(
+                std::lround(isLinearized ? fromLinear(average) : average));
+      }
+    }
+  }
+
+  return result;
+}
+
+std::vector<std::byte> bcencoder::encode(RGBAImage const &image,
+                                         abcg::CompressedFormat format) {
+  if (format == abcg::CompressedFormat::BC7) {
+    throw abcg::RuntimeError("BC7 encoding is not supported");
+  }
+
+  std::vector<std::byte> data(
+      abcg::CompressedImage::getLevelSize(format, image.width, image.height));
+  auto *output{data.data()};
+  for (auto const blockY : iter::range((image.height + 3) / 4)) {
+    for (auto const blockX : iter::range((image.width + 3) / 4)) {
+      auto const block{fetchBlock(image, blockX, blockY)};
+      switch (format) {
+      case abcg::CompressedFormat::BC1:
+        encodeBC1(block, output);
+        break;
+      case abcg::CompressedFormat::BC3:
+        encodeBC4(block, 3, output);
+        encodeBC1(block, output + 8);
+        break;
+      case abcg::CompressedFormat::BC5:
+        encodeBC4(block, 0, output);
+        encodeBC4(block, 1, output + 8);
+        break;
+      default:
+        break;
+      }
+      output += abcg::CompressedImage::getBlockSize(format);
+    }
+  }
+
+  return data;
+}
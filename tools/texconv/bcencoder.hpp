@@ -0,0 +1,29 @@
+#ifndef BCENCODER_HPP_
+#define BCENCODER_HPP_
+
+#include <cstdint>
+#include <vector>
+
+#include "abcgCompressedImage.hpp"
+
+// 8-bit RGBA image with rows stored from top to bottom
+struct RGBAImage {
+  std::uint32_t width{};
+  std::uint32_t height{};
+  std::vector<std::uint8_t> pixels; // 4 bytes per pixel
+};
+
+namespace bcencoder {
+
+// Returns the next mipmap level, computed with a 2x2 box filter. If sRGB is
+// true, the color channels are averaged in linear space.
+[[nodiscard]] RGBAImage downsample(RGBAImage const &image, bool sRGB);
+
+// Compresses an image to BC1, BC3 or BC5. BC5 stores the red and green
+// channels only.
+[[nodiscard]] std::vector<std::byte> encode(RGBAImage const &image,
+                                            abcg::CompressedFormat format);
+
+} // namespace bcencoder
+
+#endif
@@ -0,0 +1,147 @@
+// Offline converter of PNG/JPEG images to block-compressed KTX2 textures that
+// can be loaded with abcg::loadOpenGLTexture and abcg::VulkanImage::create.
+//
+// Usage: texconv [options] <input image> <output.ktx2>
+//
+// Options:
+//   --format bc1|bc3|bc5  Block format. The default is BC3 if the image has
+//                         transparent pixels, and BC1 otherwise.
+//   --srgb                Tag the texture as sRGB and build mipmaps in linear
+//                         space. Use it for color maps. The loaders do not
+//                         read the tag, and sample the texture in the color
+//                         space they use for uncompressed images.
+//   --flip-y              Flip the image upside down, as done at load time by
+//                         abcg::OpenGLTextureCreateInfo::flipUpsideDown.
+//   --no-mipmaps          Store only the base level.
+
+#define SDL_MAIN_HANDLED
+
+#include <cppitertools/itertools.hpp>
+#include <fmt/core.h>
+#include <gsl/gsl>
+
+#include <exception>
+#include <optional>
+#include <string_view>
+
+#include "abcgException.hpp"
+#include "abcgImage.hpp"
+#include "bcencoder.hpp"
+
+namespace {
+
+struct Options {
+  std::string_view inputPath;
+  std::string_view outputPath;
+  std::optional<abcg::CompressedFormat> format;
+  bool sRGB{};
+  bool flipUpsideDown{};
+  bool generateMipmaps{true};
+};
+
+std::optional<Options> parseOptions(std::span<char *> args) {
+  Options options;
+  for (auto it{args.begin() + 1}; it != args.end(); ++it) {
+    std::string_view const arg{*it};
+    if (arg == "--format" && std::next(it) != args.end()) {
+      std::string_view const format{*++it};
+      if (format == "bc1") {
+        options.format = abcg::CompressedFormat::BC1;
+      } else if (format == "bc3") {
+        options.format = abcg::CompressedFormat::BC3;
+      } else if (format == "bc5") {
+        options.format = abcg::CompressedFormat::BC5;
+      } else {
+        return std::nullopt;
+      }
+    } else if (arg == "--srgb") {
+      options.sRGB = true;
+    } else if (arg == "--flip-y") {
+      options.flipUpsideDown = true;
+    } else if (arg == "--no-mipmaps") {
+      options.generateMipmaps = false;
+    } else if (options.inputPath.empty()) {
+      options.inputPath = arg;
+    } else if (options.outputPath.empty()) {
+      options.outputPath = arg;
+    } else {
+      return std::nullopt;
+    }
+  }
+  if (options.outputPath.empty()) {
+    return std::nullopt;
+  }
+  return options;
+}
+
+RGBAImage loadImage(std::string_view path, bool flipUpsideDown) {
+  SDL_Surface *const surface{IMG_Load(path.data())};
+  if (surface == nullptr) {
+    throw abcg::RuntimeError(fmt::format("Failed to load image {}", path));
+  }
+  auto const freeSurface{gsl::finally([&] { SDL_FreeSurface(surface); })};
+
+  RGBAImage image{.width = gsl::narrow<std::uint32_t>(surface->w),
+                  .height = gsl::narrow<std::uint32_t>(surface->h),
+                  .pixels = {}};
+  image.pixels.resize(std::size_t{image.width} * image.height * 4);
+  if (!abcg::convertPixels(*surface, SDL_PIXELFORMAT_RGBA32,
+                           std::as_writable_bytes(std::span{image.pixels}), 0,
+                           flipUpsideDown)) {
+    throw abcg::RuntimeError(fmt::format("Failed to convert image {}", path));
+  }
+  return image;
+}
+
+bool hasTransparency(RGBAImage const &image) {
+  for (std::size_t index{3}; index < image.pixels.size(); index += 4) {
+    if (image.pixels[index] != 255) {
+      return true;
+    }
+  }
+  return false;
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+  auto const options{parseOptions({argv, gsl::narrow<std::size_t>(argc)})};
+  if (!options) {
+    fmt::print(stderr, "Usage: texconv [--format bc1|bc3|bc5] [--srgb] "
+                       "[--flip-y] [--no-mipmaps] <input> <output.ktx2>\n");
+    return 1;
+  }
+
+  try {
+    auto image{loadImage(options->inputPath, options->flipUpsideDown)};
+    auto const format{options->format.value_or(
+        hasTransparency(image) ? abcg::CompressedFormat::BC3
+                               : abcg::CompressedFormat::BC1)};
+
+    std::vector<std::vector<std::byte>> levelData;
+    std::vector<abcg::CompressedImageLevel> levels;
+    while (true) {
+      levelData.push_back(bcencoder::encode(image, format));
+      levels.push_back({.width = image.width, .height = image.height});
+      if (!options->generateMipmaps ||
+          (image.width == 1 && image.height == 1)) {
+        break;
+      }
+      image = bcencoder::downsample(image, options->sRGB);
+    }
+    for (auto &&[level, data] : iter::zip(levels, levelData)) {
+      level.data = data;
+    }
+
+    abcg::CompressedImage::saveKTX2(options->outputPath, format,
+                                    options->sRGB, levels);
+    fmt::print("{} -> {} ({}x{}, {} levels)\n", options->inputPath,
+               options->outputPath, levels.front().width,
+               levels.front().height, levels.size());
+  } catch (std::exception const &exception) {
+    fmt::print(stderr, "{}\n", exception.what());
+    return 1;
+  }
+
+  return 0;
+}